@@ -0,0 +1,271 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+  Reference server for the OpenOCD dap_direct interface driver: the
+  simulated DAP and Cortex-M3 of dap_sim.c, driven by DP/AP register
+  transactions instead of JTAG scans.  The wire protocol is described
+  in src/jtag/drivers/dap_direct.c.
+
+  DP register 0 reads as the IDCODE of an SW-DP and writes to it go to
+  ABORT.  An AP access fails while a sticky error flag is set, and a
+  batch stops at the first failing access.
+
+  To compile run:
+  gcc -Wall -std=gnu99 -O2 -o dap_direct_dap_sim dap_direct_dap_sim.c dap_sim.c
+
+  Usage example:
+
+  ./dap_direct_dap_sim -p 7778
+
+  or through socat:
+  socat TCP-LISTEN:7778,reuseaddr EXEC:./dap_direct_dap_sim
+
+  then run:
+  openocd -c "interface dap_direct; dap_direct_host localhost; dap_direct_port 7778" \
+	  -c "transport select dap_direct" -f contrib/dap_sim/dap_sim.cfg
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "dap_sim.h"
+
+#define LOG_ERROR(...)		do {					\
+		fprintf(stderr, __VA_ARGS__);				\
+		fputc('\n', stderr);					\
+	} while (0)
+
+#define SW_DP_IDCODE	0x2BA01477
+
+#define CMD_AP			(1 << 0)
+#define CMD_READ		(1 << 1)
+#define CMD_A32(cmd)	((cmd) & 0x0C)
+
+#define STATUS_OK		0
+#define STATUS_FAULT	1
+
+static unsigned long batches;
+static unsigned long records;
+
+static int read_bytes(FILE *in, uint8_t *buf, size_t len)
+{
+	return fread(buf, 1, len, in) == len ? 0 : -1;
+}
+
+static void put_u16(FILE *out, unsigned value)
+{
+	fputc(value & 0xFF, out);
+	fputc((value >> 8) & 0xFF, out);
+}
+
+static void put_u32(FILE *out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		fputc((value >> (8 * i)) & 0xFF, out);
+}
+
+static int transaction(uint8_t cmd, uint32_t data, uint32_t *result)
+{
+	unsigned reg = CMD_A32(cmd);
+
+	if (cmd & CMD_AP) {
+		if (dap_sim_sticky_error())
+			return -1;
+		if (cmd & CMD_READ)
+			*result = dap_sim_ap_read(reg);
+		else
+			dap_sim_ap_write(reg, data);
+		return dap_sim_sticky_error() ? -1 : 0;
+	}
+
+	if (reg == 0) {
+		if (cmd & CMD_READ)
+			*result = SW_DP_IDCODE;
+		else
+			dap_sim_abort(data);
+	} else if (cmd & CMD_READ) {
+		*result = dap_sim_dp_read(reg);
+	} else {
+		dap_sim_dp_write(reg, data);
+	}
+	return 0;
+}
+
+static int process_batch(FILE *in, FILE *out)
+{
+	static uint32_t results[65536];
+	uint8_t hdr[2];
+	unsigned reads = 0;
+	unsigned done = 0;
+	int status = STATUS_OK;
+
+	if (read_bytes(in, hdr, 2) < 0)
+		return -1;
+	unsigned count = hdr[0] | (hdr[1] << 8);
+
+	/* the whole batch is read even if an access fails on the way */
+	for (unsigned i = 0; i < count; i++) {
+		uint8_t buf[4];
+		uint32_t data = 0;
+		int cmd = fgetc(in);
+
+		if (cmd == EOF)
+			return -1;
+		if (!(cmd & CMD_READ)) {
+			if (read_bytes(in, buf, 4) < 0)
+				return -1;
+			data = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+		}
+
+		if (status != STATUS_OK)
+			continue;
+
+		uint32_t result = 0;
+		done++;
+		if (transaction(cmd, data, &result) < 0)
+			status = STATUS_FAULT;
+		if (cmd & CMD_READ)
+			results[reads++] = result;
+	}
+
+	batches++;
+	records += count;
+
+	fputc(status, out);
+	put_u16(out, done);
+	for (unsigned i = 0; i < reads; i++)
+		put_u32(out, results[i]);
+	fflush(out);
+	return 0;
+}
+
+static void process_protocol(FILE *in, FILE *out)
+{
+	int c;
+
+	while ((c = fgetc(in)) != EOF) {
+		switch (c) {
+		case 'T':
+			if (process_batch(in, out) < 0)
+				return;
+			break;
+		case 'S':
+			c = fgetc(in);
+			if (c == EOF)
+				return;
+			dap_sim_srst(c != 0);
+			fputc(STATUS_OK, out);
+			fflush(out);
+			break;
+		case 'Q':
+			return;
+		default:
+			LOG_ERROR("unknown command 0x%02x", c);
+			return;
+		}
+	}
+}
+
+static void print_stats(void)
+{
+	fprintf(stderr, "batches %lu, transactions %lu\n", batches, records);
+	dap_sim_print_stats(stderr);
+}
+
+static int serve_port(int port)
+{
+	struct sockaddr_in addr;
+	int one = 1;
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (listener < 0) {
+		LOG_ERROR("socket: %s", strerror(errno));
+		return 1;
+	}
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0
+			|| listen(listener, 1) < 0) {
+		LOG_ERROR("cannot listen on port %d: %s", port, strerror(errno));
+		close(listener);
+		return 1;
+	}
+
+	/* the simulated target keeps its state across connections */
+	for (;;) {
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG_ERROR("accept: %s", strerror(errno));
+			break;
+		}
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		FILE *in = fdopen(fd, "r");
+		FILE *out = fdopen(dup(fd), "w");
+		if (!in || !out) {
+			LOG_ERROR("fdopen: %s", strerror(errno));
+			break;
+		}
+		process_protocol(in, out);
+		fclose(in);
+		fclose(out);
+		print_stats();
+	}
+
+	close(listener);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int port = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:")) != -1) {
+		switch (opt) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		default:
+			LOG_ERROR("usage: %s [-p port]", argv[0]);
+			return 1;
+		}
+	}
+
+	dap_sim_init();
+
+	if (port)
+		return serve_port(port);
+
+	process_protocol(stdin, stdout);
+	print_stats();
+	return 0;
+}
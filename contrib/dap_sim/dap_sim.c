@@ -0,0 +1,710 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+  ADIv5 DAP and Cortex-M debug model, see dap_sim.h.
+
+  Memory map:
+    0x00000000 - 0x0003ffff  "flash", 256kB, plain read/write memory
+    0x20000000 - 0x2000ffff  SRAM, 64kB
+    0xe0000000 - 0xe00fffff  private peripheral bus: SCS (CPUID, AIRCR,
+                             DFSR, DHCSR, DCRSR, DCRDR, DEMCR), DWT with
+                             4 comparators, FPB v1 with 6 code and 2
+                             literal comparators, ROM table
+
+  The core does not execute instructions.  A running core walks its PC
+  linearly through memory, 2 or 4 bytes per Thumb instruction, until it
+  reaches a BKPT instruction or an enabled FPB comparator, and locks up
+  when it leaves memory.  That is enough for halt/resume/step, software
+  and hardware breakpoints and the exit breakpoint of target algorithms,
+  but an algorithm "completes" without having any effect.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dap_sim.h"
+
+/* DP CTRL/STAT */
+#define CORUNDETECT		(1u << 0)
+#define SSTICKYORUN		(1u << 1)
+#define SSTICKYCMP		(1u << 4)
+#define SSTICKYERR		(1u << 5)
+#define WDATAERR		(1u << 7)
+#define CDBGRSTREQ		(1u << 26)
+#define CDBGRSTACK		(1u << 27)
+#define CDBGPWRUPREQ	(1u << 28)
+#define CDBGPWRUPACK	(1u << 29)
+#define CSYSPWRUPREQ	(1u << 30)
+#define CSYSPWRUPACK	(1u << 31)
+
+/* DP ABORT */
+#define DAPABORT		(1u << 0)
+#define STKCMPCLR		(1u << 1)
+#define STKERRCLR		(1u << 2)
+#define WDERRCLR		(1u << 3)
+#define ORUNERRCLR		(1u << 4)
+
+/* MEM-AP registers */
+#define AP_REG_CSW		0x00
+#define AP_REG_TAR		0x04
+#define AP_REG_DRW		0x0C
+#define AP_REG_BD0		0x10
+#define AP_REG_BD3		0x1C
+#define AP_REG_CFG		0xF4
+#define AP_REG_BASE		0xF8
+#define AP_REG_IDR		0xFC
+
+#define CSW_SIZE_MASK		7u
+#define CSW_ADDRINC_MASK	(3u << 4)
+#define CSW_ADDRINC_OFF		(0u << 4)
+#define CSW_ADDRINC_SINGLE	(1u << 4)
+#define CSW_ADDRINC_PACKED	(2u << 4)
+#define CSW_DEVICE_EN		(1u << 6)
+
+#define AHB_AP_IDR		0x24770011
+#define ROM_TABLE_BASE	0xE00FF000
+
+/* system control space and debug components */
+#define CPUID		0xE000ED00
+#define NVIC_AIRCR	0xE000ED0C
+#define NVIC_DFSR	0xE000ED30
+#define DCB_DHCSR	0xE000EDF0
+#define DCB_DCRSR	0xE000EDF4
+#define DCB_DCRDR	0xE000EDF8
+#define DCB_DEMCR	0xE000EDFC
+#define DWT_CTRL	0xE0001000
+#define FP_CTRL		0xE0002000
+#define FP_COMP0	0xE0002008
+
+#define CORTEX_M3_CPUID	0x412FC231
+#define DWT_NUM_COMP	4
+#define FP_NUM_CODE		6
+#define FP_NUM_LIT		2
+
+#define DBGKEY		0xA05F0000
+#define C_DEBUGEN	(1u << 0)
+#define C_HALT		(1u << 1)
+#define C_STEP		(1u << 2)
+#define C_MASKINTS	(1u << 3)
+#define C_SNAPSTALL	(1u << 5)
+#define S_REGRDY	(1u << 16)
+#define S_HALT		(1u << 17)
+#define S_LOCKUP	(1u << 19)
+#define S_RETIRE_ST	(1u << 24)
+#define S_RESET_ST	(1u << 25)
+
+#define DCRSR_WnR	(1u << 16)
+
+#define VC_CORERESET	(1u << 0)
+
+#define AIRCR_VECTKEY		0x05FA0000
+#define AIRCR_VECTKEYSTAT	0xFA050000
+#define AIRCR_SYSRESETREQ	(1u << 2)
+#define AIRCR_VECTRESET		(1u << 0)
+
+#define DFSR_HALTED		1
+#define DFSR_BKPT		2
+#define DFSR_VCATCH		8
+
+/* core register selectors, as used in DCRSR */
+#define REG_SP		13
+#define REG_PC		15
+#define REG_XPSR	16
+#define REG_MSP		17
+#define REG_PSP		18
+#define REG_SPECIAL	20		/* CONTROL, FAULTMASK, BASEPRI, PRIMASK */
+#define NUM_REGS	21
+
+/* instructions a running core walks through per tick */
+#define STEPS_PER_TICK	64
+
+struct mem_region {
+	uint32_t base;
+	uint32_t size;
+	uint8_t *data;
+};
+
+static struct mem_region regions[] = {
+	{ 0x00000000, 256 * 1024, NULL },
+	{ 0x20000000, 64 * 1024, NULL },
+	{ 0xE0000000, 1024 * 1024, NULL },	/* PPB backing store */
+};
+
+#define NUM_REGIONS	(sizeof(regions) / sizeof(regions[0]))
+#define PPB_REGION	2
+
+struct dap_sim_stats dap_sim_stats;
+
+static struct {
+	uint32_t ctrl_stat;
+	uint32_t select;
+	uint32_t rdbuff;
+} dp;
+
+static struct {
+	uint32_t csw;
+	uint32_t tar;
+} ap;
+
+static struct {
+	uint32_t regs[NUM_REGS];
+	uint32_t dcrdr;
+	uint32_t dhcsr;			/* C_* control bits */
+	uint32_t demcr;
+	uint32_t dfsr;
+	int halted;
+	int lockup;
+	int in_reset;
+	int retired;			/* S_RETIRE_ST, cleared on read */
+	int was_reset;			/* S_RESET_ST, cleared on read */
+} core;
+
+static struct mem_region *find_region(uint32_t address)
+{
+	for (unsigned i = 0; i < NUM_REGIONS; i++) {
+		if (address - regions[i].base < regions[i].size)
+			return &regions[i];
+	}
+	return NULL;
+}
+
+static uint32_t raw_read_u32(struct mem_region *r, uint32_t address)
+{
+	uint8_t *p = r->data + ((address - r->base) & ~3u);
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void raw_write_u32(struct mem_region *r, uint32_t address, uint32_t value)
+{
+	uint8_t *p = r->data + ((address - r->base) & ~3u);
+	p[0] = value;
+	p[1] = value >> 8;
+	p[2] = value >> 16;
+	p[3] = value >> 24;
+}
+
+static int is_code_address(uint32_t address)
+{
+	struct mem_region *r = find_region(address);
+	return r && r != &regions[PPB_REGION] && address - r->base + 4 <= r->size;
+}
+
+static uint16_t fetch_u16(uint32_t address)
+{
+	struct mem_region *r = find_region(address);
+	uint8_t *p = r->data + (address - r->base);
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t core_reg_read(unsigned sel)
+{
+	if (sel == REG_SP)
+		sel = REG_MSP;
+	return sel < NUM_REGS ? core.regs[sel] : 0;
+}
+
+static void core_reg_write(unsigned sel, uint32_t value)
+{
+	if (sel == REG_SP)
+		sel = REG_MSP;
+	if (sel < NUM_REGS)
+		core.regs[sel] = value;
+}
+
+static void core_halt(uint32_t reason)
+{
+	if (!core.halted)
+		dap_sim_stats.halts++;
+	core.halted = 1;
+	core.lockup = 0;		/* entering debug state leaves lockup */
+	core.dfsr |= reason;
+}
+
+/* reset the core like a SYSRESETREQ; the debug domain is left alone */
+static void core_reset(void)
+{
+	struct mem_region *flash = &regions[0];
+
+	memset(core.regs, 0, sizeof(core.regs));
+	core.regs[REG_MSP] = raw_read_u32(flash, 0) & ~3u;
+	core.regs[REG_PC] = raw_read_u32(flash, 4) & ~1u;
+	core.regs[REG_XPSR] = 0x01000000;
+	core.halted = 0;
+	core.lockup = 0;
+	core.was_reset = 1;
+
+	if ((core.dhcsr & C_DEBUGEN) && (core.demcr & VC_CORERESET))
+		core_halt(DFSR_VCATCH);
+	else if ((core.dhcsr & (C_DEBUGEN | C_HALT)) == (C_DEBUGEN | C_HALT))
+		core_halt(DFSR_HALTED);
+}
+
+static int fpb_match(uint32_t pc)
+{
+	struct mem_region *ppb = &regions[PPB_REGION];
+
+	if (!(raw_read_u32(ppb, FP_CTRL) & 1))
+		return 0;
+
+	for (unsigned i = 0; i < FP_NUM_CODE; i++) {
+		uint32_t comp = raw_read_u32(ppb, FP_COMP0 + 4 * i);
+		if (!(comp & 1))
+			continue;
+		/* FPB v1: COMP holds bits [28:2], REPLACE selects the halfword */
+		uint32_t match = comp & 0x1FFFFFFC;
+		if ((comp >> 30) == 2)
+			match += 2;
+		if ((comp >> 30) != 0 && match == pc)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Advance the PC past one instruction.  Returns 0 if the core stopped
+ * (breakpoint or lockup) before the instruction retired.
+ */
+static int core_step(int check_breakpoints)
+{
+	uint32_t pc = core.regs[REG_PC];
+
+	if (!is_code_address(pc)) {
+		core.lockup = 1;
+		return 0;
+	}
+
+	uint16_t insn = fetch_u16(pc);
+	if (check_breakpoints && ((insn & 0xFF00) == 0xBE00 || fpb_match(pc))) {
+		core_halt(DFSR_BKPT);
+		return 0;
+	}
+
+	/* 32-bit Thumb-2 encodings start with 0b11101, 0b11110 or 0b11111 */
+	core.regs[REG_PC] = pc + ((insn >> 11) >= 0x1D ? 4 : 2);
+	core.retired = 1;
+	return 1;
+}
+
+void dap_sim_tick(void)
+{
+	if (core.halted || core.lockup || core.in_reset)
+		return;
+
+	for (int i = 0; i < STEPS_PER_TICK; i++) {
+		if (!core_step(core.dhcsr & C_DEBUGEN))
+			break;
+	}
+}
+
+static void dhcsr_write(uint32_t value)
+{
+	if ((value & 0xFFFF0000) != DBGKEY)
+		return;
+
+	core.dhcsr = value & (C_DEBUGEN | C_HALT | C_STEP | C_MASKINTS | C_SNAPSTALL);
+
+	if (!(core.dhcsr & C_DEBUGEN)) {
+		core.halted = 0;
+		return;
+	}
+
+	if (core.dhcsr & C_HALT) {
+		if (!core.halted && !core.in_reset)
+			core_halt(DFSR_HALTED);
+		return;
+	}
+
+	if (!core.halted)
+		return;
+
+	if (core.dhcsr & C_STEP) {
+		/* a breakpoint at the PC is taken instead of stepping over it */
+		if (core_step(1))
+			core.dfsr |= DFSR_HALTED;
+		return;
+	}
+
+	core.halted = 0;
+}
+
+static uint32_t dhcsr_read(void)
+{
+	uint32_t value = core.dhcsr | S_REGRDY;
+
+	if (core.halted)
+		value |= S_HALT;
+	if (core.lockup)
+		value |= S_LOCKUP;
+	if (core.retired)
+		value |= S_RETIRE_ST;
+	if (core.was_reset || core.in_reset)
+		value |= S_RESET_ST;
+
+	core.retired = 0;
+	core.was_reset = 0;
+	return value;
+}
+
+/* word access to the private peripheral bus */
+static uint32_t ppb_read(uint32_t address)
+{
+	struct mem_region *ppb = &regions[PPB_REGION];
+
+	switch (address) {
+	case NVIC_AIRCR:
+		return AIRCR_VECTKEYSTAT;
+	case NVIC_DFSR:
+		return core.dfsr;
+	case DCB_DHCSR:
+		return dhcsr_read();
+	case DCB_DCRSR:
+		return 0;
+	case DCB_DCRDR:
+		return core.dcrdr;
+	case DCB_DEMCR:
+		return core.demcr;
+	}
+	return raw_read_u32(ppb, address);
+}
+
+static void ppb_write(uint32_t address, uint32_t value)
+{
+	struct mem_region *ppb = &regions[PPB_REGION];
+
+	switch (address) {
+	case CPUID:
+		return;
+	case NVIC_AIRCR:
+		if ((value & 0xFFFF0000) == AIRCR_VECTKEY
+				&& (value & (AIRCR_SYSRESETREQ | AIRCR_VECTRESET)))
+			core_reset();
+		return;
+	case NVIC_DFSR:
+		core.dfsr &= ~value;
+		return;
+	case DCB_DHCSR:
+		dhcsr_write(value);
+		return;
+	case DCB_DCRSR:
+		if (!core.halted)
+			return;
+		if (value & DCRSR_WnR)
+			core_reg_write(value & 0x7F, core.dcrdr);
+		else
+			core.dcrdr = core_reg_read(value & 0x7F);
+		return;
+	case DCB_DCRDR:
+		core.dcrdr = value;
+		return;
+	case DCB_DEMCR:
+		core.demcr = value;
+		return;
+	case DWT_CTRL:
+		/* NUMCOMP is read-only */
+		value = (value & 0x0FFFFFFF) | (DWT_NUM_COMP << 28);
+		break;
+	case FP_CTRL:
+		/* only ENABLE is writable, and only together with KEY */
+		if (!(value & 2))
+			return;
+		value = (raw_read_u32(ppb, FP_CTRL) & ~1u) | (value & 1);
+		break;
+	}
+	raw_write_u32(ppb, address, value);
+}
+
+/* bus access of @a size bytes (1, 2 or 4); data is on its byte lanes */
+static uint32_t bus_read(uint32_t address, unsigned size)
+{
+	struct mem_region *r = find_region(address);
+	uint32_t word;
+
+	dap_sim_stats.mem_reads++;
+	if (!r || (address & (size - 1))) {
+		dp.ctrl_stat |= SSTICKYERR;
+		return 0;
+	}
+
+	if (r == &regions[PPB_REGION])
+		word = ppb_read(address & ~3u);
+	else
+		word = raw_read_u32(r, address);
+
+	return word;
+}
+
+static void bus_write(uint32_t address, unsigned size, uint32_t lanes)
+{
+	struct mem_region *r = find_region(address);
+
+	dap_sim_stats.mem_writes++;
+	if (!r || (address & (size - 1))) {
+		dp.ctrl_stat |= SSTICKYERR;
+		return;
+	}
+
+	if (r == &regions[PPB_REGION]) {
+		uint32_t word = lanes;
+		if (size < 4) {
+			uint32_t mask = (size == 1 ? 0xFFu : 0xFFFFu) << (8 * (address & 3));
+			word = (raw_read_u32(r, address) & ~mask) | (lanes & mask);
+		}
+		ppb_write(address & ~3u, word);
+		return;
+	}
+
+	for (unsigned i = 0; i < size; i++) {
+		unsigned lane = (address + i) & 3;
+		r->data[address + i - r->base] = lanes >> (8 * lane);
+	}
+}
+
+/* the TAR auto-increment only wraps within a 1kB block */
+static void tar_increment(unsigned n)
+{
+	ap.tar = (ap.tar & ~0x3FFu) | ((ap.tar + n) & 0x3FFu);
+}
+
+static uint32_t drw_access(int write, uint32_t value)
+{
+	unsigned size = 1u << (ap.csw & CSW_SIZE_MASK);
+	uint32_t inc = ap.csw & CSW_ADDRINC_MASK;
+	uint32_t result = 0;
+
+	if (size > 4) {
+		dp.ctrl_stat |= SSTICKYERR;
+		return 0;
+	}
+
+	/* a packed transfer does 4 / size accesses on successive lanes */
+	unsigned count = (inc == CSW_ADDRINC_PACKED) ? 4 / size : 1;
+	for (unsigned i = 0; i < count; i++) {
+		uint32_t lane_mask = (size == 4) ? 0xFFFFFFFF
+				: (((1u << (8 * size)) - 1) << (8 * (ap.tar & 3)));
+		if (write)
+			bus_write(ap.tar, size, value);
+		else
+			result |= bus_read(ap.tar, size) & lane_mask;
+		if (inc != CSW_ADDRINC_OFF)
+			tar_increment(size);
+	}
+	return result;
+}
+
+uint32_t dap_sim_ap_read(unsigned reg)
+{
+	uint32_t value = 0;
+
+	dap_sim_stats.ap_reads++;
+
+	/* there is only AP #0 */
+	if ((dp.select >> 24) != 0)
+		goto done;
+
+	reg |= dp.select & 0xF0;
+	switch (reg) {
+	case AP_REG_CSW:
+		value = ap.csw | CSW_DEVICE_EN;
+		break;
+	case AP_REG_TAR:
+		value = ap.tar;
+		break;
+	case AP_REG_DRW:
+		value = drw_access(0, 0);
+		break;
+	case AP_REG_CFG:
+		value = 0;	/* little endian */
+		break;
+	case AP_REG_BASE:
+		value = ROM_TABLE_BASE | 3;
+		break;
+	case AP_REG_IDR:
+		value = AHB_AP_IDR;
+		break;
+	default:
+		if (reg >= AP_REG_BD0 && reg <= AP_REG_BD3)
+			value = bus_read((ap.tar & ~0xFu) | (reg & 0xC), 4);
+		break;
+	}
+
+done:
+	dp.rdbuff = value;
+	dap_sim_tick();
+	return value;
+}
+
+void dap_sim_ap_write(unsigned reg, uint32_t value)
+{
+	dap_sim_stats.ap_writes++;
+
+	if ((dp.select >> 24) != 0)
+		goto done;
+
+	reg |= dp.select & 0xF0;
+	switch (reg) {
+	case AP_REG_CSW:
+		ap.csw = value & ~(CSW_DEVICE_EN | (1u << 7));
+		break;
+	case AP_REG_TAR:
+		ap.tar = value;
+		break;
+	case AP_REG_DRW:
+		drw_access(1, value);
+		break;
+	default:
+		if (reg >= AP_REG_BD0 && reg <= AP_REG_BD3)
+			bus_write((ap.tar & ~0xFu) | (reg & 0xC), 4, value);
+		break;
+	}
+
+done:
+	dap_sim_tick();
+}
+
+uint32_t dap_sim_dp_read(unsigned reg)
+{
+	uint32_t value = 0;
+
+	dap_sim_stats.dp_reads++;
+	switch (reg) {
+	case DAP_SIM_DP_CTRL_STAT:
+		value = dp.ctrl_stat;
+		if (value & CDBGPWRUPREQ)
+			value |= CDBGPWRUPACK;
+		if (value & CSYSPWRUPREQ)
+			value |= CSYSPWRUPACK;
+		if (value & CDBGRSTREQ)
+			value |= CDBGRSTACK;
+		break;
+	case DAP_SIM_DP_SELECT:
+		value = dp.select;
+		break;
+	case DAP_SIM_DP_RDBUFF:
+		value = dp.rdbuff;
+		break;
+	}
+	dap_sim_tick();
+	return value;
+}
+
+void dap_sim_dp_write(unsigned reg, uint32_t value)
+{
+	const uint32_t sticky = SSTICKYORUN | SSTICKYCMP | SSTICKYERR | WDATAERR;
+
+	dap_sim_stats.dp_writes++;
+	switch (reg) {
+	case DAP_SIM_DP_CTRL_STAT:
+		/* on a JTAG-DP the sticky flags are cleared by writing 1 */
+		dp.ctrl_stat &= ~(value & sticky);
+		dp.ctrl_stat = (dp.ctrl_stat & sticky)
+				| (value & (CORUNDETECT | CDBGRSTREQ | CDBGPWRUPREQ | CSYSPWRUPREQ));
+		break;
+	case DAP_SIM_DP_SELECT:
+		dp.select = value;
+		break;
+	}
+	dap_sim_tick();
+}
+
+void dap_sim_abort(uint32_t value)
+{
+	if (value & STKCMPCLR)
+		dp.ctrl_stat &= ~SSTICKYCMP;
+	if (value & STKERRCLR)
+		dp.ctrl_stat &= ~SSTICKYERR;
+	if (value & WDERRCLR)
+		dp.ctrl_stat &= ~WDATAERR;
+	if (value & ORUNERRCLR)
+		dp.ctrl_stat &= ~SSTICKYORUN;
+	/* DAPABORT: nothing is ever left in progress */
+}
+
+int dap_sim_sticky_error(void)
+{
+	return (dp.ctrl_stat & (SSTICKYORUN | SSTICKYERR | WDATAERR)) != 0;
+}
+
+void dap_sim_srst(int asserted)
+{
+	if (asserted) {
+		core.in_reset = 1;
+		core.halted = 0;
+	} else if (core.in_reset) {
+		core.in_reset = 0;
+		core_reset();
+	}
+}
+
+/* fill in the read-only parts of the private peripheral bus */
+static void ppb_init(void)
+{
+	struct mem_region *ppb = &regions[PPB_REGION];
+	static const uint32_t rom_entries[] = {
+		0xFFF0F003,		/* SCS at 0xE000E000 */
+		0xFFF02003,		/* DWT at 0xE0001000 */
+		0xFFF03003,		/* FPB at 0xE0002000 */
+		0,
+	};
+	/* component ID registers: ROM table (class 1), generic IP (class 14) */
+	static const uint32_t rom_cidr[] = { 0x0D, 0x10, 0x05, 0xB1 };
+	static const uint32_t ip_cidr[] = { 0x0D, 0xE0, 0x05, 0xB1 };
+	static const uint32_t components[] = { 0xE000E000, 0xE0001000, 0xE0002000 };
+
+	for (unsigned i = 0; i < 4; i++) {
+		raw_write_u32(ppb, ROM_TABLE_BASE + 4 * i, rom_entries[i]);
+		raw_write_u32(ppb, ROM_TABLE_BASE + 0xFF0 + 4 * i, rom_cidr[i]);
+		for (unsigned j = 0; j < 3; j++)
+			raw_write_u32(ppb, components[j] + 0xFF0 + 4 * i, ip_cidr[i]);
+	}
+
+	raw_write_u32(ppb, CPUID, CORTEX_M3_CPUID);
+	raw_write_u32(ppb, DWT_CTRL, DWT_NUM_COMP << 28);
+	raw_write_u32(ppb, FP_CTRL, (FP_NUM_LIT << 8) | (FP_NUM_CODE << 4));
+}
+
+void dap_sim_init(void)
+{
+	for (unsigned i = 0; i < NUM_REGIONS; i++) {
+		regions[i].data = calloc(1, regions[i].size);
+		if (!regions[i].data) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	ppb_init();
+
+	/* an erased "flash" gives a core that locks up right out of reset */
+	memset(regions[0].data, 0xFF, regions[0].size);
+
+	memset(&dp, 0, sizeof(dp));
+	memset(&ap, 0, sizeof(ap));
+	memset(&core, 0, sizeof(core));
+	memset(&dap_sim_stats, 0, sizeof(dap_sim_stats));
+	core_reset();
+}
+
+void dap_sim_print_stats(FILE *f)
+{
+	fprintf(f, "DP reads %lu, writes %lu\n",
+			dap_sim_stats.dp_reads, dap_sim_stats.dp_writes);
+	fprintf(f, "AP reads %lu, writes %lu\n",
+			dap_sim_stats.ap_reads, dap_sim_stats.ap_writes);
+	fprintf(f, "bus reads %lu, writes %lu\n",
+			dap_sim_stats.mem_reads, dap_sim_stats.mem_writes);
+	fprintf(f, "halts %lu\n", dap_sim_stats.halts);
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+#ifndef DAP_SIM_H
+#define DAP_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Software model of an ADIv5 debug port with a single AHB-AP (MEM-AP)
+ * in front of a Cortex-M3 style debug core.  The model works on DP/AP
+ * register transactions; the front ends (a JTAG TAP for remote_bitbang,
+ * the dap_direct server) only decode their wire protocol into these
+ * calls.
+ */
+
+/* DP register addresses, A[3:2] of a DPACC */
+#define DAP_SIM_DP_CTRL_STAT	0x4
+#define DAP_SIM_DP_SELECT		0x8
+#define DAP_SIM_DP_RDBUFF		0xC
+
+/* transaction counters, printed when the simulator exits */
+struct dap_sim_stats {
+	unsigned long dp_reads;
+	unsigned long dp_writes;
+	unsigned long ap_reads;
+	unsigned long ap_writes;
+	unsigned long mem_reads;	/* bus accesses done by the MEM-AP */
+	unsigned long mem_writes;
+	unsigned long halts;
+};
+
+extern struct dap_sim_stats dap_sim_stats;
+
+void dap_sim_init(void);
+
+/* assert (1) or release (0) the system reset line */
+void dap_sim_srst(int asserted);
+
+uint32_t dap_sim_dp_read(unsigned reg);
+void dap_sim_dp_write(unsigned reg, uint32_t value);
+
+/* @a reg is the AP register address within the bank selected by SELECT */
+uint32_t dap_sim_ap_read(unsigned reg);
+void dap_sim_ap_write(unsigned reg, uint32_t value);
+
+/* a write to the DP ABORT register */
+void dap_sim_abort(uint32_t value);
+
+/* non-zero while CTRL/STAT has a sticky error flag set */
+int dap_sim_sticky_error(void);
+
+/* lets a running core make progress; called after every transaction */
+void dap_sim_tick(void);
+
+void dap_sim_print_stats(FILE *f);
+
+#endif /* DAP_SIM_H */
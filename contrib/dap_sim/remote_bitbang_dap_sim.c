@@ -0,0 +1,327 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+  A simulated ARM JTAG-DP with a Cortex-M3 behind it, served over the
+  protocol of the OpenOCD remote_bitbang interface driver.  It needs no
+  hardware and lets the ADIv5 and Cortex-M code be exercised and timed
+  on any host; the counters printed on exit give the number of DAP
+  transactions a session needed.
+
+  To compile run:
+  gcc -Wall -std=gnu99 -O2 -o remote_bitbang_dap_sim remote_bitbang_dap_sim.c dap_sim.c
+
+  Usage example:
+
+  Either let the simulator listen itself:
+  ./remote_bitbang_dap_sim -p 7777
+
+  or serve stdin/stdout through socat:
+  socat TCP-LISTEN:7777,reuseaddr EXEC:./remote_bitbang_dap_sim
+
+  then run:
+  openocd -c "interface remote_bitbang; remote_bitbang_host localhost; remote_bitbang_port 7777" \
+	  -f contrib/dap_sim/dap_sim.cfg
+
+  The TAP has a 4 bit IR with IDCODE 0x4ba00477; see dap_sim.c for the
+  memory map and what the core model does.
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "dap_sim.h"
+
+#define LOG_ERROR(...)		do {					\
+		fprintf(stderr, __VA_ARGS__);				\
+		fputc('\n', stderr);					\
+	} while (0)
+
+#define JTAG_DP_IDCODE	0x4BA00477
+
+/* IR instructions of an ARM JTAG-DP */
+#define IR_ABORT	0x8
+#define IR_DPACC	0xA
+#define IR_APACC	0xB
+#define IR_IDCODE	0xE
+#define IR_BYPASS	0xF
+#define IR_LENGTH	4
+
+#define JTAG_ACK_OK_FAULT	0x2
+
+enum tap_state {
+	TLR, IDLE,
+	DRSELECT, DRCAPTURE, DRSHIFT, DREXIT1, DRPAUSE, DREXIT2, DRUPDATE,
+	IRSELECT, IRCAPTURE, IRSHIFT, IREXIT1, IRPAUSE, IREXIT2, IRUPDATE,
+};
+
+/* next state for TMS = 0 and TMS = 1 */
+static const enum tap_state tap_next[16][2] = {
+	[TLR]       = { IDLE,      TLR },
+	[IDLE]      = { IDLE,      DRSELECT },
+	[DRSELECT]  = { DRCAPTURE, IRSELECT },
+	[DRCAPTURE] = { DRSHIFT,   DREXIT1 },
+	[DRSHIFT]   = { DRSHIFT,   DREXIT1 },
+	[DREXIT1]   = { DRPAUSE,   DRUPDATE },
+	[DRPAUSE]   = { DRPAUSE,   DREXIT2 },
+	[DREXIT2]   = { DRSHIFT,   DRUPDATE },
+	[DRUPDATE]  = { IDLE,      DRSELECT },
+	[IRSELECT]  = { IRCAPTURE, TLR },
+	[IRCAPTURE] = { IRSHIFT,   IREXIT1 },
+	[IRSHIFT]   = { IRSHIFT,   IREXIT1 },
+	[IREXIT1]   = { IRPAUSE,   IRUPDATE },
+	[IRPAUSE]   = { IRPAUSE,   IREXIT2 },
+	[IREXIT2]   = { IRSHIFT,   IRUPDATE },
+	[IRUPDATE]  = { IDLE,      DRSELECT },
+};
+
+static struct {
+	enum tap_state state;
+	unsigned ir;
+	uint64_t shift;			/* IR or DR shift register */
+	unsigned length;		/* of the register being shifted */
+	uint32_t acc_result;	/* read data of the previous DPACC/APACC */
+	int tck;
+	unsigned long scans;
+	unsigned long cycles;
+} tap;
+
+static unsigned dr_length(void)
+{
+	switch (tap.ir) {
+	case IR_ABORT:
+	case IR_DPACC:
+	case IR_APACC:
+		return 35;
+	case IR_IDCODE:
+		return 32;
+	default:
+		return 1;
+	}
+}
+
+static void capture_dr(void)
+{
+	tap.length = dr_length();
+	switch (tap.ir) {
+	case IR_DPACC:
+	case IR_APACC:
+		tap.shift = JTAG_ACK_OK_FAULT | ((uint64_t)tap.acc_result << 3);
+		break;
+	case IR_IDCODE:
+		tap.shift = JTAG_DP_IDCODE;
+		break;
+	default:
+		tap.shift = 0;
+		break;
+	}
+}
+
+static void update_dr(void)
+{
+	int rnw = tap.shift & 1;
+	unsigned reg = (tap.shift >> 1 & 3) << 2;
+	uint32_t data = tap.shift >> 3;
+
+	tap.scans++;
+	switch (tap.ir) {
+	case IR_ABORT:
+		if (reg == 0 && !rnw)
+			dap_sim_abort(data);
+		break;
+	case IR_DPACC:
+		if (rnw)
+			tap.acc_result = dap_sim_dp_read(reg);
+		else
+			dap_sim_dp_write(reg, data);
+		break;
+	case IR_APACC:
+		if (rnw)
+			tap.acc_result = dap_sim_ap_read(reg);
+		else
+			dap_sim_ap_write(reg, data);
+		break;
+	}
+}
+
+static void enter_state(enum tap_state state)
+{
+	tap.state = state;
+	switch (state) {
+	case TLR:
+		tap.ir = IR_IDCODE;
+		break;
+	case DRCAPTURE:
+		capture_dr();
+		break;
+	case DRUPDATE:
+		update_dr();
+		break;
+	case IRCAPTURE:
+		tap.length = IR_LENGTH;
+		tap.shift = 0x1;
+		break;
+	case IRUPDATE:
+		tap.ir = tap.shift & ((1u << IR_LENGTH) - 1);
+		break;
+	default:
+		break;
+	}
+}
+
+static void clock_edge(int tms, int tdi)
+{
+	tap.cycles++;
+	if (tap.state == DRSHIFT || tap.state == IRSHIFT) {
+		tap.shift >>= 1;
+		tap.shift |= (uint64_t)tdi << (tap.length - 1);
+	}
+	enter_state(tap_next[tap.state][tms]);
+}
+
+static int tdo(void)
+{
+	if (tap.state == DRSHIFT || tap.state == IRSHIFT)
+		return tap.shift & 1;
+	return 0;
+}
+
+static void process_remote_protocol(FILE *in, FILE *out)
+{
+	int c;
+
+	while ((c = fgetc(in)) != EOF) {
+		switch (c) {
+		case '0': case '1': case '2': case '3':
+		case '4': case '5': case '6': case '7': {
+			int tck = (c - '0') & 0x4;
+			if (tck && !tap.tck)
+				clock_edge(!!((c - '0') & 0x2), (c - '0') & 0x1);
+			tap.tck = tck;
+			break;
+		}
+		case 'R':
+			fputc(tdo() ? '1' : '0', out);
+			fflush(out);
+			break;
+		case 'r': case 's': case 't': case 'u':
+			if ((c - 'r') & 0x2)
+				enter_state(TLR);
+			dap_sim_srst((c - 'r') & 0x1);
+			break;
+		case 'B':
+		case 'b':
+			break;
+		case 'Q':
+			return;
+		default:
+			LOG_ERROR("unknown command '%c'", c);
+			break;
+		}
+	}
+}
+
+static void print_stats(void)
+{
+	fprintf(stderr, "TCK cycles %lu, DPACC/APACC/ABORT scans %lu\n",
+			tap.cycles, tap.scans);
+	dap_sim_print_stats(stderr);
+}
+
+static int serve_port(int port)
+{
+	struct sockaddr_in addr;
+	int one = 1;
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (listener < 0) {
+		LOG_ERROR("socket: %s", strerror(errno));
+		return 1;
+	}
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0
+			|| listen(listener, 1) < 0) {
+		LOG_ERROR("cannot listen on port %d: %s", port, strerror(errno));
+		close(listener);
+		return 1;
+	}
+
+	/* the simulated target keeps its state across connections */
+	for (;;) {
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG_ERROR("accept: %s", strerror(errno));
+			break;
+		}
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		FILE *in = fdopen(fd, "r");
+		FILE *out = fdopen(dup(fd), "w");
+		if (!in || !out) {
+			LOG_ERROR("fdopen: %s", strerror(errno));
+			break;
+		}
+		process_remote_protocol(in, out);
+		fclose(in);
+		fclose(out);
+		print_stats();
+	}
+
+	close(listener);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int port = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:")) != -1) {
+		switch (opt) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		default:
+			LOG_ERROR("usage: %s [-p port]", argv[0]);
+			return 1;
+		}
+	}
+
+	dap_sim_init();
+	enter_state(TLR);
+
+	if (port)
+		return serve_port(port);
+
+	process_remote_protocol(stdin, stdout);
+	print_stats();
+	return 0;
+}
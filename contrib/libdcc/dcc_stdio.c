@@ -29,7 +29,42 @@
 #define TARGET_REQ_DEBUGMSG_HEXMSG(size)	(0x01 | ((size & 0xff) << 8))
 #define TARGET_REQ_DEBUGCHAR				0x02
 
-#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_6SM__)
+#if defined(DCC_RINGBUF)
+
+/* write the message words into a RAM ring buffer which the host drains in
+ * bulk, see "target_request ringbuf" */
+
+#ifndef DCC_RINGBUF_SIZE
+#define DCC_RINGBUF_SIZE	1024
+#endif
+
+struct dcc_ringbuf {
+	unsigned long magic;
+	volatile unsigned long *buffer;
+	unsigned long size;
+	volatile unsigned long wr;
+	volatile unsigned long rd;
+};
+
+static volatile unsigned long dcc_ringbuf_data[DCC_RINGBUF_SIZE / 4];
+
+struct dcc_ringbuf dcc_ringbuf = {
+	0x52494e47, dcc_ringbuf_data, DCC_RINGBUF_SIZE, 0, 0
+};
+
+void dbg_write(unsigned long dcc_data)
+{
+	unsigned long wr = dcc_ringbuf.wr;
+	unsigned long next = (wr + 4) % DCC_RINGBUF_SIZE;
+
+	/* wait for the host to make room, one word is always left unused */
+	while (next == dcc_ringbuf.rd);
+
+	dcc_ringbuf_data[wr / 4] = dcc_data;
+	dcc_ringbuf.wr = next;
+}
+
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_6SM__)
 
 /* we use the System Control Block DCRDR reg to simulate a arm7_9 dcc channel
  * DCRDR[7:0] is used by target for status
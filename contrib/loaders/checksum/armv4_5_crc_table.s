@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (C) 2010 by Spencer Oliver                                  *
+ *   spen@spen-soft.co.uk                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+	Table driven variant of armv4_5_crc.s, same CRC.  The table is built
+	first, then the data is processed four bytes per loop.
+
+	r0 - address in - crc out
+	r1 - char count
+	r2 - address of a 1 KiB table, 4 byte aligned
+*/
+
+	.text
+	.arm
+
+_start:
+main:
+	ldr		r7, CRC32XOR
+	mov		r3, #0
+gen:
+	mov		r4, r3, lsl #24
+	mov		r5, #8
+bit:
+	movs	r4, r4, lsl #1
+	eorcs	r4, r4, r7
+	subs	r5, r5, #1
+	bne		bit
+	str		r4, [r2, r3, lsl #2]
+	add		r3, r3, #1
+	cmp		r3, #256
+	bne		gen
+	add		r3, r0, r1			/* r3 = end */
+	mov		r1, r0				/* r1 = pointer */
+	mvn		r0, #0
+quad:
+	sub		r4, r3, r1
+	cmp		r4, #4
+	blo		tail
+	ldrb	r4, [r1], #1
+	eor		r0, r0, r4, lsl #24
+	mov		r4, r0, lsr #24
+	ldr		r4, [r2, r4, lsl #2]
+	eor		r0, r4, r0, lsl #8
+	ldrb	r4, [r1], #1
+	eor		r0, r0, r4, lsl #24
+	mov		r4, r0, lsr #24
+	ldr		r4, [r2, r4, lsl #2]
+	eor		r0, r4, r0, lsl #8
+	ldrb	r4, [r1], #1
+	eor		r0, r0, r4, lsl #24
+	mov		r4, r0, lsr #24
+	ldr		r4, [r2, r4, lsl #2]
+	eor		r0, r4, r0, lsl #8
+	ldrb	r4, [r1], #1
+	eor		r0, r0, r4, lsl #24
+	mov		r4, r0, lsr #24
+	ldr		r4, [r2, r4, lsl #2]
+	eor		r0, r4, r0, lsl #8
+	b		quad
+tail:
+	cmp		r1, r3
+	beq		done
+	ldrb	r4, [r1], #1
+	eor		r0, r0, r4, lsl #24
+	mov		r4, r0, lsr #24
+	ldr		r4, [r2, r4, lsl #2]
+	eor		r0, r4, r0, lsl #8
+	b		tail
+done:
+	bkpt	#0
+
+CRC32XOR:	.word	0x04C11DB7
+
+	.end
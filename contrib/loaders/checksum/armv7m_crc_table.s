@@ -0,0 +1,120 @@
+/***************************************************************************
+ *   Copyright (C) 2010 by Spencer Oliver                                  *
+ *   spen@spen-soft.co.uk                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+	Table driven variant of armv7m_crc.s, same CRC.  The table is built
+	first, then whole aligned words are processed four bytes at a time.
+	Runs on ARMv6-M too; words are loaded little endian.
+
+	parameters:
+	r0 - address in - crc out
+	r1 - char count
+	r2 - address of a 1 KiB table, 4 byte aligned
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+	.thumb_func
+
+	.align	2
+
+_start:
+main:
+	ldr		r7, CRC32XOR
+	movs	r3, #0
+gen:
+	lsls	r4, r3, #24
+	movs	r5, #8
+bit:
+	lsls	r4, r4, #1
+	bcc		nopoly
+	eors	r4, r4, r7
+nopoly:
+	subs	r5, r5, #1
+	bne		bit
+	lsls	r6, r3, #2
+	str		r4, [r2, r6]
+	adds	r3, r3, #1
+	lsrs	r6, r3, #8
+	beq		gen
+	adds	r3, r0, r1			/* r3 = end */
+	mov		r1, r0				/* r1 = pointer */
+	movs	r0, #0
+	mvns	r0, r0
+nbyte:
+	cmp		r1, r3
+	beq		done
+	lsls	r4, r1, #30			/* aligned with a word left? */
+	bne		onebyte
+	subs	r4, r3, r1
+	cmp		r4, #4
+	bhs		words
+onebyte:
+	ldrb	r4, [r1]
+	adds	r1, r1, #1
+	lsls	r4, r4, #24
+	eors	r0, r0, r4
+	lsrs	r4, r0, #24
+	lsls	r4, r4, #2
+	ldr		r4, [r2, r4]
+	lsls	r0, r0, #8
+	eors	r0, r0, r4
+	b		nbyte
+words:
+	lsrs	r4, r4, #2
+	lsls	r4, r4, #2
+	adds	r7, r1, r4			/* r7 = end of the words */
+nword:
+	ldmia	r1!, {r4}
+	rev		r4, r4
+	eors	r0, r0, r4
+	lsrs	r4, r0, #24
+	lsls	r4, r4, #2
+	ldr		r4, [r2, r4]
+	lsls	r0, r0, #8
+	eors	r0, r0, r4
+	lsrs	r4, r0, #24
+	lsls	r4, r4, #2
+	ldr		r4, [r2, r4]
+	lsls	r0, r0, #8
+	eors	r0, r0, r4
+	lsrs	r4, r0, #24
+	lsls	r4, r4, #2
+	ldr		r4, [r2, r4]
+	lsls	r0, r0, #8
+	eors	r0, r0, r4
+	lsrs	r4, r0, #24
+	lsls	r4, r4, #2
+	ldr		r4, [r2, r4]
+	lsls	r0, r0, #8
+	eors	r0, r0, r4
+	cmp		r1, r7
+	bne		nword
+	b		nbyte
+done:
+	bkpt	#0
+
+	.align	2
+
+CRC32XOR:	.word	0x04c11db7
+
+	.end
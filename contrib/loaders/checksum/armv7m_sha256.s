@@ -0,0 +1,127 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+	Hashes whole 64 byte blocks with SHA-256 (FIPS 180-4), the padding
+	of the last block is left to the host.
+
+	parameters:
+	r0 - work area: K[64], W[64], H[8], 4 byte aligned
+	r1 - address of the data, big endian words
+	r2 - number of blocks, at least one
+
+	H holds the hash state on entry and is updated in place.
+	Needs ARMv7-M and a little endian core.
+*/
+
+	.text
+	.syntax unified
+	.cpu cortex-m3
+	.thumb
+	.thumb_func
+
+	.align	2
+
+/* one round, see FIPS 180-4 6.2.2; r3 points at K[t], W[t] is 256 bytes above */
+.macro	round a, b, c, d, e, f, g, h
+	ror		r0, \e, #6
+	eor		r0, r0, \e, ror #11
+	eor		r0, r0, \e, ror #25
+	add		\h, \h, r0			/* h + S1(e) */
+	eor		r0, \f, \g
+	and		r0, r0, \e
+	eor		r0, r0, \g
+	add		\h, \h, r0			/* + Ch(e, f, g) */
+	ldr		r0, [r3, #256]
+	ldr		r1, [r3], #4
+	add		\h, \h, r0
+	add		\h, \h, r1			/* + W[t] + K[t] = T1 */
+	add		\d, \d, \h			/* d += T1 */
+	ror		r0, \a, #2
+	eor		r0, r0, \a, ror #13
+	eor		r0, r0, \a, ror #22
+	add		\h, \h, r0			/* T1 + S0(a) */
+	orr		r0, \a, \b
+	and		r0, r0, \c
+	and		r1, \a, \b
+	orr		r0, r0, r1
+	add		\h, \h, r0			/* + Maj(a, b, c) = new a */
+.endm
+
+_start:
+main:
+	add		lr, r0, #256		/* lr = W */
+	mov		r12, r1				/* r12 = data */
+block:
+	mov		r3, lr
+	movs	r5, #16
+load:
+	ldr		r4, [r12], #4		/* W[0..15] */
+	rev		r4, r4
+	str		r4, [r3], #4
+	subs	r5, r5, #1
+	bne		load
+	movs	r5, #48
+schedule:
+	ldr		r4, [r3, #-8]		/* s1(W[t-2]) */
+	ror		r6, r4, #17
+	eor		r6, r6, r4, ror #19
+	eor		r6, r6, r4, lsr #10
+	ldr		r4, [r3, #-28]		/* + W[t-7] */
+	add		r6, r6, r4
+	ldr		r4, [r3, #-60]		/* + s0(W[t-15]) */
+	ror		r7, r4, #7
+	eor		r7, r7, r4, ror #18
+	eor		r7, r7, r4, lsr #3
+	add		r6, r6, r7
+	ldr		r4, [r3, #-64]		/* + W[t-16] */
+	add		r6, r6, r4
+	str		r6, [r3], #4
+	subs	r5, r5, #1
+	bne		schedule
+	ldm		r3, {r4-r11}		/* r3 = H, a..h */
+	sub		r3, lr, #256		/* r3 = K */
+rounds:
+	round	r4, r5, r6, r7, r8, r9, r10, r11
+	round	r11, r4, r5, r6, r7, r8, r9, r10
+	round	r10, r11, r4, r5, r6, r7, r8, r9
+	round	r9, r10, r11, r4, r5, r6, r7, r8
+	round	r8, r9, r10, r11, r4, r5, r6, r7
+	round	r7, r8, r9, r10, r11, r4, r5, r6
+	round	r6, r7, r8, r9, r10, r11, r4, r5
+	round	r5, r6, r7, r8, r9, r10, r11, r4
+	cmp		r3, lr
+	bne		rounds
+	add		r3, lr, #256		/* H += a..h */
+	ldrd	r0, r1, [r3]
+	add		r4, r4, r0
+	add		r5, r5, r1
+	ldrd	r0, r1, [r3, #8]
+	add		r6, r6, r0
+	add		r7, r7, r1
+	ldrd	r0, r1, [r3, #16]
+	add		r8, r8, r0
+	add		r9, r9, r1
+	ldrd	r0, r1, [r3, #24]
+	add		r10, r10, r0
+	add		r11, r11, r1
+	stm		r3, {r4-r11}
+	subs	r2, r2, #1
+	bne		block
+	bkpt	#0
+
+	.end
@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+	.text
+	.syntax unified
+	.arch armv7-m
+	.thumb
+	.thumb_func
+
+	.align 2
+
+/* Program halfwords from a fifo, see target_run_flash_async_algorithm(). */
+
+/* input parameters - */
+/*	R0 = number of writes */
+/*	R1 = destination address */
+/*	R2 = workarea start */
+/*	R3 = workarea end */
+/*	R4 = constant to mask DQ7 bits */
+/*	R5 = constant to mask DQ5 bits, 0 for DQ7 polling only */
+/*	R6 = flash write command */
+/* temp registers - */
+/*	R7 = holding register */
+/*	R12 = rp */
+/*	LR = wp, value read from flash to test status */
+/* unlock registers - */
+/*  R8 = unlock1_addr */
+/*  R9 = unlock1_cmd */
+/*  R10 = unlock2_addr */
+/*  R11 = unlock2_cmd */
+
+wait_fifo:
+	ldr		lr, [r2, #0]	/* read wp */
+	cmp		lr, #0			/* abort if wp == 0 */
+	beq		done
+	ldr		r12, [r2, #4]	/* read rp */
+	cmp		r12, lr			/* wait until rp != wp */
+	beq		wait_fifo
+	ldrh	r7, [r12], #2
+	strh	r9, [r8]
+	strh	r11, [r10]
+	strh	r6, [r8]
+	strh	r7, [r1]
+busy:
+	ldrh	lr, [r1]
+	ldrh	r7, [r12, #-2]	/* reload the data from the fifo */
+	eor		r7, r7, lr
+	tst		r7, r4
+	beq		cont			/* b if DQ7 == Data7 */
+	tst		lr, r5
+	beq		busy			/* b if DQ5 low */
+	ldrh	lr, [r1]
+	ldrh	r7, [r12, #-2]
+	eor		r7, r7, lr
+	tst		r7, r4
+	beq		cont			/* b if DQ7 == Data7 */
+	mov		r7, #0			/* set rp = 0 on error */
+	str		r7, [r2, #4]
+	b		done
+cont:
+	add		r1, r1, #2
+	cmp		r12, r3			/* wrap rp at end of buffer */
+	it		cs
+	addcs	r12, r2, #8
+	str		r12, [r2, #4]	/* store rp */
+	subs	r0, r0, #1
+	bne		wait_fifo
+
+done:
+	bkpt #0
+
+	.end
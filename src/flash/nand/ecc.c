@@ -65,29 +65,56 @@ static const uint8_t nand_ecc_precalc_table[] = {
 	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
 };
 
+static inline int parity_u64(uint64_t x)
+{
+	return parity_u32((uint32_t)(x ^ (x >> 32)));
+}
+
 /*
  * nand_calculate_ecc - Calculate 3-byte ECC for 256-byte block
+ *
+ * Both column and line parity are linear, so rather than looking up every
+ * byte we XOR-fold the block as 64-bit words.  Line parity bit n is the
+ * parity of all bytes whose index has bit n set: bits 3..7 select whole
+ * words, bits 0..2 select byte lanes within the folded word.  Column
+ * parity is the table entry of the XOR of all bytes.
  */
 int nand_calculate_ecc(struct nand_device *nand, const uint8_t *dat, uint8_t *ecc_code)
 {
-	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
-	int i;
-
-	/* Initialize variables */
-	reg1 = reg2 = reg3 = 0;
-
-	/* Build up column parity */
-	for (i = 0; i < 256; i++) {
-		/* Get CP0 - CP5 from table */
-		idx = nand_ecc_precalc_table[*dat++];
-		reg1 ^= (idx & 0x3f);
-
-		/* All bit XOR = 1 ? */
-		if (idx & 0x40) {
-			reg3 ^= (uint8_t) i;
-			reg2 ^= ~((uint8_t) i);
+	uint64_t w[32], all, line[5];
+	uint8_t reg1, reg2, reg3, tmp1, tmp2;
+	int i, n, len;
+
+	for (i = 0; i < 32; i++)
+		w[i] = le_to_h_u64(dat + 8 * i);
+
+	/* pairwise folding: at level n the odd entries are exactly the words
+	 * whose index has bit n set */
+	for (n = 0, len = 32; n < 5; n++, len /= 2) {
+		line[n] = 0;
+		for (i = 0; i < len / 2; i++) {
+			line[n] ^= w[2 * i + 1];
+			w[i] = w[2 * i] ^ w[2 * i + 1];
 		}
 	}
+	all = w[0];
+
+	/* line parity: byte index bits 0..2 are byte lanes of the folded word */
+	reg3 = parity_u64(all & 0xff00ff00ff00ff00ULL) << 0;
+	reg3 |= parity_u64(all & 0xffff0000ffff0000ULL) << 1;
+	reg3 |= parity_u64(all & 0xffffffff00000000ULL) << 2;
+	for (n = 0; n < 5; n++)
+		reg3 |= parity_u64(line[n]) << (n + 3);
+
+	/* XOR of ~i over the odd lines is the XOR of i, inverted if the number
+	 * of odd lines (i.e. the parity of the whole block) is odd */
+	reg2 = parity_u64(all) ? ~reg3 : reg3;
+
+	/* column parity */
+	all ^= all >> 32;
+	all ^= all >> 16;
+	all ^= all >> 8;
+	reg1 = nand_ecc_precalc_table[all & 0xff] & 0x3f;
 
 	/* Create non-inverted ECC code from line parity */
 	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
@@ -123,11 +150,15 @@ int nand_calculate_ecc(struct nand_device *nand, const uint8_t *dat, uint8_t *ec
 
 static inline int countbits(uint32_t b)
 {
+#ifdef __GNUC__
+	return __builtin_popcount(b);
+#else
 	int res = 0;
 
 	for (; b; b >>= 1)
 		res += b & 0x01;
 	return res;
+#endif
 }
 
 /**
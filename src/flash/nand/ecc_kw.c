@@ -44,6 +44,13 @@ static uint16_t gf_exp[1023 + 1023];
  */
 static uint16_t gf_log[1024];
 
+/*
+ * Maps the feedback symbol b to its products with the eight generator
+ * polynomial coefficients, so that the inner loop of the encoder needs
+ * a single lookup per step and no special case for b == 0.
+ */
+static uint16_t rs_feedback[1024][8];
+
 static void gf_build_log_exp_table(void)
 {
 	int i;
@@ -71,6 +78,41 @@ static void gf_build_log_exp_table(void)
 }
 
 
+/*
+ * Discrete logs of the generator polynomial coefficients, X^7 down to 1
+ * (the X^8 coefficient is 1).
+ */
+static const uint16_t rs_gen_log[8] = {
+	0x21c, 0x181, 0x18e, 0x25f, 0x197, 0x193, 0x237, 0x024,
+};
+
+static void rs_build_feedback_table(void)
+{
+	int b, j;
+
+	for (b = 1; b < 1024; b++) {
+		for (j = 0; j < 8; j++)
+			rs_feedback[b][j] = gf_exp[gf_log[b] + rs_gen_log[j]];
+	}
+}
+
+/*
+ * One step of the division by the generator polynomial: shift d into r0
+ * while reducing by the coefficient falling out of r7.
+ */
+#define RS_STEP(d) \
+	do { \
+		const uint16_t *t = rs_feedback[r7]; \
+		r7 = r6 ^ t[0]; \
+		r6 = r5 ^ t[1]; \
+		r5 = r4 ^ t[2]; \
+		r4 = r3 ^ t[3]; \
+		r3 = r2 ^ t[4]; \
+		r2 = r1 ^ t[5]; \
+		r1 = r0 ^ t[6]; \
+		r0 = (d) ^ t[7]; \
+	} while (0)
+
 /*****************************************************************************
  * Reed-Solomon code
  *
@@ -106,6 +148,7 @@ int nand_calculate_ecc_kw(struct nand_device *nand, const uint8_t *data, uint8_t
 
 	if (!tables_initialized) {
 		gf_build_log_exp_table();
+		rs_build_feedback_table();
 		tables_initialized = 1;
 	}
 
@@ -126,35 +169,10 @@ int nand_calculate_ecc_kw(struct nand_device *nand, const uint8_t *data, uint8_t
 	 * by eight zero bytes, while reducing the polynomial by the
 	 * generator polynomial in every step.
 	 */
-	for (i = 503; i >= -8; i--) {
-		unsigned int d;
-
-		d = 0;
-		if (i >= 0)
-			d = data[i];
-
-		if (r7) {
-			uint16_t *t = gf_exp + gf_log[r7];
-
-			r7 = r6 ^ t[0x21c];
-			r6 = r5 ^ t[0x181];
-			r5 = r4 ^ t[0x18e];
-			r4 = r3 ^ t[0x25f];
-			r3 = r2 ^ t[0x197];
-			r2 = r1 ^ t[0x193];
-			r1 = r0 ^ t[0x237];
-			r0 = d  ^ t[0x024];
-		} else {
-			r7 = r6;
-			r6 = r5;
-			r5 = r4;
-			r4 = r3;
-			r3 = r2;
-			r2 = r1;
-			r1 = r0;
-			r0 = d;
-		}
-	}
+	for (i = 503; i >= 0; i--)
+		RS_STEP(data[i]);
+	for (i = 0; i < 8; i++)
+		RS_STEP(0);
 
 	ecc[0] = r0;
 	ecc[1] = (r0 >> 8) | (r1 << 2);
@@ -64,6 +64,8 @@
 
 #include "imp.h"
 #include <helper/time_support.h>
+#include <target/algorithm.h>
+#include <target/armv7m.h>
 
 #define REG_NAME_WIDTH  (12)
 
@@ -1992,16 +1994,11 @@ static int sam4_page_read(struct sam4_bank_private *pPrivate, unsigned pagenum,
 	return r;
 }
 
-static int sam4_page_write(struct sam4_bank_private *pPrivate, unsigned pagenum, const uint8_t *buf)
+static int sam4_set_wait(struct sam4_bank_private *pPrivate)
 {
-	uint32_t adr;
-	uint32_t status;
 	uint32_t fmr;	/* EEFC Flash Mode Register */
 	int r;
 
-	adr = pagenum * pPrivate->page_size;
-	adr = (adr + pPrivate->base_address);
-
 	/* Get flash mode register value */
 	r = target_read_u32(pPrivate->pChip->target, pPrivate->controller_address, &fmr);
 	if (r != ERROR_OK)
@@ -2018,6 +2015,20 @@ static int sam4_page_write(struct sam4_bank_private *pPrivate, unsigned pagenum,
 	if (r != ERROR_OK)
 		LOG_DEBUG("Error Write failed: set flash mode register");
 
+	return r;
+}
+
+static int sam4_page_write(struct sam4_bank_private *pPrivate, unsigned pagenum, const uint8_t *buf)
+{
+	uint32_t adr;
+	uint32_t status;
+	int r;
+
+	adr = pagenum * pPrivate->page_size;
+	adr = (adr + pPrivate->base_address);
+
+	sam4_set_wait(pPrivate);
+
 	/* 1st sector 8kBytes - page 0 - 15*/
 	/* 2nd sector 8kBytes - page 16 - 30*/
 	/* 3rd sector 48kBytes - page 31 - 127*/
@@ -2053,6 +2064,145 @@ static int sam4_page_write(struct sam4_bank_private *pPrivate, unsigned pagenum,
 	return ERROR_OK;
 }
 
+/**
+ * Writes whole pages through a fifo loader running on the target, so that
+ * the host only has to keep the fifo filled.
+ * @param pPrivate - info about the bank
+ * @param pagenum  - first page to write
+ * @param npages   - number of pages
+ * @param buf      - page data
+ */
+static int sam4_page_write_block(struct sam4_bank_private *pPrivate,
+	unsigned pagenum, unsigned npages, const uint8_t *buf)
+{
+	struct target *target = pPrivate->pChip->target;
+	uint32_t buffer_size = 16384;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	struct reg_param reg_params[7];
+	struct armv7m_algorithm armv7m_info;
+	int r;
+
+	/* see contrib/loaders/flash/at91sam4.S for src */
+	static const uint8_t sam4_flash_write_code[] = {
+		/* write_page: */
+			0x37, 0x46,               /* mov r7, r6 */
+		/* wait_fifo: */
+			0xd1, 0xf8, 0x00, 0x80,   /* ldr r8, [r1, #0] */
+			0xb8, 0xf1, 0x00, 0x0f,   /* cmp r8, #0 */
+			0x22, 0xd0,               /* beq exit */
+			0xd1, 0xf8, 0x04, 0x90,   /* ldr r9, [r1, #4] */
+			0xc1, 0x45,               /* cmp r9, r8 */
+			0xf6, 0xd0,               /* beq wait_fifo */
+			0x59, 0xf8, 0x04, 0x8b,   /* ldr r8, [r9], #4 */
+			0x43, 0xf8, 0x04, 0x8b,   /* str r8, [r3], #4 */
+			0x91, 0x45,               /* cmp r9, r2 */
+			0x28, 0xbf,               /* it cs */
+			0x01, 0xf1, 0x08, 0x09,   /* addcs r9, r1, #8 */
+			0xc1, 0xf8, 0x04, 0x90,   /* str r9, [r1, #4] */
+			0x7f, 0x1e,               /* subs r7, r7, #1 */
+			0xea, 0xd1,               /* bne wait_fifo */
+			0x65, 0x60,               /* str r5, [r4, #0x04] */
+		/* busy: */
+			0xd4, 0xf8, 0x08, 0x80,   /* ldr r8, [r4, #0x08] */
+			0x18, 0xf0, 0x01, 0x0f,   /* tst r8, #0x01 */
+			0xfa, 0xd0,               /* beq busy */
+			0x18, 0xf0, 0x06, 0x0f,   /* tst r8, #0x06 */
+			0x04, 0xd1,               /* bne error */
+			0x05, 0xf5, 0x80, 0x75,   /* add r5, r5, #0x100 */
+			0x40, 0x1e,               /* subs r0, r0, #1 */
+			0xdc, 0xd1,               /* bne write_page */
+			0x04, 0xe0,               /* b exit */
+		/* error: */
+			0x40, 0x46,               /* mov r0, r8 */
+			0x5f, 0xf0, 0x00, 0x08,   /* movs r8, #0 */
+			0xc1, 0xf8, 0x04, 0x80,   /* str r8, [r1, #4] */
+		/* exit: */
+			0x00, 0xbe,               /* bkpt #0 */
+	};
+
+	if (target_alloc_working_area(target, sizeof(sam4_flash_write_code),
+			&write_algorithm) != ERROR_OK) {
+		LOG_DEBUG("no working area for block memory writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	r = target_write_buffer(target, write_algorithm->address,
+			sizeof(sam4_flash_write_code), sam4_flash_write_code);
+	if (r != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return r;
+	}
+
+	/* the fifo must hold at least a page */
+	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
+		buffer_size /= 2;
+		if (buffer_size <= pPrivate->page_size) {
+			target_free_working_area(target, write_algorithm);
+			LOG_DEBUG("no large enough working area for block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	sam4_set_wait(pPrivate);
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* page count (in), status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer start */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* target address */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* EEFC base */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_IN_OUT);	/* EEFC_FCR command */
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);	/* page size in words */
+
+	buf_set_u32(reg_params[0].value, 0, 32, npages);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[3].value, 0, 32,
+			pPrivate->base_address + pagenum * pPrivate->page_size);
+	buf_set_u32(reg_params[4].value, 0, 32, pPrivate->controller_address);
+	buf_set_u32(reg_params[5].value, 0, 32,
+			(0x5A << 24) | (pagenum << 8) | AT91C_EFC_FCMD_WP);
+	buf_set_u32(reg_params[6].value, 0, 32, pPrivate->page_size / 4);
+
+	r = target_run_flash_async_algorithm(target, buf,
+			npages * pPrivate->page_size / 4, 4,
+			0, NULL,
+			7, reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	if (r == ERROR_FLASH_OPERATION_FAILED) {
+		uint32_t status = buf_get_u32(reg_params[0].value, 0, 32);
+		unsigned page = (buf_get_u32(reg_params[5].value, 0, 32) >> 8) & 0xffff;
+		uint32_t adr = pPrivate->base_address + page * pPrivate->page_size;
+
+		if (status & (1 << 2))
+			LOG_ERROR("SAM4: Page @ Phys address 0x%08x is locked", (unsigned int)(adr));
+		else if (status & (1 << 1))
+			LOG_ERROR("SAM4: Flash Command error @phys address 0x%08x", (unsigned int)(adr));
+		else
+			LOG_ERROR("SAM4: Error performing Write page @ phys address 0x%08x",
+				(unsigned int)(adr));
+	}
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
+	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
+	destroy_reg_param(&reg_params[6]);
+
+	return r;
+}
+
 static int sam4_write(struct flash_bank *bank,
 	const uint8_t *buffer,
 	uint32_t offset,
@@ -2172,6 +2322,20 @@ static int sam4_write(struct flash_bank *bank,
 	LOG_DEBUG("Full Page Loop: cur=%d, end=%d, count = 0x%08x",
 		(int)page_cur, (int)page_end, (unsigned int)(count));
 
+	n = count / pPrivate->page_size;
+	if (page_cur + n > page_end + 1)
+		n = page_end + 1 - page_cur;
+	if (n) {
+		r = sam4_page_write_block(pPrivate, page_cur, n, buffer);
+		if (r == ERROR_OK) {
+			count -= n * pPrivate->page_size;
+			buffer += n * pPrivate->page_size;
+			page_cur += n;
+		} else if (r != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			goto done;
+	}
+
+	/* without working area, write page by page from the host */
 	while ((page_cur < page_end) &&
 			(count >= pPrivate->page_size)) {
 		r = sam4_page_write(pPrivate, page_cur, buffer);
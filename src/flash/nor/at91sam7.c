@@ -584,6 +584,7 @@ static int at91sam7_read_part_info(struct flash_bank *bank)
 				fb->driver = bank->driver;
 				fb->driver_priv = malloc(sizeof(struct at91sam7_flash_bank));
 				fb->name = "sam7_probed";
+				fb->shadow = NULL;
 				fb->next = NULL;
 
 				/* link created bank in 'flash_banks' list */
@@ -822,6 +823,7 @@ FLASH_BANK_COMMAND_HANDLER(at91sam7_flash_bank_command)
 				fb->driver = bank->driver;
 				fb->driver_priv = malloc(sizeof(struct at91sam7_flash_bank));
 				fb->name = "sam7_probed";
+				fb->shadow = NULL;
 				fb->next = NULL;
 
 				/* link created bank in 'flash_banks' list */
@@ -307,31 +307,46 @@ static void cfi_intel_clear_status_register(struct flash_bank *bank)
 	cfi_send_command(bank, 0x50, flash_address(bank, 0, 0x0));
 }
 
-static int cfi_intel_wait_status_busy(struct flash_bank *bank, int timeout, uint8_t *val)
+/* read one bus word of status, holding the status of every chip of the bank */
+static int cfi_read_status(struct flash_bank *bank, uint8_t *word)
 {
-	uint8_t status;
+	return target_read_memory(bank->target, flash_address(bank, 0, 0x0),
+			bank->bus_width, 1, word);
+}
 
-	int retval = ERROR_OK;
+/* status byte of one of the chips wired in parallel on the bus */
+static uint8_t cfi_chip_status(struct flash_bank *bank, const uint8_t *word, int chip)
+{
+	if (bank->target->endianness == TARGET_LITTLE_ENDIAN)
+		return word[chip * bank->chip_width];
+	else
+		return word[(chip + 1) * bank->chip_width - 1];
+}
 
-	for (;; ) {
-		if (timeout-- < 0) {
-			LOG_ERROR("timeout while waiting for WSM to become ready");
-			return ERROR_FAIL;
-		}
+/* combine the status registers of a bank made of several chips:
+ * the bank is only ready once every chip is, and the error bits
+ * (which are only valid when ready) of all chips are ORed
+ */
+static uint8_t cfi_intel_status(struct flash_bank *bank, const uint8_t *word)
+{
+	uint8_t status = 0;
+	int i;
 
-		retval = cfi_get_u8(bank, 0, 0x0, &status);
-		if (retval != ERROR_OK)
-			return retval;
+	for (i = 0; i < bank->bus_width / bank->chip_width; i++) {
+		uint8_t chip_status = cfi_chip_status(bank, word, i);
 
-		if (status & 0x80)
-			break;
+		if (!(chip_status & 0x80))
+			return 0;
 
-		alive_sleep(1);
+		status |= chip_status;
 	}
 
 	/* mask out bit 0 (reserved) */
-	status = status & 0xfe;
+	return status & 0xfe;
+}
 
+static int cfi_intel_check_status(struct flash_bank *bank, uint8_t status)
+{
 	LOG_DEBUG("status: 0x%x", status);
 
 	if (status != 0x80) {
@@ -351,55 +366,107 @@ static int cfi_intel_wait_status_busy(struct flash_bank *bank, int timeout, uint
 
 		cfi_intel_clear_status_register(bank);
 
-		retval = ERROR_FAIL;
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static int cfi_intel_wait_status_busy(struct flash_bank *bank, int timeout, uint8_t *val)
+{
+	uint8_t word[CFI_MAX_BUS_WIDTH];
+	uint8_t status;
+
+	int retval = ERROR_OK;
+
+	for (;; ) {
+		if (timeout-- < 0) {
+			LOG_ERROR("timeout while waiting for WSM to become ready");
+			return ERROR_FAIL;
+		}
+
+		retval = cfi_read_status(bank, word);
+		if (retval != ERROR_OK)
+			return retval;
+
+		status = cfi_intel_status(bank, word);
+		if (status & 0x80)
+			break;
+
+		alive_sleep(1);
 	}
 
 	*val = status;
-	return retval;
+	return cfi_intel_check_status(bank, status);
+}
+
+/* compare two consecutive status reads of a bank made of several chips:
+ * returns DQ6 if any chip still toggles, plus DQ5 if one of the toggling
+ * chips reports an internal timeout
+ */
+static uint8_t cfi_spansion_toggle(struct flash_bank *bank,
+	const uint8_t *oldword, const uint8_t *word)
+{
+	uint8_t toggle = 0;
+	int i;
+
+	for (i = 0; i < bank->bus_width / bank->chip_width; i++) {
+		uint8_t oldstatus = cfi_chip_status(bank, oldword, i);
+		uint8_t status = cfi_chip_status(bank, word, i);
+
+		if ((status ^ oldstatus) & 0x40)
+			toggle |= 0x40 | (status & 0x20);
+	}
+
+	return toggle;
 }
 
 static int cfi_spansion_wait_status_busy(struct flash_bank *bank, int timeout)
 {
-	uint8_t status, oldstatus;
+	uint8_t status[CFI_MAX_BUS_WIDTH], oldstatus[CFI_MAX_BUS_WIDTH];
+	uint8_t toggle;
 	struct cfi_flash_bank *cfi_info = bank->driver_priv;
 	int retval;
 
-	retval = cfi_get_u8(bank, 0, 0x0, &oldstatus);
+	retval = cfi_read_status(bank, oldstatus);
 	if (retval != ERROR_OK)
 		return retval;
 
 	do {
-		retval = cfi_get_u8(bank, 0, 0x0, &status);
+		retval = cfi_read_status(bank, status);
 
 		if (retval != ERROR_OK)
 			return retval;
 
-		if ((status ^ oldstatus) & 0x40) {
-			if (status & cfi_info->status_poll_mask & 0x20) {
-				retval = cfi_get_u8(bank, 0, 0x0, &oldstatus);
+		toggle = cfi_spansion_toggle(bank, oldstatus, status);
+		if (toggle) {
+			if (toggle & cfi_info->status_poll_mask & 0x20) {
+				retval = cfi_read_status(bank, oldstatus);
 				if (retval != ERROR_OK)
 					return retval;
-				retval = cfi_get_u8(bank, 0, 0x0, &status);
+				retval = cfi_read_status(bank, status);
 				if (retval != ERROR_OK)
 					return retval;
-				if ((status ^ oldstatus) & 0x40) {
-					LOG_ERROR("dq5 timeout, status: 0x%x", status);
+				if (cfi_spansion_toggle(bank, oldstatus, status)) {
+					LOG_ERROR("dq5 timeout, status: 0x%" PRIx32,
+						buf_get_u32(status, 0, bank->bus_width * 8));
 					return ERROR_FLASH_OPERATION_FAILED;
 				} else {
-					LOG_DEBUG("status: 0x%x", status);
+					LOG_DEBUG("status: 0x%" PRIx32,
+						buf_get_u32(status, 0, bank->bus_width * 8));
 					return ERROR_OK;
 				}
 			}
 		} else {/* no toggle: finished, OK */
-			LOG_DEBUG("status: 0x%x", status);
+			LOG_DEBUG("status: 0x%" PRIx32, buf_get_u32(status, 0, bank->bus_width * 8));
 			return ERROR_OK;
 		}
 
-		oldstatus = status;
+		memcpy(oldstatus, status, bank->bus_width);
 		alive_sleep(1);
 	} while (timeout-- > 0);
 
-	LOG_ERROR("timeout, status: 0x%x", status);
+	LOG_ERROR("timeout, status: 0x%" PRIx32, buf_get_u32(status, 0, bank->bus_width * 8));
 
 	return ERROR_FLASH_BUSY;
 }
@@ -1592,6 +1659,145 @@ static int cfi_spansion_write_block_mips(struct flash_bank *bank, const uint8_t
 	return retval;
 }
 
+static int cfi_spansion_write_block_fifo(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+	struct target *target = bank->target;
+	struct reg_param reg_params[11];
+	struct armv7m_algorithm armv7m_algo;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	uint32_t buffer_size = 32768;
+	int retval = ERROR_OK;
+
+	/* see contrib/loaders/flash/armv7m_cfi_span_16_fifo.s for src */
+	static const uint8_t armv7m_word_16_fifo_code[] = {
+		/* wait_fifo: */
+			0xd2, 0xf8, 0x00, 0xe0,   /* ldr lr, [r2, #0] */
+			0xbe, 0xf1, 0x00, 0x0f,   /* cmp lr, #0 */
+			0x2d, 0xd0,               /* beq done */
+			0xd2, 0xf8, 0x04, 0xc0,   /* ldr r12, [r2, #4] */
+			0xf4, 0x45,               /* cmp r12, lr */
+			0xf6, 0xd0,               /* beq wait_fifo */
+			0x3c, 0xf8, 0x02, 0x7b,   /* ldrh r7, [r12], #2 */
+			0xa8, 0xf8, 0x00, 0x90,   /* strh r9, [r8] */
+			0xaa, 0xf8, 0x00, 0xb0,   /* strh r11, [r10] */
+			0xa8, 0xf8, 0x00, 0x60,   /* strh r6, [r8] */
+			0x0f, 0x80,               /* strh r7, [r1] */
+		/* busy: */
+			0xb1, 0xf8, 0x00, 0xe0,   /* ldrh lr, [r1] */
+			0x3c, 0xf8, 0x02, 0x7c,   /* ldrh r7, [r12, #-2] */
+			0x87, 0xea, 0x0e, 0x07,   /* eor r7, r7, lr */
+			0x27, 0x42,               /* tst r7, r4 */
+			0x0e, 0xd0,               /* beq cont */
+			0x1e, 0xea, 0x05, 0x0f,   /* tst lr, r5 */
+			0xf4, 0xd0,               /* beq busy */
+			0xb1, 0xf8, 0x00, 0xe0,   /* ldrh lr, [r1] */
+			0x3c, 0xf8, 0x02, 0x7c,   /* ldrh r7, [r12, #-2] */
+			0x87, 0xea, 0x0e, 0x07,   /* eor r7, r7, lr */
+			0x27, 0x42,               /* tst r7, r4 */
+			0x03, 0xd0,               /* beq cont */
+			0x4f, 0xf0, 0x00, 0x07,   /* mov r7, #0 */
+			0x57, 0x60,               /* str r7, [r2, #4] */
+			0x09, 0xe0,               /* b done */
+		/* cont: */
+			0x01, 0xf1, 0x02, 0x01,   /* add r1, r1, #2 */
+			0x9c, 0x45,               /* cmp r12, r3 */
+			0x28, 0xbf,               /* it cs */
+			0x02, 0xf1, 0x08, 0x0c,   /* addcs r12, r2, #8 */
+			0xc2, 0xf8, 0x04, 0xc0,   /* str r12, [r2, #4] */
+			0x40, 0x1e,               /* subs r0, r0, #1 */
+			0xcc, 0xd1,               /* bne wait_fifo */
+		/* done: */
+			0x00, 0xbe,               /* bkpt #0 */
+	};
+
+	/* allocate working area */
+	retval = target_alloc_working_area(target, sizeof(armv7m_word_16_fifo_code),
+			&write_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* write algorithm code to working area */
+	retval = target_write_buffer(target, write_algorithm->address,
+			sizeof(armv7m_word_16_fifo_code), armv7m_word_16_fifo_code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
+		buffer_size /= 2;
+		if (buffer_size <= 256) {
+			/* we already allocated the writing code, but failed to get a
+			 * buffer, free the algorithm */
+			target_free_working_area(target, write_algorithm);
+
+			LOG_WARNING(
+				"not enough working area available, can't do block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_algo.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);
+	init_reg_param(&reg_params[7], "r8", 32, PARAM_OUT);
+	init_reg_param(&reg_params[8], "r9", 32, PARAM_OUT);
+	init_reg_param(&reg_params[9], "r10", 32, PARAM_OUT);
+	init_reg_param(&reg_params[10], "r11", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, count / 2);
+	buf_set_u32(reg_params[1].value, 0, 32, address);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address);
+	buf_set_u32(reg_params[3].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[4].value, 0, 32, cfi_command_val(bank, 0x80));
+	/* without DQ5 support rely on DQ7 DATA# polling only */
+	buf_set_u32(reg_params[5].value, 0, 32,
+			(cfi_info->status_poll_mask & (1 << 5)) ? cfi_command_val(bank, 0x20) : 0);
+	buf_set_u32(reg_params[6].value, 0, 32, cfi_command_val(bank, 0xA0));
+	buf_set_u32(reg_params[7].value, 0, 32, flash_address(bank, 0, pri_ext->_unlock1));
+	buf_set_u32(reg_params[8].value, 0, 32, 0xaaaaaaaa);
+	buf_set_u32(reg_params[9].value, 0, 32, flash_address(bank, 0, pri_ext->_unlock2));
+	buf_set_u32(reg_params[10].value, 0, 32, 0x55555555);
+
+	retval = target_run_flash_async_algorithm(target, buffer, count / 2, 2,
+			0, NULL,
+			11, reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_algo);
+	if (retval == ERROR_FLASH_OPERATION_FAILED)
+		LOG_ERROR("flash write block failed at address 0x%" PRIx32,
+				buf_get_u32(reg_params[1].value, 0, 32));
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
+	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
+	destroy_reg_param(&reg_params[6]);
+	destroy_reg_param(&reg_params[7]);
+	destroy_reg_param(&reg_params[8]);
+	destroy_reg_param(&reg_params[9]);
+	destroy_reg_param(&reg_params[10]);
+
+	return retval;
+}
+
 static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t address, uint32_t count)
 {
@@ -1799,6 +2005,10 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 	if (strncmp(target_type_name(target), "mips_m4k", 8) == 0)
 		return cfi_spansion_write_block_mips(bank, buffer, address, count);
 
+	/* Cortex-M cores can run the algorithm while the fifo is refilled */
+	if (is_armv7m(target_to_armv7m(target)) && bank->bus_width == 2)
+		return cfi_spansion_write_block_fifo(bank, buffer, address, count);
+
 	if (is_armv7m(target_to_armv7m(target))) {	/* armv7m target */
 		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
 		armv7m_algo.core_mode = ARM_MODE_THREAD;
@@ -1972,24 +2182,96 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 	return retval;
 }
 
+/* Programming without a working area runs every word or write buffer as
+ * one sequence of memory accesses: the command cycles, the data, the
+ * confirm and a first status check.  Targets which can queue the whole
+ * sequence need a single round trip per word or buffer (two for Intel
+ * buffers, whose data may only follow once the buffer is available); the
+ * status is only polled further if the flash was still busy when read.
+ */
+#define CFI_SEQUENCE_MAX_OPS 8
+
+struct cfi_sequence {
+	struct target_memory_op ops[CFI_SEQUENCE_MAX_OPS];
+	uint8_t command[CFI_SEQUENCE_MAX_OPS][CFI_MAX_BUS_WIDTH];
+	int num_ops;
+};
+
+static void cfi_sequence_write(struct flash_bank *bank, struct cfi_sequence *seq,
+	const uint8_t *data, uint32_t count, uint32_t address)
+{
+	struct target_memory_op *op = &seq->ops[seq->num_ops++];
+
+	op->address = address;
+	op->size = bank->bus_width;
+	op->count = count;
+	op->write = data;
+	op->read = NULL;
+}
+
+static void cfi_sequence_command(struct flash_bank *bank, struct cfi_sequence *seq,
+	uint8_t cmd, uint32_t address)
+{
+	cfi_command(bank, cmd, seq->command[seq->num_ops]);
+	cfi_sequence_write(bank, seq, seq->command[seq->num_ops], 1, address);
+}
+
+static void cfi_sequence_read_status(struct flash_bank *bank, struct cfi_sequence *seq,
+	uint8_t *word)
+{
+	struct target_memory_op *op = &seq->ops[seq->num_ops++];
+
+	op->address = flash_address(bank, 0, 0x0);
+	op->size = bank->bus_width;
+	op->count = 1;
+	op->write = NULL;
+	op->read = word;
+}
+
+static int cfi_sequence_run(struct flash_bank *bank, struct cfi_sequence *seq)
+{
+	return target_memory_sequence(bank->target, seq->ops, seq->num_ops);
+}
+
+/* finish an operation whose status was read at the end of its sequence */
+static int cfi_intel_sequence_done(struct flash_bank *bank, int timeout, const uint8_t *word)
+{
+	uint8_t status = cfi_intel_status(bank, word);
+
+	if (status & 0x80)
+		return cfi_intel_check_status(bank, status);
+
+	return cfi_intel_wait_status_busy(bank, timeout, &status);
+}
+
+static int cfi_spansion_sequence_done(struct flash_bank *bank, int timeout,
+	const uint8_t *oldword, const uint8_t *word)
+{
+	if (!cfi_spansion_toggle(bank, oldword, word)) {
+		LOG_DEBUG("status: 0x%" PRIx32, buf_get_u32(word, 0, bank->bus_width * 8));
+		return ERROR_OK;
+	}
+
+	return cfi_spansion_wait_status_busy(bank, timeout);
+}
+
 static int cfi_intel_write_word(struct flash_bank *bank, uint8_t *word, uint32_t address)
 {
 	int retval;
 	struct cfi_flash_bank *cfi_info = bank->driver_priv;
-	struct target *target = bank->target;
+	struct cfi_sequence seq = { .num_ops = 0 };
+	uint8_t status[CFI_MAX_BUS_WIDTH];
 
-	cfi_intel_clear_status_register(bank);
-	retval = cfi_send_command(bank, 0x40, address);
-	if (retval != ERROR_OK)
-		return retval;
+	cfi_sequence_command(bank, &seq, 0x50, flash_address(bank, 0, 0x0));
+	cfi_sequence_command(bank, &seq, 0x40, address);
+	cfi_sequence_write(bank, &seq, word, 1, address);
+	cfi_sequence_read_status(bank, &seq, status);
 
-	retval = target_write_memory(target, address, bank->bus_width, 1, word);
+	retval = cfi_sequence_run(bank, &seq);
 	if (retval != ERROR_OK)
 		return retval;
 
-	uint8_t status;
-	retval = cfi_intel_wait_status_busy(bank, cfi_info->word_write_timeout, &status);
-	if (retval != 0x80) {
+	if (cfi_intel_sequence_done(bank, cfi_info->word_write_timeout, status) != ERROR_OK) {
 		retval = cfi_send_command(bank, 0xff, flash_address(bank, 0, 0x0));
 		if (retval != ERROR_OK)
 			return retval;
@@ -2007,7 +2289,8 @@ static int cfi_intel_write_words(struct flash_bank *bank, const uint8_t *word,
 {
 	int retval;
 	struct cfi_flash_bank *cfi_info = bank->driver_priv;
-	struct target *target = bank->target;
+	struct cfi_sequence seq = { .num_ops = 0 };
+	uint8_t xsr[CFI_MAX_BUS_WIDTH], status[CFI_MAX_BUS_WIDTH];
 
 	/* Calculate buffer size and boundary mask
 	 * buffersize is (buffer size per chip) * (number of chips)
@@ -2017,33 +2300,35 @@ static int cfi_intel_write_words(struct flash_bank *bank, const uint8_t *word,
 	uint32_t buffermask = buffersize-1;
 	uint32_t bufferwsize = buffersize / bank->bus_width;
 
-	/* Check for valid range */
-	if (address & buffermask) {
-		LOG_ERROR("Write address at base 0x%" PRIx32 ", address 0x%" PRIx32
-			" not aligned to 2^%d boundary",
-			bank->base, address, cfi_info->max_buf_write_size);
-		return ERROR_FLASH_OPERATION_FAILED;
-	}
-
 	/* Check for valid size */
-	if (wordcount > bufferwsize) {
+	if (wordcount == 0 || wordcount > bufferwsize) {
 		LOG_ERROR("Number of data words %" PRId32 " exceeds available buffersize %" PRId32,
 			wordcount, buffersize);
 		return ERROR_FLASH_OPERATION_FAILED;
 	}
 
+	/* Check for valid range */
+	if ((address & buffermask) + wordcount * bank->bus_width > buffersize) {
+		LOG_ERROR("Write address at base 0x%" PRIx32 ", address 0x%" PRIx32
+			" crosses a 2^%d boundary",
+			bank->base, address, cfi_info->max_buf_write_size);
+		return ERROR_FLASH_OPERATION_FAILED;
+	}
+
 	/* Write to flash buffer */
-	cfi_intel_clear_status_register(bank);
+	cfi_sequence_command(bank, &seq, 0x50, flash_address(bank, 0, 0x0));
 
 	/* Initiate buffer operation _*/
-	retval = cfi_send_command(bank, 0xe8, address);
-	if (retval != ERROR_OK)
-		return retval;
-	uint8_t status;
-	retval = cfi_intel_wait_status_busy(bank, cfi_info->buf_write_timeout, &status);
+	cfi_sequence_command(bank, &seq, 0xe8, address);
+	cfi_sequence_read_status(bank, &seq, xsr);
+
+	retval = cfi_sequence_run(bank, &seq);
 	if (retval != ERROR_OK)
 		return retval;
-	if (status != 0x80) {
+
+	/* the word count and data must only follow once XSR reports the
+	 * buffer available, else they would be taken as commands */
+	if (cfi_intel_sequence_done(bank, cfi_info->buf_write_timeout, xsr) != ERROR_OK) {
 		retval = cfi_send_command(bank, 0xff, flash_address(bank, 0, 0x0));
 		if (retval != ERROR_OK)
 			return retval;
@@ -2056,24 +2341,19 @@ static int cfi_intel_write_words(struct flash_bank *bank, const uint8_t *word,
 	}
 
 	/* Write buffer wordcount-1 and data words */
-	retval = cfi_send_command(bank, bufferwsize-1, address);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = target_write_memory(target, address, bank->bus_width, bufferwsize, word);
-	if (retval != ERROR_OK)
-		return retval;
+	seq.num_ops = 0;
+	cfi_sequence_command(bank, &seq, wordcount - 1, address);
+	cfi_sequence_write(bank, &seq, word, wordcount, address);
 
 	/* Commit write operation */
-	retval = cfi_send_command(bank, 0xd0, address);
-	if (retval != ERROR_OK)
-		return retval;
+	cfi_sequence_command(bank, &seq, 0xd0, address);
+	cfi_sequence_read_status(bank, &seq, status);
 
-	retval = cfi_intel_wait_status_busy(bank, cfi_info->buf_write_timeout, &status);
+	retval = cfi_sequence_run(bank, &seq);
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (status != 0x80) {
+	if (cfi_intel_sequence_done(bank, cfi_info->buf_write_timeout, status) != ERROR_OK) {
 		retval = cfi_send_command(bank, 0xff, flash_address(bank, 0, 0x0));
 		if (retval != ERROR_OK)
 			return retval;
@@ -2091,25 +2371,22 @@ static int cfi_spansion_write_word(struct flash_bank *bank, uint8_t *word, uint3
 	int retval;
 	struct cfi_flash_bank *cfi_info = bank->driver_priv;
 	struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
-	struct target *target = bank->target;
-
-	retval = cfi_send_command(bank, 0xaa, flash_address(bank, 0, pri_ext->_unlock1));
-	if (retval != ERROR_OK)
-		return retval;
+	struct cfi_sequence seq = { .num_ops = 0 };
+	uint8_t oldstatus[CFI_MAX_BUS_WIDTH], status[CFI_MAX_BUS_WIDTH];
 
-	retval = cfi_send_command(bank, 0x55, flash_address(bank, 0, pri_ext->_unlock2));
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = cfi_send_command(bank, 0xa0, flash_address(bank, 0, pri_ext->_unlock1));
-	if (retval != ERROR_OK)
-		return retval;
+	cfi_sequence_command(bank, &seq, 0xaa, flash_address(bank, 0, pri_ext->_unlock1));
+	cfi_sequence_command(bank, &seq, 0x55, flash_address(bank, 0, pri_ext->_unlock2));
+	cfi_sequence_command(bank, &seq, 0xa0, flash_address(bank, 0, pri_ext->_unlock1));
+	cfi_sequence_write(bank, &seq, word, 1, address);
+	cfi_sequence_read_status(bank, &seq, oldstatus);
+	cfi_sequence_read_status(bank, &seq, status);
 
-	retval = target_write_memory(target, address, bank->bus_width, 1, word);
+	retval = cfi_sequence_run(bank, &seq);
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (cfi_spansion_wait_status_busy(bank, cfi_info->word_write_timeout) != ERROR_OK) {
+	if (cfi_spansion_sequence_done(bank, cfi_info->word_write_timeout,
+			oldstatus, status) != ERROR_OK) {
 		retval = cfi_send_command(bank, 0xf0, flash_address(bank, 0, 0x0));
 		if (retval != ERROR_OK)
 			return retval;
@@ -2127,8 +2404,9 @@ static int cfi_spansion_write_words(struct flash_bank *bank, const uint8_t *word
 {
 	int retval;
 	struct cfi_flash_bank *cfi_info = bank->driver_priv;
-	struct target *target = bank->target;
 	struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+	struct cfi_sequence seq = { .num_ops = 0 };
+	uint8_t oldstatus[CFI_MAX_BUS_WIDTH], status[CFI_MAX_BUS_WIDTH];
 
 	/* Calculate buffer size and boundary mask
 	 * buffersize is (buffer size per chip) * (number of chips)
@@ -2138,57 +2416,50 @@ static int cfi_spansion_write_words(struct flash_bank *bank, const uint8_t *word
 	uint32_t buffermask = buffersize-1;
 	uint32_t bufferwsize = buffersize / bank->bus_width;
 
-	/* Check for valid range */
-	if (address & buffermask) {
-		LOG_ERROR("Write address at base 0x%" PRIx32
-			", address 0x%" PRIx32 " not aligned to 2^%d boundary",
-			bank->base, address, cfi_info->max_buf_write_size);
-		return ERROR_FLASH_OPERATION_FAILED;
-	}
-
 	/* Check for valid size */
-	if (wordcount > bufferwsize) {
+	if (wordcount == 0 || wordcount > bufferwsize) {
 		LOG_ERROR("Number of data words %" PRId32 " exceeds available buffersize %"
 			PRId32, wordcount, buffersize);
 		return ERROR_FLASH_OPERATION_FAILED;
 	}
 
-	/* Unlock */
-	retval = cfi_send_command(bank, 0xaa, flash_address(bank, 0, pri_ext->_unlock1));
-	if (retval != ERROR_OK)
-		return retval;
+	/* Check for valid range */
+	if ((address & buffermask) + wordcount * bank->bus_width > buffersize) {
+		LOG_ERROR("Write address at base 0x%" PRIx32
+			", address 0x%" PRIx32 " crosses a 2^%d boundary",
+			bank->base, address, cfi_info->max_buf_write_size);
+		return ERROR_FLASH_OPERATION_FAILED;
+	}
 
-	retval = cfi_send_command(bank, 0x55, flash_address(bank, 0, pri_ext->_unlock2));
-	if (retval != ERROR_OK)
-		return retval;
+	/* Unlock */
+	cfi_sequence_command(bank, &seq, 0xaa, flash_address(bank, 0, pri_ext->_unlock1));
+	cfi_sequence_command(bank, &seq, 0x55, flash_address(bank, 0, pri_ext->_unlock2));
 
 	/* Buffer load command */
-	retval = cfi_send_command(bank, 0x25, address);
-	if (retval != ERROR_OK)
-		return retval;
+	cfi_sequence_command(bank, &seq, 0x25, address);
 
 	/* Write buffer wordcount-1 and data words */
-	retval = cfi_send_command(bank, bufferwsize-1, address);
-	if (retval != ERROR_OK)
-		return retval;
+	cfi_sequence_command(bank, &seq, wordcount - 1, address);
+	cfi_sequence_write(bank, &seq, word, wordcount, address);
 
-	retval = target_write_memory(target, address, bank->bus_width, bufferwsize, word);
-	if (retval != ERROR_OK)
-		return retval;
+	/* Commit write operation, then two reads to see whether DQ6 toggles */
+	cfi_sequence_command(bank, &seq, 0x29, address);
+	cfi_sequence_read_status(bank, &seq, oldstatus);
+	cfi_sequence_read_status(bank, &seq, status);
 
-	/* Commit write operation */
-	retval = cfi_send_command(bank, 0x29, address);
+	retval = cfi_sequence_run(bank, &seq);
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (cfi_spansion_wait_status_busy(bank, cfi_info->buf_write_timeout) != ERROR_OK) {
+	if (cfi_spansion_sequence_done(bank, cfi_info->buf_write_timeout,
+			oldstatus, status) != ERROR_OK) {
 		retval = cfi_send_command(bank, 0xf0, flash_address(bank, 0, 0x0));
 		if (retval != ERROR_OK)
 			return retval;
 
 		LOG_ERROR("couldn't write block at base 0x%" PRIx32
 			", address 0x%" PRIx32 ", size 0x%" PRIx32, bank->base, address,
-			bufferwsize);
+			wordcount);
 		return ERROR_FLASH_OPERATION_FAILED;
 	}
 
@@ -2398,13 +2669,19 @@ static int cfi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t of
 						PRIx32 " bytes remaining", write_p, count);
 				}
 				fallback = 1;
-				if ((bufferwsize > 0) && (count >= buffersize) &&
-						!(write_p & buffermask)) {
-					retval = cfi_write_words(bank, buffer, bufferwsize, write_p);
+				if (bufferwsize > 0) {
+					/* fill the write buffer up to its next boundary, so
+					 * only chips without one program single words */
+					uint32_t thisrun_bytes = buffersize - (write_p & buffermask);
+					if (thisrun_bytes > count)
+						thisrun_bytes = count & ~(bank->bus_width - 1);
+
+					retval = cfi_write_words(bank, buffer,
+							thisrun_bytes / bank->bus_width, write_p);
 					if (retval == ERROR_OK) {
-						buffer += buffersize;
-						write_p += buffersize;
-						count -= buffersize;
+						buffer += thisrun_bytes;
+						write_p += thisrun_bytes;
+						count -= thisrun_bytes;
 						fallback = 0;
 					} else if (retval != ERROR_FLASH_OPER_UNSUPPORTED)
 						return retval;
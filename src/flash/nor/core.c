@@ -38,6 +38,282 @@
 
 static struct flash_bank *flash_banks;
 
+/*
+ * Host copy of the flash contents.  Sectors become known when they are
+ * erased through flash_driver_erase(), and stay known while everything
+ * written to them through flash_driver_write() lands on erased bytes.
+ * Verify and blank checks then need not read those sectors back.
+ *
+ * Only known sectors take host memory, allocated as they are erased.
+ *
+ * Erased flash is assumed to read 0xff, like the default blank check
+ * does.  The copy is dropped whenever the target resumes or halts from
+ * running, since its code may have changed the flash, and whenever
+ * flash_set_dirty() is called.
+ */
+struct flash_shadow {
+	uint32_t size;		/* bank size when allocated */
+	int num_sectors;	/* sector count when allocated */
+	uint8_t **data;		/* per sector, NULL while unknown */
+};
+
+static bool flash_shadow_enabled = true;
+
+static void flash_shadow_drop(struct flash_shadow *shadow, int sector)
+{
+	free(shadow->data[sector]);
+	shadow->data[sector] = NULL;
+}
+
+static void flash_shadow_free(struct flash_bank *bank)
+{
+	if (!bank->shadow)
+		return;
+
+	for (int i = 0; i < bank->shadow->num_sectors; i++)
+		free(bank->shadow->data[i]);
+	free(bank->shadow->data);
+	free(bank->shadow);
+	bank->shadow = NULL;
+}
+
+/* The host copy of a bank, if enabled and matching its current geometry.
+ * With create set it is allocated on demand. */
+static struct flash_shadow *flash_shadow_get(struct flash_bank *bank, bool create)
+{
+	struct flash_shadow *shadow = bank->shadow;
+
+	if (!flash_shadow_enabled)
+		return NULL;
+
+	/* a probe may have changed the bank */
+	if (shadow && (shadow->size != bank->size || shadow->num_sectors != bank->num_sectors)) {
+		flash_shadow_free(bank);
+		shadow = NULL;
+	}
+
+	if (shadow || !create || bank->num_sectors == 0)
+		return shadow;
+
+	shadow = calloc(1, sizeof(*shadow));
+	if (shadow)
+		shadow->data = calloc(bank->num_sectors, sizeof(*shadow->data));
+	if (!shadow || !shadow->data) {
+		LOG_DEBUG("no memory for the shadow of flash bank %d", bank->bank_number);
+		free(shadow);
+		return NULL;
+	}
+
+	shadow->size = bank->size;
+	shadow->num_sectors = bank->num_sectors;
+	bank->shadow = shadow;
+
+	return shadow;
+}
+
+static bool flash_shadow_is_blank(const uint8_t *data, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		if (data[i] != 0xff)
+			return false;
+	}
+	return true;
+}
+
+/* Whether the host copy of a sector can be trusted.  A driver command
+ * like a mass erase updates is_erased without going through the flash
+ * layer, which makes a copy holding data stale. */
+static bool flash_shadow_sector_valid(struct flash_bank *bank,
+		struct flash_shadow *shadow, int sector)
+{
+	struct flash_sector *f = &bank->sectors[sector];
+
+	if (!shadow->data[sector])
+		return false;
+
+	if (f->is_erased == 1 && !flash_shadow_is_blank(shadow->data[sector], f->size)) {
+		flash_shadow_drop(shadow, sector);
+		return false;
+	}
+
+	return true;
+}
+
+void flash_shadow_invalidate(struct flash_bank *bank)
+{
+	if (!bank->shadow)
+		return;
+
+	for (int i = 0; i < bank->shadow->num_sectors; i++)
+		flash_shadow_drop(bank->shadow, i);
+}
+
+void flash_shadow_enable(bool enable)
+{
+	flash_shadow_enabled = enable;
+
+	if (!enable) {
+		for (struct flash_bank *bank = flash_banks; bank; bank = bank->next)
+			flash_shadow_free(bank);
+	}
+}
+
+bool flash_shadow_is_enabled(void)
+{
+	return flash_shadow_enabled;
+}
+
+static void flash_shadow_erase(struct flash_bank *bank, int first, int last, bool erased)
+{
+	struct flash_shadow *shadow = flash_shadow_get(bank, erased);
+
+	if (!shadow)
+		return;
+
+	for (int i = first; i <= last && i < shadow->num_sectors; i++) {
+		struct flash_sector *f = &bank->sectors[i];
+
+		if (!erased) {
+			flash_shadow_drop(shadow, i);
+			continue;
+		}
+
+		if (!shadow->data[i])
+			shadow->data[i] = malloc(f->size);
+		if (shadow->data[i])
+			memset(shadow->data[i], 0xff, f->size);
+	}
+}
+
+static void flash_shadow_write(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count, bool written)
+{
+	struct flash_shadow *shadow = flash_shadow_get(bank, false);
+
+	if (!shadow)
+		return;
+
+	for (int i = 0; i < shadow->num_sectors; i++) {
+		struct flash_sector *f = &bank->sectors[i];
+		uint32_t start = MAX(offset, f->offset);
+		uint32_t end = MIN(offset + count, f->offset + f->size);
+
+		if (start >= end || !flash_shadow_sector_valid(bank, shadow, i))
+			continue;
+
+		if (!written) {
+			flash_shadow_drop(shadow, i);
+			continue;
+		}
+
+		/* bytes programmed over data may not read back as written */
+		uint8_t *data = shadow->data[i] + (start - f->offset);
+		const uint8_t *src = buffer + (start - offset);
+		for (uint32_t j = 0; j < end - start; j++) {
+			if (data[j] != 0xff && data[j] != src[j]) {
+				flash_shadow_drop(shadow, i);
+				break;
+			}
+		}
+		if (!shadow->data[i])
+			continue;
+
+		memcpy(data, src, end - start);
+		if (!flash_shadow_is_blank(src, end - start))
+			f->is_erased = 0;
+	}
+}
+
+/* The erase state of a sector according to the host copy: 0 = not
+ * erased, 1 = erased, -1 = unknown. */
+static int flash_shadow_erase_state(struct flash_bank *bank, int sector)
+{
+	struct flash_shadow *shadow = flash_shadow_get(bank, false);
+
+	if (!shadow || sector >= shadow->num_sectors ||
+			!flash_shadow_sector_valid(bank, shadow, sector))
+		return -1;
+
+	struct flash_sector *f = &bank->sectors[sector];
+	return flash_shadow_is_blank(shadow->data[sector], f->size);
+}
+
+int flash_shadow_checksum(struct target *target,
+		uint32_t address, uint32_t count, uint32_t *checksum)
+{
+	struct flash_bank *bank;
+
+	if (!flash_shadow_enabled || target->state != TARGET_HALTED || count == 0)
+		return ERROR_FAIL;
+
+	for (bank = flash_banks; bank; bank = bank->next) {
+		if (bank->target == target && address >= bank->base &&
+				address - bank->base < bank->size)
+			break;
+	}
+	if (!bank)
+		return ERROR_FAIL;
+
+	uint32_t offset = address - bank->base;
+	if (count > bank->size - offset)
+		return ERROR_FAIL;
+
+	struct flash_shadow *shadow = flash_shadow_get(bank, false);
+	if (!shadow)
+		return ERROR_FAIL;
+
+	/* every byte must lie in a known sector */
+	uint32_t covered = offset;
+	for (int i = 0; i < shadow->num_sectors && covered < offset + count; i++) {
+		struct flash_sector *f = &bank->sectors[i];
+
+		if (f->offset > covered || f->offset + f->size <= covered)
+			continue;
+		if (!flash_shadow_sector_valid(bank, shadow, i))
+			return ERROR_FAIL;
+		covered = f->offset + f->size;
+		i = -1;		/* sectors need not be sorted */
+	}
+	if (covered < offset + count)
+		return ERROR_FAIL;
+
+	/* gather the range, as large as what the caller verifies against */
+	uint8_t *data = malloc(count);
+	if (!data)
+		return ERROR_FAIL;
+
+	for (int i = 0; i < shadow->num_sectors; i++) {
+		struct flash_sector *f = &bank->sectors[i];
+		uint32_t start = MAX(offset, f->offset);
+		uint32_t end = MIN(offset + count, f->offset + f->size);
+
+		if (start < end)
+			memcpy(data + (start - offset), shadow->data[i] + (start - f->offset),
+					end - start);
+	}
+
+	LOG_DEBUG("checksum of 0x%8.8" PRIx32 " (%" PRIu32 " bytes) from flash shadow",
+			address, count);
+
+	int retval = image_calculate_checksum(data, count, checksum);
+	free(data);
+	return retval;
+}
+
+static int flash_shadow_target_event(struct target *target,
+		enum target_event event, void *priv)
+{
+	if (event != TARGET_EVENT_RESUMED && event != TARGET_EVENT_HALTED)
+		return ERROR_OK;
+
+	for (struct flash_bank *bank = flash_banks; bank; bank = bank->next) {
+		if (bank->target == target)
+			flash_shadow_invalidate(bank);
+	}
+
+	return ERROR_OK;
+}
+
 int flash_driver_erase(struct flash_bank *bank, int first, int last)
 {
 	int retval;
@@ -46,6 +322,104 @@ int flash_driver_erase(struct flash_bank *bank, int first, int last)
 	if (retval != ERROR_OK)
 		LOG_ERROR("failed erasing sectors %d to %d", first, last);
 
+	flash_shadow_erase(bank, first, last, retval == ERROR_OK);
+
+	return retval;
+}
+
+/*
+ * Erases started through flash_driver_erase_start() which have not been
+ * seen to complete yet.  Banks whose drivers implement erase_start and
+ * erase_poll are erased in the background, so several banks can erase
+ * at once, and one bank can erase while another is being programmed.
+ */
+struct flash_erase_job {
+	struct flash_bank *bank;
+	int first;
+	int last;
+	struct flash_erase_job *next;
+};
+
+static struct flash_erase_job *flash_erase_jobs;
+
+static int flash_driver_erase_start(struct flash_bank *bank, int first, int last)
+{
+	int retval;
+
+	if (!bank->driver->erase_start || !bank->driver->erase_poll)
+		return flash_driver_erase(bank, first, last);
+
+	retval = bank->driver->erase_start(bank, first, last);
+	if (retval == ERROR_FLASH_OPER_UNSUPPORTED)
+		return flash_driver_erase(bank, first, last);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("failed erasing sectors %d to %d", first, last);
+		flash_shadow_erase(bank, first, last, false);
+		return retval;
+	}
+
+	struct flash_erase_job *job = malloc(sizeof(*job));
+	if (!job) {
+		/* the erase is running; wait for it here instead */
+		do {
+			retval = bank->driver->erase_poll(bank);
+		} while (retval == ERROR_FLASH_BUSY);
+		flash_shadow_erase(bank, first, last, retval == ERROR_OK);
+		return retval;
+	}
+
+	LOG_DEBUG("erasing sectors %d to %d of %s in the background",
+		first, last, bank->name);
+
+	job->bank = bank;
+	job->first = first;
+	job->last = last;
+	job->next = flash_erase_jobs;
+	flash_erase_jobs = job;
+
+	return ERROR_OK;
+}
+
+/**
+ * Check on the background erases, retiring those which have completed.
+ * With @a wait, keep polling until none is left.  Failed erases are
+ * reported, and the first failure is returned.
+ */
+static int flash_erase_poll(bool wait)
+{
+	int retval = ERROR_OK;
+
+	while (flash_erase_jobs) {
+		struct flash_erase_job **p = &flash_erase_jobs;
+
+		while (*p) {
+			struct flash_erase_job *job = *p;
+			int status = job->bank->driver->erase_poll(job->bank);
+
+			if (status == ERROR_FLASH_BUSY) {
+				p = &job->next;
+				continue;
+			}
+
+			if (status != ERROR_OK) {
+				LOG_ERROR("failed erasing sectors %d to %d",
+					job->first, job->last);
+				if (retval == ERROR_OK)
+					retval = status;
+			}
+			flash_shadow_erase(job->bank, job->first, job->last,
+				status == ERROR_OK);
+
+			*p = job->next;
+			free(job);
+		}
+
+		if (!wait || !flash_erase_jobs)
+			break;
+
+		alive_sleep(1);
+	}
+
 	return retval;
 }
 
@@ -93,6 +467,33 @@ int flash_driver_write(struct flash_bank *bank,
 			offset);
 	}
 
+	flash_shadow_write(bank, buffer, offset, count, retval == ERROR_OK);
+
+	return retval;
+}
+
+static int flash_driver_erase_write(struct flash_bank *bank, int first, int last,
+	uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	int retval;
+
+	retval = bank->driver->erase_write(bank, first, last, buffer, offset, count);
+	if (retval == ERROR_FLASH_OPER_UNSUPPORTED) {
+		retval = flash_driver_erase(bank, first, last);
+		if (retval != ERROR_OK)
+			return retval;
+		return flash_driver_write(bank, buffer, offset, count);
+	}
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("failed erasing sectors %d to %d and writing to flash "
+			"at address 0x%08" PRIx32 " at offset 0x%8.8" PRIx32,
+			first, last, bank->base, offset);
+	}
+
+	flash_shadow_erase(bank, first, last, retval == ERROR_OK);
+	flash_shadow_write(bank, buffer, offset, count, retval == ERROR_OK);
+
 	return retval;
 }
 
@@ -133,8 +534,10 @@ void flash_bank_add(struct flash_bank *bank)
 		}
 		p->next = bank;
 		bank_num += 1;
-	} else
+	} else {
 		flash_banks = bank;
+		target_register_event_callback(flash_shadow_target_event, NULL);
+	}
 
 	bank->bank_number = bank_num;
 }
@@ -273,6 +676,12 @@ static int default_flash_mem_blank_check(struct flash_bank *bank)
 
 	for (i = 0; i < bank->num_sectors; i++) {
 		uint32_t j;
+		int state = flash_shadow_erase_state(bank, i);
+		if (state >= 0) {
+			bank->sectors[i].is_erased = state;
+			continue;
+		}
+
 		bank->sectors[i].is_erased = 1;
 
 		for (j = 0; j < bank->sectors[i].size; j += buffer_size) {
@@ -320,6 +729,13 @@ int default_flash_blank_check(struct flash_bank *bank)
 	for (i = 0; i < bank->num_sectors; i++) {
 		uint32_t address = bank->base + bank->sectors[i].offset;
 		uint32_t size = bank->sectors[i].size;
+		int state = flash_shadow_erase_state(bank, i);
+
+		if (state >= 0) {
+			bank->sectors[i].is_erased = state;
+			fast_check = 1;
+			continue;
+		}
 
 		retval = target_blank_check_memory(target, address, size, &blank);
 		if (retval != ERROR_OK) {
@@ -504,11 +920,24 @@ static int flash_iterate_address_range(struct target *target,
 	return retval;
 }
 
-int flash_erase_address_range(struct target *target,
+/* Start the erase of every bank in the range, then wait for the banks
+ * erasing in the background; a range spanning banks with independent
+ * erase hardware thus takes about as long as its slowest bank.
+ */
+static int flash_erase_address_range_start(struct target *target,
 	bool pad, uint32_t addr, uint32_t length)
 {
 	return flash_iterate_address_range(target, pad ? "erase" : NULL,
-		addr, length, &flash_driver_erase);
+		addr, length, &flash_driver_erase_start);
+}
+
+int flash_erase_address_range(struct target *target,
+	bool pad, uint32_t addr, uint32_t length)
+{
+	int retval = flash_erase_address_range_start(target, pad, addr, length);
+	int wait_retval = flash_erase_poll(true);
+
+	return retval != ERROR_OK ? retval : wait_retval;
 }
 
 static int flash_driver_unprotect(struct flash_bank *bank, int first, int last)
@@ -540,44 +969,45 @@ static int compare_section(const void *a, const void *b)
 		return -1;
 }
 
-int flash_write_unlock(struct target *target, struct image *image,
-	uint32_t *written, int erase, bool unlock)
-{
-	int retval = ERROR_OK;
-
+/* One stretch of the image within a single flash bank, read into a buffer */
+struct flash_write_run {
+	struct flash_bank *bank;
+	uint32_t address;
+	uint32_t size;
+	uint8_t *buffer;
+};
+
+/* Where flash_write_unlock() is within the sorted image sections */
+struct flash_write_state {
+	struct target *target;
+	struct image *image;
+	struct imagesection **sections;
+	int *padding;
 	int section;
 	uint32_t section_offset;
-	struct flash_bank *c;
-	int *padding;
+	bool pad_sectors;
+};
 
-	section = 0;
-	section_offset = 0;
-
-	if (written)
-		*written = 0;
-
-	if (erase) {
-		/* assume all sectors need erasing - stops any problems
-		 * when flash_write is called multiple times */
-
-		flash_set_dirty();
-	}
-
-	/* allocate padding array */
-	padding = calloc(image->num_sections, sizeof(*padding));
-
-	/* This fn requires all sections to be in ascending order of addresses,
-	 * whereas an image can have sections out of order. */
-	struct imagesection **sections = malloc(sizeof(struct imagesection *) *
-			image->num_sections);
-	int i;
-	for (i = 0; i < image->num_sections; i++)
-		sections[i] = &image->sections[i];
+/**
+ * Read the next run of the image: the consecutive sections which fall
+ * into one flash bank, combined into one buffer.  At the end of the image
+ * ERROR_OK is returned and @c run->buffer is left NULL.
+ */
+static int flash_write_read_run(struct flash_write_state *state,
+	struct flash_write_run *run)
+{
+	struct target *target = state->target;
+	struct image *image = state->image;
+	struct imagesection **sections = state->sections;
+	int *padding = state->padding;
+	int section = state->section;
+	uint32_t section_offset = state->section_offset;
+	struct flash_bank *c;
+	int retval = ERROR_OK;
 
-	qsort(sections, image->num_sections, sizeof(struct imagesection *),
-		compare_section);
+	run->buffer = NULL;
 
-	/* loop until we reach end of the image */
+	/* loop until we find a run or reach end of the image */
 	while (section < image->num_sections) {
 		uint32_t buffer_size;
 		uint8_t *buffer;
@@ -657,7 +1087,7 @@ int flash_write_unlock(struct target *target, struct image *image,
 		/* If we're applying any sector automagic, then pad this
 		 * (maybe-combined) segment to the end of its last sector.
 		 */
-		if (unlock || erase) {
+		if (state->pad_sectors) {
 			int sector;
 			uint32_t offset_start = run_address - c->base;
 			uint32_t offset_end = offset_start + run_size;
@@ -724,37 +1154,196 @@ int flash_write_unlock(struct target *target, struct image *image,
 			}
 		}
 
-		retval = ERROR_OK;
+		run->bank = c;
+		run->address = run_address;
+		run->size = run_size;
+		run->buffer = buffer;
+		break;
+	}
 
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
+done:
+	state->section = section;
+	state->section_offset = section_offset;
+
+	return retval;
+}
+
+/* While other banks erase in the background, runs are programmed in
+ * chunks of about this size, ending on sector boundaries, so that those
+ * erases can be moved on from one sector to the next in between.
+ */
+#define FLASH_WRITE_CHUNK 0x2000
+
+static int flash_write_run(struct flash_write_run *run)
+{
+	struct flash_bank *c = run->bank;
+	uint32_t start = run->address - c->base;
+	uint32_t run_end = start + run->size;
+	uint32_t offset = start;
+	int retval;
+
+	while (flash_erase_jobs && offset < run_end) {
+		uint32_t chunk_end = run_end;
+
+		for (int i = 0; i < c->num_sectors; i++) {
+			uint32_t end = c->sectors[i].offset + c->sectors[i].size;
+
+			if (end >= offset + FLASH_WRITE_CHUNK) {
+				if (end < chunk_end)
+					chunk_end = end;
+				break;
+			}
+		}
+
+		retval = flash_driver_write(c, run->buffer + (offset - start), offset,
+				chunk_end - offset);
+		if (retval != ERROR_OK)
+			return retval;
+		offset = chunk_end;
+
+		retval = flash_erase_poll(false);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (offset == run_end)
+		return ERROR_OK;
+
+	return flash_driver_write(c, run->buffer + (offset - start),
+			offset, run_end - offset);
+}
+
+/* the run being handled by flash_erase_write_address_range() */
+static struct flash_write_run *flash_erase_write_run;
+
+static int flash_erase_write_sectors(struct flash_bank *bank, int first, int last)
+{
+	struct flash_write_run *run = flash_erase_write_run;
+
+	return flash_driver_erase_write(bank, first, last, run->buffer,
+			run->address - bank->base, run->size);
+}
+
+/* Erase and program a run in one go, through the driver's erase_write */
+static int flash_erase_write_address_range(struct target *target,
+	struct flash_write_run *run)
+{
+	int retval;
+
+	flash_erase_write_run = run;
+	retval = flash_iterate_address_range(target, "erase",
+			run->address, run->size, &flash_erase_write_sectors);
+	flash_erase_write_run = NULL;
+
+	return retval;
+}
+
+int flash_write_unlock(struct target *target, struct image *image,
+	uint32_t *written, int erase, bool unlock)
+{
+	int retval = ERROR_OK;
+	struct flash_write_state state;
+	struct flash_write_run run, next;
+	bool run_erasing = false;
+
+	if (written)
+		*written = 0;
+
+	if (erase) {
+		/* assume all sectors need erasing - stops any problems
+		 * when flash_write is called multiple times */
+
+		flash_set_dirty();
+	}
+
+	state.target = target;
+	state.image = image;
+	state.section = 0;
+	state.section_offset = 0;
+	state.pad_sectors = unlock || erase;
+
+	/* allocate padding array */
+	state.padding = calloc(image->num_sections, sizeof(*state.padding));
+
+	/* This fn requires all sections to be in ascending order of addresses,
+	 * whereas an image can have sections out of order. */
+	state.sections = malloc(sizeof(struct imagesection *) *
+			image->num_sections);
+	int i;
+	for (i = 0; i < image->num_sections; i++)
+		state.sections[i] = &image->sections[i];
+
+	qsort(state.sections, image->num_sections, sizeof(struct imagesection *),
+		compare_section);
+
+	retval = flash_write_read_run(&state, &run);
+
+	/* loop until we reach end of the image */
+	while (retval == ERROR_OK && run.buffer) {
+		bool next_erasing = false;
+		bool erase_write = erase && !run_erasing && run.bank->driver->erase_write;
+		int next_retval;
+
+		/* the erase of this run may already have been started below */
+		if (unlock && !run_erasing)
+			retval = flash_unlock_address_range(target, run.address, run.size);
 		if (retval == ERROR_OK) {
-			if (erase) {
+			if (erase && run_erasing)
+				retval = flash_erase_poll(true);
+			else if (erase && !erase_write) {
 				/* calculate and erase sectors */
 				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
+						true, run.address, run.size);
 			}
 		}
 
+		/* When the next run lies in a bank which can erase in the
+		 * background, start that erase now so it overlaps with the
+		 * programming of this run.  Other drivers keep erasing just
+		 * before they program.
+		 */
+		next_retval = flash_write_read_run(&state, &next);
+		if (retval == ERROR_OK && erase && next_retval == ERROR_OK && next.buffer
+				&& next.bank != run.bank && next.bank->driver->erase_start) {
+			if (unlock)
+				retval = flash_unlock_address_range(target, next.address, next.size);
+			if (retval == ERROR_OK)
+				retval = flash_erase_address_range_start(target,
+						true, next.address, next.size);
+			next_erasing = true;
+		}
+
 		if (retval == ERROR_OK) {
-			/* write flash sectors */
-			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+			/* write flash sectors, or erase and write them together */
+			if (erase_write)
+				retval = flash_erase_write_address_range(target, &run);
+			else
+				retval = flash_write_run(&run);
 		}
 
-		free(buffer);
+		free(run.buffer);
 
 		if (retval != ERROR_OK) {
 			/* abort operation */
-			goto done;
+			free(next.buffer);
+			break;
 		}
 
 		if (written != NULL)
-			*written += run_size;	/* add run size to total written counter */
+			*written += run.size;	/* add run size to total written counter */
+
+		run = next;
+		run_erasing = next_erasing;
+		retval = next_retval;
 	}
 
-done:
-	free(sections);
-	free(padding);
+	/* never leave an erase running behind */
+	int erase_retval = flash_erase_poll(true);
+	if (retval == ERROR_OK)
+		retval = erase_retval;
+
+	free(state.sections);
+	free(state.padding);
 
 	return retval;
 }
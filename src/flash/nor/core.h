@@ -32,6 +32,7 @@
  */
 
 struct image;
+struct flash_shadow;
 
 #define FLASH_MAX_ERROR_STR	(128)
 
@@ -100,6 +101,10 @@ struct flash_bank {
 	/** Array of sectors, allocated and initilized by the flash driver */
 	struct flash_sector *sectors;
 
+	/** Host copy of the sectors written or erased in this session,
+	 * see flash_shadow_checksum() */
+	struct flash_shadow *shadow;
+
 	struct flash_bank *next; /**< The next flash bank on this chip */
 };
 
@@ -137,6 +142,20 @@ int flash_write(struct target *target,
  * This routine must be called when the system may modify the status.
  */
 void flash_set_dirty(void);
+/**
+ * Computes the checksum of flash contents from the host copy of the
+ * sectors previously written or erased through the flash layer, so a
+ * verify does not have to read them back from the target.
+ * @param target The target with the flash.
+ * @param address The start address of the range, which must lie in one bank.
+ * @param count The number of bytes.
+ * @param checksum On success, the checksum as image_calculate_checksum()
+ * computes it.
+ * @returns ERROR_OK if the whole range is known; otherwise, an error
+ * code and the caller must read the target.
+ */
+int flash_shadow_checksum(struct target *target,
+		uint32_t address, uint32_t count, uint32_t *checksum);
 /** @returns The number of flash banks currently defined. */
 int flash_get_bank_count(void);
 /**
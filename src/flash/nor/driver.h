@@ -108,6 +108,54 @@ struct flash_driver {
 	 */
 	int (*erase)(struct flash_bank *bank, int first, int last);
 
+	/**
+	 * Optional.  Start erasing the specified sectors and return
+	 * without waiting for completion, so that the flash core can
+	 * program another bank while this one erases.  Progress is
+	 * driven by flash_driver_s::erase_poll, which must be provided
+	 * as well.  Only drivers whose banks have independent erase
+	 * hardware should offer this.
+	 *
+	 * @param bank The bank of flash to be erased.
+	 * @param first The number of the first sector to erase.
+	 * @param last The number of the last sector to erase.
+	 * @returns ERROR_OK if the erase was started;
+	 * ERROR_FLASH_OPER_UNSUPPORTED if this bank cannot be erased in
+	 * the background, in which case flash_driver_s::erase is used;
+	 * otherwise, an error code.
+	 */
+	int (*erase_start)(struct flash_bank *bank, int first, int last);
+
+	/**
+	 * Check on an erase begun by flash_driver_s::erase_start and, for
+	 * erases done in several steps, start the next step.  The driver
+	 * is responsible for timing out an erase which never completes.
+	 *
+	 * @param bank The bank being erased.
+	 * @returns ERROR_OK once all sectors are erased; ERROR_FLASH_BUSY
+	 * while the erase is still in progress; otherwise, an error code.
+	 */
+	int (*erase_poll)(struct flash_bank *bank);
+
+	/**
+	 * Optional.  Erase the specified sectors and program data into
+	 * them in one operation, for drivers whose flash loader can erase
+	 * ahead of the data it programs.  The erase then overlaps with
+	 * the transfer of the data to the target.
+	 *
+	 * @param bank The bank to erase and program.
+	 * @param first The number of the first sector to erase.
+	 * @param last The number of the last sector to erase.
+	 * @param buffer The data bytes to write.
+	 * @param offset The offset into the chip to program.
+	 * @param count The number of bytes to write.
+	 * @returns ERROR_OK if successful; ERROR_FLASH_OPER_UNSUPPORTED,
+	 * before anything was changed, to have flash_driver_s::erase and
+	 * flash_driver_s::write used instead; otherwise, an error code.
+	 */
+	int (*erase_write)(struct flash_bank *bank, int first, int last,
+			const uint8_t *buffer, uint32_t offset, uint32_t count);
+
 	/**
 	 * Bank/sector protection routine (target-specific).
 	 *
@@ -44,6 +44,18 @@ int flash_driver_write(struct flash_bank *bank,
 int flash_driver_read(struct flash_bank *bank,
 		uint8_t *buffer, uint32_t offset, uint32_t count);
 
+/**
+ * Forgets the host copy of the contents of @a bank, e.g. because code
+ * running on the target may have changed them.
+ */
+void flash_shadow_invalidate(struct flash_bank *bank);
+/**
+ * Enables or disables the host copy of the flash contents for all banks.
+ * When disabled, verify and blank checks always read the target.
+ */
+void flash_shadow_enable(bool enable);
+bool flash_shadow_is_enabled(void);
+
 /* write (optional verify) an image to flash memory of the given target */
 int flash_write_unlock(struct target *target, struct image *image,
 		uint32_t *written, int erase, bool unlock);
@@ -487,67 +487,65 @@ FLASH_BANK_COMMAND_HANDLER(kinetis_flash_bank_command)
 	return ERROR_OK;
 }
 
-/* Kinetis Program-LongWord Microcodes */
+/* Kinetis Program-LongWord Microcodes, see contrib/loaders/flash/kinetis.S for src */
 static const uint8_t kinetis_flash_write_code[] = {
 	/* Params:
-	 * r0 - workarea buffer
-	* r1 - target address
-	* r2 - wordcount
-	* Clobbered:
-	* r4 - tmp
-	* r5 - tmp
-	* r6 - tmp
-	* r7 - tmp
-	*/
-
-							/* .L1: */
-						/* for(register uint32_t i=0;i<wcount;i++){ */
-	0x04, 0x1C,					/* mov    r4, r0          */
-	0x00, 0x23,					/* mov    r3, #0          */
-							/* .L2: */
-	0x0E, 0x1A,					/* sub    r6, r1, r0      */
-	0xA6, 0x19,					/* add    r6, r4, r6      */
-	0x93, 0x42,					/* cmp    r3, r2          */
-	0x16, 0xD0,					/* beq    .L9             */
-							/* .L5: */
-						/* while((FTFx_FSTAT&FTFA_FSTAT_CCIF_MASK) != FTFA_FSTAT_CCIF_MASK){}; */
-	0x0B, 0x4D,					/* ldr    r5, .L10        */
-	0x2F, 0x78,					/* ldrb   r7, [r5]        */
-	0x7F, 0xB2,					/* sxtb   r7, r7          */
-	0x00, 0x2F,					/* cmp    r7, #0          */
-	0xFA, 0xDA,					/* bge    .L5             */
-						/* FTFx_FSTAT = FTFA_FSTAT_ACCERR_MASK|FTFA_FSTAT_FPVIOL_MASK|FTFA_FSTAT_RDCO */
-	0x70, 0x27,					/* mov    r7, #112        */
-	0x2F, 0x70,					/* strb   r7, [r5]        */
-						/* FTFx_FCCOB3 = faddr; */
-	0x09, 0x4F,					/* ldr    r7, .L10+4      */
-	0x3E, 0x60,					/* str    r6, [r7]        */
-	0x06, 0x27,					/* mov    r7, #6          */
-						/* FTFx_FCCOB0 = 0x06;  */
-	0x08, 0x4E,					/* ldr    r6, .L10+8      */
-	0x37, 0x70,					/* strb   r7, [r6]        */
-						/* FTFx_FCCOB7 = *pLW;  */
-	0x80, 0xCC,					/* ldmia  r4!, {r7}       */
-	0x08, 0x4E,					/* ldr    r6, .L10+12     */
-	0x37, 0x60,					/* str    r7, [r6]        */
-						/* FTFx_FSTAT = FTFA_FSTAT_CCIF_MASK; */
-	0x80, 0x27,					/* mov    r7, #128        */
-	0x2F, 0x70,					/* strb   r7, [r5]        */
-							/* .L4: */
-						/* while((FTFx_FSTAT&FTFA_FSTAT_CCIF_MASK) != FTFA_FSTAT_CCIF_MASK){}; */
-	0x2E, 0x78,					/* ldrb    r6, [r5]       */
-	0x77, 0xB2,					/* sxtb    r7, r6         */
-	0x00, 0x2F,					/* cmp     r7, #0         */
-	0xFB, 0xDA,					/* bge     .L4            */
-	0x01, 0x33,					/* add     r3, r3, #1     */
-	0xE4, 0xE7,					/* b       .L2            */
-							/* .L9: */
-	0x00, 0xBE,					/* bkpt #0                */
-							/* .L10: */
-	0x00, 0x00, 0x02, 0x40,		/* .word    1073872896    */
-	0x04, 0x00, 0x02, 0x40,		/* .word    1073872900    */
-	0x07, 0x00, 0x02, 0x40,		/* .word    1073872903    */
-	0x08, 0x00, 0x02, 0x40,		/* .word    1073872904    */
+	 * r0 - longword count (in), FSTAT on error (out)
+	 * r1 - workarea start
+	 * r2 - workarea end
+	 * r3 - target address
+	 * Clobbered:
+	 * r4 - rp
+	 * r5 - wp, tmp
+	 * r6 - FTFx base
+	 * r7 - tmp
+	 */
+		0x12, 0x4e,               /* ldr r6, ftfx_fstat */
+	/* wait_fifo: */
+		0x0d, 0x68,               /* ldr r5, [r1, #0] */
+		0x00, 0x2d,               /* cmp r5, #0 */
+		0x20, 0xd0,               /* beq exit */
+		0x4c, 0x68,               /* ldr r4, [r1, #4] */
+		0xac, 0x42,               /* cmp r4, r5 */
+		0xf9, 0xd0,               /* beq wait_fifo */
+	/* ready: */
+		0x37, 0x78,               /* ldrb r7, [r6] */
+		0x7f, 0x06,               /* lsls r7, r7, #25 */
+		0xfc, 0xd3,               /* bcc ready */
+		0x70, 0x27,               /* movs r7, #0x70 */
+		0x37, 0x70,               /* strb r7, [r6] */
+		0x73, 0x60,               /* str r3, [r6, #4] */
+		0x06, 0x27,               /* movs r7, #0x06 */
+		0xf7, 0x71,               /* strb r7, [r6, #7] */
+		0x80, 0xcc,               /* ldmia r4!, {r7} */
+		0xb7, 0x60,               /* str r7, [r6, #8] */
+		0x80, 0x27,               /* movs r7, #0x80 */
+		0x37, 0x70,               /* strb r7, [r6] */
+	/* busy: */
+		0x37, 0x78,               /* ldrb r7, [r6] */
+		0x7d, 0x06,               /* lsls r5, r7, #25 */
+		0xfc, 0xd3,               /* bcc busy */
+		0x71, 0x25,               /* movs r5, #0x71 */
+		0x2f, 0x42,               /* tst r7, r5 */
+		0x08, 0xd1,               /* bne error */
+		0x04, 0x33,               /* adds r3, #4 */
+		0x94, 0x42,               /* cmp r4, r2 */
+		0x01, 0xd3,               /* bcc no_wrap */
+		0x0c, 0x46,               /* mov r4, r1 */
+		0x08, 0x34,               /* adds r4, #8 */
+	/* no_wrap: */
+		0x4c, 0x60,               /* str r4, [r1, #4] */
+		0x40, 0x1e,               /* subs r0, r0, #1 */
+		0xdf, 0xd1,               /* bne wait_fifo */
+		0x02, 0xe0,               /* b exit */
+	/* error: */
+		0x38, 0x46,               /* mov r0, r7 */
+		0x00, 0x25,               /* movs r5, #0 */
+		0x4d, 0x60,               /* str r5, [r1, #4] */
+	/* exit: */
+		0x00, 0xbe,               /* bkpt #0 */
+	/* ftfx_fstat: */
+		0x00, 0x00, 0x02, 0x40,   /* .word 0x40020000 */
 };
 
 /* Program LongWord Block Write */
@@ -559,21 +557,10 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	struct working_area *write_algorithm;
 	struct working_area *source;
 	uint32_t address = bank->base + offset;
-	struct reg_param reg_params[3];
+	struct reg_param reg_params[4];
 	struct armv7m_algorithm armv7m_info;
 	int retval = ERROR_OK;
 
-	/* Params:
-	 * r0 - workarea buffer
-	 * r1 - target address
-	 * r2 - wordcount
-	 * Clobbered:
-	 * r4 - tmp
-	 * r5 - tmp
-	 * r6 - tmp
-	 * r7 - tmp
-	 */
-
 	/* Increase buffer_size if needed */
 	if (buffer_size < (target->working_area_size/2))
 		buffer_size = (target->working_area_size/2);
@@ -595,12 +582,16 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 
 	retval = target_write_buffer(target, write_algorithm->address,
 		sizeof(kinetis_flash_write_code), kinetis_flash_write_code);
-	if (retval != ERROR_OK)
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
 		return retval;
+	}
 
-	/* memory buffer */
-	while (target_alloc_working_area(target, buffer_size, &source) != ERROR_OK) {
+	/* memory buffer, the fifo is consumed a longword at a time */
+	buffer_size &= ~3UL;
+	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
 		buffer_size /= 4;
+		buffer_size &= ~3UL;
 		if (buffer_size <= 256) {
 			/* free working area, write algorithm already allocated */
 			target_free_working_area(target, write_algorithm);
@@ -613,35 +604,35 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
-	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT); /* *pLW (*buffer) */
-	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT); /* faddr */
-	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT); /* number of words to program */
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* longword count (in), FSTAT (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer start */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* target address */
 
-	/* write code buffer and use Flash programming code within kinetis       */
-	/* Set breakpoint to 0 with time-out of 1000 ms                          */
-	while (wcount > 0) {
-		uint32_t thisrun_count = (wcount > (buffer_size / 4)) ? (buffer_size / 4) : wcount;
+	buf_set_u32(reg_params[0].value, 0, 32, wcount);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[3].value, 0, 32, address);
 
-		retval = target_write_buffer(target, source->address, thisrun_count * 4, buffer);
-		if (retval != ERROR_OK)
-			break;
+	retval = target_run_flash_async_algorithm(target, buffer, wcount, 4,
+			0, NULL,
+			4, reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
 
-		buf_set_u32(reg_params[0].value, 0, 32, source->address);
-		buf_set_u32(reg_params[1].value, 0, 32, address);
-		buf_set_u32(reg_params[2].value, 0, 32, thisrun_count);
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		uint32_t fstat = buf_get_u32(reg_params[0].value, 0, 32);
 
-		retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-				write_algorithm->address, 0, 100000, &armv7m_info);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error executing kinetis Flash programming algorithm");
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-		}
+		LOG_ERROR("flash write failed at address 0x%" PRIx32 ", FSTAT 0x%02" PRIx32,
+				buf_get_u32(reg_params[3].value, 0, 32), fstat);
 
-		buffer += thisrun_count * 4;
-		address += thisrun_count * 4;
-		wcount -= thisrun_count;
-	}
+		if (fstat & 0x10)
+			LOG_ERROR("flash memory write protected");
+		if (fstat & 0x01)
+			LOG_ERROR("flash memory not erased before writing");
+	} else if (retval != ERROR_OK)
+		LOG_ERROR("Error executing kinetis Flash programming algorithm");
 
 	target_free_working_area(target, source);
 	target_free_working_area(target, write_algorithm);
@@ -649,6 +640,7 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
 
 	return retval;
 }
@@ -1017,7 +1009,10 @@ static int kinetis_write(struct flash_bank *bank, const uint8_t *buffer,
 		/* try using a block write */
 		int retval = kinetis_write_block(bank, buffer, offset, words_remaining);
 
-		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+		if (retval != ERROR_OK && retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+			free(new_buffer);
+			return retval;
+		} else if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
 			/* if block write failed (no sufficient working area),
 			 * we use normal (slow) single word accesses */
 			LOG_WARNING("couldn't use block writes, falling back to single "
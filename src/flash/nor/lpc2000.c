@@ -688,47 +688,61 @@ static int lpc2000_iap_working_area_init(struct flash_bank *bank, struct working
 
 /* call LPC8xx/LPC1xxx/LPC4xxx/LPC5410x/LPC2000 IAP function */
 
-static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_working_area, int code,
-		uint32_t param_table[5], uint32_t result_table[4])
+/* address of the IAP entry in the boot ROM */
+static int lpc2000_iap_entry_point(struct flash_bank *bank, uint32_t *iap_entry_point)
 {
 	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
 	struct target *target = bank->target;
 
-	struct arm_algorithm arm_algo;	/* for LPC2000 */
-	struct armv7m_algorithm armv7m_info;	/* for LPC8xx/LPC1xxx/LPC4xxx/LPC5410x */
-	uint32_t iap_entry_point = 0;	/* to make compiler happier */
-
 	switch (lpc2000_info->variant) {
 		case lpc800:
 		case lpc1100:
 		case lpc1700:
 		case lpc_auto:
-			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
-			armv7m_info.core_mode = ARM_MODE_THREAD;
-			iap_entry_point = 0x1fff1ff1;
+			*iap_entry_point = 0x1fff1ff1;
 			break;
 		case lpc1500:
 		case lpc54100:
-			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
-			armv7m_info.core_mode = ARM_MODE_THREAD;
-			iap_entry_point = 0x03000205;
+			*iap_entry_point = 0x03000205;
 			break;
 		case lpc2000_v1:
+		case lpc2000_v2:
+			*iap_entry_point = 0x7ffffff1;
+			break;
+		case lpc4300:
+			/* read out IAP entry point from ROM driver table at 0x10400100 */
+			return target_read_u32(target, 0x10400100, iap_entry_point);
+		default:
+			LOG_ERROR("BUG: unknown lpc2000->variant encountered");
+			exit(-1);
+	}
+
+	return ERROR_OK;
+}
+
+static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_working_area, int code,
+		uint32_t param_table[5], uint32_t result_table[4])
+{
+	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
+	struct target *target = bank->target;
+
+	struct arm_algorithm arm_algo;	/* for LPC2000 */
+	struct armv7m_algorithm armv7m_info;	/* for LPC8xx/LPC1xxx/LPC4xxx/LPC5410x */
+	uint32_t iap_entry_point = 0;	/* to make compiler happier */
+
+	lpc2000_iap_entry_point(bank, &iap_entry_point);
+
+	switch (lpc2000_info->variant) {
+		case lpc2000_v1:
 		case lpc2000_v2:
 			arm_algo.common_magic = ARM_COMMON_MAGIC;
 			arm_algo.core_mode = ARM_MODE_SVC;
 			arm_algo.core_state = ARM_STATE_ARM;
-			iap_entry_point = 0x7ffffff1;
 			break;
-		case lpc4300:
+		default:
 			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 			armv7m_info.core_mode = ARM_MODE_THREAD;
-			/* read out IAP entry point from ROM driver table at 0x10400100 */
-			target_read_u32(target, 0x10400100, &iap_entry_point);
 			break;
-		default:
-			LOG_ERROR("BUG: unknown lpc2000->variant encountered");
-			exit(-1);
 	}
 
 	struct mem_param mem_params[2];
@@ -1014,6 +1028,196 @@ static int lpc2000_protect(struct flash_bank *bank, int set, int first, int last
 	return ERROR_OK;
 }
 
+/* parameter block of contrib/loaders/flash/lpc2000.S, after the IAP tables */
+#define LPC2000_FIFO_PARAMS_LEN	0x40
+
+/*
+ * Programs whole cmd51_max_buffer sized blocks with a loader which runs
+ * the IAP prepare and copy commands itself, while the host keeps its fifo
+ * filled.  Only Cortex-M based parts can run such an algorithm.
+ */
+static int lpc2000_write_fifo(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t address, uint32_t blocks, int first_sector, int last_sector)
+{
+	struct target *target = bank->target;
+	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
+	uint32_t block_size = lpc2000_info->cmd51_max_buffer;
+	uint32_t iap_entry_point;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	struct reg_param reg_params[7];
+	struct armv7m_algorithm armv7m_info;
+	int retval;
+
+	/* see contrib/loaders/flash/lpc2000.S for src */
+	static const uint8_t lpc2000_flash_write_code[] = {
+		/* wait_fifo: */
+			0x28, 0x68,               /* ldr r0, [r5, #0] */
+			0x00, 0x28,               /* cmp r0, #0 */
+			0x37, 0xd0,               /* beq exit */
+			0x69, 0x68,               /* ldr r1, [r5, #4] */
+			0x40, 0x1a,               /* subs r0, r0, r1 */
+			0x02, 0xd2,               /* bcs no_wrap_count */
+			0x40, 0x44,               /* add r0, r8 */
+			0x40, 0x1b,               /* subs r0, r0, r5 */
+			0x08, 0x38,               /* subs r0, #8 */
+		/* no_wrap_count: */
+			0xa2, 0x6b,               /* ldr r2, [r4, #0x38] */
+			0x90, 0x42,               /* cmp r0, r2 */
+			0xf3, 0xd3,               /* bcc wait_fifo */
+			0x32, 0x20,               /* movs r0, #50 */
+			0x20, 0x60,               /* str r0, [r4, #0x00] */
+			0xa0, 0x6a,               /* ldr r0, [r4, #0x28] */
+			0x60, 0x60,               /* str r0, [r4, #0x00 + 4] */
+			0xe0, 0x6a,               /* ldr r0, [r4, #0x2c] */
+			0xa0, 0x60,               /* str r0, [r4, #0x00 + 8] */
+			0x20, 0x6b,               /* ldr r0, [r4, #0x30] */
+			0xe0, 0x60,               /* str r0, [r4, #0x00 + 12] */
+			0x20, 0x46,               /* mov r0, r4 */
+			0x21, 0x46,               /* mov r1, r4 */
+			0x14, 0x31,               /* adds r1, #0x14 */
+			0xe2, 0x6b,               /* ldr r2, [r4, #0x3c] */
+			0x90, 0x47,               /* blx r2 */
+			0x60, 0x69,               /* ldr r0, [r4, #0x14] */
+			0x00, 0x28,               /* cmp r0, #0 */
+			0x1c, 0xd1,               /* bne error */
+			0x33, 0x20,               /* movs r0, #51 */
+			0x20, 0x60,               /* str r0, [r4, #0x00] */
+			0x67, 0x60,               /* str r7, [r4, #0x00 + 4] */
+			0x68, 0x68,               /* ldr r0, [r5, #4] */
+			0xa0, 0x60,               /* str r0, [r4, #0x00 + 8] */
+			0xa0, 0x6b,               /* ldr r0, [r4, #0x38] */
+			0xe0, 0x60,               /* str r0, [r4, #0x00 + 12] */
+			0x60, 0x6b,               /* ldr r0, [r4, #0x34] */
+			0x20, 0x61,               /* str r0, [r4, #0x00 + 16] */
+			0x20, 0x46,               /* mov r0, r4 */
+			0x21, 0x46,               /* mov r1, r4 */
+			0x14, 0x31,               /* adds r1, #0x14 */
+			0xe2, 0x6b,               /* ldr r2, [r4, #0x3c] */
+			0x90, 0x47,               /* blx r2 */
+			0x60, 0x69,               /* ldr r0, [r4, #0x14] */
+			0x00, 0x28,               /* cmp r0, #0 */
+			0x0b, 0xd1,               /* bne error */
+			0xa0, 0x6b,               /* ldr r0, [r4, #0x38] */
+			0x3f, 0x18,               /* adds r7, r7, r0 */
+			0x69, 0x68,               /* ldr r1, [r5, #4] */
+			0x09, 0x18,               /* adds r1, r1, r0 */
+			0x41, 0x45,               /* cmp r1, r8 */
+			0x01, 0xd3,               /* bcc no_wrap */
+			0x29, 0x46,               /* mov r1, r5 */
+			0x08, 0x31,               /* adds r1, #8 */
+		/* no_wrap: */
+			0x69, 0x60,               /* str r1, [r5, #4] */
+			0x76, 0x1e,               /* subs r6, r6, #1 */
+			0xc7, 0xd1,               /* bne wait_fifo */
+			0x01, 0xe0,               /* b exit */
+		/* error: */
+			0x00, 0x21,               /* movs r1, #0 */
+			0x69, 0x60,               /* str r1, [r5, #4] */
+		/* exit: */
+			0x00, 0xbe,               /* bkpt #0 */
+	};
+
+	if (lpc2000_info->variant == lpc2000_v1 || lpc2000_info->variant == lpc2000_v2)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = lpc2000_iap_entry_point(bank, &iap_entry_point);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* code, parameter block and the stack of the IAP */
+	uint32_t code_size = sizeof(lpc2000_flash_write_code);
+	uint32_t algorithm_size = code_size + LPC2000_FIFO_PARAMS_LEN + lpc2000_info->iap_max_stack;
+
+	if (target_alloc_working_area(target, algorithm_size, &write_algorithm) != ERROR_OK) {
+		LOG_DEBUG("no working area for block memory writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	uint32_t params_addr = write_algorithm->address + code_size;
+	uint8_t params[LPC2000_FIFO_PARAMS_LEN];
+
+	memset(params, 0, sizeof(params));
+	target_buffer_set_u32(target, params + 0x28, first_sector);
+	target_buffer_set_u32(target, params + 0x2c, last_sector);
+	if (lpc2000_info->variant == lpc4300)
+		target_buffer_set_u32(target, params + 0x30, lpc2000_info->lpc4300_bank);
+	else
+		target_buffer_set_u32(target, params + 0x30, lpc2000_info->cclk);
+	target_buffer_set_u32(target, params + 0x34, lpc2000_info->cclk);
+	target_buffer_set_u32(target, params + 0x38, block_size);
+	target_buffer_set_u32(target, params + 0x3c, iap_entry_point);
+
+	retval = target_write_buffer(target, write_algorithm->address, code_size,
+			lpc2000_flash_write_code);
+	if (retval == ERROR_OK)
+		retval = target_write_buffer(target, params_addr, sizeof(params), params);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	/* The loader hands each block to the IAP in place, so the fifo holds
+	 * a whole number of blocks, and at least two since it is never filled
+	 * up completely. */
+	uint32_t fifo_blocks = 8;
+	while (target_alloc_working_area_try(target, 8 + fifo_blocks * block_size, &source) != ERROR_OK) {
+		if (--fifo_blocks < 2) {
+			target_free_working_area(target, write_algorithm);
+			LOG_DEBUG("no large enough working area for block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);	/* IAP status */
+	init_reg_param(&reg_params[1], "r4", 32, PARAM_OUT);	/* parameter block */
+	init_reg_param(&reg_params[2], "r5", 32, PARAM_OUT);	/* buffer start */
+	init_reg_param(&reg_params[3], "r6", 32, PARAM_OUT);	/* block count */
+	init_reg_param(&reg_params[4], "r7", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[5], "r8", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[6], "sp", 32, PARAM_OUT);	/* IAP stack */
+
+	buf_set_u32(reg_params[1].value, 0, 32, params_addr);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address);
+	buf_set_u32(reg_params[3].value, 0, 32, blocks);
+	buf_set_u32(reg_params[4].value, 0, 32, address);
+	buf_set_u32(reg_params[5].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[6].value, 0, 32,
+			(write_algorithm->address + algorithm_size) & ~7UL);
+
+	retval = target_run_flash_async_algorithm(target, buffer, blocks, block_size,
+			0, NULL,
+			7, reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		uint32_t status_code = buf_get_u32(reg_params[0].value, 0, 32);
+
+		LOG_ERROR("lpc2000 IAP returned %" PRIu32 " writing 0x%" PRIx32, status_code,
+				buf_get_u32(reg_params[4].value, 0, 32));
+		if (status_code == LPC2000_INVALID_SECTOR)
+			retval = ERROR_FLASH_SECTOR_INVALID;
+	}
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
+	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
+	destroy_reg_param(&reg_params[6]);
+
+	return retval;
+}
+
 static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct target *target = bank->target;
@@ -1078,15 +1282,6 @@ static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 	if (retval != ERROR_OK)
 		return retval;
 
-	struct working_area *download_area;
-
-	/* allocate a working area */
-	if (target_alloc_working_area(target, lpc2000_info->cmd51_max_buffer, &download_area) != ERROR_OK) {
-		LOG_ERROR("no working area specified, can't write LPC2000 internal flash");
-		target_free_working_area(target, iap_working_area);
-		return ERROR_FLASH_OPERATION_FAILED;
-	}
-
 	uint32_t bytes_remaining = count;
 	uint32_t bytes_written = 0;
 	uint32_t param_table[5] = {0};
@@ -1096,6 +1291,35 @@ static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 		/* Init IAP Anyway */
 		lpc2000_iap_call(bank, iap_working_area, 49, param_table, result_table);
 
+	/* stream the whole blocks if the target can, the rest is written below */
+	uint32_t blocks = bytes_remaining / lpc2000_info->cmd51_max_buffer;
+	if (blocks) {
+		retval = lpc2000_write_fifo(bank, buffer, bank->base + offset, blocks,
+				first_sector, last_sector);
+		if (retval == ERROR_OK) {
+			bytes_written = blocks * lpc2000_info->cmd51_max_buffer;
+			bytes_remaining -= bytes_written;
+		} else if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+			target_free_working_area(target, iap_working_area);
+			return retval;
+		}
+		retval = ERROR_OK;
+	}
+
+	if (bytes_remaining == 0) {
+		target_free_working_area(target, iap_working_area);
+		return ERROR_OK;
+	}
+
+	struct working_area *download_area;
+
+	/* allocate a working area */
+	if (target_alloc_working_area(target, lpc2000_info->cmd51_max_buffer, &download_area) != ERROR_OK) {
+		LOG_ERROR("no working area specified, can't write LPC2000 internal flash");
+		target_free_working_area(target, iap_working_area);
+		return ERROR_FLASH_OPERATION_FAILED;
+	}
+
 	while (bytes_remaining > 0) {
 		uint32_t thisrun_bytes;
 		if (bytes_remaining >= lpc2000_info->cmd51_max_buffer)
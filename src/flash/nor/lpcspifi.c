@@ -39,6 +39,16 @@
 /* Status register fields */
 #define SSP_BSY		(0x00000010)
 
+/* SPIFI status register, and its memory mode flag */
+#define SPIFI_STAT			(0x4000301C)
+#define SPIFI_STAT_MCINIT	(0x00000001)
+
+/* Offset from ioconfig_base of the SPIFI_SCK pin configuration, which
+ * selects SPIFI (function 3) in HW mode and SSP in SW mode */
+#define SCU_SFS_SCK			(0x18c)
+#define SCU_MODE_MASK		(0x00000007)
+#define SCU_MODE_SPIFI		(0x00000003)
+
 /* Timeout in ms */
 #define SSP_CMD_TIMEOUT   (100)
 #define SSP_PROBE_TIMEOUT (100)
@@ -336,94 +346,79 @@ static int read_status_reg(struct flash_bank *bank, uint32_t *status)
 	return retval;
 }
 
-/* check for BSY bit in flash status register */
-/* timeout in ms */
-static int wait_till_ready(struct flash_bank *bank, int timeout)
-{
-	uint32_t status;
-	int retval;
-	long long endtime;
-
-	endtime = timeval_ms() + timeout;
-	do {
-		/* read flash status register */
-		retval = read_status_reg(bank, &status);
-		if (retval != ERROR_OK)
-			return retval;
-
-		if ((status & SPIFLASH_BSY_BIT) == 0)
-			return ERROR_OK;
-		alive_sleep(1);
-	} while (timeval_ms() < endtime);
-
-	LOG_ERROR("timeout waiting for flash to finish write/erase operation");
-	return ERROR_FAIL;
-}
-
-/* Send "write enable" command to SPI flash chip. */
-static int lpcspifi_write_enable(struct flash_bank *bank)
+/* Send a command to the SPI flash chip, in SW mode. */
+static int lpcspifi_command(struct flash_bank *bank, uint8_t opcode,
+	bool has_addr, uint32_t addr)
 {
 	struct target *target = bank->target;
 	struct lpcspifi_flash_bank *lpcspifi_info = bank->driver_priv;
 	uint32_t ssp_base = lpcspifi_info->ssp_base;
 	uint32_t io_base = lpcspifi_info->io_base;
-	uint32_t status, value;
+	uint8_t cmd[4] = { opcode, addr >> 16, addr >> 8, addr };
+	int len = has_addr ? 4 : 1;
+	uint32_t value;
 	int retval = ERROR_OK;
 
 	retval = ssp_setcs(target, io_base, 0);
-	if (retval == ERROR_OK)
-		retval = ssp_write_reg(target, ssp_base, SSP_DATA, SPIFLASH_WRITE_ENABLE);
-	if (retval == ERROR_OK)
-		retval = poll_ssp_busy(target, ssp_base, SSP_CMD_TIMEOUT);
-	if (retval == ERROR_OK)
-		retval = ssp_read_reg(target, ssp_base, SSP_DATA, &value);
+	for (int i = 0; i < len && retval == ERROR_OK; i++) {
+		retval = ssp_write_reg(target, ssp_base, SSP_DATA, cmd[i]);
+		if (retval == ERROR_OK)
+			retval = poll_ssp_busy(target, ssp_base, SSP_CMD_TIMEOUT);
+		/* drain the byte clocked in */
+		if (retval == ERROR_OK)
+			retval = ssp_read_reg(target, ssp_base, SSP_DATA, &value);
+	}
 	if (retval == ERROR_OK)
 		retval = ssp_setcs(target, io_base, 1);
 
-	/* read flash status register */
+	return retval;
+}
+
+/* Make sure the flash is memory mapped.  Re-initializing SPIFI takes an
+ * algorithm run, so first check whether it is in memory mode already. */
+static int lpcspifi_map(struct flash_bank *bank)
+{
+	struct target *target = bank->target;
+	struct lpcspifi_flash_bank *lpcspifi_info = bank->driver_priv;
+	uint32_t pin, stat;
+	int retval;
+
+	retval = target_read_u32(target, lpcspifi_info->ioconfig_base + SCU_SFS_SCK, &pin);
 	if (retval == ERROR_OK)
-		retval = read_status_reg(bank, &status);
+		retval = target_read_u32(target, SPIFI_STAT, &stat);
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* Check write enabled */
-	if ((status & SPIFLASH_WE_BIT) == 0) {
-		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
-		return ERROR_FAIL;
-	}
+	if ((pin & SCU_MODE_MASK) == SCU_MODE_SPIFI && (stat & SPIFI_STAT_MCINIT))
+		return ERROR_OK;
 
-	return retval;
+	return lpcspifi_set_hw_mode(bank);
+}
+
+static const struct spi_nor_ops lpcspifi_ops = {
+	.read_status = read_status_reg,
+	.command = lpcspifi_command,
+	.map = lpcspifi_map,
+};
+
+/* check for BSY bit in flash status register */
+/* timeout in ms */
+static int wait_till_ready(struct flash_bank *bank, int timeout)
+{
+	return spi_nor_wait_till_ready(bank, &lpcspifi_ops, timeout);
 }
 
 static int lpcspifi_bulk_erase(struct flash_bank *bank)
 {
-	struct target *target = bank->target;
 	struct lpcspifi_flash_bank *lpcspifi_info = bank->driver_priv;
-	uint32_t ssp_base = lpcspifi_info->ssp_base;
-	uint32_t io_base = lpcspifi_info->io_base;
-	uint32_t value;
 	int retval = ERROR_OK;
 
 	retval = lpcspifi_set_sw_mode(bank);
 
+	/* send SPI command "bulk erase", and poll flash BSY for its end */
 	if (retval == ERROR_OK)
-		retval = lpcspifi_write_enable(bank);
-
-	/* send SPI command "bulk erase" */
-	if (retval == ERROR_OK)
-		ssp_setcs(target, io_base, 0);
-	if (retval == ERROR_OK)
-		retval = ssp_write_reg(target, ssp_base, SSP_DATA, lpcspifi_info->dev->chip_erase_cmd);
-	if (retval == ERROR_OK)
-		retval = poll_ssp_busy(target, ssp_base, SSP_CMD_TIMEOUT);
-	if (retval == ERROR_OK)
-		retval = ssp_read_reg(target, ssp_base, SSP_DATA, &value);
-	if (retval == ERROR_OK)
-		retval = ssp_setcs(target, io_base, 1);
-
-	/* poll flash BSY for self-timed bulk erase */
-	if (retval == ERROR_OK)
-		retval = wait_till_ready(bank, bank->num_sectors*SSP_MAX_TIMEOUT);
+		retval = spi_nor_bulk_erase(bank, &lpcspifi_ops, lpcspifi_info->dev,
+			bank->num_sectors*SSP_MAX_TIMEOUT);
 
 	return retval;
 }
@@ -601,7 +596,6 @@ static int lpcspifi_write(struct flash_bank *bank, const uint8_t *buffer,
 	struct reg_param reg_params[5];
 	struct armv7m_algorithm armv7m_info;
 	struct working_area *write_algorithm;
-	int sector;
 	int retval = ERROR_OK;
 
 	LOG_DEBUG("offset=0x%08" PRIx32 " count=0x%08" PRIx32,
@@ -612,23 +606,9 @@ static int lpcspifi_write(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	if (offset + count > lpcspifi_info->dev->size_in_bytes) {
-		LOG_WARNING("Writes past end of flash. Extra data discarded.");
-		count = lpcspifi_info->dev->size_in_bytes - offset;
-	}
-
-	/* Check sector protection */
-	for (sector = 0; sector < bank->num_sectors; sector++) {
-		/* Start offset in or before this sector? */
-		/* End offset in or behind this sector? */
-		if ((offset <
-				(bank->sectors[sector].offset + bank->sectors[sector].size))
-			&& ((offset + count - 1) >= bank->sectors[sector].offset)
-			&& bank->sectors[sector].is_protected) {
-			LOG_ERROR("Flash sector %d protected", sector);
-			return ERROR_FAIL;
-		}
-	}
+	retval = spi_nor_check_write(bank, lpcspifi_info->dev, offset, &count);
+	if (retval != ERROR_OK)
+		return retval;
 
 	page_size = lpcspifi_info->dev->pagesize;
 
@@ -857,7 +837,6 @@ static int lpcspifi_probe(struct flash_bank *bank)
 	uint32_t ssp_base;
 	uint32_t io_base;
 	uint32_t ioconfig_base;
-	struct flash_sector *sectors;
 	uint32_t id = 0; /* silence uninitialized warning */
 	const struct lpcspifi_target *target_device;
 	int retval;
@@ -896,13 +875,7 @@ static int lpcspifi_probe(struct flash_bank *bank)
 	if (retval != ERROR_OK)
 		return retval;
 
-	lpcspifi_info->dev = NULL;
-	for (const struct flash_device *p = flash_devices; p->name ; p++)
-		if (p->device_id == id) {
-			lpcspifi_info->dev = p;
-			break;
-		}
-
+	lpcspifi_info->dev = spi_nor_find_device(id);
 	if (!lpcspifi_info->dev) {
 		LOG_ERROR("Unknown flash device (ID 0x%08" PRIx32 ")", id);
 		return ERROR_FAIL;
@@ -911,31 +884,25 @@ static int lpcspifi_probe(struct flash_bank *bank)
 	LOG_INFO("Found flash device \'%s\' (ID 0x%08" PRIx32 ")",
 		lpcspifi_info->dev->name, lpcspifi_info->dev->device_id);
 
-	/* Set correct size value */
-	bank->size = lpcspifi_info->dev->size_in_bytes;
-
-	/* create and fill sectors array */
-	bank->num_sectors =
-		lpcspifi_info->dev->size_in_bytes / lpcspifi_info->dev->sectorsize;
-	sectors = malloc(sizeof(struct flash_sector) * bank->num_sectors);
-	if (sectors == NULL) {
-		LOG_ERROR("not enough memory");
-		return ERROR_FAIL;
-	}
-
-	for (int sector = 0; sector < bank->num_sectors; sector++) {
-		sectors[sector].offset = sector * lpcspifi_info->dev->sectorsize;
-		sectors[sector].size = lpcspifi_info->dev->sectorsize;
-		sectors[sector].is_erased = -1;
-		sectors[sector].is_protected = 0;
-	}
-
-	bank->sectors = sectors;
+	retval = spi_nor_setup_sectors(bank, lpcspifi_info->dev, 0);
+	if (retval != ERROR_OK)
+		return retval;
 
 	lpcspifi_info->probed = 1;
 	return ERROR_OK;
 }
 
+static int lpcspifi_read(struct flash_bank *bank, uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	return spi_nor_read(bank, &lpcspifi_ops, buffer, offset, count);
+}
+
+static int lpcspifi_erase_check(struct flash_bank *bank)
+{
+	return spi_nor_blank_check(bank, &lpcspifi_ops);
+}
+
 static int lpcspifi_auto_probe(struct flash_bank *bank)
 {
 	struct lpcspifi_flash_bank *lpcspifi_info = bank->driver_priv;
@@ -973,10 +940,10 @@ struct flash_driver lpcspifi_flash = {
 	.erase = lpcspifi_erase,
 	.protect = lpcspifi_protect,
 	.write = lpcspifi_write,
-	.read = default_flash_read,
+	.read = lpcspifi_read,
 	.probe = lpcspifi_probe,
 	.auto_probe = lpcspifi_auto_probe,
-	.erase_check = default_flash_blank_check,
+	.erase_check = lpcspifi_erase_check,
 	.protect_check = lpcspifi_protect_check,
 	.info = get_lpcspifi_info,
 };
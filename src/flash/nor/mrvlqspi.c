@@ -40,8 +40,6 @@
 #define QSPI_W_EN (0x1)
 #define QSPI_SS_DISABLE (0x0)
 #define QSPI_SS_ENABLE (0x1)
-#define WRITE_DISBALE (0x0)
-#define WRITE_ENABLE (0x1)
 
 #define QSPI_TIMEOUT (1000)
 #define FIFO_FLUSH_TIMEOUT (1000)
@@ -326,7 +324,8 @@ static int mrvlqspi_read_byte(struct flash_bank *bank, uint8_t *data)
 	return ERROR_OK;
 }
 
-static int mrvlqspi_flash_busy_status(struct flash_bank *bank, int timeout)
+/* Read the status register of the flash chip, one byte transfer */
+static int mrvlqspi_read_status(struct flash_bank *bank, uint32_t *status)
 {
 	uint8_t val;
 	int retval;
@@ -341,8 +340,8 @@ static int mrvlqspi_flash_busy_status(struct flash_bank *bank, int timeout)
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* Read flash status register in continuous manner */
-	retval = mrvlqspi_set_din_cnt(bank, 0x0);
+	/* Set count for number of bytes to read */
+	retval = mrvlqspi_set_din_cnt(bank, 0x1);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -356,31 +355,27 @@ static int mrvlqspi_flash_busy_status(struct flash_bank *bank, int timeout)
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* Enable read mode transfer */
 	retval = mrvlqspi_start_transfer(bank, QSPI_R_EN);
 	if (retval != ERROR_OK)
 		return retval;
 
-	for (;;) {
-		retval = mrvlqspi_read_byte(bank, &val);
-		if (retval != ERROR_OK)
-			return retval;
-		if (!(val & 0x1))
-			break;
-		if (timeout-- <= 0) {
-			LOG_ERROR("timed out waiting for flash");
-			return ERROR_FAIL;
-		}
-		alive_sleep(1);
-	}
+	retval = mrvlqspi_read_byte(bank, &val);
+	if (retval != ERROR_OK)
+		return retval;
 
-	return mrvlqspi_stop_transfer(bank);
+	retval = mrvlqspi_set_ss_state(bank, QSPI_SS_DISABLE, QSPI_TIMEOUT);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*status = val;
+	return ERROR_OK;
 }
 
-static int mrvlqspi_set_write_status(struct flash_bank *bank, bool mode)
+/* Send a command without data phase to the flash chip */
+static int mrvlqspi_command(struct flash_bank *bank, uint8_t opcode,
+	bool has_addr, uint32_t addr)
 {
 	int retval;
-	uint32_t instr;
 
 	/* Flush read/write fifo's */
 	retval = mrvlqspi_fifo_flush(bank, FIFO_FLUSH_TIMEOUT);
@@ -388,17 +383,18 @@ static int mrvlqspi_set_write_status(struct flash_bank *bank, bool mode)
 		return retval;
 
 	/* Set instruction/addr count value */
-	retval = mrvlqspi_set_hdr_cnt(bank, 0x1);
+	retval = mrvlqspi_set_hdr_cnt(bank, has_addr ? (0x1 | (0x3 << 4)) : 0x1);
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (mode)
-		instr = INS_WRITE_ENABLE;
-	else
-		instr = INS_WRITE_DISABLE;
+	if (has_addr) {
+		retval = mrvlqspi_set_addr(bank, addr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
 
 	/* Set instruction */
-	retval = mrvlqspi_set_instr(bank, instr);
+	retval = mrvlqspi_set_instr(bank, opcode);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -406,13 +402,14 @@ static int mrvlqspi_set_write_status(struct flash_bank *bank, bool mode)
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = mrvlqspi_stop_transfer(bank);
-	if (retval != ERROR_OK)
-		return retval;
-
-	return retval;
+	return mrvlqspi_stop_transfer(bank);
 }
 
+static const struct spi_nor_ops mrvlqspi_ops = {
+	.read_status = mrvlqspi_read_status,
+	.command = mrvlqspi_command,
+};
+
 static int mrvlqspi_read_id(struct flash_bank *bank, uint32_t *id)
 {
 	uint8_t id_buf[3] = {0, 0, 0};
@@ -464,68 +461,6 @@ static int mrvlqspi_read_id(struct flash_bank *bank, uint32_t *id)
 	return ERROR_OK;
 }
 
-static int mrvlqspi_block_erase(struct flash_bank *bank, uint32_t offset)
-{
-	int retval;
-	struct mrvlqspi_flash_bank *mrvlqspi_info = bank->driver_priv;
-
-	/* Set flash write enable */
-	retval = mrvlqspi_set_write_status(bank, WRITE_ENABLE);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Set instruction/addr count value */
-	retval = mrvlqspi_set_hdr_cnt(bank, (0x1 | (0x3 << 4)));
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Set read offset address */
-	retval = mrvlqspi_set_addr(bank, offset);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Set instruction */
-	retval = mrvlqspi_set_instr(bank, mrvlqspi_info->dev->erase_cmd);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = mrvlqspi_start_transfer(bank, QSPI_W_EN);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = mrvlqspi_stop_transfer(bank);
-	if (retval != ERROR_OK)
-		return retval;
-
-	return mrvlqspi_flash_busy_status(bank, BLOCK_ERASE_TIMEOUT);
-}
-
-static int mrvlqspi_bulk_erase(struct flash_bank *bank)
-{
-	int retval;
-	struct mrvlqspi_flash_bank *mrvlqspi_info = bank->driver_priv;
-
-	/* Set flash write enable */
-	retval = mrvlqspi_set_write_status(bank, WRITE_ENABLE);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Set instruction */
-	retval = mrvlqspi_set_instr(bank, mrvlqspi_info->dev->chip_erase_cmd);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = mrvlqspi_start_transfer(bank, QSPI_W_EN);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = mrvlqspi_stop_transfer(bank);
-	if (retval != ERROR_OK)
-		return retval;
-
-	return mrvlqspi_flash_busy_status(bank, CHIP_ERASE_TIMEOUT);
-}
-
 static int mrvlqspi_flash_erase(struct flash_bank *bank, int first, int last)
 {
 	struct target *target = bank->target;
@@ -564,7 +499,8 @@ static int mrvlqspi_flash_erase(struct flash_bank *bank, int first, int last)
 					mrvlqspi_info->dev->erase_cmd) {
 		LOG_DEBUG("Chip supports the bulk erase command."\
 		" Will use bulk erase instead of sector-by-sector erase.");
-		retval = mrvlqspi_bulk_erase(bank);
+		retval = spi_nor_bulk_erase(bank, &mrvlqspi_ops,
+				mrvlqspi_info->dev, CHIP_ERASE_TIMEOUT);
 		if (retval == ERROR_OK) {
 			return retval;
 		} else
@@ -573,8 +509,8 @@ static int mrvlqspi_flash_erase(struct flash_bank *bank, int first, int last)
 	}
 
 	for (sector = first; sector <= last; sector++) {
-		retval = mrvlqspi_block_erase(bank,
-				sector * mrvlqspi_info->dev->sectorsize);
+		retval = spi_nor_erase_sector(bank, &mrvlqspi_ops,
+				mrvlqspi_info->dev, sector, BLOCK_ERASE_TIMEOUT);
 		if (retval != ERROR_OK)
 			return retval;
 	}
@@ -593,7 +529,6 @@ static int mrvlqspi_flash_write(struct flash_bank *bank, const uint8_t *buffer,
 	struct reg_param reg_params[6];
 	struct armv7m_algorithm armv7m_info;
 	struct working_area *write_algorithm;
-	int sector;
 
 	LOG_DEBUG("offset=0x%08" PRIx32 " count=0x%08" PRIx32,
 		offset, count);
@@ -603,23 +538,9 @@ static int mrvlqspi_flash_write(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	if (offset + count > mrvlqspi_info->dev->size_in_bytes) {
-		LOG_WARNING("Writes past end of flash. Extra data discarded.");
-		count = mrvlqspi_info->dev->size_in_bytes - offset;
-	}
-
-	/* Check sector protection */
-	for (sector = 0; sector < bank->num_sectors; sector++) {
-		/* Start offset in or before this sector? */
-		/* End offset in or behind this sector? */
-		if ((offset <
-			(bank->sectors[sector].offset + bank->sectors[sector].size))
-			&& ((offset + count - 1) >= bank->sectors[sector].offset)
-			&& bank->sectors[sector].is_protected) {
-			LOG_ERROR("Flash sector %d protected", sector);
-			return ERROR_FAIL;
-		}
-	}
+	retval = spi_nor_check_write(bank, mrvlqspi_info->dev, offset, &count);
+	if (retval != ERROR_OK)
+		return retval;
 
 	page_size = mrvlqspi_info->dev->pagesize;
 
@@ -827,7 +748,6 @@ static int mrvlqspi_probe(struct flash_bank *bank)
 	struct mrvlqspi_flash_bank *mrvlqspi_info = bank->driver_priv;
 	uint32_t id = 0;
 	int retval;
-	struct flash_sector *sectors;
 
 	/* If we've already probed, we should be fine to skip this time. */
 	if (mrvlqspi_info->probed)
@@ -846,13 +766,7 @@ static int mrvlqspi_probe(struct flash_bank *bank)
 	if (retval != ERROR_OK)
 		return retval;
 
-	mrvlqspi_info->dev = NULL;
-	for (const struct flash_device *p = flash_devices; p->name ; p++)
-		if (p->device_id == id) {
-			mrvlqspi_info->dev = p;
-			break;
-		}
-
+	mrvlqspi_info->dev = spi_nor_find_device(id);
 	if (!mrvlqspi_info->dev) {
 		LOG_ERROR("Unknown flash device ID 0x%08x", id);
 		return ERROR_FAIL;
@@ -861,27 +775,10 @@ static int mrvlqspi_probe(struct flash_bank *bank)
 	LOG_INFO("Found flash device \'%s\' ID 0x%08x",
 		mrvlqspi_info->dev->name, mrvlqspi_info->dev->device_id);
 
-	/* Set correct size value */
-	bank->size = mrvlqspi_info->dev->size_in_bytes;
-
-	/* create and fill sectors array */
-	bank->num_sectors = mrvlqspi_info->dev->size_in_bytes /
-					mrvlqspi_info->dev->sectorsize;
-	sectors = malloc(sizeof(struct flash_sector) * bank->num_sectors);
-	if (sectors == NULL) {
-		LOG_ERROR("not enough memory");
-		return ERROR_FAIL;
-	}
-
-	for (int sector = 0; sector < bank->num_sectors; sector++) {
-		sectors[sector].offset =
-				sector * mrvlqspi_info->dev->sectorsize;
-		sectors[sector].size = mrvlqspi_info->dev->sectorsize;
-		sectors[sector].is_erased = -1;
-		sectors[sector].is_protected = 0;
-	}
+	retval = spi_nor_setup_sectors(bank, mrvlqspi_info->dev, 0);
+	if (retval != ERROR_OK)
+		return retval;
 
-	bank->sectors = sectors;
 	mrvlqspi_info->probed = 1;
 
 	return ERROR_OK;
@@ -23,6 +23,8 @@
 #endif
 
 #include "imp.h"
+#include <target/algorithm.h>
+#include <target/armv7m.h>
 
 enum {
 	NRF51_FLASH_BASE = 0x00000000,
@@ -608,11 +610,116 @@ static int nrf51_erase_page(struct flash_bank *bank,
 	return res;
 }
 
+/* Program words through a fifo, the NVMC must already be write enabled */
+static int nrf51_ll_flash_write_block(struct nrf51_info *chip, uint32_t offset,
+		const uint8_t *buffer, uint32_t buffer_size)
+{
+	struct target *target = chip->target;
+	uint32_t fifo_size = 8192;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	struct reg_param reg_params[5];
+	struct armv7m_algorithm armv7m_info;
+	int retval;
+
+	/* see contrib/loaders/flash/nrf51.S for src */
+	static const uint8_t nrf51_flash_write_code[] = {
+		/* wait_fifo: */
+			0x0e, 0x68,               /* ldr r6, [r1, #0] */
+			0x00, 0x2e,               /* cmp r6, #0 */
+			0x0f, 0xd0,               /* beq exit */
+			0x4d, 0x68,               /* ldr r5, [r1, #4] */
+			0xb5, 0x42,               /* cmp r5, r6 */
+			0xf9, 0xd0,               /* beq wait_fifo */
+			0x40, 0xcd,               /* ldmia r5!, {r6} */
+			0x1e, 0x60,               /* str r6, [r3] */
+			0x04, 0x33,               /* adds r3, #4 */
+		/* busy: */
+			0x26, 0x68,               /* ldr r6, [r4] */
+			0x00, 0x2e,               /* cmp r6, #0 */
+			0xfc, 0xd0,               /* beq busy */
+			0x95, 0x42,               /* cmp r5, r2 */
+			0x01, 0xd3,               /* bcc no_wrap */
+			0x0d, 0x46,               /* mov r5, r1 */
+			0x08, 0x35,               /* adds r5, #8 */
+		/* no_wrap: */
+			0x4d, 0x60,               /* str r5, [r1, #4] */
+			0x40, 0x1e,               /* subs r0, r0, #1 */
+			0xec, 0xd1,               /* bne wait_fifo */
+		/* exit: */
+			0x00, 0xbe,               /* bkpt #0 */
+	};
+
+	if (target_alloc_working_area(target, sizeof(nrf51_flash_write_code),
+			&write_algorithm) != ERROR_OK) {
+		LOG_DEBUG("no working area for block memory writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_write_buffer(target, write_algorithm->address,
+			sizeof(nrf51_flash_write_code), nrf51_flash_write_code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	while (target_alloc_working_area_try(target, fifo_size, &source) != ERROR_OK) {
+		fifo_size /= 2;
+		if (fifo_size <= 256) {
+			target_free_working_area(target, write_algorithm);
+
+			LOG_WARNING("no large enough working area available, can't do block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);	/* word count */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer start */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* NVMC_READY */
+
+	buf_set_u32(reg_params[0].value, 0, 32, buffer_size / 4);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[3].value, 0, 32, offset);
+	buf_set_u32(reg_params[4].value, 0, 32, NRF51_NVMC_READY);
+
+	retval = target_run_flash_async_algorithm(target, buffer, buffer_size / 4, 4,
+			0, NULL,
+			5, reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+	if (retval != ERROR_OK)
+		LOG_ERROR("flash write failed at address 0x%08" PRIx32,
+				buf_get_u32(reg_params[3].value, 0, 32));
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
+	destroy_reg_param(&reg_params[4]);
+
+	return retval;
+}
+
 static int nrf51_ll_flash_write(struct nrf51_info *chip, uint32_t offset, const uint8_t *buffer, uint32_t buffer_size)
 {
 	int res;
 	assert(buffer_size % 4 == 0);
 
+	res = nrf51_ll_flash_write_block(chip, offset, buffer, buffer_size);
+	if (res != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		return res;
+
+	/* no working area, write word by word from the host */
 	for (; buffer_size > 0; buffer_size -= 4) {
 		res = target_write_memory(chip->target, offset, 4, 1, buffer);
 		if (res != ERROR_OK)
@@ -629,34 +736,38 @@ static int nrf51_ll_flash_write(struct nrf51_info *chip, uint32_t offset, const
 	return ERROR_OK;
 }
 
-static int nrf51_write_page(struct flash_bank *bank, uint32_t offset, const uint8_t *buffer)
+static int nrf51_write_pages(struct flash_bank *bank, uint32_t start, uint32_t end, const uint8_t *buffer)
 {
-	assert(offset % 4 == 0);
+	assert(start % 4 == 0);
 	int res = ERROR_FAIL;
 	struct nrf51_info *chip = bank->driver_priv;
-	struct flash_sector *sector = nrf51_find_sector_by_address(bank, offset);
+	struct flash_sector *sector;
+	uint32_t offset;
 
-	if (!sector)
-		return ERROR_FLASH_SECTOR_INVALID;
+	/* erase the pages first, so that they can be programmed in one run */
+	for (offset = start; offset < end; offset += chip->code_page_size) {
+		sector = nrf51_find_sector_by_address(bank, offset);
+		if (!sector)
+			return ERROR_FLASH_SECTOR_INVALID;
 
-	if (sector->is_protected)
-		goto error;
-
-	if (sector->is_erased != 1) {
-		res = nrf51_erase_page(bank, chip, sector);
-		if (res != ERROR_OK) {
-			LOG_ERROR("Failed to erase sector @ 0x%08"PRIx32, sector->offset);
+		if (sector->is_protected)
 			goto error;
+
+		if (sector->is_erased != 1) {
+			res = nrf51_erase_page(bank, chip, sector);
+			if (res != ERROR_OK) {
+				LOG_ERROR("Failed to erase sector @ 0x%08"PRIx32, sector->offset);
+				goto error;
+			}
 		}
+		sector->is_erased = 0;
 	}
 
 	res = nrf51_nvmc_write_enable(chip);
 	if (res != ERROR_OK)
 		goto error;
 
-	sector->is_erased = 0;
-
-	res = nrf51_ll_flash_write(chip, offset, buffer, chip->code_page_size);
+	res = nrf51_ll_flash_write(chip, start, buffer, end - start);
 	if (res != ERROR_OK)
 		goto set_read_only;
 
@@ -665,10 +776,17 @@ static int nrf51_write_page(struct flash_bank *bank, uint32_t offset, const uint
 set_read_only:
 	nrf51_nvmc_read_only(chip);
 error:
-	LOG_ERROR("Failed to write sector @ 0x%08"PRIx32, sector->offset);
+	LOG_ERROR("Failed to write to nrf51 flash");
 	return res;
 }
 
+static int nrf51_write_page(struct flash_bank *bank, uint32_t offset, const uint8_t *buffer)
+{
+	struct nrf51_info *chip = bank->driver_priv;
+
+	return nrf51_write_pages(bank, offset, offset + chip->code_page_size, buffer);
+}
+
 static int nrf51_erase(struct flash_bank *bank, int first, int last)
 {
 	int res;
@@ -749,16 +867,16 @@ static int nrf51_code_flash_write(struct flash_bank *bank,
 	}
 
 
-	region.start += start_extra.length;
+	/* the whole pages in between */
+	if (start_extra.length)
+		region.start += chip->code_page_size - start_extra.length;
 	region.end   -= end_extra.length;
 
-	for (uint32_t address = region.start; address < region.end;
-	     address += chip->code_page_size) {
-		res = nrf51_write_page(bank, address, &buffer[address - region.start]);
-
+	if (region.start < region.end) {
+		res = nrf51_write_pages(bank, region.start, region.end,
+					&buffer[region.start - offset]);
 		if (res != ERROR_OK)
 			return res;
-
 	}
 
 	return ERROR_OK;
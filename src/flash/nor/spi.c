@@ -28,6 +28,7 @@
 #include "imp.h"
 #include "spi.h"
 #include <jtag/jtag.h>
+#include <helper/time_support.h>
 
  /* Shared table of known SPI flash devices for SPI-based flash drivers. Taken
   * from device datasheets and Linux SPI flash drivers. */
@@ -76,3 +77,231 @@ const struct flash_device flash_devices[] = {
 	FLASH_ID("win w25q64cv",   0xd8, 0xc7, 0x001740ef, 0x100, 0x10000, 0x800000),
 	FLASH_ID(NULL,             0,    0,	   0,          0,     0,       0)
 };
+
+const struct flash_device *spi_nor_find_device(uint32_t device_id)
+{
+	for (const struct flash_device *p = flash_devices; p->name ; p++)
+		if (p->device_id == device_id)
+			return p;
+
+	return NULL;
+}
+
+/* Size the bank after the flash device and create its sectors array */
+int spi_nor_setup_sectors(struct flash_bank *bank,
+		const struct flash_device *dev, int is_protected)
+{
+	struct flash_sector *sectors;
+
+	/* Set correct size value */
+	bank->size = dev->size_in_bytes;
+
+	/* create and fill sectors array */
+	bank->num_sectors = dev->size_in_bytes / dev->sectorsize;
+	sectors = malloc(sizeof(struct flash_sector) * bank->num_sectors);
+	if (sectors == NULL) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+
+	for (int sector = 0; sector < bank->num_sectors; sector++) {
+		sectors[sector].offset = sector * dev->sectorsize;
+		sectors[sector].size = dev->sectorsize;
+		sectors[sector].is_erased = -1;
+		sectors[sector].is_protected = is_protected;
+	}
+
+	bank->sectors = sectors;
+	return ERROR_OK;
+}
+
+/* check for WIP (write in progress) bit in status register */
+/* timeout in ms */
+int spi_nor_wait_till_ready(struct flash_bank *bank,
+		const struct spi_nor_ops *ops, int timeout)
+{
+	uint32_t status;
+	int retval;
+	long long endtime;
+
+	endtime = timeval_ms() + timeout;
+	do {
+		/* read flash status register */
+		retval = ops->read_status(bank, &status);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if ((status & SPIFLASH_BSY_BIT) == 0)
+			return ERROR_OK;
+		alive_sleep(1);
+	} while (timeval_ms() < endtime);
+
+	LOG_ERROR("timeout waiting for flash to finish write/erase operation");
+	return ERROR_FAIL;
+}
+
+/* Send "write enable" and check that the flash chip took it */
+int spi_nor_write_enable(struct flash_bank *bank, const struct spi_nor_ops *ops)
+{
+	uint32_t status;
+	int retval;
+
+	retval = ops->command(bank, SPIFLASH_WRITE_ENABLE, false, 0);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* read flash status register */
+	retval = ops->read_status(bank, &status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Check write enabled */
+	if ((status & SPIFLASH_WE_BIT) == 0) {
+		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+/* Erase one sector and wait for the end of the self timed erase cycle */
+/* timeout in ms */
+int spi_nor_erase_sector(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, int sector, int timeout)
+{
+	int retval;
+
+	retval = spi_nor_write_enable(bank, ops);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* send SPI command "sector erase" */
+	retval = ops->command(bank, dev->erase_cmd, true,
+			bank->sectors[sector].offset);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return spi_nor_wait_till_ready(bank, ops, timeout);
+}
+
+/* Erase the whole chip and wait for the end of the self timed erase cycle */
+/* timeout in ms */
+int spi_nor_bulk_erase(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, int timeout)
+{
+	int retval;
+
+	retval = spi_nor_write_enable(bank, ops);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* send SPI command "bulk erase" */
+	retval = ops->command(bank, dev->chip_erase_cmd, false, 0);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return spi_nor_wait_till_ready(bank, ops, timeout);
+}
+
+/* Clip a write at the end of the flash and refuse writes to protected
+ * sectors */
+int spi_nor_check_write(struct flash_bank *bank, const struct flash_device *dev,
+		uint32_t offset, uint32_t *count)
+{
+	int sector;
+
+	if (offset + *count > dev->size_in_bytes) {
+		LOG_WARNING("Writes past end of flash. Extra data discarded.");
+		*count = dev->size_in_bytes - offset;
+	}
+
+	/* Check sector protection */
+	for (sector = 0; sector < bank->num_sectors; sector++) {
+		/* Start offset in or before this sector? */
+		/* End offset in or behind this sector? */
+		if ((offset <
+				(bank->sectors[sector].offset + bank->sectors[sector].size))
+			&& ((offset + *count - 1) >= bank->sectors[sector].offset)
+			&& bank->sectors[sector].is_protected) {
+			LOG_ERROR("Flash sector %d protected", sector);
+			return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* Program from the host, one page program command per page */
+/* timeout in ms, for each page */
+int spi_nor_write(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, const uint8_t *buffer,
+		uint32_t offset, uint32_t count, int timeout)
+{
+	uint32_t cur_count;
+	int retval;
+
+	retval = spi_nor_check_write(bank, dev, offset, &count);
+	if (retval != ERROR_OK)
+		return retval;
+
+	while (count > 0) {
+		/* clip block at page boundary */
+		cur_count = dev->pagesize - offset % dev->pagesize;
+		if (cur_count > count)
+			cur_count = count;
+
+		retval = spi_nor_write_enable(bank, ops);
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = ops->program(bank, buffer, offset, cur_count);
+		if (retval != ERROR_OK)
+			return retval;
+
+		/* poll WIP for end of self timed page program cycle */
+		retval = spi_nor_wait_till_ready(bank, ops, timeout);
+		if (retval != ERROR_OK)
+			return retval;
+
+		buffer += cur_count;
+		offset += cur_count;
+		count -= cur_count;
+
+		keep_alive();
+	}
+
+	return ERROR_OK;
+}
+
+/* Bulk reads go through the memory mapped window, as one block transfer
+ * instead of one command per few bytes. */
+int spi_nor_read(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	int retval;
+
+	if (!ops->map)
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	retval = ops->map(bank);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return default_flash_read(bank, buffer, offset, count);
+}
+
+/* Blank check through the memory mapped window, which lets the target
+ * do the checking when it has a working area. */
+int spi_nor_blank_check(struct flash_bank *bank, const struct spi_nor_ops *ops)
+{
+	int retval;
+
+	if (!ops->map)
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	retval = ops->map(bank);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return default_flash_blank_check(bank);
+}
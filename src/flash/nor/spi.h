@@ -56,3 +56,44 @@ extern const struct flash_device flash_devices[];
 #define SPIFLASH_PAGE_PROGRAM	0x02 /* Page Program */
 #define SPIFLASH_FAST_READ		0x0B /* Fast Read */
 #define SPIFLASH_READ			0x03 /* Normal Read */
+
+/* Controller specific part of a SPI flash driver, used by the spi_nor_*()
+ * routines below which hold what is common to all SPI NOR chips. */
+struct spi_nor_ops {
+	/* Read the status register of the flash chip */
+	int (*read_status)(struct flash_bank *bank, uint32_t *status);
+
+	/* Send a command without data phase to the flash chip: the opcode,
+	 * followed by the 24 bit address if has_addr is set. */
+	int (*command)(struct flash_bank *bank, uint8_t opcode,
+			bool has_addr, uint32_t addr);
+
+	/* Send "page program" for count bytes at offset, which all lie in one
+	 * page.  Write enable has been sent already.  NULL if the controller
+	 * only programs through a target algorithm. */
+	int (*program)(struct flash_bank *bank, const uint8_t *buffer,
+			uint32_t offset, uint32_t count);
+
+	/* Put the controller in memory mapped (XIP) mode, in which the whole
+	 * flash reads at bank->base.  NULL if the controller has no such mode. */
+	int (*map)(struct flash_bank *bank);
+};
+
+const struct flash_device *spi_nor_find_device(uint32_t device_id);
+int spi_nor_setup_sectors(struct flash_bank *bank,
+		const struct flash_device *dev, int is_protected);
+int spi_nor_wait_till_ready(struct flash_bank *bank,
+		const struct spi_nor_ops *ops, int timeout);
+int spi_nor_write_enable(struct flash_bank *bank, const struct spi_nor_ops *ops);
+int spi_nor_erase_sector(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, int sector, int timeout);
+int spi_nor_bulk_erase(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, int timeout);
+int spi_nor_check_write(struct flash_bank *bank, const struct flash_device *dev,
+		uint32_t offset, uint32_t *count);
+int spi_nor_write(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		const struct flash_device *dev, const uint8_t *buffer,
+		uint32_t offset, uint32_t count, int timeout);
+int spi_nor_read(struct flash_bank *bank, const struct spi_nor_ops *ops,
+		uint8_t *buffer, uint32_t offset, uint32_t count);
+int spi_nor_blank_check(struct flash_bank *bank, const struct spi_nor_ops *ops);
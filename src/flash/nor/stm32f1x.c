@@ -30,6 +30,7 @@
 
 #include "imp.h"
 #include <helper/binarybuffer.h>
+#include <helper/time_support.h>
 #include <target/algorithm.h>
 #include <target/armv7m.h>
 
@@ -126,6 +127,12 @@ struct stm32x_flash_bank {
 	int user_data_offset;
 	int option_offset;
 	uint32_t user_bank_size;
+
+	/* state of an erase started by stm32x_erase_start() */
+	int erase_step_first;	/* first page of the running step */
+	int erase_next;
+	int erase_last;
+	int64_t erase_step_start;
 };
 
 static int stm32x_mass_erase(struct flash_bank *bank);
@@ -419,6 +426,21 @@ static int stm32x_protect_check(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+static int stm32x_erase_page_start(struct flash_bank *bank, int page)
+{
+	struct target *target = bank->target;
+
+	int retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_PER);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_AR),
+			bank->base + bank->sectors[page].offset);
+	if (retval != ERROR_OK)
+		return retval;
+	return target_write_u32(target,
+			stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_PER | FLASH_STRT);
+}
+
 static int stm32x_erase(struct flash_bank *bank, int first, int last)
 {
 	struct target *target = bank->target;
@@ -441,15 +463,7 @@ static int stm32x_erase(struct flash_bank *bank, int first, int last)
 		return retval;
 
 	for (i = first; i <= last; i++) {
-		retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_PER);
-		if (retval != ERROR_OK)
-			return retval;
-		retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_AR),
-				bank->base + bank->sectors[i].offset);
-		if (retval != ERROR_OK)
-			return retval;
-		retval = target_write_u32(target,
-				stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_PER | FLASH_STRT);
+		retval = stm32x_erase_page_start(bank, i);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -467,6 +481,93 @@ static int stm32x_erase(struct flash_bank *bank, int first, int last)
 	return ERROR_OK;
 }
 
+/* The two banks of XL density devices have a controller each, so one
+ * can erase while the other is being programmed.  The erase runs page by
+ * page, or as a mass erase when the whole bank goes.
+ */
+static int stm32x_erase_start(struct flash_bank *bank, int first, int last)
+{
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
+	struct target *target = bank->target;
+	int retval;
+
+	if (!stm32x_info->has_dual_banks)
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	/* unlock flash registers */
+	retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_KEYR), KEY1);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_KEYR), KEY2);
+	if (retval != ERROR_OK)
+		return retval;
+
+	stm32x_info->erase_step_first = first;
+	if ((first == 0) && (last == (bank->num_sectors - 1))) {
+		retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_MER);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR),
+				FLASH_MER | FLASH_STRT);
+		first = last;
+	} else
+		retval = stm32x_erase_page_start(bank, first);
+	if (retval != ERROR_OK)
+		return retval;
+
+	stm32x_info->erase_next = first + 1;
+	stm32x_info->erase_last = last;
+	stm32x_info->erase_step_start = timeval_ms();
+
+	return ERROR_OK;
+}
+
+static int stm32x_erase_poll(struct flash_bank *bank)
+{
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
+	struct target *target = bank->target;
+	uint32_t status;
+
+	int retval = stm32x_get_flash_status(bank, &status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (status & FLASH_BSY) {
+		if (timeval_ms() - stm32x_info->erase_step_start <= FLASH_ERASE_TIMEOUT)
+			return ERROR_FLASH_BUSY;
+
+		LOG_ERROR("timed out waiting for flash");
+		target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_LOCK);
+		return ERROR_FAIL;
+	}
+
+	/* check and clear the error flags */
+	retval = stm32x_wait_status_busy(bank, 0);
+
+	if (retval == ERROR_OK) {
+		for (int i = stm32x_info->erase_step_first; i < stm32x_info->erase_next; i++)
+			bank->sectors[i].is_erased = 1;
+	}
+
+	if (retval == ERROR_OK && stm32x_info->erase_next <= stm32x_info->erase_last) {
+		stm32x_info->erase_step_first = stm32x_info->erase_next;
+		retval = stm32x_erase_page_start(bank, stm32x_info->erase_next++);
+		if (retval == ERROR_OK) {
+			stm32x_info->erase_step_start = timeval_ms();
+			return ERROR_FLASH_BUSY;
+		}
+	}
+
+	int lock_retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_LOCK);
+
+	return retval != ERROR_OK ? retval : lock_retval;
+}
+
 static int stm32x_protect(struct flash_bank *bank, int set, int first, int last)
 {
 	struct stm32x_flash_bank *stm32x_info = NULL;
@@ -1639,6 +1740,8 @@ struct flash_driver stm32f1x_flash = {
 	.commands = stm32x_command_handlers,
 	.flash_bank_command = stm32x_flash_bank_command,
 	.erase = stm32x_erase,
+	.erase_start = stm32x_erase_start,
+	.erase_poll = stm32x_erase_poll,
 	.protect = stm32x_protect,
 	.write = stm32x_write,
 	.read = default_flash_read,
@@ -481,21 +481,39 @@ static int stm32x_protect(struct flash_bank *bank, int set, int first, int last)
 	return ERROR_OK;
 }
 
+/* Program count halfwords.  Sectors erase_first to erase_last, if any,
+ * are erased by the loader as it reaches them, so the host can fill the
+ * fifo meanwhile.
+ */
 static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
-		uint32_t offset, uint32_t count)
+		uint32_t offset, uint32_t count, int erase_first, int erase_last)
 {
 	struct target *target = bank->target;
 	uint32_t buffer_size = 16384;
 	struct working_area *write_algorithm;
 	struct working_area *source;
 	uint32_t address = bank->base + offset;
-	struct reg_param reg_params[5];
+	struct reg_param reg_params[6];
 	struct armv7m_algorithm armv7m_info;
 	int retval = ERROR_OK;
 
 	/* see contrib/loaders/flash/stm32f2x.S for src */
 
 	static const uint8_t stm32x_flash_write_code[] = {
+									/* next_sector: */
+		0x2E, 0x68,					/* ldr		r6, [r5, #0] */
+		0xB2, 0x42,					/* cmp		r2, r6 */
+		0x0A, 0xD3,					/* bcc		wait_fifo */
+		0x6E, 0x68,					/* ldr		r6, [r5, #4] */
+		0x26, 0x61,					/* str		r6, [r4, #STM32_FLASH_CR_OFFSET] */
+		0x08, 0x35,					/* adds		r5, r5, #8 */
+									/* erase_busy: */
+		0xE6, 0x68,					/* ldr		r6, [r4, #STM32_FLASH_SR_OFFSET] */
+		0x16, 0xF4, 0x80, 0x3F,		/* tst		r6, #0x10000 */
+		0xFB, 0xD1,					/* bne		erase_busy */
+		0x16, 0xF0, 0xF2, 0x0F,		/* tst		r6, #0xf2 */
+		0x1E, 0xD1,					/* bne		error */
+		0xF1, 0xE7,					/* b		next_sector */
 									/* wait_fifo: */
 		0xD0, 0xF8, 0x00, 0x80,		/* ldr		r8, [r0, #0] */
 		0xB8, 0xF1, 0x00, 0x0F,		/* cmp		r8, #0 */
@@ -521,7 +539,7 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		0x47, 0x60,					/* str		r7, [r0, #4] */
 		0x01, 0x3B,					/* subs		r3, r3, #1 */
 		0x13, 0xB1,					/* cbz		r3, exit */
-		0xE1, 0xE7,					/* b		wait_fifo */
+		0xD3, 0xE7,					/* b		next_sector */
 									/* error: */
 		0x00, 0x21,					/* movs		r1, #0 */
 		0x41, 0x60,					/* str		r1, [r0, #4] */
@@ -533,8 +551,26 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		0x01, 0x01, 0x00, 0x00,		/* .word	0x00000101 */
 	};
 
-	if (target_alloc_working_area(target, sizeof(stm32x_flash_write_code),
+	/* the erase list follows the code: sector address and CR value pairs */
+	int erase_count = erase_last >= erase_first ? erase_last - erase_first + 1 : 0;
+	uint32_t erase_list_size = (erase_count + 1) * 8;
+	uint8_t *erase_list = malloc(erase_list_size);
+	if (erase_list == NULL)
+		return ERROR_FAIL;
+
+	for (int i = 0; i < erase_count; i++) {
+		int sector = erase_first + i;
+		target_buffer_set_u32(target, erase_list + i * 8,
+				bank->base + bank->sectors[sector].offset);
+		target_buffer_set_u32(target, erase_list + i * 8 + 4,
+				FLASH_SER | FLASH_SNB(sector) | FLASH_STRT);
+	}
+	target_buffer_set_u32(target, erase_list + erase_count * 8, 0xffffffff);
+	target_buffer_set_u32(target, erase_list + erase_count * 8 + 4, 0);
+
+	if (target_alloc_working_area(target, sizeof(stm32x_flash_write_code) + erase_list_size,
 			&write_algorithm) != ERROR_OK) {
+		free(erase_list);
 		LOG_WARNING("no working area available, can't do block memory writes");
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	};
@@ -542,8 +578,15 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	retval = target_write_buffer(target, write_algorithm->address,
 			sizeof(stm32x_flash_write_code),
 			stm32x_flash_write_code);
-	if (retval != ERROR_OK)
+	if (retval == ERROR_OK)
+		retval = target_write_buffer(target,
+				write_algorithm->address + sizeof(stm32x_flash_write_code),
+				erase_list_size, erase_list);
+	free(erase_list);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
 		return retval;
+	}
 
 	/* memory buffer */
 	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
@@ -566,18 +609,24 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);		/* target address */
 	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);		/* count (halfword-16bit) */
 	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);		/* flash base */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);		/* erase list */
 
 	buf_set_u32(reg_params[0].value, 0, 32, source->address);
 	buf_set_u32(reg_params[1].value, 0, 32, source->address + source->size);
 	buf_set_u32(reg_params[2].value, 0, 32, address);
 	buf_set_u32(reg_params[3].value, 0, 32, count);
 	buf_set_u32(reg_params[4].value, 0, 32, STM32_FLASH_BASE);
+	buf_set_u32(reg_params[5].value, 0, 32,
+			write_algorithm->address + sizeof(stm32x_flash_write_code));
 
-	retval = target_run_flash_async_algorithm(target, buffer, count, 2,
+	/* the loader takes no data while it erases a sector, which can take
+	 * seconds for the large sectors */
+	retval = target_run_flash_async_algorithm_timeout(target, buffer, count, 2,
 			0, NULL,
-			5, reg_params,
+			6, reg_params,
 			source->address, source->size,
 			write_algorithm->address, 0,
+			erase_count ? FLASH_ERASE_TIMEOUT : 5000,
 			&armv7m_info);
 
 	if (retval == ERROR_FLASH_OPERATION_FAILED) {
@@ -604,6 +653,7 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	destroy_reg_param(&reg_params[2]);
 	destroy_reg_param(&reg_params[3]);
 	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
 
 	return retval;
 }
@@ -635,7 +685,7 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 	/* multiple half words (2-byte) to be programmed? */
 	if (words_remaining > 0) {
 		/* try using a block write */
-		retval = stm32x_write_block(bank, buffer, offset, words_remaining);
+		retval = stm32x_write_block(bank, buffer, offset, words_remaining, 0, -1);
 		if (retval != ERROR_OK) {
 			if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
 				/* if block write failed (no sufficient working area),
@@ -707,6 +757,63 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 	return target_write_u32(target, STM32_FLASH_CR, FLASH_LOCK);
 }
 
+/* Erase and program in one pass of the flash loader: it erases each
+ * sector just before programming into it, while the host streams the data
+ * into the fifo.  Whatever the loader cannot handle is left to the separate
+ * erase and write paths.
+ */
+static int stm32x_erase_write(struct flash_bank *bank, int first, int last,
+		const uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	struct target *target = bank->target;
+	uint32_t words = count / 2;
+	uint32_t end;
+	int retval;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if ((offset & 0x1) || words == 0)
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	retval = stm32x_unlock_reg(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* sectors beyond the data are not reached by the loader */
+	end = offset + words * 2;
+	int loader_last = first;
+	while (loader_last < last && bank->sectors[loader_last + 1].offset < end)
+		loader_last++;
+
+	retval = stm32x_write_block(bank, buffer, offset, words, first, loader_last);
+	if (retval != ERROR_OK) {
+		target_write_u32(target, STM32_FLASH_CR, FLASH_LOCK);
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return ERROR_FLASH_OPER_UNSUPPORTED;
+		return retval;
+	}
+
+	for (int i = first; i <= loader_last; i++)
+		bank->sectors[i].is_erased = 1;
+
+	if (loader_last < last) {
+		retval = stm32x_erase(bank, loader_last + 1, last);
+		if (retval != ERROR_OK) {
+			target_write_u32(target, STM32_FLASH_CR, FLASH_LOCK);
+			return retval;
+		}
+	}
+
+	/* an odd trailing byte */
+	if (count & 1)
+		return stm32x_write(bank, buffer + words * 2, end, 1);
+
+	return target_write_u32(target, STM32_FLASH_CR, FLASH_LOCK);
+}
+
 static void setup_sector(struct flash_bank *bank, int start, int num, int size)
 {
 	for (int i = start; i < (start + num) ; i++) {
@@ -1149,6 +1256,7 @@ struct flash_driver stm32f2x_flash = {
 	.commands = stm32x_command_handlers,
 	.flash_bank_command = stm32x_flash_bank_command,
 	.erase = stm32x_erase,
+	.erase_write = stm32x_erase_write,
 	.protect = stm32x_protect,
 	.write = stm32x_write,
 	.read = default_flash_read,
@@ -341,7 +341,7 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 	struct working_area *source;
 	uint32_t address = bank->base + offset;
 
-	struct reg_param reg_params[3];
+	struct reg_param reg_params[6];
 	struct armv7m_algorithm armv7m_info;
 
 	int retval = ERROR_OK;
@@ -349,19 +349,51 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 	/* see contib/loaders/flash/stm32lx.S for src */
 
 	static const uint8_t stm32lx_flash_write_code[] = {
-		/* write_word: */
-		0x00, 0x23,             /* movs r3, #0 */
-		0x04, 0xe0,             /* b test_done */
-
-		/* write_word: */
-		0x51, 0xf8, 0x04, 0xcb, /* ldr ip, [r1], #4 */
-		0x40, 0xf8, 0x04, 0xcb, /* str ip, [r0], #4 */
-		0x01, 0x33,             /* adds r3, #1 */
-
-		/* test_done: */
-		0x93, 0x42,             /* cmp r3, r2 */
-		0xf8, 0xd3,             /* bcc write_word */
-		0x00, 0xbe,             /* bkpt 0 */
+		/* wait_fifo: */
+		0x0f, 0x68,               /* ldr r7, [r1, #0] */
+		0x00, 0x2f,               /* cmp r7, #0 */
+		0x21, 0xd0,               /* beq exit */
+		0x4d, 0x68,               /* ldr r5, [r1, #4] */
+		0x7f, 0x1b,               /* subs r7, r7, r5 */
+		0x02, 0xd2,               /* bcs no_wrap_count */
+		0xbf, 0x18,               /* adds r7, r7, r2 */
+		0x7f, 0x1a,               /* subs r7, r7, r1 */
+		0x08, 0x3f,               /* subs r7, #8 */
+		/* no_wrap_count: */
+		0xa7, 0x42,               /* cmp r7, r4 */
+		0xf4, 0xd3,               /* bcc wait_fifo */
+		0x26, 0x46,               /* mov r6, r4 */
+		/* copy: */
+		0x80, 0xcd,               /* ldmia r5!, {r7} */
+		0x1f, 0x60,               /* str r7, [r3] */
+		0x04, 0x33,               /* adds r3, #4 */
+		0x95, 0x42,               /* cmp r5, r2 */
+		0x01, 0xd3,               /* bcc no_wrap */
+		0x0d, 0x46,               /* mov r5, r1 */
+		0x08, 0x35,               /* adds r5, #8 */
+		/* no_wrap: */
+		0x04, 0x3e,               /* subs r6, #4 */
+		0xf6, 0xd1,               /* bne copy */
+		/* busy: */
+		0x47, 0x46,               /* mov r7, r8 */
+		0xbf, 0x69,               /* ldr r7, [r7, #0x18] */
+		0x01, 0x26,               /* movs r6, #1 */
+		0x37, 0x42,               /* tst r7, r6 */
+		0xfa, 0xd1,               /* bne busy */
+		0x07, 0x26,               /* movs r6, #7 */
+		0x36, 0x02,               /* lsls r6, r6, #8 */
+		0x37, 0x42,               /* tst r7, r6 */
+		0x03, 0xd1,               /* bne error */
+		0x4d, 0x60,               /* str r5, [r1, #4] */
+		0x40, 0x1e,               /* subs r0, r0, #1 */
+		0xde, 0xd1,               /* bne wait_fifo */
+		0x02, 0xe0,               /* b exit */
+		/* error: */
+		0x38, 0x46,               /* mov r0, r7 */
+		0x00, 0x26,               /* movs r6, #0 */
+		0x4e, 0x60,               /* str r6, [r1, #4] */
+		/* exit: */
+		0x00, 0xbe,               /* bkpt #0 */
 	};
 
 	/* Make sure we're performing a half-page aligned write. */
@@ -387,7 +419,8 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 		return retval;
 	}
 
-	/* Allocate half pages memory */
+	/* Allocate the fifo, it must hold at least one half page besides the
+	 * read and write pointers and the block that keeps it from filling up */
 	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
 		if (buffer_size > 1024)
 			buffer_size -= 1024;
@@ -406,9 +439,19 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
-	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
-	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
-	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* half page count (in), status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer start */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* half page size */
+	init_reg_param(&reg_params[5], "r8", 32, PARAM_OUT);	/* flash register base */
+
+	buf_set_u32(reg_params[0].value, 0, 32, count / hp_nb);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address);
+	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[3].value, 0, 32, address);
+	buf_set_u32(reg_params[4].value, 0, 32, hp_nb);
+	buf_set_u32(reg_params[5].value, 0, 32, stm32lx_info->flash_base);
 
 	/* Enable half-page write */
 	retval = stm32lx_enable_write_half_page(bank);
@@ -419,6 +462,9 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 		destroy_reg_param(&reg_params[0]);
 		destroy_reg_param(&reg_params[1]);
 		destroy_reg_param(&reg_params[2]);
+		destroy_reg_param(&reg_params[3]);
+		destroy_reg_param(&reg_params[4]);
+		destroy_reg_param(&reg_params[5]);
 		return retval;
 	}
 
@@ -434,43 +480,27 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 	uint32_t demcr_save = armv7m->demcr;
 	armv7m->demcr = VC_HARDERR;
 
-	/* Loop while there are bytes to write */
-	while (count > 0) {
-		uint32_t this_count;
-		this_count = (count > buffer_size) ? buffer_size : count;
-
-		/* Write the next half pages */
-		retval = target_write_buffer(target, source->address, this_count, buffer);
-		if (retval != ERROR_OK)
-			break;
-
-		/* 4: Store useful information in the registers */
-		/* the destination address of the copy (R0) */
-		buf_set_u32(reg_params[0].value, 0, 32, address);
-		/* The source address of the copy (R1) */
-		buf_set_u32(reg_params[1].value, 0, 32, source->address);
-		/* The length of the copy (R2) */
-		buf_set_u32(reg_params[2].value, 0, 32, this_count / 4);
-
-		/* 5: Execute the bunch of code */
-		retval = target_run_algorithm(target, 0, NULL, sizeof(reg_params)
-				/ sizeof(*reg_params), reg_params,
-				write_algorithm->address, 0, 10000, &armv7m_info);
-		if (retval != ERROR_OK)
-			break;
+	/* Stream all half pages through the fifo */
+	retval = target_run_flash_async_algorithm(target, buffer, count / 4, 4,
+			0, NULL,
+			6, reg_params,
+			source->address, source->size,
+			write_algorithm->address,
+			write_algorithm->address + sizeof(stm32lx_flash_write_code) - 2,
+			&armv7m_info);
 
-		/* check for Hard Fault */
-		if (armv7m->exception_number == 3)
-			break;
+	if (retval == ERROR_FLASH_OPERATION_FAILED && armv7m->exception_number != 3) {
+		uint32_t status = buf_get_u32(reg_params[0].value, 0, 32);
 
-		/* 6: Wait while busy */
-		retval = stm32lx_wait_until_bsy_clear(bank);
-		if (retval != ERROR_OK)
-			break;
+		LOG_ERROR("flash write failed at address 0x%" PRIx32,
+				buf_get_u32(reg_params[3].value, 0, 32));
 
-		buffer += this_count;
-		address += this_count;
-		count -= this_count;
+		if (status & FLASH_SR__WRPERR)
+			LOG_ERROR("access denied / write protected");
+		if (status & FLASH_SR__PGAERR)
+			LOG_ERROR("invalid program address");
+		if (status & FLASH_SR__SIZERR)
+			LOG_ERROR("invalid program size");
 	}
 
 	/* restore previous flags */
@@ -485,10 +515,13 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 		 * The workaround of handling the Hard Fault exception does work, but makes the
 		 * loader more complicated, as a compromise we manually write the pages, programming time
 		 * is reduced by 50% using this slower method.
+		 * The fault hits on the loader's first flash access, so nothing
+		 * has been programmed yet and the whole range is written again.
 		 */
 
 		LOG_WARNING("couldn't use loader, falling back to page memory writes");
 
+		retval = ERROR_OK;
 		while (count > 0) {
 			uint32_t this_count;
 			this_count = (count > hp_nb) ? hp_nb : count;
@@ -518,6 +551,9 @@ static int stm32lx_write_half_pages(struct flash_bank *bank, const uint8_t *buff
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
+	destroy_reg_param(&reg_params[3]);
+	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
 
 	return retval;
 }
@@ -207,117 +207,143 @@ static int read_status_reg(struct flash_bank *bank, uint32_t *status)
 	return ERROR_OK;
 }
 
-/* check for WIP (write in progress) bit in status register */
-/* timeout in ms */
-static int wait_till_ready(struct flash_bank *bank, int timeout)
-{
-	uint32_t status;
-	int retval;
-	long long endtime;
-
-	endtime = timeval_ms() + timeout;
-	do {
-		/* read flash status register */
-		retval = read_status_reg(bank, &status);
-		if (retval != ERROR_OK)
-			return retval;
-
-		if ((status & SPIFLASH_BSY_BIT) == 0)
-			return ERROR_OK;
-		alive_sleep(1);
-	} while (timeval_ms() < endtime);
-
-	LOG_ERROR("timeout");
-	return ERROR_FAIL;
-}
-
-/* Send "write enable" command to SPI flash chip.
- * The operation is triggered by setting SMI_WE bit, and SMI sends
- * the proper SPI command (0x06) */
-static int smi_write_enable(struct flash_bank *bank)
+/* Enter HW mode, in which the flash is memory mapped */
+static int stmsmi_map(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
 	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
 	uint32_t io_base = stmsmi_info->io_base;
-	uint32_t status;
-	int retval;
-
-	/* Enter in HW mode */
-	SMI_SET_HW_MODE(); /* AB: is this correct ?*/
-
-	/* clear transmit finished flag */
-	SMI_CLEAR_TFF();
-
-	/* Send write enable command */
-	SMI_WRITE_REG(SMI_CR2, stmsmi_info->bank_num | SMI_WE);
-
-	/* Poll transmit finished flag */
-	SMI_POLL_TFF(SMI_CMD_TIMEOUT);
-
-	/* read flash status register */
-	retval = read_status_reg(bank, &status);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Check write enabled */
-	if ((status & SPIFLASH_WE_BIT) == 0) {
-		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
-		return ERROR_FAIL;
-	}
 
+	SMI_SET_HW_MODE();
 	return ERROR_OK;
 }
 
-static uint32_t erase_command(struct stmsmi_flash_bank *stmsmi_info,
-	uint32_t offset)
+static const struct spi_nor_ops stmsmi_ops;
+
+static uint32_t command_word(uint8_t opcode, uint32_t addr)
 {
 	union {
 		uint32_t command;
 		uint8_t x[4];
 	} cmd;
 
-	cmd.x[0] = stmsmi_info->dev->erase_cmd;
-	cmd.x[1] = offset >> 16;
-	cmd.x[2] = offset >> 8;
-	cmd.x[3] = offset;
+	cmd.x[0] = opcode;
+	cmd.x[1] = addr >> 16;
+	cmd.x[2] = addr >> 8;
+	cmd.x[3] = addr;
 
 	return cmd.command;
 }
 
-static int smi_erase_sector(struct flash_bank *bank, int sector)
+/* Send a command to SPI flash chip.
+ * "Write enable" is triggered by setting SMI_WE bit, and SMI sends
+ * the proper SPI command (0x06).  Anything else goes out in SW mode. */
+static int smi_command(struct flash_bank *bank, uint8_t opcode,
+	bool has_addr, uint32_t addr)
 {
 	struct target *target = bank->target;
 	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
 	uint32_t io_base = stmsmi_info->io_base;
-	uint32_t cmd;
-	int retval;
 
-	retval = smi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
+	if (opcode == SPIFLASH_WRITE_ENABLE) {
+		/* Enter in HW mode */
+		SMI_SET_HW_MODE(); /* AB: is this correct ?*/
+
+		/* clear transmit finished flag */
+		SMI_CLEAR_TFF();
+
+		/* Send write enable command */
+		SMI_WRITE_REG(SMI_CR2, stmsmi_info->bank_num | SMI_WE);
+	} else {
+		/* Switch to SW mode to send the command */
+		SMI_SET_SW_MODE();
+
+		/* clear transmit finished flag */
+		SMI_CLEAR_TFF();
+
+		if (has_addr) {
+			SMI_WRITE_REG(SMI_TR, command_word(opcode, addr));
+			SMI_WRITE_REG(SMI_CR2,
+				stmsmi_info->bank_num | SMI_SEND | SMI_TX_LEN_4);
+		} else {
+			SMI_WRITE_REG(SMI_TR, opcode);
+			SMI_WRITE_REG(SMI_CR2,
+				stmsmi_info->bank_num | SMI_SEND | SMI_TX_LEN_1);
+		}
+	}
 
-	/* Switch to SW mode to send sector erase command */
-	SMI_SET_SW_MODE();
+	/* Poll transmit finished flag */
+	SMI_POLL_TFF(SMI_CMD_TIMEOUT);
 
-	/* clear transmit finished flag */
-	SMI_CLEAR_TFF();
+	return ERROR_OK;
+}
+
+/* Program in HW write burst mode, where SMI sends the page program command
+ * itself.  As before, an unaligned head and tail are written as bursts of
+ * their own, each after a new write enable. */
+static int smi_program(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	struct target *target = bank->target;
+	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
+	uint32_t io_base = stmsmi_info->io_base;
+	uint32_t part[3];
+	bool first = true;
+	int retval;
 
-	/* send SPI command "block erase" */
-	cmd = erase_command(stmsmi_info, bank->sectors[sector].offset);
-	SMI_WRITE_REG(SMI_TR, cmd);
-	SMI_WRITE_REG(SMI_CR2, stmsmi_info->bank_num | SMI_SEND | SMI_TX_LEN_4);
+	LOG_DEBUG("%s: offset=0x%08" PRIx32 " count=0x%08" PRIx32,
+			__func__, offset, count);
+
+	part[0] = (4 - (offset & 3)) & 3;
+	if (part[0] > count)
+		part[0] = count;
+	part[2] = (count - part[0]) & 3;
+	part[1] = count - part[0] - part[2];
+
+	for (int i = 0; i < 3; i++) {
+		if (part[i] == 0)
+			continue;
+
+		if (!first) {
+			retval = spi_nor_write_enable(bank, &stmsmi_ops);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		first = false;
 
-	/* Poll transmit finished flag */
-	SMI_POLL_TFF(SMI_CMD_TIMEOUT);
+		/* HW mode, write burst mode */
+		SMI_SET_HWWB_MODE();
 
-	/* poll WIP for end of self timed Sector Erase cycle */
-	retval = wait_till_ready(bank, SMI_MAX_TIMEOUT);
-	if (retval != ERROR_OK)
-		return retval;
+		retval = target_write_buffer(target, bank->base + offset,
+			part[i], buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		buffer += part[i];
+		offset += part[i];
+		count -= part[i];
+	}
+
+	/* close the burst before the status register is polled */
+	SMI_SET_HW_MODE();
 
 	return ERROR_OK;
 }
 
+static const struct spi_nor_ops stmsmi_ops = {
+	.read_status = read_status_reg,
+	.command = smi_command,
+	.program = smi_program,
+	.map = stmsmi_map,
+};
+
+/* check for WIP (write in progress) bit in status register */
+/* timeout in ms */
+static int wait_till_ready(struct flash_bank *bank, int timeout)
+{
+	return spi_nor_wait_till_ready(bank, &stmsmi_ops, timeout);
+}
+
 static int stmsmi_erase(struct flash_bank *bank, int first, int last)
 {
 	struct target *target = bank->target;
@@ -351,7 +377,8 @@ static int stmsmi_erase(struct flash_bank *bank, int first, int last)
 	}
 
 	for (sector = first; sector <= last; sector++) {
-		retval = smi_erase_sector(bank, sector);
+		retval = spi_nor_erase_sector(bank, &stmsmi_ops, stmsmi_info->dev,
+			sector, SMI_MAX_TIMEOUT);
 		if (retval != ERROR_OK)
 			break;
 		keep_alive();
@@ -372,40 +399,13 @@ static int stmsmi_protect(struct flash_bank *bank, int set,
 	return ERROR_OK;
 }
 
-static int smi_write_buffer(struct flash_bank *bank, const uint8_t *buffer,
-	uint32_t address, uint32_t len)
-{
-	struct target *target = bank->target;
-	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
-	uint32_t io_base = stmsmi_info->io_base;
-	int retval;
-
-	LOG_DEBUG("%s: address=0x%08" PRIx32 " len=0x%08" PRIx32,
-			__func__, address, len);
-
-	retval = smi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* HW mode, write burst mode */
-	SMI_SET_HWWB_MODE();
-
-	retval = target_write_buffer(target, address, len, buffer);
-	if (retval != ERROR_OK)
-		return retval;
-
-	return ERROR_OK;
-}
-
 static int stmsmi_write(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t offset, uint32_t count)
 {
 	struct target *target = bank->target;
 	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
 	uint32_t io_base = stmsmi_info->io_base;
-	uint32_t cur_count, page_size, page_offset;
-	int sector;
-	int retval = ERROR_OK;
+	int retval;
 
 	LOG_DEBUG("%s: offset=0x%08" PRIx32 " count=0x%08" PRIx32,
 		__func__, offset, count);
@@ -415,67 +415,9 @@ static int stmsmi_write(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	if (offset + count > stmsmi_info->dev->size_in_bytes) {
-		LOG_WARNING("Write pasts end of flash. Extra data discarded.");
-		count = stmsmi_info->dev->size_in_bytes - offset;
-	}
-
-	/* Check sector protection */
-	for (sector = 0; sector < bank->num_sectors; sector++) {
-		/* Start offset in or before this sector? */
-		/* End offset in or behind this sector? */
-		if ((offset <
-				(bank->sectors[sector].offset + bank->sectors[sector].size))
-			&& ((offset + count - 1) >= bank->sectors[sector].offset)
-			&& bank->sectors[sector].is_protected) {
-			LOG_ERROR("Flash sector %d protected", sector);
-			return ERROR_FAIL;
-		}
-	}
-
-	page_size = stmsmi_info->dev->pagesize;
-
-	/* unaligned buffer head */
-	if (count > 0 && (offset & 3) != 0) {
-		cur_count = 4 - (offset & 3);
-		if (cur_count > count)
-			cur_count = count;
-		retval = smi_write_buffer(bank, buffer, bank->base + offset,
-			cur_count);
-		if (retval != ERROR_OK)
-			goto err;
-		offset += cur_count;
-		buffer += cur_count;
-		count -= cur_count;
-	}
-
-	page_offset = offset % page_size;
-	/* central part, aligned words */
-	while (count >= 4) {
-		/* clip block at page boundary */
-		if (page_offset + count > page_size)
-			cur_count = page_size - page_offset;
-		else
-			cur_count = count & ~3;
-
-		retval = smi_write_buffer(bank, buffer, bank->base + offset,
-			cur_count);
-		if (retval != ERROR_OK)
-			goto err;
-
-		page_offset = 0;
-		buffer += cur_count;
-		offset += cur_count;
-		count -= cur_count;
-
-		keep_alive();
-	}
-
-	/* buffer tail */
-	if (count > 0)
-		retval = smi_write_buffer(bank, buffer, bank->base + offset, count);
+	retval = spi_nor_write(bank, &stmsmi_ops, stmsmi_info->dev,
+		buffer, offset, count, SMI_CMD_TIMEOUT);
 
-err:
 	/* Switch to HW mode before return to prompt */
 	SMI_SET_HW_MODE();
 	return retval;
@@ -527,7 +469,6 @@ static int stmsmi_probe(struct flash_bank *bank)
 	struct target *target = bank->target;
 	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
 	uint32_t io_base;
-	struct flash_sector *sectors;
 	uint32_t id = 0; /* silence uninitialized warning */
 	const struct stmsmi_target *target_device;
 	int retval;
@@ -574,13 +515,7 @@ static int stmsmi_probe(struct flash_bank *bank)
 	if (retval != ERROR_OK)
 		return retval;
 
-	stmsmi_info->dev = NULL;
-	for (const struct flash_device *p = flash_devices; p->name ; p++)
-		if (p->device_id == id) {
-			stmsmi_info->dev = p;
-			break;
-		}
-
+	stmsmi_info->dev = spi_nor_find_device(id);
 	if (!stmsmi_info->dev) {
 		LOG_ERROR("Unknown flash device (ID 0x%08" PRIx32 ")", id);
 		return ERROR_FAIL;
@@ -589,30 +524,25 @@ static int stmsmi_probe(struct flash_bank *bank)
 	LOG_INFO("Found flash device \'%s\' (ID 0x%08" PRIx32 ")",
 		stmsmi_info->dev->name, stmsmi_info->dev->device_id);
 
-	/* Set correct size value */
-	bank->size = stmsmi_info->dev->size_in_bytes;
-
-	/* create and fill sectors array */
-	bank->num_sectors =
-		stmsmi_info->dev->size_in_bytes / stmsmi_info->dev->sectorsize;
-	sectors = malloc(sizeof(struct flash_sector) * bank->num_sectors);
-	if (sectors == NULL) {
-		LOG_ERROR("not enough memory");
-		return ERROR_FAIL;
-	}
-
-	for (int sector = 0; sector < bank->num_sectors; sector++) {
-		sectors[sector].offset = sector * stmsmi_info->dev->sectorsize;
-		sectors[sector].size = stmsmi_info->dev->sectorsize;
-		sectors[sector].is_erased = -1;
-		sectors[sector].is_protected = 1;
-	}
+	retval = spi_nor_setup_sectors(bank, stmsmi_info->dev, 1);
+	if (retval != ERROR_OK)
+		return retval;
 
-	bank->sectors = sectors;
 	stmsmi_info->probed = 1;
 	return ERROR_OK;
 }
 
+static int stmsmi_read(struct flash_bank *bank, uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	return spi_nor_read(bank, &stmsmi_ops, buffer, offset, count);
+}
+
+static int stmsmi_erase_check(struct flash_bank *bank)
+{
+	return spi_nor_blank_check(bank, &stmsmi_ops);
+}
+
 static int stmsmi_auto_probe(struct flash_bank *bank)
 {
 	struct stmsmi_flash_bank *stmsmi_info = bank->driver_priv;
@@ -650,10 +580,10 @@ struct flash_driver stmsmi_flash = {
 	.erase = stmsmi_erase,
 	.protect = stmsmi_protect,
 	.write = stmsmi_write,
-	.read = default_flash_read,
+	.read = stmsmi_read,
 	.probe = stmsmi_probe,
 	.auto_probe = stmsmi_auto_probe,
-	.erase_check = default_flash_blank_check,
+	.erase_check = stmsmi_erase_check,
 	.protect_check = stmsmi_protect_check,
 	.info = get_stmsmi_info,
 };
@@ -619,6 +619,7 @@ void flash_set_dirty(void)
 	for (c = flash_bank_list(); c; c = c->next) {
 		for (i = 0; i < c->num_sectors; i++)
 			c->sectors[i].is_erased = 0;
+		flash_shadow_invalidate(c);
 	}
 }
 
@@ -809,6 +810,7 @@ COMMAND_HANDLER(handle_flash_bank_command)
 	c->default_padded_value = 0xff;
 	c->num_sectors = 0;
 	c->sectors = NULL;
+	c->shadow = NULL;
 	c->next = NULL;
 
 	int retval;
@@ -828,6 +830,23 @@ COMMAND_HANDLER(handle_flash_bank_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_flash_shadow_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+		flash_shadow_enable(enable);
+	}
+
+	command_print(CMD_CTX, "flash shadow is %s",
+		flash_shadow_is_enabled() ? "on" : "off");
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_flash_banks_command)
 {
 	if (CMD_ARGC != 0)
@@ -920,6 +939,15 @@ static const struct command_registration flash_config_command_handlers[] = {
 		.jim_handler = jim_flash_list,
 		.help = "Returns a list of details about the flash banks.",
 	},
+	{
+		.name = "shadow",
+		.mode = COMMAND_ANY,
+		.handler = handle_flash_shadow_command,
+		.usage = "['on'|'off']",
+		.help = "Display or set whether verify and erase checks may use "
+			"the host copy of the flash sectors written or erased "
+			"in this session, instead of reading them back.",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 static const struct command_registration flash_command_handlers[] = {
@@ -125,46 +125,81 @@ void *buf_set_ones(void *_buf, unsigned size)
 	return buf;
 }
 
+/* load/store up to eight bytes as a little endian word, any alignment */
+static inline uint64_t buf_get_le(const uint8_t *p, unsigned bytes)
+{
+	uint64_t value = 0;
+
+	if (bytes == 8)
+		return le_to_h_u64(p);
+
+	for (unsigned i = 0; i < bytes; i++)
+		value |= (uint64_t)p[i] << (8 * i);
+	return value;
+}
+
+static inline void buf_put_le(uint8_t *p, unsigned bytes, uint64_t value)
+{
+	if (bytes == 8) {
+		h_u64_to_le(p, value);
+		return;
+	}
+
+	for (unsigned i = 0; i < bytes; i++)
+		p[i] = value >> (8 * i);
+}
+
 void *buf_set_buf(const void *_src, unsigned src_start,
 	void *_dst, unsigned dst_start, unsigned len)
 {
 	const uint8_t *src = _src;
 	uint8_t *dst = _dst;
-	unsigned i, sb, db, sq, dq, lb, lq;
+	unsigned sq, dq;
 
-	sb = src_start / 8;
-	db = dst_start / 8;
+	src += src_start / 8;
+	dst += dst_start / 8;
 	sq = src_start % 8;
 	dq = dst_start % 8;
-	lb = len / 8;
-	lq = len % 8;
-
-	src += sb;
-	dst += db;
-
-	/* check if both buffers are on byte boundary and
-	 * len is a multiple of 8bit so we can simple copy
-	 * the buffer */
-	if ((sq == 0) && (dq == 0) &&  (lq == 0)) {
-		for (i = 0; i < lb; i++)
-			*dst++ = *src++;
-		return _dst;
+
+	/* check if both buffers are on byte boundary so the
+	 * whole bytes can simply be copied */
+	if ((sq == 0) && (dq == 0)) {
+		memcpy(dst, src, len / 8);
+		src += len / 8;
+		dst += len / 8;
+		len %= 8;
 	}
 
-	/* fallback to slow bit copy */
-	for (i = 0; i < len; i++) {
-		if (((*src >> (sq&7)) & 1) == 1)
-			*dst |= 1 << (dq&7);
-		else
-			*dst &= ~(1 << (dq&7));
-		if (sq++ == 7) {
-			sq = 0;
+	/* Shift and merge, at most 56 bits at a time:  with both bit
+	 * offsets below 8 the source and destination bits then always fit
+	 * into one 64-bit word.  Only the bytes actually covered by the
+	 * copy are touched.
+	 */
+	while (len > 0) {
+		unsigned n = len < 56 ? len : 56;
+		unsigned sbytes = DIV_ROUND_UP(sq + n, 8);
+		unsigned dbytes = DIV_ROUND_UP(dq + n, 8);
+		uint64_t mask = ((UINT64_C(1) << n) - 1) << dq;
+		uint64_t bits, word;
+
+		bits = buf_get_le(src, sbytes) >> sq;
+		word = buf_get_le(dst, dbytes);
+		word = (word & ~mask) | ((bits << dq) & mask);
+		buf_put_le(dst, dbytes, word);
+
+		src += n / 8;
+		dst += n / 8;
+		sq += n % 8;
+		dq += n % 8;
+		if (sq >= 8) {
+			sq -= 8;
 			src++;
 		}
-		if (dq++ == 7) {
-			dq = 0;
+		if (dq >= 8) {
+			dq -= 8;
 			dst++;
 		}
+		len -= n;
 	}
 
 	return _dst;
@@ -336,7 +371,25 @@ void bit_copy_queue_init(struct bit_copy_queue *q)
 int bit_copy_queued(struct bit_copy_queue *q, uint8_t *dst, unsigned dst_offset, const uint8_t *src,
 	unsigned src_offset, unsigned bit_count)
 {
-	struct bit_copy_queue_entry *qe = malloc(sizeof(*qe));
+	struct bit_copy_queue_entry *qe;
+
+	/* a copy that continues the previous one, in both source and
+	 * destination, just extends it */
+	if (!list_empty(&q->list)) {
+		qe = list_entry(q->list.prev, struct bit_copy_queue_entry, list);
+		unsigned src_end = qe->src_offset + qe->bit_count;
+		unsigned dst_end = qe->dst_offset + qe->bit_count;
+
+		if (qe->src + src_end / 8 == src + src_offset / 8
+				&& src_end % 8 == src_offset % 8
+				&& qe->dst + dst_end / 8 == dst + dst_offset / 8
+				&& dst_end % 8 == dst_offset % 8) {
+			qe->bit_count += bit_count;
+			return ERROR_OK;
+		}
+	}
+
+	qe = malloc(sizeof(*qe));
 	if (!qe)
 		return ERROR_FAIL;
 
@@ -196,6 +196,12 @@ void *buf_cpy(const void *from, void *to, unsigned size);
  */
 void *buf_set_ones(void *buf, unsigned size);
 
+/**
+ * Copies @c len bits starting at bit @c src_start of @c src to bit
+ * @c dst_start of @c dst.  Bits of @c dst outside the copied range are
+ * preserved.  Neither offset needs to be byte aligned.
+ * @returns The destination buffer (@c dst).
+ */
 void *buf_set_buf(const void *src, unsigned src_start,
 		  void *dst, unsigned dst_start, unsigned len);
 
@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+#ifndef HELPER_SHA256_H
+#define HELPER_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * SHA-256 as specified in FIPS 180-4.
+ */
+
+#define SHA256_BLOCK_SIZE	64
+#define SHA256_DIGEST_SIZE	32
+
+/** The round constants, also used by the on-target algorithms. */
+extern const uint32_t sha256_k[64];
+
+struct sha256_ctx {
+	/** The intermediate hash value */
+	uint32_t state[8];
+	/** Number of bytes hashed so far */
+	uint64_t length;
+	/** Data not yet hashed, less than a block */
+	uint8_t buffer[SHA256_BLOCK_SIZE];
+};
+
+void sha256_init(struct sha256_ctx *ctx);
+/**
+ * Hashes @a len bytes of @a data.  While no partial block is buffered,
+ * i.e. @a length is a multiple of the block size, whole blocks may also
+ * be hashed elsewhere by updating @a state and adding to @a length.
+ */
+void sha256_update(struct sha256_ctx *ctx, const uint8_t *data, size_t len);
+/** Pads the message and stores its digest in @a digest. */
+void sha256_final(struct sha256_ctx *ctx, uint8_t *digest);
+
+#endif /* HELPER_SHA256_H */
@@ -177,7 +177,8 @@ int jtag_build_buffer(const struct scan_command *cmd, uint8_t **buffer)
 	int i;
 
 	bit_count = jtag_scan_size(cmd);
-	*buffer = calloc(1, DIV_ROUND_UP(bit_count, 8));
+	*buffer = cmd_queue_alloc(DIV_ROUND_UP(bit_count, 8));
+	memset(*buffer, 0, DIV_ROUND_UP(bit_count, 8));
 
 	bit_count = 0;
 
@@ -227,8 +228,13 @@ int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd)
 		 */
 		if (cmd->fields[i].in_value) {
 			int num_bits = cmd->fields[i].num_bits;
-			uint8_t *captured = buf_set_buf(buffer, bit_count,
-					malloc(DIV_ROUND_UP(num_bits, 8)), 0, num_bits);
+			uint8_t *captured = cmd->fields[i].in_value;
+
+			/* straight into in_value; like buf_cpy(), clear the
+			 * unused bits of the last byte */
+			buf_set_buf(buffer, bit_count, captured, 0, num_bits);
+			if (num_bits % 8)
+				captured[num_bits / 8] &= (1 << (num_bits % 8)) - 1;
 
 #ifdef _DEBUG_JTAG_IO_
 			char *char_buf = buf_to_str(captured,
@@ -240,11 +246,6 @@ int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd)
 					i, num_bits, char_buf);
 			free(char_buf);
 #endif
-
-			if (cmd->fields[i].in_value)
-				buf_cpy(captured, cmd->fields[i].in_value, num_bits);
-
-			free(captured);
 		}
 		bit_count += cmd->fields[i].num_bits;
 	}
@@ -172,7 +172,17 @@ void jtag_command_queue_reset(void);
 
 enum scan_type jtag_scan_type(const struct scan_command *cmd);
 int jtag_scan_size(const struct scan_command *cmd);
+/**
+ * Copy the bits captured by a scan from @a buffer into the in_value
+ * of each field of @a cmd.
+ */
 int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd);
+/**
+ * Concatenate the out_value of all fields of @a cmd into one buffer.
+ * The buffer comes from the command queue (cmd_queue_alloc()), so it
+ * lives until the queue is reset and must not be freed by the caller.
+ * @returns The number of bits in the scan.
+ */
 int jtag_build_buffer(const struct scan_command *cmd, uint8_t **buffer);
 
 #endif /* JTAG_COMMANDS_H */
@@ -427,12 +427,18 @@ static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
 
 	for (int i = 0; i < in_num_fields; i++) {
 		if ((in_fields[i].check_value != NULL) && (in_fields[i].in_value != NULL)) {
+#ifdef HAVE_JTAG_MINIDRIVER_H
 			/* this is synchronous for a minidriver */
 			jtag_add_callback4(jtag_check_value_mask_callback,
 				(jtag_callback_data_t)in_fields[i].in_value,
 				(jtag_callback_data_t)in_fields[i].check_value,
 				(jtag_callback_data_t)in_fields[i].check_mask,
 				(jtag_callback_data_t)in_fields[i].num_bits);
+#else
+			interface_jtag_add_check_value(jtag_check_value_mask_callback,
+				in_fields[i].in_value, in_fields[i].check_value,
+				in_fields[i].check_mask, in_fields[i].num_bits);
+#endif
 		}
 	}
 }
@@ -1833,6 +1839,8 @@ void adapter_assert_reset(void)
 		swd_add_reset(1);
 	else if (transport_is_cmsis_dap())
 		swd_add_reset(1);  /* FIXME */
+	else if (transport_is_dap_direct())
+		swd_add_reset(1);
 	else if (get_current_transport() != NULL)
 		LOG_ERROR("reset is not supported on %s",
 			get_current_transport()->name);
@@ -1848,6 +1856,8 @@ void adapter_deassert_reset(void)
 		swd_add_reset(0);
 	else if (transport_is_cmsis_dap())
 		swd_add_reset(0);  /* FIXME */
+	else if (transport_is_dap_direct())
+		swd_add_reset(0);
 	else if (get_current_transport() != NULL)
 		LOG_ERROR("reset is not supported on %s",
 			get_current_transport()->name);
@@ -72,18 +72,29 @@ static void bitbang_end_state(tap_state_t state)
 	}
 }
 
-static void bitbang_state_move(int skip)
+/**
+ * Clock out bits @a skip to @a num_bits - 1 of the packed TMS sequence
+ * @a bits, leaving TCK idle afterwards.
+ */
+static void bitbang_tms_seq(const uint8_t *bits, unsigned skip, unsigned num_bits)
 {
-	int i = 0, tms = 0;
-	uint8_t tms_scan = tap_get_tms_path(tap_get_state(), tap_get_end_state());
-	int tms_count = tap_get_tms_path_len(tap_get_state(), tap_get_end_state());
+	int tms = 0;
 
-	for (i = skip; i < tms_count; i++) {
-		tms = (tms_scan >> i) & 1;
+	for (unsigned i = skip; i < num_bits; i++) {
+		tms = (bits[i / 8] >> (i % 8)) & 1;
 		bitbang_interface->write(0, tms, 0);
 		bitbang_interface->write(1, tms, 0);
 	}
 	bitbang_interface->write(CLOCK_IDLE(), tms, 0);
+}
+
+static void bitbang_state_move(int skip)
+{
+	uint8_t tms_scan[1];
+	unsigned tms_count = tap_append_tms_path(tms_scan, 0,
+			tap_get_state(), tap_get_end_state());
+
+	bitbang_tms_seq(tms_scan, skip, tms_count);
 
 	tap_set_state(tap_get_end_state());
 }
@@ -99,13 +110,7 @@ static int bitbang_execute_tms(struct jtag_command *cmd)
 
 	DEBUG_JTAG_IO("TMS: %d bits", num_bits);
 
-	int tms = 0;
-	for (unsigned i = 0; i < num_bits; i++) {
-		tms = ((bits[i/8] >> (i % 8)) & 1);
-		bitbang_interface->write(0, tms, 0);
-		bitbang_interface->write(1, tms, 0);
-	}
-	bitbang_interface->write(CLOCK_IDLE(), tms, 0);
+	bitbang_tms_seq(bits, 0, num_bits);
 
 	return ERROR_OK;
 }
@@ -142,12 +147,25 @@ static void bitbang_path_move(struct pathmove_command *cmd)
 	tap_set_end_state(tap_get_state());
 }
 
+/* runtest operations up to this many cycles are clocked as one sequence */
+#define BITBANG_RUNTEST_SEQ_CYCLES	256
+
 static void bitbang_runtest(int num_cycles)
 {
 	int i;
 
 	tap_state_t saved_end_state = tap_get_end_state();
 
+	if (num_cycles <= BITBANG_RUNTEST_SEQ_CYCLES) {
+		uint8_t tms[DIV_ROUND_UP(TAP_RUNTEST_TMS_BITS(BITBANG_RUNTEST_SEQ_CYCLES), 8)];
+		unsigned len = tap_get_tms_runtest(tms, tap_get_state(),
+				num_cycles, saved_end_state);
+
+		bitbang_tms_seq(tms, 0, len);
+		tap_set_state(saved_end_state);
+		return;
+	}
+
 	/* only do a state_move when we're not already in IDLE */
 	if (tap_get_state() != TAP_IDLE) {
 		bitbang_end_state(TAP_IDLE);
@@ -314,8 +332,6 @@ int bitbang_execute_queue(void)
 				bitbang_scan(cmd->cmd.scan->ir_scan, type, buffer, scan_size);
 				if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
 					retval = ERROR_JTAG_QUEUE_FAILED;
-				if (buffer)
-					free(buffer);
 				break;
 			case JTAG_SLEEP:
 #ifdef _DEBUG_JTAG_IO_
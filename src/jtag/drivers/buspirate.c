@@ -508,18 +508,19 @@ static void buspirate_end_state(tap_state_t state)
 	}
 }
 
+static void buspirate_tms_seq(const uint8_t *bits, unsigned num_bits)
+{
+	for (unsigned i = 0; i < num_bits; i++)
+		buspirate_tap_append((bits[i / 8] >> (i % 8)) & 1, 0);
+}
+
 static void buspirate_state_move(void)
 {
-	int i = 0, tms = 0;
-	uint8_t tms_scan = tap_get_tms_path(tap_get_state(),
-			tap_get_end_state());
-	int tms_count = tap_get_tms_path_len(tap_get_state(),
-			tap_get_end_state());
-
-	for (i = 0; i < tms_count; i++) {
-		tms = (tms_scan >> i) & 1;
-		buspirate_tap_append(tms, 0);
-	}
+	uint8_t tms_scan[1];
+	unsigned tms_count = tap_append_tms_path(tms_scan, 0,
+			tap_get_state(), tap_get_end_state());
+
+	buspirate_tms_seq(tms_scan, tms_count);
 
 	tap_set_state(tap_get_end_state());
 }
@@ -548,12 +549,25 @@ static void buspirate_path_move(int num_states, tap_state_t *path)
 	tap_set_end_state(tap_get_state());
 }
 
+/* runtest operations up to this many cycles are queued as one sequence */
+#define BUSPIRATE_RUNTEST_SEQ_CYCLES	256
+
 static void buspirate_runtest(int num_cycles)
 {
 	int i;
 
 	tap_state_t saved_end_state = tap_get_end_state();
 
+	if (num_cycles <= BUSPIRATE_RUNTEST_SEQ_CYCLES) {
+		uint8_t tms[DIV_ROUND_UP(TAP_RUNTEST_TMS_BITS(BUSPIRATE_RUNTEST_SEQ_CYCLES), 8)];
+		unsigned len = tap_get_tms_runtest(tms, tap_get_state(),
+				num_cycles, saved_end_state);
+
+		buspirate_tms_seq(tms, len);
+		tap_set_state(saved_end_state);
+		return;
+	}
+
 	/* only do a state_move when we're not already in IDLE */
 	if (tap_get_state() != TAP_IDLE) {
 		buspirate_end_state(TAP_IDLE);
@@ -709,8 +723,6 @@ static int buspirate_tap_execute(void)
 			buspirate_tap_init();
 			return ERROR_JTAG_QUEUE_FAILED;
 		}
-
-		free(buffer);
 	}
 	buspirate_tap_init();
 	return ERROR_OK;
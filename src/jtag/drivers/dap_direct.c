@@ -0,0 +1,424 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+ * Client for a transaction level DAP server, such as a simulator of a
+ * debug port, reached over TCP or a unix socket.  Used with the
+ * "dap_direct" transport.
+ *
+ * Wire protocol, all values little endian:
+ *
+ *   'T' count:u16 { cmd:u8 [data:u32] } * count
+ *       A batch of DP/AP register accesses.  cmd bit 0 selects the AP,
+ *       bit 1 marks a read and bits 3:2 hold A[3:2]; only writes carry
+ *       data.  The server answers status:u8 done:u16 { data:u32 } with
+ *       one word per executed read.  Execution stops at the first
+ *       access that failed (status 1, done counts the failed access).
+ *   'S' srst:u8
+ *       Assert (1) or release (0) the system reset; answered by
+ *       status:u8.
+ *   'Q'
+ *       Close the session.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifndef _WIN32
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#endif
+#include <jtag/interface.h>
+#include <jtag/commands.h>
+#include <jtag/swd.h>
+
+#define DAP_DIRECT_CMD_AP		(1 << 0)
+#define DAP_DIRECT_CMD_READ		(1 << 1)
+#define DAP_DIRECT_CMD_A32(n)	((n) & 0x0C)
+
+#define DAP_DIRECT_STATUS_OK	0
+#define DAP_DIRECT_STATUS_FAULT	1
+
+/* records per batch; a longer queue is flushed early */
+#define DAP_DIRECT_MAX_QUEUE	8192
+
+struct dap_direct_record {
+	uint8_t cmd;
+	uint32_t data;
+	uint32_t *result;
+};
+
+static char *dap_direct_host;
+static char *dap_direct_port;
+static int dap_direct_fd = -1;
+
+static struct dap_direct_record *queue;
+static unsigned queue_len;
+static int queued_retval;
+
+/* transmit buffer: header plus five bytes per record */
+static uint8_t *tx_buf;
+
+static int dap_direct_write_all(const uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = write_socket(dap_direct_fd, buf, len);
+		if (n <= 0) {
+			LOG_ERROR("dap_direct: write failed: %s", strerror(errno));
+			return ERROR_FAIL;
+		}
+		buf += n;
+		len -= n;
+	}
+	return ERROR_OK;
+}
+
+static int dap_direct_read_all(uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = read_socket(dap_direct_fd, buf, len);
+		if (n <= 0) {
+			LOG_ERROR("dap_direct: server closed the connection");
+			return ERROR_FAIL;
+		}
+		buf += n;
+		len -= n;
+	}
+	return ERROR_OK;
+}
+
+/* Send the queued records as one batch and scatter the read data. */
+static int dap_direct_flush(void)
+{
+	unsigned reads = 0;
+	size_t len = 3;
+	uint8_t hdr[3];
+	int retval;
+
+	if (queue_len == 0)
+		return ERROR_OK;
+
+	tx_buf[0] = 'T';
+	h_u16_to_le(tx_buf + 1, queue_len);
+	for (unsigned i = 0; i < queue_len; i++) {
+		tx_buf[len++] = queue[i].cmd;
+		if (!(queue[i].cmd & DAP_DIRECT_CMD_READ)) {
+			h_u32_to_le(tx_buf + len, queue[i].data);
+			len += 4;
+		}
+	}
+
+	unsigned count = queue_len;
+	queue_len = 0;
+
+	retval = dap_direct_write_all(tx_buf, len);
+	if (retval == ERROR_OK)
+		retval = dap_direct_read_all(hdr, sizeof(hdr));
+	if (retval != ERROR_OK)
+		return retval;
+
+	unsigned done = le_to_h_u16(hdr + 1);
+	if (done > count) {
+		LOG_ERROR("dap_direct: bad response");
+		return ERROR_FAIL;
+	}
+
+	/* read data comes back for the executed accesses only */
+	for (unsigned i = 0; i < done; i++)
+		if (queue[i].cmd & DAP_DIRECT_CMD_READ)
+			reads++;
+
+	uint8_t *rx_buf = tx_buf;
+	retval = dap_direct_read_all(rx_buf, reads * 4);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned i = 0; i < done; i++) {
+		if (!(queue[i].cmd & DAP_DIRECT_CMD_READ))
+			continue;
+		if (queue[i].result)
+			*queue[i].result = le_to_h_u32(rx_buf);
+		rx_buf += 4;
+	}
+
+	if (hdr[0] != DAP_DIRECT_STATUS_OK) {
+		LOG_DEBUG("dap_direct: access %u of %u failed", done, count);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static void dap_direct_queue(uint8_t swd_cmd, uint32_t data, uint32_t *result)
+{
+	if (queued_retval != ERROR_OK)
+		return;
+
+	if (queue_len == DAP_DIRECT_MAX_QUEUE) {
+		queued_retval = dap_direct_flush();
+		if (queued_retval != ERROR_OK)
+			return;
+	}
+
+	struct dap_direct_record *rec = &queue[queue_len++];
+	rec->cmd = DAP_DIRECT_CMD_A32(swd_cmd >> 1)
+		| ((swd_cmd & SWD_CMD_APnDP) ? DAP_DIRECT_CMD_AP : 0)
+		| ((swd_cmd & SWD_CMD_RnW) ? DAP_DIRECT_CMD_READ : 0);
+	rec->data = data;
+	rec->result = result;
+}
+
+static void dap_direct_read_reg(struct adiv5_dap *dap, uint8_t cmd, uint32_t *value)
+{
+	dap_direct_queue(cmd, 0, value);
+}
+
+static void dap_direct_write_reg(struct adiv5_dap *dap, uint8_t cmd, uint32_t value)
+{
+	dap_direct_queue(cmd, value, NULL);
+}
+
+static int dap_direct_run(struct adiv5_dap *dap)
+{
+	int retval = queued_retval;
+	queued_retval = ERROR_OK;
+
+	if (retval == ERROR_OK)
+		retval = dap_direct_flush();
+	queue_len = 0;
+
+	return retval;
+}
+
+static int dap_direct_swd_init(void)
+{
+	return ERROR_OK;
+}
+
+static int dap_direct_reset(int srst)
+{
+	uint8_t buf[2] = { 'S', srst ? 1 : 0 };
+
+	int retval = dap_direct_write_all(buf, sizeof(buf));
+	if (retval == ERROR_OK)
+		retval = dap_direct_read_all(buf, 1);
+	if (retval == ERROR_OK && buf[0] != DAP_DIRECT_STATUS_OK)
+		retval = ERROR_FAIL;
+	return retval;
+}
+
+static int dap_direct_execute_queue(void)
+{
+	struct jtag_command *cmd;
+	int retval = ERROR_OK;
+
+	for (cmd = jtag_command_queue; cmd != NULL; cmd = cmd->next) {
+		switch (cmd->type) {
+		case JTAG_RESET:
+			retval = dap_direct_reset(cmd->cmd.reset->srst);
+			if (retval != ERROR_OK)
+				return retval;
+			break;
+		case JTAG_SLEEP:
+			jtag_sleep(cmd->cmd.sleep->us);
+			break;
+		default:
+			LOG_ERROR("BUG: unknown JTAG command type encountered");
+			return ERROR_FAIL;
+		}
+	}
+
+	return retval;
+}
+
+static int dap_direct_connect_tcp(void)
+{
+	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+	struct addrinfo *result, *rp;
+	int fd = -1;
+
+	LOG_INFO("Connecting to %s:%s",
+			dap_direct_host ? dap_direct_host : "localhost",
+			dap_direct_port);
+
+	int s = getaddrinfo(dap_direct_host, dap_direct_port, &hints, &result);
+	if (s != 0) {
+		LOG_ERROR("getaddrinfo: %s", gai_strerror(s));
+		return ERROR_FAIL;
+	}
+
+	for (rp = result; rp != NULL ; rp = rp->ai_next) {
+		fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+		if (fd == -1)
+			continue;
+
+		if (connect(fd, rp->ai_addr, rp->ai_addrlen) != -1)
+			break;
+
+		close(fd);
+	}
+
+	freeaddrinfo(result);
+
+	if (rp == NULL) {
+		LOG_ERROR("Failed to connect: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	/* every batch waits for its answer, don't let Nagle delay it */
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+
+	return fd;
+}
+
+static int dap_direct_connect_unix(void)
+{
+	if (dap_direct_host == NULL) {
+		LOG_ERROR("host/socket not specified");
+		return ERROR_FAIL;
+	}
+
+	LOG_INFO("Connecting to unix socket %s", dap_direct_host);
+	int fd = socket(PF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		LOG_ERROR("socket: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	struct sockaddr_un addr;
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, dap_direct_host, sizeof(addr.sun_path));
+	addr.sun_path[sizeof(addr.sun_path)-1] = '\0';
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(struct sockaddr_un)) < 0) {
+		LOG_ERROR("connect: %s", strerror(errno));
+		close(fd);
+		return ERROR_FAIL;
+	}
+
+	return fd;
+}
+
+static int dap_direct_init(void)
+{
+	LOG_INFO("Initializing dap_direct driver");
+
+	queue = malloc(DAP_DIRECT_MAX_QUEUE * sizeof(*queue));
+	tx_buf = malloc(3 + DAP_DIRECT_MAX_QUEUE * 5);
+	if (queue == NULL || tx_buf == NULL) {
+		LOG_ERROR("dap_direct: out of memory");
+		return ERROR_FAIL;
+	}
+	queue_len = 0;
+	queued_retval = ERROR_OK;
+
+	if (dap_direct_port == NULL)
+		dap_direct_fd = dap_direct_connect_unix();
+	else
+		dap_direct_fd = dap_direct_connect_tcp();
+
+	if (dap_direct_fd < 0)
+		return dap_direct_fd;
+
+	return ERROR_OK;
+}
+
+static int dap_direct_quit(void)
+{
+	if (dap_direct_fd >= 0) {
+		uint8_t c = 'Q';
+		dap_direct_write_all(&c, 1);
+		close_socket(dap_direct_fd);
+		dap_direct_fd = -1;
+	}
+
+	free(queue);
+	queue = NULL;
+	free(tx_buf);
+	tx_buf = NULL;
+	free(dap_direct_host);
+	dap_direct_host = NULL;
+	free(dap_direct_port);
+	dap_direct_port = NULL;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dap_direct_handle_port_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	uint16_t port;
+	COMMAND_PARSE_NUMBER(u16, CMD_ARGV[0], port);
+	free(dap_direct_port);
+	dap_direct_port = port == 0 ? NULL : strdup(CMD_ARGV[0]);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dap_direct_handle_host_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	free(dap_direct_host);
+	dap_direct_host = strdup(CMD_ARGV[0]);
+	return ERROR_OK;
+}
+
+static const struct command_registration dap_direct_command_handlers[] = {
+	{
+		.name = "dap_direct_port",
+		.handler = dap_direct_handle_port_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set the TCP port of the DAP server.\n"
+			"  if 0 or unset, use unix sockets to connect to the server.",
+		.usage = "port_number",
+	},
+	{
+		.name = "dap_direct_host",
+		.handler = dap_direct_handle_host_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set the host name of the DAP server.\n"
+			"  if port is 0 or unset, this is the name of the unix socket to use.",
+		.usage = "host_name",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct swd_driver dap_direct_swd_driver = {
+	.init = dap_direct_swd_init,
+	.read_reg = dap_direct_read_reg,
+	.write_reg = dap_direct_write_reg,
+	.run = dap_direct_run,
+};
+
+static const char * const dap_direct_transports[] = { "dap_direct", NULL };
+
+struct jtag_interface dap_direct_interface = {
+	.name = "dap_direct",
+	.commands = dap_direct_command_handlers,
+	.swd = &dap_direct_swd_driver,
+	.transports = dap_direct_transports,
+
+	.execute_queue = dap_direct_execute_queue,
+	.init = dap_direct_init,
+	.quit = dap_direct_quit,
+};
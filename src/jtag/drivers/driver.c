@@ -57,6 +57,36 @@ static void jtag_callback_queue_reset(void)
 	jtag_callback_queue_tail = NULL;
 }
 
+/* Checked scan fields, verified after the queue has been executed in
+ * queue order with the callbacks.  Entries are kept in blocks taken from
+ * the command queue arena, so they are released along with the commands.
+ */
+struct jtag_check_entry {
+	struct jtag_callback_entry *after;	/* last callback queued before */
+	jtag_callback_t report;
+	uint8_t *captured;
+	const uint8_t *value;
+	const uint8_t *mask;
+	int num_bits;
+};
+
+#define JTAG_CHECK_BLOCK_ENTRIES	64
+
+struct jtag_check_block {
+	struct jtag_check_block *next;
+	unsigned count;
+	struct jtag_check_entry entries[JTAG_CHECK_BLOCK_ENTRIES];
+};
+
+static struct jtag_check_block *jtag_check_queue_head;
+static struct jtag_check_block *jtag_check_queue_tail;
+
+static void jtag_check_queue_reset(void)
+{
+	jtag_check_queue_head = NULL;
+	jtag_check_queue_tail = NULL;
+}
+
 /**
  * Copy a struct scan_field for insertion into the queue.
  *
@@ -373,6 +403,77 @@ void interface_jtag_add_callback4(jtag_callback_t callback,
 	}
 }
 
+void interface_jtag_add_check_value(jtag_callback_t report, uint8_t *captured,
+		const uint8_t *value, const uint8_t *mask, int num_bits)
+{
+	struct jtag_check_block *block = jtag_check_queue_tail;
+
+	if (block == NULL || block->count == JTAG_CHECK_BLOCK_ENTRIES) {
+		block = cmd_queue_alloc(sizeof(struct jtag_check_block));
+		block->next = NULL;
+		block->count = 0;
+		if (jtag_check_queue_head == NULL)
+			jtag_check_queue_head = block;
+		else
+			jtag_check_queue_tail->next = block;
+		jtag_check_queue_tail = block;
+	}
+
+	struct jtag_check_entry *entry = &block->entries[block->count++];
+	entry->after = jtag_callback_queue_tail;
+	entry->report = report;
+	entry->captured = captured;
+	entry->value = value;
+	entry->mask = mask;
+	entry->num_bits = num_bits;
+}
+
+/* position in the check queue while it is run along with the callbacks */
+struct jtag_check_cursor {
+	struct jtag_check_block *block;
+	unsigned i;
+};
+
+/* verifies the checks queued right after callback @a after (NULL: before
+ * the first callback) */
+static int jtag_check_queue_run(struct jtag_check_cursor *cursor,
+		struct jtag_callback_entry *after)
+{
+	while (cursor->block) {
+		if (cursor->i == cursor->block->count) {
+			cursor->block = cursor->block->next;
+			cursor->i = 0;
+			continue;
+		}
+
+		const struct jtag_check_entry *entry = &cursor->block->entries[cursor->i];
+		if (entry->after != after)
+			break;
+		cursor->i++;
+
+		/* short fields (ACKs, IR captures) are the common case;
+		 * anything that doesn't obviously match gets the full
+		 * comparison, which also reports the mismatch */
+		if (entry->num_bits <= 32) {
+			uint32_t diff = buf_get_u32(entry->captured, 0, entry->num_bits)
+					^ buf_get_u32(entry->value, 0, entry->num_bits);
+			if (entry->mask)
+				diff &= buf_get_u32(entry->mask, 0, entry->num_bits);
+			if (diff == 0)
+				continue;
+		}
+
+		int retval = entry->report((jtag_callback_data_t)entry->captured,
+				(jtag_callback_data_t)entry->value,
+				(jtag_callback_data_t)entry->mask,
+				(jtag_callback_data_t)entry->num_bits);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 int interface_jtag_execute_queue(void)
 {
 	static int reentry;
@@ -382,16 +483,21 @@ int interface_jtag_execute_queue(void)
 
 	int retval = default_interface_jtag_execute_queue();
 	if (retval == ERROR_OK) {
+		struct jtag_check_cursor cursor = { jtag_check_queue_head, 0 };
 		struct jtag_callback_entry *entry;
-		for (entry = jtag_callback_queue_head; entry != NULL; entry = entry->next) {
+
+		retval = jtag_check_queue_run(&cursor, NULL);
+		for (entry = jtag_callback_queue_head; entry != NULL && retval == ERROR_OK;
+				entry = entry->next) {
 			retval = entry->callback(entry->data0, entry->data1, entry->data2, entry->data3);
-			if (retval != ERROR_OK)
-				break;
+			if (retval == ERROR_OK)
+				retval = jtag_check_queue_run(&cursor, entry);
 		}
 	}
 
 	jtag_command_queue_reset();
 	jtag_callback_queue_reset();
+	jtag_check_queue_reset();
 
 	reentry--;
 
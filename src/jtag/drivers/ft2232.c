@@ -895,11 +895,11 @@ static int ft2232_send_and_recv(struct jtag_command *first, struct jtag_command
 				type = jtag_scan_type(cmd->cmd.scan);
 				if (type != SCAN_OUT) {
 					scan_size = jtag_scan_size(cmd->cmd.scan);
-					buffer = calloc(DIV_ROUND_UP(scan_size, 8), 1);
+					buffer = cmd_queue_alloc(DIV_ROUND_UP(scan_size, 8));
+					memset(buffer, 0, DIV_ROUND_UP(scan_size, 8));
 					ft2232_read_scan(type, buffer, scan_size);
 					if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
 						retval = ERROR_JTAG_QUEUE_FAILED;
-					free(buffer);
 				}
 				break;
 
@@ -1861,8 +1861,6 @@ static int ft2232_execute_scan(struct jtag_command *cmd)
 		ft2232_large_scan(cmd->cmd.scan, type, buffer, scan_size);
 		require_send = 0;
 		first_unsent = cmd->next;
-		if (buffer)
-			free(buffer);
 		return retval;
 	} else if (ft2232_buffer_size + predicted_size + 1 > FT2232_BUFFER_SIZE) {
 		LOG_DEBUG(
@@ -1879,8 +1877,6 @@ static int ft2232_execute_scan(struct jtag_command *cmd)
 	ft2232_end_state(cmd->cmd.scan->end_state);
 	ft2232_add_scan(cmd->cmd.scan->ir_scan, type, buffer, scan_size);
 	require_send = 1;
-	if (buffer)
-		free(buffer);
 	DEBUG_JTAG_IO("%s scan, %i bits, end in %s",
 		(cmd->cmd.scan->ir_scan) ? "IR" : "DR", scan_size,
 		tap_state_name(tap_get_end_state()));
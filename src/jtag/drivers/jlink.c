@@ -1540,9 +1540,6 @@ static int jlink_tap_execute(void)
 			jlink_tap_init();
 			return ERROR_JTAG_QUEUE_FAILED;
 		}
-
-		if (pending_scan_result->buffer != NULL)
-			free(pending_scan_result->buffer);
 	}
 
 	jlink_tap_init();
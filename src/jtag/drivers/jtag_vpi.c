@@ -296,9 +296,6 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (buf)
-		free(buf);
-
 	if (cmd->end_state != TAP_DRSHIFT) {
 		retval = jtag_vpi_state_move(cmd->end_state);
 		if (retval != ERROR_OK)
@@ -310,15 +307,34 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 
 static int jtag_vpi_runtest(int cycles, tap_state_t state)
 {
+	uint8_t tms[XFERT_MAX_SIZE];
 	int retval;
 
+	/* short runs go out as a single TMS sequence, moves included */
+	if (TAP_RUNTEST_TMS_BITS(cycles) <= XFERT_MAX_SIZE * 8) {
+		int len = tap_get_tms_runtest(tms, tap_get_state(), cycles, state);
+
+		retval = jtag_vpi_tms_seq(tms, len);
+		if (retval != ERROR_OK)
+			return retval;
+
+		tap_set_state(state);
+		return ERROR_OK;
+	}
+
 	retval = jtag_vpi_state_move(TAP_IDLE);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = jtag_vpi_queue_tdi(NULL, cycles, TAP_SHIFT);
-	if (retval != ERROR_OK)
-		return retval;
+	memset(tms, 0, sizeof(tms));
+	while (cycles > 0) {
+		int len = MIN(cycles, XFERT_MAX_SIZE * 8);
+
+		retval = jtag_vpi_tms_seq(tms, len);
+		if (retval != ERROR_OK)
+			return retval;
+		cycles -= len;
+	}
 
 	return jtag_vpi_state_move(state);
 }
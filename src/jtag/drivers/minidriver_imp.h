@@ -29,6 +29,17 @@ static inline void interface_jtag_add_scan_check_alloc(struct scan_field *field)
 	field->in_value = cmd_queue_alloc(num_bytes);
 }
 
+/**
+ * Queue the verification of a captured scan field.  The check runs
+ * after the queue has been executed, in queue order with the callbacks;
+ * @a value and @a mask must stay valid until then, like the captured
+ * data.  Fields which don't obviously match are passed to @a report,
+ * as a callback with the same four arguments, which does the full
+ * comparison and reports the mismatch.
+ */
+void interface_jtag_add_check_value(jtag_callback_t report, uint8_t *captured,
+		const uint8_t *value, const uint8_t *mask, int num_bits);
+
 void interface_jtag_add_callback(jtag_callback1_t f, jtag_callback_data_t data0);
 
 void interface_jtag_add_callback4(jtag_callback_t f, jtag_callback_data_t data0,
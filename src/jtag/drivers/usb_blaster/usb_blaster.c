@@ -514,8 +514,7 @@ static void ublast_state_move(tap_state_t state)
 		  tap_state_name(state));
 	if (tap_get_state() == state)
 		return;
-	tms_scan = tap_get_tms_path(tap_get_state(), state);
-	tms_len = tap_get_tms_path_len(tap_get_state(), state);
+	tms_len = tap_append_tms_path(&tms_scan, 0, tap_get_state(), state);
 	ublast_tms_seq(&tms_scan, tms_len);
 	tap_set_state(state);
 }
@@ -688,6 +687,19 @@ static void ublast_runtest(int cycles, tap_state_t state)
 {
 	DEBUG_JTAG_IO("%s(cycles=%i, end_state=%d)", __func__, cycles, state);
 
+	/*
+	 * Below a byte worth of cycles, byteshift mode buys nothing: clock the
+	 * moves and the cycles as a single TMS sequence.
+	 */
+	if (cycles < 8) {
+		uint8_t tms[DIV_ROUND_UP(TAP_RUNTEST_TMS_BITS(8), 8)];
+		int len = tap_get_tms_runtest(tms, tap_get_state(), cycles, state);
+
+		ublast_tms_seq(tms, len);
+		tap_set_state(state);
+		return;
+	}
+
 	ublast_state_move(TAP_IDLE);
 	ublast_queue_tdi(NULL, cycles, SCAN_OUT);
 	ublast_state_move(state);
@@ -744,8 +756,6 @@ static int ublast_scan(struct scan_command *cmd)
 		tap_set_state(TAP_DRPAUSE);
 
 	ret = jtag_read_buffer(buf, cmd);
-	if (buf)
-		free(buf);
 	ublast_state_move(cmd->end_state);
 	return ret;
 }
@@ -149,8 +149,6 @@ static int usbprog_execute_queue(void)
 			    usbprog_scan(cmd->cmd.scan->ir_scan, type, buffer, scan_size);
 			    if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
 				    return ERROR_JTAG_QUEUE_FAILED;
-			    if (buffer)
-				    free(buffer);
 			    break;
 		    case JTAG_SLEEP:
 #ifdef _DEBUG_JTAG_IO_
@@ -210,6 +210,53 @@ int tap_get_tms_path_len(tap_state_t from, tap_state_t to)
 	return (*tms_seqs)[tap_move_ndx(from)][tap_move_ndx(to)].bit_count;
 }
 
+unsigned tap_append_tms_path(uint8_t *buf, unsigned offset,
+		tap_state_t from, tap_state_t to)
+{
+	const struct tms_sequences *seq =
+		&(*tms_seqs)[tap_move_ndx(from)][tap_move_ndx(to)];
+
+	buf_set_u32(buf, offset, seq->bit_count, seq->bits);
+	return offset + seq->bit_count;
+}
+
+/* clear @a count bits of @a buf from bit @a offset on, a byte at a time
+ * where possible */
+static unsigned tap_append_tms_zeros(uint8_t *buf, unsigned offset,
+		unsigned count)
+{
+	unsigned end = offset + count;
+
+	for (; offset < end && (offset % 8); offset++)
+		buf[offset / 8] &= ~(1 << (offset % 8));
+
+	if (end - offset >= 8) {
+		memset(&buf[offset / 8], 0, (end - offset) / 8);
+		offset += (end - offset) & ~7u;
+	}
+
+	for (; offset < end; offset++)
+		buf[offset / 8] &= ~(1 << (offset % 8));
+
+	return end;
+}
+
+unsigned tap_get_tms_runtest(uint8_t *buf, tap_state_t from,
+		unsigned num_cycles, tap_state_t to)
+{
+	unsigned len = 0;
+
+	if (from != TAP_IDLE)
+		len = tap_append_tms_path(buf, len, from, TAP_IDLE);
+
+	len = tap_append_tms_zeros(buf, len, num_cycles);
+
+	if (to != TAP_IDLE)
+		len = tap_append_tms_path(buf, len, TAP_IDLE, to);
+
+	return len;
+}
+
 bool tap_is_state_stable(tap_state_t astate)
 {
 	bool is_stable;
@@ -129,6 +129,43 @@ int tap_get_tms_path(tap_state_t from, tap_state_t to);
  */
 int tap_get_tms_path_len(tap_state_t from, tap_state_t to);
 
+/** The longest TMS sequence tap_get_tms_path() returns. */
+#define TAP_MAX_TMS_PATH_LEN	7
+
+/**
+ * Packs the TMS path from state \a from to state \a to into @a buf,
+ * starting at bit @a offset, with the first bit clocked out at the
+ * lowest bit position.  Drivers use this to build one TMS buffer for
+ * several moves instead of clocking each path separately.
+ *
+ * @param buf The buffer the path is stored to.
+ * @param offset The first bit of @a buf to write.
+ * @param from The starting state.
+ * @param to The desired final state.
+ * @return unsigned - the bit offset following the path.
+ */
+unsigned tap_append_tms_path(uint8_t *buf, unsigned offset,
+		tap_state_t from, tap_state_t to);
+
+/** Size in bits of a tap_get_tms_runtest() sequence of @a cycles clocks. */
+#define TAP_RUNTEST_TMS_BITS(cycles)	((cycles) + 2 * TAP_MAX_TMS_PATH_LEN)
+
+/**
+ * Builds the complete TMS sequence of a RUNTEST operation: the move
+ * from \a from to Run-Test/Idle, \a num_cycles clocks with TMS low, and
+ * the move from Run-Test/Idle to \a to.  No move is made when \a from or
+ * \a to already is TAP_IDLE.
+ *
+ * @param buf The buffer the sequence is stored to; it must hold at least
+ * TAP_RUNTEST_TMS_BITS(num_cycles) bits.
+ * @param from The starting state.
+ * @param num_cycles The number of clocks spent in Run-Test/Idle.
+ * @param to The stable state to end in.
+ * @return unsigned - the total number of bits in the sequence.
+ */
+unsigned tap_get_tms_runtest(uint8_t *buf, tap_state_t from,
+		unsigned num_cycles, tap_state_t to);
+
 
 /**
  * Function tap_move_ndx
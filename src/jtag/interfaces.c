@@ -110,6 +110,9 @@ extern struct jtag_interface buspirate_interface;
 #if BUILD_REMOTE_BITBANG == 1
 extern struct jtag_interface remote_bitbang_interface;
 #endif
+#if BUILD_DAP_DIRECT == 1
+extern struct jtag_interface dap_direct_interface;
+#endif
 #if BUILD_HLADAPTER == 1
 extern struct jtag_interface hl_interface;
 #endif
@@ -209,6 +212,9 @@ struct jtag_interface *jtag_interfaces[] = {
 #if BUILD_REMOTE_BITBANG == 1
 		&remote_bitbang_interface,
 #endif
+#if BUILD_DAP_DIRECT == 1
+		&dap_direct_interface,
+#endif
 #if BUILD_HLADAPTER == 1
 		&hl_interface,
 #endif
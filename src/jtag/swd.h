@@ -216,5 +216,6 @@ void swd_add_reset(int req_srst);
 
 bool transport_is_swd(void);
 bool transport_is_cmsis_dap(void);
+bool transport_is_dap_direct(void);
 
 #endif /* SWD_H */
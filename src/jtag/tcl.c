@@ -691,7 +691,7 @@ static int jim_jtag_arp_init_reset(Jim_Interp *interp, int argc, Jim_Obj *const
 	struct command_context *context = current_command_context(interp);
 	if (transport_is_jtag())
 		e = jtag_init_reset(context);
-	else if (transport_is_swd())
+	else if (transport_is_swd() || transport_is_dap_direct())
 		e = swd_init_reset(context);
 
 	if (e != ERROR_OK) {
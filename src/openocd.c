@@ -39,6 +39,7 @@
 #include <flash/nand/core.h>
 #include <pld/pld.h>
 #include <flash/mflash.h>
+#include <target/target_request.h>
 
 #include <server/server.h>
 #include <server/gdb_server.h>
@@ -331,6 +332,8 @@ int openocd_main(int argc, char *argv[])
 	/* Start the executable meat that can evolve into thread in future. */
 	ret = openocd_thread(argc, argv, cmd_ctx);
 
+	target_request_quit();
+
 	unregister_all_commands(cmd_ctx, NULL);
 
 	/* free commandline interface */
@@ -66,6 +66,16 @@ struct target_desc_format {
 };
 
 /* private connection data for GDB */
+/* vFlashWrite data received but not programmed yet, see gdb_flash_stream */
+struct gdb_vflash_run {
+	uint32_t address;	/* target address of data[0] */
+	uint8_t *data;
+	uint32_t size;
+	uint32_t capacity;
+	bool started;		/* TARGET_EVENT_GDB_FLASH_WRITE_START was sent */
+	int error;		/* first failure of a streamed flash write */
+};
+
 struct gdb_connection {
 	char buffer[GDB_BUFFER_SIZE];
 	char *buf_p;
@@ -73,6 +83,7 @@ struct gdb_connection {
 	int ctrl_c;
 	enum target_state frontend_state;
 	struct image *vflash_image;
+	struct gdb_vflash_run vflash_run;
 	int closed;
 	int busy;
 	int noack_mode;
@@ -104,6 +115,7 @@ static int gdb_breakpoint_override;
 static enum breakpoint_type gdb_breakpoint_override_type;
 
 static int gdb_error(struct connection *connection, int retval);
+static void gdb_vflash_reset(struct connection *connection);
 static char *gdb_port;
 static char *gdb_port_next;
 
@@ -121,6 +133,15 @@ static int gdb_use_memory_map = 1;
 /* enabled by default*/
 static int gdb_flash_program = 1;
 
+/* if set, completed flash sectors are programmed while GDB is still
+ * sending vFlashWrite packets, instead of all at vFlashDone.
+ * enabled by default */
+static int gdb_flash_stream = 1;
+
+/* smallest amount of completed vFlashWrite data programmed at once,
+ * so that flash algorithm setup costs stay small */
+#define GDB_VFLASH_STREAM_CHUNK		(64 * 1024)
+
 /* if set, data aborts cause an error to be reported in memory read packets
  * see the code in gdb_read_memory_packet() for further explanations.
  * Disabled by default.
@@ -928,6 +949,7 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->ctrl_c = 0;
 	gdb_connection->frontend_state = TARGET_HALTED;
 	gdb_connection->vflash_image = NULL;
+	memset(&gdb_connection->vflash_run, 0, sizeof(gdb_connection->vflash_run));
 	gdb_connection->closed = 0;
 	gdb_connection->busy = 0;
 	gdb_connection->noack_mode = 0;
@@ -1025,6 +1047,8 @@ static int gdb_connection_closed(struct connection *connection)
 		free(gdb_connection->vflash_image);
 		gdb_connection->vflash_image = NULL;
 	}
+	gdb_vflash_reset(connection);
+	free(gdb_connection->vflash_run.data);
 
 	/* if this connection registered a debug-message receiver delete it */
 	delete_debug_msg_receiver(connection->cmd_ctx, gdb_service->target);
@@ -2416,6 +2440,163 @@ static int gdb_query_packet(struct connection *connection,
 	return ERROR_OK;
 }
 
+/**
+ * Returns the start of the flash sector holding @a addr, and in @a bank
+ * the flash bank, or @a addr itself and NULL if @a addr is not in flash.
+ */
+static uint32_t gdb_vflash_sector_start(struct target *target, uint32_t addr,
+		struct flash_bank **bank)
+{
+	if (get_flash_bank_by_addr(target, addr, false, bank) != ERROR_OK || !*bank) {
+		*bank = NULL;
+		return addr;
+	}
+
+	uint32_t offset = addr - (*bank)->base;
+	for (int i = 0; i < (*bank)->num_sectors; i++) {
+		struct flash_sector *sector = &(*bank)->sectors[i];
+		if (offset < sector->offset + sector->size)
+			return (*bank)->base + sector->offset;
+	}
+
+	return addr;
+}
+
+/** Programs the first @a size bytes of the vFlashWrite run and drops them. */
+static int gdb_vflash_program(struct connection *connection, uint32_t size)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_vflash_run *run = &gdb_connection->vflash_run;
+	uint32_t written;
+
+	/* a one section image on top of the run buffer */
+	struct imagesection section = {
+		.base_address = run->address,
+		.size = size,
+		.flags = 0,
+		.private = run->data,
+	};
+	struct image image = {
+		.type = IMAGE_BUILDER,
+		.num_sections = 1,
+		.sections = &section,
+	};
+
+	if (!run->started) {
+		target_call_event_callbacks(gdb_service->target,
+				TARGET_EVENT_GDB_FLASH_WRITE_START);
+		run->started = true;
+	}
+
+	int retval = flash_write(gdb_service->target, &image, &written, 0);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("streamed flash write at 0x%8.8" PRIx32 " failed", run->address);
+		if (run->error == ERROR_OK)
+			run->error = retval;
+	}
+
+	memmove(run->data, run->data + size, run->size - size);
+	run->address += size;
+	run->size -= size;
+
+	return retval;
+}
+
+/**
+ * Ends a vFlashWrite run: drops any data not yet programmed, clears an
+ * earlier failure and closes the GDB_FLASH_WRITE_START/END pair.  GDB
+ * gives up on a download after a failed vFlashWrite without sending
+ * vFlashDone, so the next download's vFlashErase does this as well.
+ */
+static void gdb_vflash_reset(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_vflash_run *run = &gdb_connection->vflash_run;
+
+	if (run->started)
+		target_call_event_callbacks(gdb_service->target,
+				TARGET_EVENT_GDB_FLASH_WRITE_END);
+
+	run->size = 0;
+	run->started = false;
+	run->error = ERROR_OK;
+}
+
+/**
+ * Adds the data of a vFlashWrite packet to the run of data waiting to
+ * be programmed.  A packet which doesn't continue the run first flushes
+ * it, unless it lands in the sector the run ends in; then the gap is
+ * padded like flash_write() pads gaps between image sections.
+ */
+static int gdb_vflash_append(struct connection *connection, uint32_t addr,
+		const uint8_t *data, uint32_t length)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_vflash_run *run = &gdb_connection->vflash_run;
+	uint32_t pad = 0;
+	uint8_t pad_value = 0xff;
+
+	if (run->size && addr != run->address + run->size) {
+		struct flash_bank *bank;
+		uint32_t end = run->address + run->size;
+
+		if (addr > end && gdb_vflash_sector_start(gdb_service->target,
+					addr, &bank) < end) {
+			pad = addr - end;
+			pad_value = bank->default_padded_value;
+		} else {
+			gdb_vflash_program(connection, run->size);
+		}
+	}
+	if (run->size == 0)
+		run->address = addr;
+
+	uint32_t size = run->size + pad + length;
+	if (size > run->capacity) {
+		uint32_t capacity = run->capacity ? run->capacity : GDB_VFLASH_STREAM_CHUNK;
+		while (capacity < size)
+			capacity *= 2;
+
+		uint8_t *buf = realloc(run->data, capacity);
+		if (!buf) {
+			LOG_ERROR("Out of memory for vFlashWrite data");
+			return ERROR_FAIL;
+		}
+		run->data = buf;
+		run->capacity = capacity;
+	}
+
+	memset(run->data + run->size, pad_value, pad);
+	memcpy(run->data + run->size + pad, data, length);
+	run->size = size;
+
+	return ERROR_OK;
+}
+
+/* programs whatever complete sectors the run holds, if that is enough
+ * to be worth a flash write */
+static void gdb_vflash_stream(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_vflash_run *run = &gdb_connection->vflash_run;
+	struct flash_bank *bank;
+
+	if (run->size < GDB_VFLASH_STREAM_CHUNK)
+		return;
+
+	/* GDB sends vFlashWrite packets in ascending address order, so the
+	 * sectors below the one the run ends in are complete */
+	uint32_t boundary = gdb_vflash_sector_start(gdb_service->target,
+			run->address + run->size, &bank);
+	if (bank && boundary > run->address
+			&& boundary - run->address >= GDB_VFLASH_STREAM_CHUNK)
+		gdb_vflash_program(connection, boundary - run->address);
+}
+
 static int gdb_v_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -2454,6 +2635,10 @@ static int gdb_v_packet(struct connection *connection,
 			return ERROR_SERVER_REMOTE_CLOSED;
 		}
 
+		/* a new download starts with its erases; forget what is left
+		 * of an earlier one which failed before vFlashDone */
+		gdb_vflash_reset(connection);
+
 		/* assume all sectors need erasing - stops any problems
 		 * when flash_write is called multiple times */
 		flash_set_dirty();
@@ -2503,6 +2688,26 @@ static int gdb_v_packet(struct connection *connection,
 		}
 		length = packet_size - (parse - packet);
 
+		if (gdb_flash_stream) {
+			struct gdb_vflash_run *run = &gdb_connection->vflash_run;
+
+			/* an earlier part of the download failed to program */
+			if (run->error != ERROR_OK) {
+				gdb_send_error(connection, EIO);
+				return ERROR_OK;
+			}
+
+			retval = gdb_vflash_append(connection, addr, (uint8_t const *)parse, length);
+			if (retval != ERROR_OK)
+				return retval;
+
+			/* acknowledge first, so GDB sends the next packet while
+			 * the completed sectors are programmed */
+			gdb_put_packet(connection, "OK", 2);
+			gdb_vflash_stream(connection);
+			return ERROR_OK;
+		}
+
 		/* create a new image if there isn't already one */
 		if (gdb_connection->vflash_image == NULL) {
 			gdb_connection->vflash_image = malloc(sizeof(struct image));
@@ -2523,6 +2728,27 @@ static int gdb_v_packet(struct connection *connection,
 	if (strncmp(packet, "vFlashDone", 10) == 0) {
 		uint32_t written;
 
+		if (gdb_flash_stream) {
+			struct gdb_vflash_run *run = &gdb_connection->vflash_run;
+
+			/* program what is left; no need to erase as GDB always
+			 * issues a vFlashErase first */
+			if (run->size && run->error == ERROR_OK)
+				gdb_vflash_program(connection, run->size);
+
+			result = run->error;
+			gdb_vflash_reset(connection);
+
+			if (result == ERROR_FLASH_DST_OUT_OF_BANK)
+				gdb_put_packet(connection, "E.memtype", 9);
+			else if (result != ERROR_OK)
+				gdb_send_error(connection, EIO);
+			else
+				gdb_put_packet(connection, "OK", 2);
+
+			return ERROR_OK;
+		}
+
 		/* process the flashing buffer. No need to erase as GDB
 		 * always issues a vFlashErase first. */
 		target_call_event_callbacks(gdb_service->target,
@@ -3008,6 +3234,15 @@ COMMAND_HANDLER(handle_gdb_flash_program_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_flash_stream_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ENABLE(CMD_ARGV[0], gdb_flash_stream);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_report_data_abort_command)
 {
 	if (CMD_ARGC != 1)
@@ -3131,6 +3366,14 @@ static const struct command_registration gdb_command_handlers[] = {
 		.help = "enable or disable flash program",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "gdb_flash_stream",
+		.handler = handle_gdb_flash_stream_command,
+		.mode = COMMAND_CONFIG,
+		.help = "enable or disable programming flash while a GDB "
+			"download is still in progress",
+		.usage = "('enable'|'disable')"
+	},
 	{
 		.name = "gdb_report_data_abort",
 		.handler = handle_gdb_report_data_abort_command,
@@ -0,0 +1,226 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/**
+ * @file
+ * Transaction level DAP transport, for simulators and co-simulation
+ * models which implement DP and AP registers but no wire protocol.
+ *
+ * DP and AP register accesses are handed to the interface's swd_driver
+ * methods unchanged; the driver queues them and ships a whole dap_run()
+ * worth of transactions at once.  Unlike real SWD, AP reads are not
+ * posted: every read returns its own data, and DP register 0 is IDCODE
+ * on read and ABORT on write.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "arm.h"
+#include "arm_adi_v5.h"
+
+#include <transport/transport.h>
+#include <jtag/interface.h>
+
+#include <jtag/swd.h>
+
+/* YUK! - but this is currently a global.... */
+extern struct jtag_interface *jtag_interface;
+
+static void dap_direct_clear_sticky_errors(struct adiv5_dap *dap)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+	assert(swd);
+
+	swd->write_reg(dap, swd_cmd(false, false, DP_ABORT),
+		STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+}
+
+static int dap_direct_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+	assert(swd);
+
+	swd->write_reg(dap, swd_cmd(false, false, DP_ABORT),
+		DAPABORT | STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+	return ERROR_OK;
+}
+
+static int dap_direct_queue_dp_read(struct adiv5_dap *dap, unsigned reg,
+		uint32_t *data)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+	assert(swd);
+
+	swd->read_reg(dap, swd_cmd(true, false, reg), data);
+	return ERROR_OK;
+}
+
+static int dap_direct_queue_dp_write(struct adiv5_dap *dap, unsigned reg,
+		uint32_t data)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+	assert(swd);
+
+	swd->write_reg(dap, swd_cmd(false, false, reg), data);
+	return ERROR_OK;
+}
+
+/** Select the AP register bank matching bits 7:4 of reg. */
+static void dap_direct_queue_ap_bankselect(struct adiv5_dap *dap, unsigned reg)
+{
+	uint32_t select_ap_bank = reg & 0x000000F0;
+
+	if (select_ap_bank == dap->ap_bank_value)
+		return;
+
+	dap->ap_bank_value = select_ap_bank;
+	select_ap_bank |= dap->ap_current;
+
+	dap_direct_queue_dp_write(dap, DP_SELECT, select_ap_bank);
+}
+
+static int dap_direct_queue_ap_read(struct adiv5_dap *dap, unsigned reg,
+		uint32_t *data)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+	assert(swd);
+
+	dap_direct_queue_ap_bankselect(dap, reg);
+	swd->read_reg(dap, swd_cmd(true, true, reg), data);
+	return ERROR_OK;
+}
+
+static int dap_direct_queue_ap_write(struct adiv5_dap *dap, unsigned reg,
+		uint32_t data)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+	assert(swd);
+
+	dap_direct_queue_ap_bankselect(dap, reg);
+	swd->write_reg(dap, swd_cmd(false, true, reg), data);
+	return ERROR_OK;
+}
+
+/** Executes all queued DAP operations. */
+static int dap_direct_run(struct adiv5_dap *dap)
+{
+	const struct swd_driver *swd = jtag_interface->swd;
+	int retval = swd->run(dap);
+
+	if (retval != ERROR_OK) {
+		/* the failing transaction left a sticky error behind */
+		dap_direct_clear_sticky_errors(dap);
+		swd->run(dap);
+	}
+
+	return retval;
+}
+
+const struct dap_ops dap_direct_ops = {
+	.is_swd = true,
+
+	.queue_dp_read = dap_direct_queue_dp_read,
+	.queue_dp_write = dap_direct_queue_dp_write,
+	.queue_ap_read = dap_direct_queue_ap_read,
+	.queue_ap_write = dap_direct_queue_ap_write,
+	.queue_ap_abort = dap_direct_queue_ap_abort,
+	.run = dap_direct_run,
+};
+
+static const struct command_registration dap_direct_commands[] = {
+	{
+		.name = "newdap",
+		.jim_handler = jim_jtag_newtap,
+		.mode = COMMAND_CONFIG,
+		.help = "declare a new transaction level DAP"
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration dap_direct_handlers[] = {
+	{
+		.name = "dap_direct",
+		.mode = COMMAND_ANY,
+		.help = "dap_direct command group",
+		.chain = dap_direct_commands,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static int dap_direct_select(struct command_context *ctx)
+{
+	int retval = register_commands(ctx, NULL, dap_direct_handlers);
+	if (retval != ERROR_OK)
+		return retval;
+
+	const struct swd_driver *swd = jtag_interface->swd;
+	if (!swd || !swd->read_reg || !swd->write_reg || !swd->run || !swd->init) {
+		LOG_ERROR("interface %s has no transaction level DAP access",
+				jtag_interface->name);
+		return ERROR_FAIL;
+	}
+
+	return swd->init();
+}
+
+static int dap_direct_init(struct command_context *ctx)
+{
+	struct target *target = get_current_target(ctx);
+	struct arm *arm = target_to_arm(target);
+	struct adiv5_dap *dap = arm->dap;
+	uint32_t idcode;
+	int retval;
+
+	if (!dap) {
+		LOG_ERROR("dap_direct needs an ADIv5 target");
+		return ERROR_FAIL;
+	}
+
+	/* Force the DAP's ops vector, as the SWD transport does */
+	dap->ops = &dap_direct_ops;
+
+	dap_direct_queue_dp_read(dap, DP_IDCODE, &idcode);
+	dap_direct_clear_sticky_errors(dap);
+	retval = dap_direct_run(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_INFO("dap_direct IDCODE %#8.8" PRIx32, idcode);
+	return ERROR_OK;
+}
+
+static struct transport dap_direct_transport = {
+	.name = "dap_direct",
+	.select = dap_direct_select,
+	.init = dap_direct_init,
+};
+
+static void dap_direct_constructor(void) __attribute__((constructor));
+static void dap_direct_constructor(void)
+{
+	transport_register(&dap_direct_transport);
+}
+
+/** Returns true if the current debug session
+ * is using the transaction level dap_direct transport.
+ */
+bool transport_is_dap_direct(void)
+{
+	return get_current_transport() == &dap_direct_transport;
+}
@@ -141,6 +141,10 @@ struct arm {
 	/** Flag reporting whether semihosting is active. */
 	bool is_semihosting;
 
+	/** Flag reporting whether semihosting requests are fetched with
+	 * batched debug port accesses. */
+	bool is_semihosting_fast;
+
 	/** Value to be returned by semihosting SYS_ERRNO request. */
 	int semihosting_errno;
 
@@ -258,6 +262,8 @@ int armv4_5_run_algorithm_inner(struct target *target,
 
 int arm_checksum_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t *checksum);
+int arm_sha256_memory(struct target *target,
+		uint32_t address, uint32_t blocks, uint32_t *state);
 int arm_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t *blank);
 
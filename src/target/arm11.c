@@ -1337,6 +1337,7 @@ struct target_type arm11_target = {
 	.write_memory = arm11_write_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.sha256_memory = arm_sha256_memory,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.add_breakpoint = arm11_add_breakpoint,
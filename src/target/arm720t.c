@@ -572,6 +572,7 @@ struct target_type arm720t_target = {
 	.virt2phys = arm720_virt2phys,
 
 	.checksum_memory = arm_checksum_memory,
+	.sha256_memory = arm_sha256_memory,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -706,6 +706,7 @@ struct target_type arm7tdmi_target = {
 	.write_memory = arm7_9_write_memory_opt,
 
 	.checksum_memory = arm_checksum_memory,
+	.sha256_memory = arm_sha256_memory,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -766,6 +766,7 @@ struct target_type arm946e_target = {
 	.write_memory = arm946e_write_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.sha256_memory = arm_sha256_memory,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
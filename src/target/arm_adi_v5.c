@@ -278,7 +278,9 @@ int mem_ap_write_atomic_u32(struct adiv5_dap *dap, uint32_t address,
 }
 
 /**
- * Synchronous write of a block of memory, using a specific access size.
+ * Queued write of a block of memory, using a specific access size.  The
+ * transfers are only queued; dap_run() executes them, together with any
+ * other transactions queued after them.
  *
  * @param dap The DAP connected to the MEM-AP.
  * @param buffer The data buffer to write. No particular alignment is assumed.
@@ -289,8 +291,8 @@ int mem_ap_write_atomic_u32(struct adiv5_dap *dap, uint32_t address,
  *  should normally be true, except when writing to e.g. a FIFO.
  * @return ERROR_OK on success, otherwise an error code.
  */
-int mem_ap_write(struct adiv5_dap *dap, const uint8_t *buffer, uint32_t size, uint32_t count,
-		uint32_t address, bool addrinc)
+int mem_ap_queue_write(struct adiv5_dap *dap, const uint8_t *buffer, uint32_t size,
+		uint32_t count, uint32_t address, bool addrinc)
 {
 	size_t nbytes = size * count;
 	const uint32_t csw_addrincr = addrinc ? CSW_ADDRINC_SINGLE : CSW_ADDRINC_OFF;
@@ -391,7 +393,26 @@ int mem_ap_write(struct adiv5_dap *dap, const uint8_t *buffer, uint32_t size, ui
 		}
 	}
 
-	/* REVISIT: Might want to have a queued version of this function that does not run. */
+	return retval;
+}
+
+/**
+ * Synchronous write of a block of memory, using a specific access size.
+ *
+ * @param dap The DAP connected to the MEM-AP.
+ * @param buffer The data buffer to write. No particular alignment is assumed.
+ * @param size Which access size to use, in bytes. 1, 2 or 4.
+ * @param count The number of writes to do (in size units, not bytes).
+ * @param address Address to be written; it must be writable by the currently selected MEM-AP.
+ * @param addrinc Whether the target address should be increased for each write or not. This
+ *  should normally be true, except when writing to e.g. a FIFO.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+int mem_ap_write(struct adiv5_dap *dap, const uint8_t *buffer, uint32_t size, uint32_t count,
+		uint32_t address, bool addrinc)
+{
+	int retval = mem_ap_queue_write(dap, buffer, size, count, address, addrinc);
+
 	if (retval == ERROR_OK)
 		retval = dap_run(dap);
 
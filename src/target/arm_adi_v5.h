@@ -443,6 +443,10 @@ int mem_ap_sel_read_atomic_u32(struct adiv5_dap *swjdp, uint8_t ap,
 int mem_ap_sel_write_atomic_u32(struct adiv5_dap *swjdp, uint8_t ap,
 		uint32_t address, uint32_t value);
 
+/* Queued MEM-AP memory mapped bus block transfers */
+int mem_ap_queue_write(struct adiv5_dap *dap, const uint8_t *buffer, uint32_t size,
+		uint32_t count, uint32_t address, bool addrinc);
+
 /* Synchronous MEM-AP memory mapped bus block transfers */
 int mem_ap_read(struct adiv5_dap *dap, uint8_t *buffer, uint32_t size,
 		uint32_t count, uint32_t address, bool addrinc);
@@ -4292,42 +4292,28 @@ ldrh_literal:
  * REVISIT for Thumb2 instructions, instruction->type and friends aren't
  * always set.  That means eventual arm_simulate_step() support for Thumb2
  * will need work in this area.
+ *
+ * The opcode has already been fetched:  a 32-bit instruction is passed
+ * with its first halfword in the upper sixteen bits, 16-bit instructions
+ * are passed as they are.
  */
-int thumb2_opcode(struct target *target, uint32_t address, struct arm_instruction *instruction)
+int thumb2_evaluate_opcode(uint32_t opcode, uint32_t address,
+		struct arm_instruction *instruction)
 {
 	int retval;
-	uint16_t op;
-	uint32_t opcode;
 	char *cp;
 
 	/* clear low bit ... it's set on function pointers */
 	address &= ~1;
 
+	if (opcode <= 0xffff)
+		/* 16-bit:  Thumb1 + IT + CBZ/CBNZ + ... */
+		return thumb_evaluate_opcode(opcode, address, instruction);
+
 	/* clear fields, to avoid confusion */
 	memset(instruction, 0, sizeof(struct arm_instruction));
-
-	/* read first halfword, see if this is the only one */
-	retval = target_read_u16(target, address, &op);
-	if (retval != ERROR_OK)
-		return retval;
-
-	switch (op & 0xf800) {
-		case 0xf800:
-		case 0xf000:
-		case 0xe800:
-			/* 32-bit instructions */
-			instruction->instruction_size = 4;
-			opcode = op << 16;
-			retval = target_read_u16(target, address + 2, &op);
-			if (retval != ERROR_OK)
-				return retval;
-			opcode |= op;
-			instruction->opcode = opcode;
-			break;
-		default:
-			/* 16-bit:  Thumb1 + IT + CBZ/CBNZ + ... */
-			return thumb_evaluate_opcode(op, address, instruction);
-	}
+	instruction->instruction_size = 4;
+	instruction->opcode = opcode;
 
 	snprintf(instruction->text, 128,
 			"0x%8.8" PRIx32 "  0x%8.8" PRIx32 "\t",
@@ -4410,6 +4396,36 @@ int thumb2_opcode(struct target *target, uint32_t address, struct arm_instructio
 	return ERROR_OK;
 }
 
+int thumb2_opcode(struct target *target, uint32_t address, struct arm_instruction *instruction)
+{
+	int retval;
+	uint16_t op;
+	uint32_t opcode;
+
+	/* clear low bit ... it's set on function pointers */
+	address &= ~1;
+
+	/* read first halfword, see if this is the only one */
+	retval = target_read_u16(target, address, &op);
+	if (retval != ERROR_OK)
+		return retval;
+
+	opcode = op;
+	switch (op & 0xf800) {
+		case 0xf800:
+		case 0xf000:
+		case 0xe800:
+			/* 32-bit instructions */
+			retval = target_read_u16(target, address + 2, &op);
+			if (retval != ERROR_OK)
+				return retval;
+			opcode = (opcode << 16) | op;
+			break;
+	}
+
+	return thumb2_evaluate_opcode(opcode, address, instruction);
+}
+
 int arm_access_size(struct arm_instruction *instruction)
 {
 	if ((instruction->type == ARM_LDRB)
@@ -192,6 +192,8 @@ int arm_evaluate_opcode(uint32_t opcode, uint32_t address,
 		struct arm_instruction *instruction);
 int thumb_evaluate_opcode(uint16_t opcode, uint32_t address,
 		struct arm_instruction *instruction);
+int thumb2_evaluate_opcode(uint32_t opcode, uint32_t address,
+		struct arm_instruction *instruction);
 int thumb2_opcode(struct target *target, uint32_t address,
 		struct arm_instruction *instruction);
 int arm_access_size(struct arm_instruction *instruction);
@@ -44,6 +44,7 @@
 #include "cortex_m.h"
 #include "register.h"
 #include "arm_semihosting.h"
+#include "arm_adi_v5.h"
 #include <helper/binarybuffer.h>
 #include <helper/log.h>
 #include <sys/stat.h>
@@ -63,7 +64,69 @@ static const int open_modeflags[12] = {
 	O_RDWR | O_CREAT | O_APPEND | O_BINARY
 };
 
-static int do_semihosting(struct target *target)
+/*
+ * Console output is written through stdio and flushed from a timer, so
+ * that chatty firmware doesn't cost a system call per character while
+ * its output still shows up promptly.
+ */
+static bool semihosting_flush_registered;
+
+static int semihosting_flush_callback(void *priv)
+{
+	fflush(stdout);
+	return ERROR_OK;
+}
+
+static void semihosting_output(const void *buf, size_t len)
+{
+	fwrite(buf, 1, len, stdout);
+
+	if (!semihosting_flush_registered) {
+		target_register_timer_callback(semihosting_flush_callback,
+				100, 1, NULL);
+		semihosting_flush_registered = true;
+	}
+}
+
+/* number of words in the parameter block r1 points to, if any */
+static unsigned semihosting_param_count(uint32_t r0)
+{
+	switch (r0) {
+	case 0x02:	/* SYS_CLOSE */
+	case 0x08:	/* SYS_ISERROR */
+	case 0x09:	/* SYS_ISTTY */
+	case 0x0c:	/* SYS_FLEN */
+	case 0x16:	/* SYS_HEAPINFO */
+		return 1;
+	case 0x0a:	/* SYS_SEEK */
+	case 0x0e:	/* SYS_REMOVE */
+	case 0x12:	/* SYS_SYSTEM */
+	case 0x15:	/* SYS_GET_CMDLINE */
+		return 2;
+	case 0x01:	/* SYS_OPEN */
+	case 0x05:	/* SYS_WRITE */
+	case 0x06:	/* SYS_READ */
+		return 3;
+	case 0x0f:	/* SYS_RENAME */
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+/* fetch @a count parameter words, unless they were already prefetched */
+static int semihosting_read_params(struct target *target, uint32_t r1,
+		unsigned count, uint8_t *params, const uint8_t *prefetched)
+{
+	if (prefetched) {
+		memcpy(params, prefetched, 4 * count);
+		return ERROR_OK;
+	}
+
+	return target_read_memory(target, r1, 4, count, params);
+}
+
+static int do_semihosting(struct target *target, const uint8_t *prefetched)
 {
 	struct arm *arm = target_to_arm(target);
 	uint32_t r0 = buf_get_u32(arm->core_cache->reg_list[0].value, 0, 32);
@@ -71,6 +134,10 @@ static int do_semihosting(struct target *target)
 	uint8_t params[16];
 	int retval, result;
 
+	/* keep buffered console output ordered with everything else */
+	if (r0 != 0x03 && r0 != 0x04)
+		fflush(stdout);
+
 	/*
 	 * TODO: lots of security issues are not considered yet, such as:
 	 * - no validation on target provided file descriptors
@@ -82,7 +149,7 @@ static int do_semihosting(struct target *target)
 	 */
 	switch (r0) {
 	case 0x01:	/* SYS_OPEN */
-		retval = target_read_memory(target, r1, 4, 3, params);
+		retval = semihosting_read_params(target, r1, 3, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -115,7 +182,7 @@ static int do_semihosting(struct target *target)
 		break;
 
 	case 0x02:	/* SYS_CLOSE */
-		retval = target_read_memory(target, r1, 4, 1, params);
+		retval = semihosting_read_params(target, r1, 1, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -131,26 +198,33 @@ static int do_semihosting(struct target *target)
 			retval = target_read_memory(target, r1, 1, 1, &c);
 			if (retval != ERROR_OK)
 				return retval;
-			putchar(c);
+			semihosting_output(&c, 1);
 			result = 0;
 		}
 		break;
 
 	case 0x04:	/* SYS_WRITE0 */
 		do {
-			unsigned char c;
-			retval = target_read_memory(target, r1++, 1, 1, &c);
+			/* read in chunks, but never across a 64 byte boundary:
+			 * the terminator may be the last byte of memory */
+			uint8_t chunk[64];
+			uint32_t n = sizeof(chunk) - (r1 % sizeof(chunk));
+			uint8_t *end;
+
+			retval = target_read_buffer(target, r1, n, chunk);
 			if (retval != ERROR_OK)
 				return retval;
-			if (!c)
+			end = memchr(chunk, 0, n);
+			semihosting_output(chunk, end ? (uint32_t)(end - chunk) : n);
+			if (end)
 				break;
-			putchar(c);
+			r1 += n;
 		} while (1);
 		result = 0;
 		break;
 
 	case 0x05:	/* SYS_WRITE */
-		retval = target_read_memory(target, r1, 4, 3, params);
+		retval = semihosting_read_params(target, r1, 3, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -177,7 +251,7 @@ static int do_semihosting(struct target *target)
 		break;
 
 	case 0x06:	/* SYS_READ */
-		retval = target_read_memory(target, r1, 4, 3, params);
+		retval = semihosting_read_params(target, r1, 3, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -209,21 +283,21 @@ static int do_semihosting(struct target *target)
 		break;
 
 	case 0x08:	/* SYS_ISERROR */
-		retval = target_read_memory(target, r1, 4, 1, params);
+		retval = semihosting_read_params(target, r1, 1, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		result = (target_buffer_get_u32(target, params+0) != 0);
 		break;
 
 	case 0x09:	/* SYS_ISTTY */
-		retval = target_read_memory(target, r1, 4, 1, params);
+		retval = semihosting_read_params(target, r1, 1, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		result = isatty(target_buffer_get_u32(target, params+0));
 		break;
 
 	case 0x0a:	/* SYS_SEEK */
-		retval = target_read_memory(target, r1, 4, 2, params);
+		retval = semihosting_read_params(target, r1, 2, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -237,7 +311,7 @@ static int do_semihosting(struct target *target)
 		break;
 
 	case 0x0c:	/* SYS_FLEN */
-		retval = target_read_memory(target, r1, 4, 1, params);
+		retval = semihosting_read_params(target, r1, 1, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -254,7 +328,7 @@ static int do_semihosting(struct target *target)
 		break;
 
 	case 0x0e:	/* SYS_REMOVE */
-		retval = target_read_memory(target, r1, 4, 2, params);
+		retval = semihosting_read_params(target, r1, 2, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -276,7 +350,7 @@ static int do_semihosting(struct target *target)
 		break;
 
 	case 0x0f:	/* SYS_RENAME */
-		retval = target_read_memory(target, r1, 4, 4, params);
+		retval = semihosting_read_params(target, r1, 4, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -312,7 +386,7 @@ static int do_semihosting(struct target *target)
 		break;
 
 	case 0x15:	/* SYS_GET_CMDLINE */
-		retval = target_read_memory(target, r1, 4, 2, params);
+		retval = semihosting_read_params(target, r1, 2, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -332,7 +406,7 @@ static int do_semihosting(struct target *target)
 		break;
 
 	case 0x16:	/* SYS_HEAPINFO */
-		retval = target_read_memory(target, r1, 4, 1, params);
+		retval = semihosting_read_params(target, r1, 1, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -380,7 +454,7 @@ static int do_semihosting(struct target *target)
 		 * to use this, but as I can't think of one, I
 		 * implemented it this way.
 		 */
-		retval = target_read_memory(target, r1, 4, 2, params);
+		retval = semihosting_read_params(target, r1, 2, params, prefetched);
 		if (retval != ERROR_OK)
 			return retval;
 		else {
@@ -454,6 +528,44 @@ static int do_semihosting(struct target *target)
 	return target_resume(target, 1, 0, 0, 0);
 }
 
+/*
+ * Fast semihosting on ARMv7-M:  fetch the instruction at the PC and, for
+ * calls taking one, the parameter block with a single DAP flush instead
+ * of one blocking read each.  On failure the caller falls back to the
+ * plain reads, so a parameter block that can't be read doesn't turn an
+ * ordinary breakpoint into an error.
+ */
+static int semihosting_prefetch(struct target *target, uint32_t pc,
+		uint16_t *insn, uint8_t *params, bool *params_valid)
+{
+	struct arm *arm = target_to_arm(target);
+	struct adiv5_dap *dap = arm->dap;
+	uint32_t r0 = buf_get_u32(arm->core_cache->reg_list[0].value, 0, 32);
+	uint32_t r1 = buf_get_u32(arm->core_cache->reg_list[1].value, 0, 32);
+	unsigned i, count = semihosting_param_count(r0);
+	uint32_t word, values[4];
+	int retval;
+
+	/* parameter blocks are word aligned */
+	if (r1 & 3)
+		count = 0;
+
+	retval = mem_ap_read_u32(dap, pc & ~3, &word);
+	for (i = 0; i < count && retval == ERROR_OK; i++)
+		retval = mem_ap_read_u32(dap, r1 + 4 * i, &values[i]);
+	if (retval == ERROR_OK)
+		retval = dap_run(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*insn = (pc & 2) ? word >> 16 : word & 0xffff;
+	for (i = 0; i < count; i++)
+		target_buffer_set_u32(target, params + 4 * i, values[i]);
+	*params_valid = count > 0;
+
+	return ERROR_OK;
+}
+
 /**
  * Checks for and processes an ARM semihosting request.  This is meant
  * to be called when the target is stopped due to a debug mode entry.
@@ -532,6 +644,8 @@ int arm_semihosting(struct target *target, int *retval)
 				return 0;
 		}
 	} else if (is_armv7m(target_to_armv7m(target))) {
+		uint8_t params[16];
+		bool params_valid = false;
 		uint16_t insn;
 
 		if (target->debug_reason != DBG_REASON_BREAKPOINT)
@@ -541,6 +655,18 @@ int arm_semihosting(struct target *target, int *retval)
 		pc = buf_get_u32(r->value, 0, 32);
 
 		pc &= ~1;
+
+		if (arm->is_semihosting_fast && arm->dap
+				&& semihosting_prefetch(target, pc, &insn,
+						params, &params_valid) == ERROR_OK) {
+			/* bkpt 0xAB */
+			if (insn != 0xBEAB)
+				return 0;
+
+			*retval = do_semihosting(target, params_valid ? params : NULL);
+			return 1;
+		}
+
 		*retval = target_read_u16(target, pc, &insn);
 		if (*retval != ERROR_OK)
 			return 1;
@@ -553,6 +679,6 @@ int arm_semihosting(struct target *target, int *retval)
 		return 0;
 	}
 
-	*retval = do_semihosting(target);
+	*retval = do_semihosting(target, NULL);
 	return 1;
 }
@@ -34,6 +34,7 @@
 #include "breakpoints.h"
 #include "arm_disassembler.h"
 #include <helper/binarybuffer.h>
+#include <helper/sha256.h>
 #include "algorithm.h"
 #include "register.h"
 
@@ -1183,6 +1184,36 @@ COMMAND_HANDLER(handle_arm_semihosting_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_arm_semihosting_fast_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (target == NULL) {
+		LOG_ERROR("No target selected");
+		return ERROR_FAIL;
+	}
+
+	struct arm *arm = target_to_arm(target);
+
+	if (!is_arm(arm)) {
+		command_print(CMD_CTX, "current target isn't an ARM");
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC > 0) {
+		int fast;
+
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], fast);
+		arm->is_semihosting_fast = fast;
+	}
+
+	command_print(CMD_CTX, "fast semihosting is %s",
+		arm->is_semihosting_fast
+		? "enabled" : "disabled");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration arm_exec_command_handlers[] = {
 	{
 		.name = "reg",
@@ -1239,6 +1270,14 @@ static const struct command_registration arm_exec_command_handlers[] = {
 		.usage = "['enable'|'disable']",
 		.help = "activate support for semihosting operations",
 	},
+	{
+		"semihosting_fast",
+		.handler = handle_arm_semihosting_fast_command,
+		.mode = COMMAND_EXEC,
+		.usage = "['enable'|'disable']",
+		.help = "fetch semihosting requests with batched debug port "
+			"accesses (ARMv7-M)",
+	},
 
 	COMMAND_REGISTRATION_DONE
 };
@@ -1560,7 +1599,9 @@ int arm_checksum_memory(struct target *target,
 	struct working_area *crc_algorithm;
 	struct arm_algorithm arm_algo;
 	struct arm *arm = target_to_arm(target);
-	struct reg_param reg_params[2];
+	struct reg_param reg_params[3];
+	const uint32_t *code;
+	uint32_t code_size;
 	int retval;
 	uint32_t i;
 	uint32_t exit_var = 0;
@@ -1596,16 +1637,88 @@ int arm_checksum_memory(struct target *target,
 		0x04C11DB7		/* .word 0x04C11DB7 */
 	};
 
-	retval = target_alloc_working_area(target,
-			sizeof(arm_crc_code), &crc_algorithm);
-	if (retval != ERROR_OK)
-		return retval;
+	/* see contrib/loaders/checksum/armv4_5_crc_table.s for src */
+
+	static const uint32_t arm_crc_table_code[] = {
+		/* main: */
+		0xE59F70B8,		/* ldr r7, CRC32XOR */
+		0xE3A03000,		/* mov r3, #0 */
+		/* gen: */
+		0xE1A04C03,		/* mov r4, r3, lsl #24 */
+		0xE3A05008,		/* mov r5, #8 */
+		/* bit: */
+		0xE1B04084,		/* movs r4, r4, lsl #1 */
+		0x20244007,		/* eorcs r4, r4, r7 */
+		0xE2555001,		/* subs r5, r5, #1 */
+		0x1AFFFFFB,		/* bne bit */
+		0xE7824103,		/* str r4, [r2, r3, lsl #2] */
+		0xE2833001,		/* add r3, r3, #1 */
+		0xE3530C01,		/* cmp r3, #256 */
+		0x1AFFFFF5,		/* bne gen */
+		0xE0803001,		/* add r3, r0, r1 */
+		0xE1A01000,		/* mov r1, r0 */
+		0xE3E00000,		/* mvn r0, #0 */
+		/* quad: */
+		0xE0434001,		/* sub r4, r3, r1 */
+		0xE3540004,		/* cmp r4, #4 */
+		0x3A000014,		/* blo tail */
+		0xE4D14001,		/* ldrb r4, [r1], #1 */
+		0xE0200C04,		/* eor r0, r0, r4, lsl #24 */
+		0xE1A04C20,		/* mov r4, r0, lsr #24 */
+		0xE7924104,		/* ldr r4, [r2, r4, lsl #2] */
+		0xE0240400,		/* eor r0, r4, r0, lsl #8 */
+		0xE4D14001,		/* ldrb r4, [r1], #1 */
+		0xE0200C04,		/* eor r0, r0, r4, lsl #24 */
+		0xE1A04C20,		/* mov r4, r0, lsr #24 */
+		0xE7924104,		/* ldr r4, [r2, r4, lsl #2] */
+		0xE0240400,		/* eor r0, r4, r0, lsl #8 */
+		0xE4D14001,		/* ldrb r4, [r1], #1 */
+		0xE0200C04,		/* eor r0, r0, r4, lsl #24 */
+		0xE1A04C20,		/* mov r4, r0, lsr #24 */
+		0xE7924104,		/* ldr r4, [r2, r4, lsl #2] */
+		0xE0240400,		/* eor r0, r4, r0, lsl #8 */
+		0xE4D14001,		/* ldrb r4, [r1], #1 */
+		0xE0200C04,		/* eor r0, r0, r4, lsl #24 */
+		0xE1A04C20,		/* mov r4, r0, lsr #24 */
+		0xE7924104,		/* ldr r4, [r2, r4, lsl #2] */
+		0xE0240400,		/* eor r0, r4, r0, lsl #8 */
+		0xEAFFFFE7,		/* b quad */
+		/* tail: */
+		0xE1510003,		/* cmp r1, r3 */
+		0x0A000005,		/* beq done */
+		0xE4D14001,		/* ldrb r4, [r1], #1 */
+		0xE0200C04,		/* eor r0, r0, r4, lsl #24 */
+		0xE1A04C20,		/* mov r4, r0, lsr #24 */
+		0xE7924104,		/* ldr r4, [r2, r4, lsl #2] */
+		0xE0240400,		/* eor r0, r4, r0, lsl #8 */
+		0xEAFFFFF7,		/* b tail */
+		/* done: */
+		0xE1200070,		/* bkpt #0 */
+		/* CRC32XOR: */
+		0x04C11DB7		/* .word 0x04C11DB7 */
+	};
+
+	/* The table driven code is much faster, but needs room for its 1 KiB
+	 * table, and building the table costs about as much as 200 bytes
+	 * done bitwise. */
+	if (count >= 256 && target_alloc_working_area_try(target,
+				sizeof(arm_crc_table_code) + 1024, &crc_algorithm) == ERROR_OK) {
+		code = arm_crc_table_code;
+		code_size = sizeof(arm_crc_table_code);
+	} else {
+		retval = target_alloc_working_area(target,
+				sizeof(arm_crc_code), &crc_algorithm);
+		if (retval != ERROR_OK)
+			return retval;
+		code = arm_crc_code;
+		code_size = sizeof(arm_crc_code);
+	}
 
 	/* convert code into a buffer in target endianness */
-	for (i = 0; i < ARRAY_SIZE(arm_crc_code); i++) {
+	for (i = 0; i < code_size / sizeof(uint32_t); i++) {
 		retval = target_write_u32(target,
 				crc_algorithm->address + i * sizeof(uint32_t),
-				arm_crc_code[i]);
+				code[i]);
 		if (retval != ERROR_OK)
 			return retval;
 	}
@@ -1616,18 +1729,21 @@ int arm_checksum_memory(struct target *target,
 
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
 
 	buf_set_u32(reg_params[0].value, 0, 32, address);
 	buf_set_u32(reg_params[1].value, 0, 32, count);
+	/* the table follows the code */
+	buf_set_u32(reg_params[2].value, 0, 32, crc_algorithm->address + code_size);
 
 	/* 20 second timeout/megabyte */
 	int timeout = 20000 * (1 + (count / (1024 * 1024)));
 
 	/* armv4 must exit using a hardware breakpoint */
 	if (arm->is_armv4)
-		exit_var = crc_algorithm->address + sizeof(arm_crc_code) - 8;
+		exit_var = crc_algorithm->address + code_size - 8;
 
-	retval = target_run_algorithm(target, 0, NULL, 2, reg_params,
+	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
 			crc_algorithm->address,
 			exit_var,
 			timeout, &arm_algo);
@@ -1635,6 +1751,7 @@ int arm_checksum_memory(struct target *target,
 		LOG_ERROR("error executing ARM crc algorithm");
 		destroy_reg_param(&reg_params[0]);
 		destroy_reg_param(&reg_params[1]);
+		destroy_reg_param(&reg_params[2]);
 		target_free_working_area(target, crc_algorithm);
 		return retval;
 	}
@@ -1643,12 +1760,335 @@ int arm_checksum_memory(struct target *target,
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
 
 	target_free_working_area(target, crc_algorithm);
 
 	return ERROR_OK;
 }
 
+/**
+ * Runs ARM code in a target to update a SHA-256 state with whole 64 byte
+ * blocks of memory.
+ */
+int arm_sha256_memory(struct target *target,
+	uint32_t address, uint32_t blocks, uint32_t *state)
+{
+	struct working_area *sha_algorithm;
+	struct arm_algorithm arm_algo;
+	struct arm *arm = target_to_arm(target);
+	struct reg_param reg_params[3];
+	uint8_t *buf;
+	int retval;
+	uint32_t exit_var = 0;
+
+	/* see contrib/loaders/checksum/armv4_5_sha256.s for src */
+
+	static const uint32_t arm_sha256_code[] = {
+		/* main: */
+		0xE280EC01,		/* add lr, r0, #256 */
+		0xE1A0C001,		/* mov r12, r1 */
+		/* block: */
+		0xE1A0300E,		/* mov r3, lr */
+		0xE3A05010,		/* mov r5, #16 */
+		/* load: */
+		0xE4DC4001,		/* ldrb r4, [r12], #1 */
+		0xE4DC6001,		/* ldrb r6, [r12], #1 */
+		0xE4DC7001,		/* ldrb r7, [r12], #1 */
+		0xE4DC8001,		/* ldrb r8, [r12], #1 */
+		0xE1864404,		/* orr r4, r6, r4, lsl #8 */
+		0xE1874404,		/* orr r4, r7, r4, lsl #8 */
+		0xE1884404,		/* orr r4, r8, r4, lsl #8 */
+		0xE4834004,		/* str r4, [r3], #4 */
+		0xE2555001,		/* subs r5, r5, #1 */
+		0x1AFFFFF5,		/* bne load */
+		0xE3A05030,		/* mov r5, #48 */
+		/* schedule: */
+		0xE5134008,		/* ldr r4, [r3, #-8] */
+		0xE1A068E4,		/* mov r6, r4, ror #17 */
+		0xE02669E4,		/* eor r6, r6, r4, ror #19 */
+		0xE0266524,		/* eor r6, r6, r4, lsr #10 */
+		0xE513401C,		/* ldr r4, [r3, #-28] */
+		0xE0866004,		/* add r6, r6, r4 */
+		0xE513403C,		/* ldr r4, [r3, #-60] */
+		0xE1A073E4,		/* mov r7, r4, ror #7 */
+		0xE0277964,		/* eor r7, r7, r4, ror #18 */
+		0xE02771A4,		/* eor r7, r7, r4, lsr #3 */
+		0xE0866007,		/* add r6, r6, r7 */
+		0xE5134040,		/* ldr r4, [r3, #-64] */
+		0xE0866004,		/* add r6, r6, r4 */
+		0xE4836004,		/* str r6, [r3], #4 */
+		0xE2555001,		/* subs r5, r5, #1 */
+		0x1AFFFFEF,		/* bne schedule */
+		0xE8930FF0,		/* ldmia r3, {r4-r11} */
+		0xE24E3C01,		/* sub r3, lr, #256 */
+		/* rounds: */
+		0xE1A00368,		/* mov r0, r8, ror #6 */
+		0xE02005E8,		/* eor r0, r0, r8, ror #11 */
+		0xE0200CE8,		/* eor r0, r0, r8, ror #25 */
+		0xE08BB000,		/* add r11, r11, r0 */
+		0xE029000A,		/* eor r0, r9, r10 */
+		0xE0000008,		/* and r0, r0, r8 */
+		0xE020000A,		/* eor r0, r0, r10 */
+		0xE08BB000,		/* add r11, r11, r0 */
+		0xE5930100,		/* ldr r0, [r3, #256] */
+		0xE4931004,		/* ldr r1, [r3], #4 */
+		0xE08BB000,		/* add r11, r11, r0 */
+		0xE08BB001,		/* add r11, r11, r1 */
+		0xE087700B,		/* add r7, r7, r11 */
+		0xE1A00164,		/* mov r0, r4, ror #2 */
+		0xE02006E4,		/* eor r0, r0, r4, ror #13 */
+		0xE0200B64,		/* eor r0, r0, r4, ror #22 */
+		0xE08BB000,		/* add r11, r11, r0 */
+		0xE1840005,		/* orr r0, r4, r5 */
+		0xE0000006,		/* and r0, r0, r6 */
+		0xE0041005,		/* and r1, r4, r5 */
+		0xE1800001,		/* orr r0, r0, r1 */
+		0xE08BB000,		/* add r11, r11, r0 */
+		0xE1A00367,		/* mov r0, r7, ror #6 */
+		0xE02005E7,		/* eor r0, r0, r7, ror #11 */
+		0xE0200CE7,		/* eor r0, r0, r7, ror #25 */
+		0xE08AA000,		/* add r10, r10, r0 */
+		0xE0280009,		/* eor r0, r8, r9 */
+		0xE0000007,		/* and r0, r0, r7 */
+		0xE0200009,		/* eor r0, r0, r9 */
+		0xE08AA000,		/* add r10, r10, r0 */
+		0xE5930100,		/* ldr r0, [r3, #256] */
+		0xE4931004,		/* ldr r1, [r3], #4 */
+		0xE08AA000,		/* add r10, r10, r0 */
+		0xE08AA001,		/* add r10, r10, r1 */
+		0xE086600A,		/* add r6, r6, r10 */
+		0xE1A0016B,		/* mov r0, r11, ror #2 */
+		0xE02006EB,		/* eor r0, r0, r11, ror #13 */
+		0xE0200B6B,		/* eor r0, r0, r11, ror #22 */
+		0xE08AA000,		/* add r10, r10, r0 */
+		0xE18B0004,		/* orr r0, r11, r4 */
+		0xE0000005,		/* and r0, r0, r5 */
+		0xE00B1004,		/* and r1, r11, r4 */
+		0xE1800001,		/* orr r0, r0, r1 */
+		0xE08AA000,		/* add r10, r10, r0 */
+		0xE1A00366,		/* mov r0, r6, ror #6 */
+		0xE02005E6,		/* eor r0, r0, r6, ror #11 */
+		0xE0200CE6,		/* eor r0, r0, r6, ror #25 */
+		0xE0899000,		/* add r9, r9, r0 */
+		0xE0270008,		/* eor r0, r7, r8 */
+		0xE0000006,		/* and r0, r0, r6 */
+		0xE0200008,		/* eor r0, r0, r8 */
+		0xE0899000,		/* add r9, r9, r0 */
+		0xE5930100,		/* ldr r0, [r3, #256] */
+		0xE4931004,		/* ldr r1, [r3], #4 */
+		0xE0899000,		/* add r9, r9, r0 */
+		0xE0899001,		/* add r9, r9, r1 */
+		0xE0855009,		/* add r5, r5, r9 */
+		0xE1A0016A,		/* mov r0, r10, ror #2 */
+		0xE02006EA,		/* eor r0, r0, r10, ror #13 */
+		0xE0200B6A,		/* eor r0, r0, r10, ror #22 */
+		0xE0899000,		/* add r9, r9, r0 */
+		0xE18A000B,		/* orr r0, r10, r11 */
+		0xE0000004,		/* and r0, r0, r4 */
+		0xE00A100B,		/* and r1, r10, r11 */
+		0xE1800001,		/* orr r0, r0, r1 */
+		0xE0899000,		/* add r9, r9, r0 */
+		0xE1A00365,		/* mov r0, r5, ror #6 */
+		0xE02005E5,		/* eor r0, r0, r5, ror #11 */
+		0xE0200CE5,		/* eor r0, r0, r5, ror #25 */
+		0xE0888000,		/* add r8, r8, r0 */
+		0xE0260007,		/* eor r0, r6, r7 */
+		0xE0000005,		/* and r0, r0, r5 */
+		0xE0200007,		/* eor r0, r0, r7 */
+		0xE0888000,		/* add r8, r8, r0 */
+		0xE5930100,		/* ldr r0, [r3, #256] */
+		0xE4931004,		/* ldr r1, [r3], #4 */
+		0xE0888000,		/* add r8, r8, r0 */
+		0xE0888001,		/* add r8, r8, r1 */
+		0xE0844008,		/* add r4, r4, r8 */
+		0xE1A00169,		/* mov r0, r9, ror #2 */
+		0xE02006E9,		/* eor r0, r0, r9, ror #13 */
+		0xE0200B69,		/* eor r0, r0, r9, ror #22 */
+		0xE0888000,		/* add r8, r8, r0 */
+		0xE189000A,		/* orr r0, r9, r10 */
+		0xE000000B,		/* and r0, r0, r11 */
+		0xE009100A,		/* and r1, r9, r10 */
+		0xE1800001,		/* orr r0, r0, r1 */
+		0xE0888000,		/* add r8, r8, r0 */
+		0xE1A00364,		/* mov r0, r4, ror #6 */
+		0xE02005E4,		/* eor r0, r0, r4, ror #11 */
+		0xE0200CE4,		/* eor r0, r0, r4, ror #25 */
+		0xE0877000,		/* add r7, r7, r0 */
+		0xE0250006,		/* eor r0, r5, r6 */
+		0xE0000004,		/* and r0, r0, r4 */
+		0xE0200006,		/* eor r0, r0, r6 */
+		0xE0877000,		/* add r7, r7, r0 */
+		0xE5930100,		/* ldr r0, [r3, #256] */
+		0xE4931004,		/* ldr r1, [r3], #4 */
+		0xE0877000,		/* add r7, r7, r0 */
+		0xE0877001,		/* add r7, r7, r1 */
+		0xE08BB007,		/* add r11, r11, r7 */
+		0xE1A00168,		/* mov r0, r8, ror #2 */
+		0xE02006E8,		/* eor r0, r0, r8, ror #13 */
+		0xE0200B68,		/* eor r0, r0, r8, ror #22 */
+		0xE0877000,		/* add r7, r7, r0 */
+		0xE1880009,		/* orr r0, r8, r9 */
+		0xE000000A,		/* and r0, r0, r10 */
+		0xE0081009,		/* and r1, r8, r9 */
+		0xE1800001,		/* orr r0, r0, r1 */
+		0xE0877000,		/* add r7, r7, r0 */
+		0xE1A0036B,		/* mov r0, r11, ror #6 */
+		0xE02005EB,		/* eor r0, r0, r11, ror #11 */
+		0xE0200CEB,		/* eor r0, r0, r11, ror #25 */
+		0xE0866000,		/* add r6, r6, r0 */
+		0xE0240005,		/* eor r0, r4, r5 */
+		0xE000000B,		/* and r0, r0, r11 */
+		0xE0200005,		/* eor r0, r0, r5 */
+		0xE0866000,		/* add r6, r6, r0 */
+		0xE5930100,		/* ldr r0, [r3, #256] */
+		0xE4931004,		/* ldr r1, [r3], #4 */
+		0xE0866000,		/* add r6, r6, r0 */
+		0xE0866001,		/* add r6, r6, r1 */
+		0xE08AA006,		/* add r10, r10, r6 */
+		0xE1A00167,		/* mov r0, r7, ror #2 */
+		0xE02006E7,		/* eor r0, r0, r7, ror #13 */
+		0xE0200B67,		/* eor r0, r0, r7, ror #22 */
+		0xE0866000,		/* add r6, r6, r0 */
+		0xE1870008,		/* orr r0, r7, r8 */
+		0xE0000009,		/* and r0, r0, r9 */
+		0xE0071008,		/* and r1, r7, r8 */
+		0xE1800001,		/* orr r0, r0, r1 */
+		0xE0866000,		/* add r6, r6, r0 */
+		0xE1A0036A,		/* mov r0, r10, ror #6 */
+		0xE02005EA,		/* eor r0, r0, r10, ror #11 */
+		0xE0200CEA,		/* eor r0, r0, r10, ror #25 */
+		0xE0855000,		/* add r5, r5, r0 */
+		0xE02B0004,		/* eor r0, r11, r4 */
+		0xE000000A,		/* and r0, r0, r10 */
+		0xE0200004,		/* eor r0, r0, r4 */
+		0xE0855000,		/* add r5, r5, r0 */
+		0xE5930100,		/* ldr r0, [r3, #256] */
+		0xE4931004,		/* ldr r1, [r3], #4 */
+		0xE0855000,		/* add r5, r5, r0 */
+		0xE0855001,		/* add r5, r5, r1 */
+		0xE0899005,		/* add r9, r9, r5 */
+		0xE1A00166,		/* mov r0, r6, ror #2 */
+		0xE02006E6,		/* eor r0, r0, r6, ror #13 */
+		0xE0200B66,		/* eor r0, r0, r6, ror #22 */
+		0xE0855000,		/* add r5, r5, r0 */
+		0xE1860007,		/* orr r0, r6, r7 */
+		0xE0000008,		/* and r0, r0, r8 */
+		0xE0061007,		/* and r1, r6, r7 */
+		0xE1800001,		/* orr r0, r0, r1 */
+		0xE0855000,		/* add r5, r5, r0 */
+		0xE1A00369,		/* mov r0, r9, ror #6 */
+		0xE02005E9,		/* eor r0, r0, r9, ror #11 */
+		0xE0200CE9,		/* eor r0, r0, r9, ror #25 */
+		0xE0844000,		/* add r4, r4, r0 */
+		0xE02A000B,		/* eor r0, r10, r11 */
+		0xE0000009,		/* and r0, r0, r9 */
+		0xE020000B,		/* eor r0, r0, r11 */
+		0xE0844000,		/* add r4, r4, r0 */
+		0xE5930100,		/* ldr r0, [r3, #256] */
+		0xE4931004,		/* ldr r1, [r3], #4 */
+		0xE0844000,		/* add r4, r4, r0 */
+		0xE0844001,		/* add r4, r4, r1 */
+		0xE0888004,		/* add r8, r8, r4 */
+		0xE1A00165,		/* mov r0, r5, ror #2 */
+		0xE02006E5,		/* eor r0, r0, r5, ror #13 */
+		0xE0200B65,		/* eor r0, r0, r5, ror #22 */
+		0xE0844000,		/* add r4, r4, r0 */
+		0xE1850006,		/* orr r0, r5, r6 */
+		0xE0000007,		/* and r0, r0, r7 */
+		0xE0051006,		/* and r1, r5, r6 */
+		0xE1800001,		/* orr r0, r0, r1 */
+		0xE0844000,		/* add r4, r4, r0 */
+		0xE153000E,		/* cmp r3, lr */
+		0x1AFFFF4D,		/* bne rounds */
+		0xE28E3C01,		/* add r3, lr, #256 */
+		0xE8B30003,		/* ldmia r3!, {r0, r1} */
+		0xE0844000,		/* add r4, r4, r0 */
+		0xE0855001,		/* add r5, r5, r1 */
+		0xE8B30003,		/* ldmia r3!, {r0, r1} */
+		0xE0866000,		/* add r6, r6, r0 */
+		0xE0877001,		/* add r7, r7, r1 */
+		0xE8B30003,		/* ldmia r3!, {r0, r1} */
+		0xE0888000,		/* add r8, r8, r0 */
+		0xE0899001,		/* add r9, r9, r1 */
+		0xE8B30003,		/* ldmia r3!, {r0, r1} */
+		0xE08AA000,		/* add r10, r10, r0 */
+		0xE08BB001,		/* add r11, r11, r1 */
+		0xE2433020,		/* sub r3, r3, #32 */
+		0xE8830FF0,		/* stmia r3, {r4-r11} */
+		0xE2522001,		/* subs r2, r2, #1 */
+		0x1AFFFF1D,		/* bne block */
+		0xE1200070		/* bkpt #0 */
+	};
+
+	/* code, then K[64], W[64] and H[8] */
+	uint32_t code_size = sizeof(arm_sha256_code);
+
+	buf = malloc(code_size + 4 * 64);
+	if (buf == NULL)
+		return ERROR_FAIL;
+
+	retval = target_alloc_working_area(target, code_size + 4 * (64 + 64 + 8), &sha_algorithm);
+	if (retval != ERROR_OK) {
+		free(buf);
+		return retval;
+	}
+
+	uint32_t k_addr = sha_algorithm->address + code_size;
+
+	/* convert code and constants into a buffer in target endianness */
+	target_buffer_set_u32_array(target, buf, ARRAY_SIZE(arm_sha256_code), arm_sha256_code);
+	target_buffer_set_u32_array(target, buf + code_size, 64, sha256_k);
+	retval = target_write_buffer(target, sha_algorithm->address, code_size + 4 * 64, buf);
+	if (retval == ERROR_OK) {
+		target_buffer_set_u32_array(target, buf, 8, state);
+		retval = target_write_buffer(target, k_addr + 4 * 128, 4 * 8, buf);
+	}
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_SVC;
+	arm_algo.core_state = ARM_STATE_ARM;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, k_addr);
+	buf_set_u32(reg_params[1].value, 0, 32, address);
+	buf_set_u32(reg_params[2].value, 0, 32, blocks);
+
+	/* 20 second timeout/megabyte */
+	int timeout = 20000 * (1 + (blocks / (16 * 1024)));
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->is_armv4)
+		exit_var = sha_algorithm->address + code_size - 4;
+
+	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
+			sha_algorithm->address,
+			exit_var,
+			timeout, &arm_algo);
+	if (retval == ERROR_OK)
+		retval = target_read_buffer(target, k_addr + 4 * 128, 4 * 8, buf);
+	else
+		LOG_ERROR("error executing ARM sha256 algorithm");
+
+	if (retval == ERROR_OK)
+		target_buffer_get_u32_array(target, buf, 8, state);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+
+cleanup:
+	target_free_working_area(target, sha_algorithm);
+	free(buf);
+
+	return retval;
+}
+
 /**
  * Runs ARM code in the target to check whether a memory block holds
  * all ones.  NOR flash which has been erased, and thus may be written,
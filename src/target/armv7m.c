@@ -39,6 +39,8 @@
 #include "armv7m.h"
 #include "algorithm.h"
 #include "register.h"
+#include "cortex_m.h"
+#include <helper/sha256.h>
 
 #if 0
 #define _DEBUG_INSTRUCTION_EXECUTION_
@@ -595,7 +597,9 @@ int armv7m_checksum_memory(struct target *target,
 {
 	struct working_area *crc_algorithm;
 	struct armv7m_algorithm armv7m_info;
-	struct reg_param reg_params[2];
+	struct reg_param reg_params[3];
+	const uint8_t *code;
+	uint32_t code_size, exit_offset;
 	int retval;
 
 	/* see contrib/loaders/checksum/armv7m_crc.s for src */
@@ -634,12 +638,107 @@ int armv7m_checksum_memory(struct target *target,
 		0xB7, 0x1D, 0xC1, 0x04	/* CRC32XOR:	.word	0x04c11db7 */
 	};
 
-	retval = target_alloc_working_area(target, sizeof(cortex_m_crc_code), &crc_algorithm);
-	if (retval != ERROR_OK)
-		return retval;
+	/* see contrib/loaders/checksum/armv7m_crc_table.s for src */
+
+	static const uint8_t cortex_m_crc_table_code[] = {
+		/* main: */
+			0x20, 0x4f,               /* ldr r7, CRC32XOR */
+			0x00, 0x23,               /* movs r3, #0 */
+		/* gen: */
+			0x1c, 0x06,               /* lsls r4, r3, #24 */
+			0x08, 0x25,               /* movs r5, #8 */
+		/* bit: */
+			0x64, 0x00,               /* lsls r4, r4, #1 */
+			0x00, 0xd3,               /* bcc nopoly */
+			0x7c, 0x40,               /* eors r4, r4, r7 */
+		/* nopoly: */
+			0x6d, 0x1e,               /* subs r5, r5, #1 */
+			0xfa, 0xd1,               /* bne bit */
+			0x9e, 0x00,               /* lsls r6, r3, #2 */
+			0x94, 0x51,               /* str r4, [r2, r6] */
+			0x5b, 0x1c,               /* adds r3, r3, #1 */
+			0x1e, 0x0a,               /* lsrs r6, r3, #8 */
+			0xf3, 0xd0,               /* beq gen */
+			0x43, 0x18,               /* adds r3, r0, r1 */
+			0x01, 0x46,               /* mov r1, r0 */
+			0x00, 0x20,               /* movs r0, #0 */
+			0xc0, 0x43,               /* mvns r0, r0 */
+		/* nbyte: */
+			0x99, 0x42,               /* cmp r1, r3 */
+			0x2b, 0xd0,               /* beq done */
+			0x8c, 0x07,               /* lsls r4, r1, #30 */
+			0x02, 0xd1,               /* bne onebyte */
+			0x5c, 0x1a,               /* subs r4, r3, r1 */
+			0x04, 0x2c,               /* cmp r4, #4 */
+			0x09, 0xd2,               /* bhs words */
+		/* onebyte: */
+			0x0c, 0x78,               /* ldrb r4, [r1] */
+			0x49, 0x1c,               /* adds r1, r1, #1 */
+			0x24, 0x06,               /* lsls r4, r4, #24 */
+			0x60, 0x40,               /* eors r0, r0, r4 */
+			0x04, 0x0e,               /* lsrs r4, r0, #24 */
+			0xa4, 0x00,               /* lsls r4, r4, #2 */
+			0x14, 0x59,               /* ldr r4, [r2, r4] */
+			0x00, 0x02,               /* lsls r0, r0, #8 */
+			0x60, 0x40,               /* eors r0, r0, r4 */
+			0xee, 0xe7,               /* b nbyte */
+		/* words: */
+			0xa4, 0x08,               /* lsrs r4, r4, #2 */
+			0xa4, 0x00,               /* lsls r4, r4, #2 */
+			0x0f, 0x19,               /* adds r7, r1, r4 */
+		/* nword: */
+			0x10, 0xc9,               /* ldmia r1!, {r4} */
+			0x24, 0xba,               /* rev r4, r4 */
+			0x60, 0x40,               /* eors r0, r0, r4 */
+			0x04, 0x0e,               /* lsrs r4, r0, #24 */
+			0xa4, 0x00,               /* lsls r4, r4, #2 */
+			0x14, 0x59,               /* ldr r4, [r2, r4] */
+			0x00, 0x02,               /* lsls r0, r0, #8 */
+			0x60, 0x40,               /* eors r0, r0, r4 */
+			0x04, 0x0e,               /* lsrs r4, r0, #24 */
+			0xa4, 0x00,               /* lsls r4, r4, #2 */
+			0x14, 0x59,               /* ldr r4, [r2, r4] */
+			0x00, 0x02,               /* lsls r0, r0, #8 */
+			0x60, 0x40,               /* eors r0, r0, r4 */
+			0x04, 0x0e,               /* lsrs r4, r0, #24 */
+			0xa4, 0x00,               /* lsls r4, r4, #2 */
+			0x14, 0x59,               /* ldr r4, [r2, r4] */
+			0x00, 0x02,               /* lsls r0, r0, #8 */
+			0x60, 0x40,               /* eors r0, r0, r4 */
+			0x04, 0x0e,               /* lsrs r4, r0, #24 */
+			0xa4, 0x00,               /* lsls r4, r4, #2 */
+			0x14, 0x59,               /* ldr r4, [r2, r4] */
+			0x00, 0x02,               /* lsls r0, r0, #8 */
+			0x60, 0x40,               /* eors r0, r0, r4 */
+			0xb9, 0x42,               /* cmp r1, r7 */
+			0xe6, 0xd1,               /* bne nword */
+			0xd1, 0xe7,               /* b nbyte */
+		/* done: */
+			0x00, 0xbe,               /* bkpt #0 */
+			0xc0, 0x46,              /* (align) */
+		/* CRC32XOR: */
+			0xb7, 0x1d, 0xc1, 0x04,   /* .word 0x04c11db7 */
+	};
+
+	/* The table driven code is about ten times faster, but needs room for
+	 * its 1 KiB table, loads words little endian, and building the table
+	 * costs about as much as 200 bytes done bitwise. */
+	if (count >= 256 && target->endianness == TARGET_LITTLE_ENDIAN &&
+			target_alloc_working_area_try(target,
+				sizeof(cortex_m_crc_table_code) + 1024, &crc_algorithm) == ERROR_OK) {
+		code = cortex_m_crc_table_code;
+		code_size = sizeof(cortex_m_crc_table_code);
+		exit_offset = code_size - 8;
+	} else {
+		retval = target_alloc_working_area(target, sizeof(cortex_m_crc_code), &crc_algorithm);
+		if (retval != ERROR_OK)
+			return retval;
+		code = cortex_m_crc_code;
+		code_size = sizeof(cortex_m_crc_code);
+		exit_offset = code_size - 6;
+	}
 
-	retval = target_write_buffer(target, crc_algorithm->address,
-			sizeof(cortex_m_crc_code), (uint8_t *)cortex_m_crc_code);
+	retval = target_write_buffer(target, crc_algorithm->address, code_size, code);
 	if (retval != ERROR_OK)
 		goto cleanup;
 
@@ -648,14 +747,17 @@ int armv7m_checksum_memory(struct target *target,
 
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
 
 	buf_set_u32(reg_params[0].value, 0, 32, address);
 	buf_set_u32(reg_params[1].value, 0, 32, count);
+	/* the table follows the code, which is a multiple of 4 bytes */
+	buf_set_u32(reg_params[2].value, 0, 32, crc_algorithm->address + code_size);
 
 	int timeout = 20000 * (1 + (count / (1024 * 1024)));
 
-	retval = target_run_algorithm(target, 0, NULL, 2, reg_params, crc_algorithm->address,
-			crc_algorithm->address + (sizeof(cortex_m_crc_code) - 6),
+	retval = target_run_algorithm(target, 0, NULL, 3, reg_params, crc_algorithm->address,
+			crc_algorithm->address + exit_offset,
 			timeout, &armv7m_info);
 
 	if (retval == ERROR_OK)
@@ -665,6 +767,7 @@ int armv7m_checksum_memory(struct target *target,
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
 
 cleanup:
 	target_free_working_area(target, crc_algorithm);
@@ -672,6 +775,320 @@ cleanup:
 	return retval;
 }
 
+/** Updates a SHA-256 state with whole 64 byte blocks of target memory. */
+int armv7m_sha256_memory(struct target *target,
+	uint32_t address, uint32_t blocks, uint32_t *state)
+{
+	struct working_area *sha_algorithm;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[3];
+	uint8_t buf[4 * 64];
+	uint32_t cpuid;
+	int retval;
+
+	/* see contrib/loaders/checksum/armv7m_sha256.s for src */
+
+	static const uint8_t cortex_m_sha256_code[] = {
+		/* main: */
+			0x00, 0xf5, 0x80, 0x7e,   /* add lr, r0, #256 */
+			0x8c, 0x46,               /* mov r12, r1 */
+		/* block: */
+			0x73, 0x46,               /* mov r3, lr */
+			0x10, 0x25,               /* movs r5, #16 */
+		/* load: */
+			0x5c, 0xf8, 0x04, 0x4b,   /* ldr r4, [r12], #4 */
+			0x24, 0xba,               /* rev r4, r4 */
+			0x43, 0xf8, 0x04, 0x4b,   /* str r4, [r3], #4 */
+			0x6d, 0x1e,               /* subs r5, r5, #1 */
+			0xf8, 0xd1,               /* bne load */
+			0x30, 0x25,               /* movs r5, #48 */
+		/* schedule: */
+			0x53, 0xf8, 0x08, 0x4c,   /* ldr r4, [r3, #-8] */
+			0x4f, 0xea, 0x74, 0x46,   /* ror r6, r4, #17 */
+			0x86, 0xea, 0xf4, 0x46,   /* eor r6, r6, r4, ror #19 */
+			0x86, 0xea, 0x94, 0x26,   /* eor r6, r6, r4, lsr #10 */
+			0x53, 0xf8, 0x1c, 0x4c,   /* ldr r4, [r3, #-28] */
+			0x26, 0x44,               /* add r6, r6, r4 */
+			0x53, 0xf8, 0x3c, 0x4c,   /* ldr r4, [r3, #-60] */
+			0x4f, 0xea, 0xf4, 0x17,   /* ror r7, r4, #7 */
+			0x87, 0xea, 0xb4, 0x47,   /* eor r7, r7, r4, ror #18 */
+			0x87, 0xea, 0xd4, 0x07,   /* eor r7, r7, r4, lsr #3 */
+			0x3e, 0x44,               /* add r6, r6, r7 */
+			0x53, 0xf8, 0x40, 0x4c,   /* ldr r4, [r3, #-64] */
+			0x26, 0x44,               /* add r6, r6, r4 */
+			0x43, 0xf8, 0x04, 0x6b,   /* str r6, [r3], #4 */
+			0x6d, 0x1e,               /* subs r5, r5, #1 */
+			0xe4, 0xd1,               /* bne schedule */
+			0x93, 0xe8, 0xf0, 0x0f,   /* ldm r3, {r4-r11} */
+			0xae, 0xf5, 0x80, 0x73,   /* sub r3, lr, #256 */
+		/* rounds: */
+			0x4f, 0xea, 0xb8, 0x10,   /* ror r0, r8, #6 */
+			0x80, 0xea, 0xf8, 0x20,   /* eor r0, r0, r8, ror #11 */
+			0x80, 0xea, 0x78, 0x60,   /* eor r0, r0, r8, ror #25 */
+			0x83, 0x44,               /* add r11, r11, r0 */
+			0x89, 0xea, 0x0a, 0x00,   /* eor r0, r9, r10 */
+			0x00, 0xea, 0x08, 0x00,   /* and r0, r0, r8 */
+			0x80, 0xea, 0x0a, 0x00,   /* eor r0, r0, r10 */
+			0x83, 0x44,               /* add r11, r11, r0 */
+			0xd3, 0xf8, 0x00, 0x01,   /* ldr r0, [r3, #256] */
+			0x53, 0xf8, 0x04, 0x1b,   /* ldr r1, [r3], #4 */
+			0x83, 0x44,               /* add r11, r11, r0 */
+			0x8b, 0x44,               /* add r11, r11, r1 */
+			0x5f, 0x44,               /* add r7, r7, r11 */
+			0x4f, 0xea, 0xb4, 0x00,   /* ror r0, r4, #2 */
+			0x80, 0xea, 0x74, 0x30,   /* eor r0, r0, r4, ror #13 */
+			0x80, 0xea, 0xb4, 0x50,   /* eor r0, r0, r4, ror #22 */
+			0x83, 0x44,               /* add r11, r11, r0 */
+			0x44, 0xea, 0x05, 0x00,   /* orr r0, r4, r5 */
+			0x00, 0xea, 0x06, 0x00,   /* and r0, r0, r6 */
+			0x04, 0xea, 0x05, 0x01,   /* and r1, r4, r5 */
+			0x40, 0xea, 0x01, 0x00,   /* orr r0, r0, r1 */
+			0x83, 0x44,               /* add r11, r11, r0 */
+			0x4f, 0xea, 0xb7, 0x10,   /* ror r0, r7, #6 */
+			0x80, 0xea, 0xf7, 0x20,   /* eor r0, r0, r7, ror #11 */
+			0x80, 0xea, 0x77, 0x60,   /* eor r0, r0, r7, ror #25 */
+			0x82, 0x44,               /* add r10, r10, r0 */
+			0x88, 0xea, 0x09, 0x00,   /* eor r0, r8, r9 */
+			0x00, 0xea, 0x07, 0x00,   /* and r0, r0, r7 */
+			0x80, 0xea, 0x09, 0x00,   /* eor r0, r0, r9 */
+			0x82, 0x44,               /* add r10, r10, r0 */
+			0xd3, 0xf8, 0x00, 0x01,   /* ldr r0, [r3, #256] */
+			0x53, 0xf8, 0x04, 0x1b,   /* ldr r1, [r3], #4 */
+			0x82, 0x44,               /* add r10, r10, r0 */
+			0x8a, 0x44,               /* add r10, r10, r1 */
+			0x56, 0x44,               /* add r6, r6, r10 */
+			0x4f, 0xea, 0xbb, 0x00,   /* ror r0, r11, #2 */
+			0x80, 0xea, 0x7b, 0x30,   /* eor r0, r0, r11, ror #13 */
+			0x80, 0xea, 0xbb, 0x50,   /* eor r0, r0, r11, ror #22 */
+			0x82, 0x44,               /* add r10, r10, r0 */
+			0x4b, 0xea, 0x04, 0x00,   /* orr r0, r11, r4 */
+			0x00, 0xea, 0x05, 0x00,   /* and r0, r0, r5 */
+			0x0b, 0xea, 0x04, 0x01,   /* and r1, r11, r4 */
+			0x40, 0xea, 0x01, 0x00,   /* orr r0, r0, r1 */
+			0x82, 0x44,               /* add r10, r10, r0 */
+			0x4f, 0xea, 0xb6, 0x10,   /* ror r0, r6, #6 */
+			0x80, 0xea, 0xf6, 0x20,   /* eor r0, r0, r6, ror #11 */
+			0x80, 0xea, 0x76, 0x60,   /* eor r0, r0, r6, ror #25 */
+			0x81, 0x44,               /* add r9, r9, r0 */
+			0x87, 0xea, 0x08, 0x00,   /* eor r0, r7, r8 */
+			0x00, 0xea, 0x06, 0x00,   /* and r0, r0, r6 */
+			0x80, 0xea, 0x08, 0x00,   /* eor r0, r0, r8 */
+			0x81, 0x44,               /* add r9, r9, r0 */
+			0xd3, 0xf8, 0x00, 0x01,   /* ldr r0, [r3, #256] */
+			0x53, 0xf8, 0x04, 0x1b,   /* ldr r1, [r3], #4 */
+			0x81, 0x44,               /* add r9, r9, r0 */
+			0x89, 0x44,               /* add r9, r9, r1 */
+			0x4d, 0x44,               /* add r5, r5, r9 */
+			0x4f, 0xea, 0xba, 0x00,   /* ror r0, r10, #2 */
+			0x80, 0xea, 0x7a, 0x30,   /* eor r0, r0, r10, ror #13 */
+			0x80, 0xea, 0xba, 0x50,   /* eor r0, r0, r10, ror #22 */
+			0x81, 0x44,               /* add r9, r9, r0 */
+			0x4a, 0xea, 0x0b, 0x00,   /* orr r0, r10, r11 */
+			0x00, 0xea, 0x04, 0x00,   /* and r0, r0, r4 */
+			0x0a, 0xea, 0x0b, 0x01,   /* and r1, r10, r11 */
+			0x40, 0xea, 0x01, 0x00,   /* orr r0, r0, r1 */
+			0x81, 0x44,               /* add r9, r9, r0 */
+			0x4f, 0xea, 0xb5, 0x10,   /* ror r0, r5, #6 */
+			0x80, 0xea, 0xf5, 0x20,   /* eor r0, r0, r5, ror #11 */
+			0x80, 0xea, 0x75, 0x60,   /* eor r0, r0, r5, ror #25 */
+			0x80, 0x44,               /* add r8, r8, r0 */
+			0x86, 0xea, 0x07, 0x00,   /* eor r0, r6, r7 */
+			0x00, 0xea, 0x05, 0x00,   /* and r0, r0, r5 */
+			0x80, 0xea, 0x07, 0x00,   /* eor r0, r0, r7 */
+			0x80, 0x44,               /* add r8, r8, r0 */
+			0xd3, 0xf8, 0x00, 0x01,   /* ldr r0, [r3, #256] */
+			0x53, 0xf8, 0x04, 0x1b,   /* ldr r1, [r3], #4 */
+			0x80, 0x44,               /* add r8, r8, r0 */
+			0x88, 0x44,               /* add r8, r8, r1 */
+			0x44, 0x44,               /* add r4, r4, r8 */
+			0x4f, 0xea, 0xb9, 0x00,   /* ror r0, r9, #2 */
+			0x80, 0xea, 0x79, 0x30,   /* eor r0, r0, r9, ror #13 */
+			0x80, 0xea, 0xb9, 0x50,   /* eor r0, r0, r9, ror #22 */
+			0x80, 0x44,               /* add r8, r8, r0 */
+			0x49, 0xea, 0x0a, 0x00,   /* orr r0, r9, r10 */
+			0x00, 0xea, 0x0b, 0x00,   /* and r0, r0, r11 */
+			0x09, 0xea, 0x0a, 0x01,   /* and r1, r9, r10 */
+			0x40, 0xea, 0x01, 0x00,   /* orr r0, r0, r1 */
+			0x80, 0x44,               /* add r8, r8, r0 */
+			0x4f, 0xea, 0xb4, 0x10,   /* ror r0, r4, #6 */
+			0x80, 0xea, 0xf4, 0x20,   /* eor r0, r0, r4, ror #11 */
+			0x80, 0xea, 0x74, 0x60,   /* eor r0, r0, r4, ror #25 */
+			0x07, 0x44,               /* add r7, r7, r0 */
+			0x85, 0xea, 0x06, 0x00,   /* eor r0, r5, r6 */
+			0x00, 0xea, 0x04, 0x00,   /* and r0, r0, r4 */
+			0x80, 0xea, 0x06, 0x00,   /* eor r0, r0, r6 */
+			0x07, 0x44,               /* add r7, r7, r0 */
+			0xd3, 0xf8, 0x00, 0x01,   /* ldr r0, [r3, #256] */
+			0x53, 0xf8, 0x04, 0x1b,   /* ldr r1, [r3], #4 */
+			0x07, 0x44,               /* add r7, r7, r0 */
+			0x0f, 0x44,               /* add r7, r7, r1 */
+			0xbb, 0x44,               /* add r11, r11, r7 */
+			0x4f, 0xea, 0xb8, 0x00,   /* ror r0, r8, #2 */
+			0x80, 0xea, 0x78, 0x30,   /* eor r0, r0, r8, ror #13 */
+			0x80, 0xea, 0xb8, 0x50,   /* eor r0, r0, r8, ror #22 */
+			0x07, 0x44,               /* add r7, r7, r0 */
+			0x48, 0xea, 0x09, 0x00,   /* orr r0, r8, r9 */
+			0x00, 0xea, 0x0a, 0x00,   /* and r0, r0, r10 */
+			0x08, 0xea, 0x09, 0x01,   /* and r1, r8, r9 */
+			0x40, 0xea, 0x01, 0x00,   /* orr r0, r0, r1 */
+			0x07, 0x44,               /* add r7, r7, r0 */
+			0x4f, 0xea, 0xbb, 0x10,   /* ror r0, r11, #6 */
+			0x80, 0xea, 0xfb, 0x20,   /* eor r0, r0, r11, ror #11 */
+			0x80, 0xea, 0x7b, 0x60,   /* eor r0, r0, r11, ror #25 */
+			0x06, 0x44,               /* add r6, r6, r0 */
+			0x84, 0xea, 0x05, 0x00,   /* eor r0, r4, r5 */
+			0x00, 0xea, 0x0b, 0x00,   /* and r0, r0, r11 */
+			0x80, 0xea, 0x05, 0x00,   /* eor r0, r0, r5 */
+			0x06, 0x44,               /* add r6, r6, r0 */
+			0xd3, 0xf8, 0x00, 0x01,   /* ldr r0, [r3, #256] */
+			0x53, 0xf8, 0x04, 0x1b,   /* ldr r1, [r3], #4 */
+			0x06, 0x44,               /* add r6, r6, r0 */
+			0x0e, 0x44,               /* add r6, r6, r1 */
+			0xb2, 0x44,               /* add r10, r10, r6 */
+			0x4f, 0xea, 0xb7, 0x00,   /* ror r0, r7, #2 */
+			0x80, 0xea, 0x77, 0x30,   /* eor r0, r0, r7, ror #13 */
+			0x80, 0xea, 0xb7, 0x50,   /* eor r0, r0, r7, ror #22 */
+			0x06, 0x44,               /* add r6, r6, r0 */
+			0x47, 0xea, 0x08, 0x00,   /* orr r0, r7, r8 */
+			0x00, 0xea, 0x09, 0x00,   /* and r0, r0, r9 */
+			0x07, 0xea, 0x08, 0x01,   /* and r1, r7, r8 */
+			0x40, 0xea, 0x01, 0x00,   /* orr r0, r0, r1 */
+			0x06, 0x44,               /* add r6, r6, r0 */
+			0x4f, 0xea, 0xba, 0x10,   /* ror r0, r10, #6 */
+			0x80, 0xea, 0xfa, 0x20,   /* eor r0, r0, r10, ror #11 */
+			0x80, 0xea, 0x7a, 0x60,   /* eor r0, r0, r10, ror #25 */
+			0x05, 0x44,               /* add r5, r5, r0 */
+			0x8b, 0xea, 0x04, 0x00,   /* eor r0, r11, r4 */
+			0x00, 0xea, 0x0a, 0x00,   /* and r0, r0, r10 */
+			0x80, 0xea, 0x04, 0x00,   /* eor r0, r0, r4 */
+			0x05, 0x44,               /* add r5, r5, r0 */
+			0xd3, 0xf8, 0x00, 0x01,   /* ldr r0, [r3, #256] */
+			0x53, 0xf8, 0x04, 0x1b,   /* ldr r1, [r3], #4 */
+			0x05, 0x44,               /* add r5, r5, r0 */
+			0x0d, 0x44,               /* add r5, r5, r1 */
+			0xa9, 0x44,               /* add r9, r9, r5 */
+			0x4f, 0xea, 0xb6, 0x00,   /* ror r0, r6, #2 */
+			0x80, 0xea, 0x76, 0x30,   /* eor r0, r0, r6, ror #13 */
+			0x80, 0xea, 0xb6, 0x50,   /* eor r0, r0, r6, ror #22 */
+			0x05, 0x44,               /* add r5, r5, r0 */
+			0x46, 0xea, 0x07, 0x00,   /* orr r0, r6, r7 */
+			0x00, 0xea, 0x08, 0x00,   /* and r0, r0, r8 */
+			0x06, 0xea, 0x07, 0x01,   /* and r1, r6, r7 */
+			0x40, 0xea, 0x01, 0x00,   /* orr r0, r0, r1 */
+			0x05, 0x44,               /* add r5, r5, r0 */
+			0x4f, 0xea, 0xb9, 0x10,   /* ror r0, r9, #6 */
+			0x80, 0xea, 0xf9, 0x20,   /* eor r0, r0, r9, ror #11 */
+			0x80, 0xea, 0x79, 0x60,   /* eor r0, r0, r9, ror #25 */
+			0x04, 0x44,               /* add r4, r4, r0 */
+			0x8a, 0xea, 0x0b, 0x00,   /* eor r0, r10, r11 */
+			0x00, 0xea, 0x09, 0x00,   /* and r0, r0, r9 */
+			0x80, 0xea, 0x0b, 0x00,   /* eor r0, r0, r11 */
+			0x04, 0x44,               /* add r4, r4, r0 */
+			0xd3, 0xf8, 0x00, 0x01,   /* ldr r0, [r3, #256] */
+			0x53, 0xf8, 0x04, 0x1b,   /* ldr r1, [r3], #4 */
+			0x04, 0x44,               /* add r4, r4, r0 */
+			0x0c, 0x44,               /* add r4, r4, r1 */
+			0xa0, 0x44,               /* add r8, r8, r4 */
+			0x4f, 0xea, 0xb5, 0x00,   /* ror r0, r5, #2 */
+			0x80, 0xea, 0x75, 0x30,   /* eor r0, r0, r5, ror #13 */
+			0x80, 0xea, 0xb5, 0x50,   /* eor r0, r0, r5, ror #22 */
+			0x04, 0x44,               /* add r4, r4, r0 */
+			0x45, 0xea, 0x06, 0x00,   /* orr r0, r5, r6 */
+			0x00, 0xea, 0x07, 0x00,   /* and r0, r0, r7 */
+			0x05, 0xea, 0x06, 0x01,   /* and r1, r5, r6 */
+			0x40, 0xea, 0x01, 0x00,   /* orr r0, r0, r1 */
+			0x04, 0x44,               /* add r4, r4, r0 */
+			0x73, 0x45,               /* cmp r3, lr */
+			0x7f, 0xf4, 0xd5, 0xae,   /* bne rounds */
+			0x0e, 0xf5, 0x80, 0x73,   /* add r3, lr, #256 */
+			0xd3, 0xe9, 0x00, 0x01,   /* ldrd r0, r1, [r3] */
+			0x04, 0x44,               /* add r4, r4, r0 */
+			0x0d, 0x44,               /* add r5, r5, r1 */
+			0xd3, 0xe9, 0x02, 0x01,   /* ldrd r0, r1, [r3, #8] */
+			0x06, 0x44,               /* add r6, r6, r0 */
+			0x0f, 0x44,               /* add r7, r7, r1 */
+			0xd3, 0xe9, 0x04, 0x01,   /* ldrd r0, r1, [r3, #16] */
+			0x80, 0x44,               /* add r8, r8, r0 */
+			0x89, 0x44,               /* add r9, r9, r1 */
+			0xd3, 0xe9, 0x06, 0x01,   /* ldrd r0, r1, [r3, #24] */
+			0x82, 0x44,               /* add r10, r10, r0 */
+			0x8b, 0x44,               /* add r11, r11, r1 */
+			0x83, 0xe8, 0xf0, 0x0f,   /* stm r3, {r4-r11} */
+			0x52, 0x1e,               /* subs r2, r2, #1 */
+			0x7f, 0xf4, 0x95, 0xae,   /* bne block */
+			0x00, 0xbe,               /* bkpt #0 */
+	};
+
+	/* the algorithm uses Thumb-2 post-indexed ldr, shifted register
+	 * operands and ldrd, which ARMv6-M lacks; those cores report
+	 * architecture 0xC in the CPUID */
+	if (target->endianness != TARGET_LITTLE_ENDIAN)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	retval = target_read_u32(target, CPUID, &cpuid);
+	if (retval != ERROR_OK)
+		return retval;
+	if (((cpuid >> 16) & 0xf) != 0xf)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* code, then K[64], W[64] and H[8] */
+	uint32_t code_size = (sizeof(cortex_m_sha256_code) + 3) & ~3;
+
+	retval = target_alloc_working_area(target, code_size + 4 * (64 + 64 + 8), &sha_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t k_addr = sha_algorithm->address + code_size;
+
+	retval = target_write_buffer(target, sha_algorithm->address,
+			sizeof(cortex_m_sha256_code), cortex_m_sha256_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	target_buffer_set_u32_array(target, buf, 64, sha256_k);
+	retval = target_write_buffer(target, k_addr, 4 * 64, buf);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	target_buffer_set_u32_array(target, buf, 8, state);
+	retval = target_write_buffer(target, k_addr + 4 * 128, 4 * 8, buf);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, k_addr);
+	buf_set_u32(reg_params[1].value, 0, 32, address);
+	buf_set_u32(reg_params[2].value, 0, 32, blocks);
+
+	int timeout = 20000 * (1 + (blocks / (16 * 1024)));
+
+	retval = target_run_algorithm(target, 0, NULL, 3, reg_params, sha_algorithm->address,
+			sha_algorithm->address + (sizeof(cortex_m_sha256_code) - 2),
+			timeout, &armv7m_info);
+
+	if (retval == ERROR_OK)
+		retval = target_read_buffer(target, k_addr + 4 * 128, 4 * 8, buf);
+	else
+		LOG_ERROR("error executing cortex_m sha256 algorithm");
+
+	if (retval == ERROR_OK)
+		target_buffer_get_u32_array(target, buf, 8, state);
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+	destroy_reg_param(&reg_params[2]);
+
+cleanup:
+	target_free_working_area(target, sha_algorithm);
+
+	return retval;
+}
+
 /** Checks whether a memory region is zeroed. */
 int armv7m_blank_check_memory(struct target *target,
 	uint32_t address, uint32_t count, uint32_t *blank)
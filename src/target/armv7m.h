@@ -216,6 +216,8 @@ int armv7m_restore_context(struct target *target);
 
 int armv7m_checksum_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t *checksum);
+int armv7m_sha256_memory(struct target *target,
+		uint32_t address, uint32_t blocks, uint32_t *state);
 int armv7m_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t *blank);
 
@@ -45,70 +45,223 @@ static const char * const watchpoint_rw_strings[] = {
 /* monotonic counter/id-number for breakpoints and watch points */
 static int bpwp_unique_id;
 
-int breakpoint_add_internal(struct target *target,
-	uint64_t address,
-	uint32_t length,
-	enum breakpoint_type type)
+/*
+ * target->breakpoints stays a plain list for the benefit of the target
+ * drivers walking it, but lookups by address go through a hash index,
+ * and each breakpoint remembers the link pointing at it so removal needs
+ * no list walk either.  This keeps targets with hundreds or thousands
+ * of breakpoints cheap to manage.
+ */
+struct breakpoint_index {
+	unsigned size;			/* number of buckets, a power of two */
+	unsigned count;			/* number of breakpoints on the list */
+	struct breakpoint **buckets;
+	struct breakpoint **tail;	/* link to update when appending */
+};
+
+#define BREAKPOINT_INDEX_MIN_SIZE	64
+
+static inline uint64_t breakpoint_key(struct target *target,
+		struct breakpoint *breakpoint)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
-	const char *reason;
-	int retval;
-	int n;
+	if (target->type->pc_size == 64)
+		return breakpoint->address_64;
+	return breakpoint->address;
+}
 
-	n = 0;
-	while (breakpoint) {
-		n++;
-		if (breakpoint->address == address) {
-			/* FIXME don't assume "same address" means "same
-			 * breakpoint" ... check all the parameters before
-			 * succeeding.
-			 */
-			LOG_DEBUG("Duplicate Breakpoint address: 0x%08" PRIx64 " (BP %" PRIu32 ")",
-				address, breakpoint->unique_id);
-			return ERROR_OK;
-		}
-		breakpoint_p = &breakpoint->next;
-		breakpoint = breakpoint->next;
+static inline unsigned breakpoint_hash(struct breakpoint_index *index,
+		uint64_t address)
+{
+	/* drop the bits which are the same for all instructions */
+	uint32_t h = (uint32_t)(address >> 1) ^ (uint32_t)(address >> 33);
+
+	return (h * 2654435761u) & (index->size - 1);
+}
+
+static struct breakpoint_index *breakpoint_index_get(struct target *target)
+{
+	struct breakpoint_index *index = target->breakpoint_index;
+
+	if (index)
+		return index;
+
+	index = calloc(1, sizeof(*index));
+	if (!index)
+		return NULL;
+
+	index->size = BREAKPOINT_INDEX_MIN_SIZE;
+	index->buckets = calloc(index->size, sizeof(*index->buckets));
+	if (!index->buckets) {
+		free(index);
+		return NULL;
+	}
+	index->tail = &target->breakpoints;
+
+	target->breakpoint_index = index;
+	return index;
+}
+
+static void breakpoint_index_grow(struct target *target,
+		struct breakpoint_index *index)
+{
+	struct breakpoint **buckets;
+	struct breakpoint *breakpoint;
+
+	buckets = calloc(2 * index->size, sizeof(*buckets));
+	if (!buckets)
+		return;		/* keep using the smaller table */
+
+	free(index->buckets);
+	index->buckets = buckets;
+	index->size *= 2;
+
+	for (breakpoint = target->breakpoints; breakpoint; breakpoint = breakpoint->next) {
+		unsigned h = breakpoint_hash(index, breakpoint_key(target, breakpoint));
+
+		breakpoint->hash_next = index->buckets[h];
+		index->buckets[h] = breakpoint;
 	}
+}
+
+/* append a breakpoint to the target's list and index it */
+static void breakpoint_link(struct target *target, struct breakpoint *breakpoint)
+{
+	struct breakpoint_index *index = target->breakpoint_index;
+	unsigned h;
+
+	breakpoint->next = NULL;
+	breakpoint->pprev = index->tail;
+	*index->tail = breakpoint;
+	index->tail = &breakpoint->next;
+
+	h = breakpoint_hash(index, breakpoint_key(target, breakpoint));
+	breakpoint->hash_next = index->buckets[h];
+	index->buckets[h] = breakpoint;
+
+	if (++index->count > 2 * index->size)
+		breakpoint_index_grow(target, index);
+}
+
+static void breakpoint_unlink(struct target *target, struct breakpoint *breakpoint)
+{
+	struct breakpoint_index *index = target->breakpoint_index;
+	struct breakpoint **p;
+
+	*breakpoint->pprev = breakpoint->next;
+	if (breakpoint->next)
+		breakpoint->next->pprev = breakpoint->pprev;
+	else
+		index->tail = breakpoint->pprev;
+
+	p = &index->buckets[breakpoint_hash(index, breakpoint_key(target, breakpoint))];
+	while (*p != breakpoint)
+		p = &(*p)->hash_next;
+	*p = breakpoint->hash_next;
+
+	index->count--;
+}
+
+/* first breakpoint (in list order) at address, or NULL */
+static struct breakpoint *breakpoint_lookup(struct target *target, uint64_t address)
+{
+	struct breakpoint_index *index = target->breakpoint_index;
+	struct breakpoint *breakpoint, *found = NULL;
+
+	if (!index)
+		return NULL;
+
+	breakpoint = index->buckets[breakpoint_hash(index, address)];
+	for (; breakpoint; breakpoint = breakpoint->hash_next) {
+		if (breakpoint_key(target, breakpoint) != address)
+			continue;
+		/* buckets are in reverse insertion order */
+		found = breakpoint;
+	}
+
+	return found;
+}
+
+static struct breakpoint *breakpoint_new(struct target *target,
+	uint64_t address, uint32_t asid, uint32_t length, enum breakpoint_type type)
+{
+	struct breakpoint *breakpoint;
+
+	if (!breakpoint_index_get(target))
+		return NULL;
+
+	breakpoint = calloc(1, sizeof(struct breakpoint));
+	if (!breakpoint)
+		return NULL;
 
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
 	if (target->type->pc_size == 64)
-		(*breakpoint_p)->address_64 = address;
+		breakpoint->address_64 = address;
 	else
-		(*breakpoint_p)->address = (uint32_t)address;
-	(*breakpoint_p)->asid = 0;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->set = 0;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
-
-	retval = target_add_breakpoint(target, *breakpoint_p);
+		breakpoint->address = (uint32_t)address;
+	breakpoint->asid = asid;
+	breakpoint->length = length;
+	breakpoint->type = type;
+	breakpoint->set = 0;
+	breakpoint->orig_instr = malloc(length);
+	breakpoint->unique_id = bpwp_unique_id++;
+
+	return breakpoint;
+}
+
+static void breakpoint_delete(struct breakpoint *breakpoint)
+{
+	free(breakpoint->orig_instr);
+	free(breakpoint);
+}
+
+static const char *breakpoint_add_error(int retval)
+{
 	switch (retval) {
-		case ERROR_OK:
-			break;
 		case ERROR_TARGET_RESOURCE_NOT_AVAILABLE:
-			reason = "resource not available";
-			goto fail;
+			return "resource not available";
 		case ERROR_TARGET_NOT_HALTED:
-			reason = "target running";
-			goto fail;
+			return "target running";
 		default:
-			reason = "unknown reason";
-fail:
-			LOG_ERROR("can't add breakpoint: %s", reason);
-			free((*breakpoint_p)->orig_instr);
-			free(*breakpoint_p);
-			*breakpoint_p = NULL;
-			return retval;
+			return "unknown reason";
 	}
+}
+
+int breakpoint_add_internal(struct target *target,
+	uint64_t address,
+	uint32_t length,
+	enum breakpoint_type type)
+{
+	struct breakpoint *breakpoint;
+	int retval;
+
+	breakpoint = breakpoint_lookup(target, address);
+	if (breakpoint) {
+		/* FIXME don't assume "same address" means "same
+		 * breakpoint" ... check all the parameters before
+		 * succeeding.
+		 */
+		LOG_DEBUG("Duplicate Breakpoint address: 0x%08" PRIx64 " (BP %" PRIu32 ")",
+			address, breakpoint->unique_id);
+		breakpoint->coverage = false;
+		return ERROR_OK;
+	}
+
+	breakpoint = breakpoint_new(target, address, 0, length, type);
+	if (!breakpoint)
+		return ERROR_FAIL;
+
+	retval = target_add_breakpoint(target, breakpoint);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("can't add breakpoint: %s", breakpoint_add_error(retval));
+		breakpoint_delete(breakpoint);
+		return retval;
+	}
+
+	breakpoint_link(target, breakpoint);
 
 	LOG_DEBUG("added %s breakpoint at 0x%8.8" PRIx64 " of length 0x%8.8x, (BPID: %" PRIu32 ")",
-		breakpoint_type_strings[(*breakpoint_p)->type],
-		(target->type->pc_size == 64) ? (*breakpoint_p)->address_64 : (*breakpoint_p)->address, (*breakpoint_p)->length,
-		(*breakpoint_p)->unique_id);
+		breakpoint_type_strings[breakpoint->type],
+		breakpoint_key(target, breakpoint), breakpoint->length,
+		breakpoint->unique_id);
 
 	return ERROR_OK;
 }
@@ -119,13 +272,9 @@ int context_breakpoint_add_internal(struct target *target,
 	enum breakpoint_type type)
 {
 	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
 	int retval;
-	int n;
 
-	n = 0;
 	while (breakpoint) {
-		n++;
 		if (breakpoint->asid == asid) {
 			/* FIXME don't assume "same address" means "same
 			 * breakpoint" ... check all the parameters before
@@ -135,32 +284,26 @@ int context_breakpoint_add_internal(struct target *target,
 				asid, breakpoint->unique_id);
 			return -1;
 		}
-		breakpoint_p = &breakpoint->next;
 		breakpoint = breakpoint->next;
 	}
 
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
-	(*breakpoint_p)->address = 0;
-	(*breakpoint_p)->asid = asid;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->set = 0;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
-	retval = target_add_context_breakpoint(target, *breakpoint_p);
+	breakpoint = breakpoint_new(target, 0, asid, length, type);
+	if (!breakpoint)
+		return ERROR_FAIL;
+
+	retval = target_add_context_breakpoint(target, breakpoint);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("could not add breakpoint");
-		free((*breakpoint_p)->orig_instr);
-		free(*breakpoint_p);
-		*breakpoint_p = NULL;
+		breakpoint_delete(breakpoint);
 		return retval;
 	}
 
+	breakpoint_link(target, breakpoint);
+
 	LOG_DEBUG("added %s Context breakpoint at 0x%8.8" PRIx32 " of length 0x%8.8x, (BPID: %" PRIu32 ")",
-		breakpoint_type_strings[(*breakpoint_p)->type],
-		(*breakpoint_p)->asid, (*breakpoint_p)->length,
-		(*breakpoint_p)->unique_id);
+		breakpoint_type_strings[breakpoint->type],
+		breakpoint->asid, breakpoint->length,
+		breakpoint->unique_id);
 
 	return ERROR_OK;
 }
@@ -172,12 +315,9 @@ int hybrid_breakpoint_add_internal(struct target *target,
 	enum breakpoint_type type)
 {
 	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
 	int retval;
-	int n;
-	n = 0;
+
 	while (breakpoint) {
-		n++;
 		if ((breakpoint->asid == asid) && (breakpoint->address == address)) {
 			/* FIXME don't assume "same address" means "same
 			 * breakpoint" ... check all the parameters before
@@ -193,37 +333,28 @@ int hybrid_breakpoint_add_internal(struct target *target,
 			return -1;
 
 		}
-		breakpoint_p = &breakpoint->next;
 		breakpoint = breakpoint->next;
 	}
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
-	if (target->type->pc_size == 64)
-		(*breakpoint_p)->address_64 = address;
-	else
-		(*breakpoint_p)->address = (uint32_t)address;
-	(*breakpoint_p)->asid = asid;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->set = 0;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
 
+	breakpoint = breakpoint_new(target, address, asid, length, type);
+	if (!breakpoint)
+		return ERROR_FAIL;
 
-	retval = target_add_hybrid_breakpoint(target, *breakpoint_p);
+	retval = target_add_hybrid_breakpoint(target, breakpoint);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("could not add breakpoint");
-		free((*breakpoint_p)->orig_instr);
-		free(*breakpoint_p);
-		*breakpoint_p = NULL;
+		breakpoint_delete(breakpoint);
 		return retval;
 	}
+
+	breakpoint_link(target, breakpoint);
+
 	LOG_DEBUG(
 		"added %s Hybrid breakpoint at address 0x%8.8" PRIx64 " of length 0x%8.8x, (BPID: %" PRIu32 ")",
-		breakpoint_type_strings[(*breakpoint_p)->type],
-		(target->type->pc_size == 64) ? (*breakpoint_p)->address_64 : (*breakpoint_p)->address,
-		(*breakpoint_p)->length,
-		(*breakpoint_p)->unique_id);
+		breakpoint_type_strings[breakpoint->type],
+		breakpoint_key(target, breakpoint),
+		breakpoint->length,
+		breakpoint->unique_id);
 
 	return ERROR_OK;
 }
@@ -297,53 +428,43 @@ int hybrid_breakpoint_add(struct target *target,
 }
 
 /* free up a breakpoint */
-static void breakpoint_free(struct target *target, struct breakpoint *breakpoint_to_remove)
+static void breakpoint_free(struct target *target, struct breakpoint *breakpoint)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
 	int retval;
 
-	while (breakpoint) {
-		if (breakpoint == breakpoint_to_remove)
-			break;
-		breakpoint_p = &breakpoint->next;
-		breakpoint = breakpoint->next;
-	}
-
-	if (breakpoint == NULL)
-		return;
-
 	retval = target_remove_breakpoint(target, breakpoint);
 
 	LOG_DEBUG("free BPID: %" PRIu32 " --> %d", breakpoint->unique_id, retval);
-	(*breakpoint_p) = breakpoint->next;
-	free(breakpoint->orig_instr);
-	free(breakpoint);
+	breakpoint_unlink(target, breakpoint);
+	breakpoint_delete(breakpoint);
 }
 
-int breakpoint_remove_internal(struct target *target, uint64_t address)
+/* the breakpoint "rbp address" refers to: one at that address, or else
+ * a context breakpoint with that ASID */
+static struct breakpoint *breakpoint_find_for_removal(struct target *target,
+		uint64_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-
-	while (breakpoint) {
-		if (target->type->pc_size == 64) {
-			if ((breakpoint->address_64 == address) && (breakpoint->asid == 0))
-				break;
-			else if ((breakpoint->address_64 == 0) && (breakpoint->asid == ((uint32_t)address)))
-				break;
-			else if ((breakpoint->address_64 == address) && (breakpoint->asid != 0))
-				break;
-		} else {
-			if ((breakpoint->address == ((uint32_t)address)) && (breakpoint->asid == 0))
-				break;
-			else if ((breakpoint->address == 0) && (breakpoint->asid == ((uint32_t)address)))
-				break;
-			else if ((breakpoint->address == ((uint32_t)address)) && (breakpoint->asid != 0))
-				break;
-		}
-		breakpoint = breakpoint->next;
+	struct breakpoint_index *index = target->breakpoint_index;
+	struct breakpoint *breakpoint, *found;
+
+	found = breakpoint_lookup(target, address);
+	if (found || !index)
+		return found;
+
+	breakpoint = index->buckets[breakpoint_hash(index, 0)];
+	for (; breakpoint; breakpoint = breakpoint->hash_next) {
+		if (breakpoint_key(target, breakpoint) == 0
+				&& breakpoint->asid == (uint32_t)address)
+			found = breakpoint;
 	}
 
+	return found;
+}
+
+int breakpoint_remove_internal(struct target *target, uint64_t address)
+{
+	struct breakpoint *breakpoint = breakpoint_find_for_removal(target, address);
+
 	if (breakpoint) {
 		breakpoint_free(target, breakpoint);
 		return 1;
@@ -371,12 +492,185 @@ void breakpoint_remove(struct target *target, uint64_t address)
 		breakpoint_remove_internal(target, address);
 }
 
+/*
+ * Bulk variants, used when many breakpoints come and go at once (e.g.
+ * coverage style "hit once and remove").  Targets may implement
+ * add_breakpoints/remove_breakpoints to batch the memory accesses for
+ * software breakpoints; failures are reported per breakpoint.
+ */
+static int breakpoint_address_compare(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int breakpoint_add_multiple_internal(struct target *target,
+		const uint64_t *addresses, unsigned count, uint32_t length,
+		enum breakpoint_type type)
+{
+	struct breakpoint **breakpoints;
+	uint64_t *sorted;
+	int *results;
+	unsigned i, n = 0, added = 0;
+	bool out_of_memory = false;
+	int retval = ERROR_OK;
+
+	if (count == 0)
+		return ERROR_OK;
+
+	breakpoints = malloc(count * sizeof(*breakpoints));
+	results = malloc(count * sizeof(*results));
+	sorted = malloc(count * sizeof(*sorted));
+	if (!breakpoints || !results || !sorted) {
+		free(breakpoints);
+		free(results);
+		free(sorted);
+		return ERROR_FAIL;
+	}
+
+	/* sorted, so duplicates within the batch are adjacent and targets
+	 * see neighbouring breakpoints together */
+	memcpy(sorted, addresses, count * sizeof(*sorted));
+	qsort(sorted, count, sizeof(*sorted), breakpoint_address_compare);
+
+	for (i = 0; i < count; i++) {
+		struct breakpoint *breakpoint;
+
+		/* skip duplicates and existing breakpoints */
+		if (i > 0 && sorted[i] == sorted[i - 1])
+			continue;
+		breakpoint = breakpoint_lookup(target, sorted[i]);
+		if (breakpoint) {
+			breakpoint->coverage = false;
+			continue;
+		}
+
+		breakpoint = breakpoint_new(target, sorted[i], 0, length, type);
+		if (!breakpoint) {
+			out_of_memory = true;
+			retval = ERROR_FAIL;
+			break;
+		}
+		breakpoints[n++] = breakpoint;
+	}
+
+	if (n > 0)
+		target_add_breakpoints(target, breakpoints, n, results);
+
+	for (i = 0; i < n; i++) {
+		if (!out_of_memory && results[i] == ERROR_OK) {
+			breakpoint_link(target, breakpoints[i]);
+			added++;
+			continue;
+		}
+
+		if (results[i] != ERROR_OK) {
+			LOG_ERROR("can't add breakpoint at 0x%8.8" PRIx64 ": %s",
+				breakpoint_key(target, breakpoints[i]),
+				breakpoint_add_error(results[i]));
+			if (retval == ERROR_OK)
+				retval = results[i];
+		} else
+			target_remove_breakpoint(target, breakpoints[i]);
+		breakpoint_delete(breakpoints[i]);
+	}
+
+	LOG_DEBUG("added %u %s breakpoints", added, breakpoint_type_strings[type]);
+
+	free(breakpoints);
+	free(results);
+	free(sorted);
+	return retval;
+}
+
+int breakpoint_add_multiple(struct target *target, const uint64_t *addresses,
+		unsigned count, uint32_t length, enum breakpoint_type type)
+{
+	int retval = ERROR_OK;
+	if (target->smp) {
+		struct target_list *head;
+		struct target *curr;
+		head = target->head;
+		if (type == BKPT_SOFT)
+			return breakpoint_add_multiple_internal(head->target,
+					addresses, count, length, type);
+
+		while (head != (struct target_list *)NULL) {
+			curr = head->target;
+			retval = breakpoint_add_multiple_internal(curr,
+					addresses, count, length, type);
+			if (retval != ERROR_OK)
+				return retval;
+			head = head->next;
+		}
+		return retval;
+	} else
+		return breakpoint_add_multiple_internal(target, addresses, count, length, type);
+}
+
+static unsigned breakpoint_remove_multiple_internal(struct target *target,
+		const uint64_t *addresses, unsigned count)
+{
+	struct breakpoint **breakpoints;
+	unsigned i, n = 0;
+
+	if (count == 0)
+		return 0;
+
+	breakpoints = malloc(count * sizeof(*breakpoints));
+	if (!breakpoints)
+		return 0;
+
+	/* unlink first, so duplicate addresses are only removed once */
+	for (i = 0; i < count; i++) {
+		struct breakpoint *breakpoint = breakpoint_lookup(target, addresses[i]);
+
+		if (!breakpoint)
+			continue;
+		breakpoint_unlink(target, breakpoint);
+		breakpoints[n++] = breakpoint;
+	}
+
+	if (n > 0)
+		target_remove_breakpoints(target, breakpoints, n);
+
+	for (i = 0; i < n; i++)
+		breakpoint_delete(breakpoints[i]);
+
+	LOG_DEBUG("removed %u breakpoints", n);
+
+	free(breakpoints);
+	return n;
+}
+
+void breakpoint_remove_multiple(struct target *target,
+		const uint64_t *addresses, unsigned count)
+{
+	if (target->smp) {
+		struct target_list *head;
+		head = target->head;
+		while (head != (struct target_list *)NULL) {
+			breakpoint_remove_multiple_internal(head->target, addresses, count);
+			head = head->next;
+		}
+	} else
+		breakpoint_remove_multiple_internal(target, addresses, count);
+}
+
 void breakpoint_clear_target_internal(struct target *target)
 {
 	LOG_DEBUG("Delete all breakpoints for target: %s",
 		target_name(target));
 	while (target->breakpoints != NULL)
 		breakpoint_free(target, target->breakpoints);
+
+	if (target->breakpoint_index) {
+		free(target->breakpoint_index->buckets);
+		free(target->breakpoint_index);
+		target->breakpoint_index = NULL;
+	}
 }
 
 void breakpoint_clear_target(struct target *target)
@@ -397,15 +691,7 @@ void breakpoint_clear_target(struct target *target)
 
 struct breakpoint *breakpoint_find(struct target *target, uint64_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-
-	while (breakpoint) {
-		if (breakpoint->address == address)
-			return breakpoint;
-		breakpoint = breakpoint->next;
-	}
-
-	return NULL;
+	return breakpoint_lookup(target, address);
 }
 
 int watchpoint_add(struct target *target, uint32_t address, uint32_t length,
@@ -41,8 +41,12 @@ struct breakpoint {
 	int set;
 	uint8_t *orig_instr;
 	struct breakpoint *next;
+	struct breakpoint **pprev;	/* link pointing at this breakpoint */
+	struct breakpoint *hash_next;	/* next in address index bucket */
 	uint32_t unique_id;
 	int linked_BRP;
+	bool coverage;		/* set by code coverage, cleared once anyone
+				 * else adds a breakpoint at the same address */
 };
 
 struct watchpoint {
@@ -64,6 +68,10 @@ int context_breakpoint_add(struct target *target,
 int hybrid_breakpoint_add(struct target *target,
 		uint64_t address, uint32_t asid, uint32_t length, enum breakpoint_type type);
 void breakpoint_remove(struct target *target, uint64_t address);
+int breakpoint_add_multiple(struct target *target, const uint64_t *addresses,
+		unsigned count, uint32_t length, enum breakpoint_type type);
+void breakpoint_remove_multiple(struct target *target,
+		const uint64_t *addresses, unsigned count);
 
 struct breakpoint *breakpoint_find(struct target *target, uint64_t address);
 
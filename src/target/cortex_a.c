@@ -2849,6 +2849,7 @@ struct target_type cortexa_target = {
 	.write_memory = cortex_a_write_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.sha256_memory = arm_sha256_memory,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -2926,6 +2927,7 @@ struct target_type cortexr4_target = {
 	.write_memory = cortex_a_write_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.sha256_memory = arm_sha256_memory,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
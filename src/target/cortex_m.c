@@ -1238,7 +1238,8 @@ int cortex_m_unset_breakpoint(struct target *target, struct breakpoint *breakpoi
 	return ERROR_OK;
 }
 
-int cortex_m_add_breakpoint(struct target *target, struct breakpoint *breakpoint)
+/* validate a new breakpoint and reserve its comparator, if any */
+static int cortex_m_check_breakpoint(struct target *target, struct breakpoint *breakpoint)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 
@@ -1275,9 +1276,148 @@ int cortex_m_add_breakpoint(struct target *target, struct breakpoint *breakpoint
 	if (breakpoint->type == BKPT_HARD)
 		cortex_m->fp_code_available--;
 
+	return ERROR_OK;
+}
+
+int cortex_m_add_breakpoint(struct target *target, struct breakpoint *breakpoint)
+{
+	int retval = cortex_m_check_breakpoint(target, breakpoint);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return cortex_m_set_breakpoint(target, breakpoint);
 }
 
+static int cortex_m_breakpoint_compare(const void *a, const void *b)
+{
+	const struct breakpoint *x = *(struct breakpoint * const *)a;
+	const struct breakpoint *y = *(struct breakpoint * const *)b;
+
+	return (x->address > y->address) - (x->address < y->address);
+}
+
+/*
+ * Set or clear many software breakpoints with two DAP flushes in total:
+ * one fetching the memory words holding them, one writing the patched
+ * words back, rather than a blocking read and write per breakpoint.
+ * Soft breakpoints live outside the code region, where word accesses
+ * are fine; words holding several breakpoints are patched only once.
+ */
+static int cortex_m_patch_soft_breakpoints(struct target *target,
+	struct breakpoint **breakpoints, int count, bool set)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct adiv5_dap *swjdp = armv7m->arm.dap;
+	struct breakpoint **sorted;
+	uint32_t *words;
+	uint8_t code[4];
+	int i, j, retval;
+
+	sorted = malloc(count * sizeof(*sorted));
+	words = malloc(count * sizeof(*words));
+	if (!sorted || !words) {
+		free(sorted);
+		free(words);
+		return ERROR_FAIL;
+	}
+
+	memcpy(sorted, breakpoints, count * sizeof(*sorted));
+	qsort(sorted, count, sizeof(*sorted), cortex_m_breakpoint_compare);
+
+	/* queue reads of all words, sharing them between neighbours */
+	for (i = 0, retval = ERROR_OK; i < count && retval == ERROR_OK; i++) {
+		if (i > 0 && (sorted[i]->address & ~3) == (sorted[i - 1]->address & ~3))
+			continue;
+		retval = mem_ap_read_u32(swjdp, sorted[i]->address & ~3, &words[i]);
+	}
+	if (retval == ERROR_OK)
+		retval = dap_run(swjdp);
+	if (retval != ERROR_OK)
+		goto done;
+
+	/* see cortex_m_set_breakpoint() */
+	buf_set_u32(code, 0, 32, ARMV5_T_BKPT(0x11));
+
+	for (i = 0; i < count && retval == ERROR_OK; i = j) {
+		uint32_t word = sorted[i]->address & ~3;
+		uint8_t buf[4];
+
+		target_buffer_set_u32(target, buf, words[i]);
+		for (j = i; j < count && (sorted[j]->address & ~3) == word; j++) {
+			uint8_t *insn = buf + (sorted[j]->address & 2);
+
+			if (set) {
+				memcpy(sorted[j]->orig_instr, insn, 2);
+				memcpy(insn, code, 2);
+			} else
+				memcpy(insn, sorted[j]->orig_instr, 2);
+		}
+
+		retval = mem_ap_write_u32(swjdp, word, target_buffer_get_u32(target, buf));
+	}
+	if (retval == ERROR_OK)
+		retval = dap_run(swjdp);
+
+	if (retval != ERROR_OK && set) {
+		/* we don't know which writes made it, put back what we read */
+		for (i = 0; i < count; i++) {
+			if (i > 0 && (sorted[i]->address & ~3) == (sorted[i - 1]->address & ~3))
+				continue;
+			if (mem_ap_write_u32(swjdp, sorted[i]->address & ~3, words[i]) != ERROR_OK)
+				break;
+		}
+		dap_run(swjdp);
+		goto done;
+	}
+
+	for (i = 0; i < count; i++) {
+		sorted[i]->set = set;
+		LOG_DEBUG("BPID: %" PRIu32 ", Address: 0x%08" PRIx32 " (set=%d)",
+			sorted[i]->unique_id, sorted[i]->address, sorted[i]->set);
+	}
+
+done:
+	free(sorted);
+	free(words);
+	return retval;
+}
+
+static int cortex_m_add_breakpoints(struct target *target,
+	struct breakpoint **breakpoints, int count, int *results)
+{
+	struct breakpoint **soft;
+	int i, n = 0;
+	int retval;
+
+	soft = malloc(count * sizeof(*soft));
+	if (!soft)
+		return ERROR_FAIL;
+
+	for (i = 0; i < count; i++) {
+		results[i] = cortex_m_check_breakpoint(target, breakpoints[i]);
+		if (results[i] != ERROR_OK)
+			continue;
+
+		if (breakpoints[i]->type == BKPT_SOFT)
+			soft[n++] = breakpoints[i];
+		else
+			results[i] = cortex_m_set_breakpoint(target, breakpoints[i]);
+	}
+
+	retval = ERROR_OK;
+	if (n > 0)
+		retval = cortex_m_patch_soft_breakpoints(target, soft, n, true);
+
+	for (i = 0; i < count; i++) {
+		if (results[i] == ERROR_OK && breakpoints[i]->type == BKPT_SOFT
+				&& !breakpoints[i]->set)
+			results[i] = (retval != ERROR_OK) ? retval : ERROR_FAIL;
+	}
+
+	free(soft);
+	return retval;
+}
+
 int cortex_m_remove_breakpoint(struct target *target, struct breakpoint *breakpoint)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
@@ -1300,6 +1440,40 @@ int cortex_m_remove_breakpoint(struct target *target, struct breakpoint *breakpo
 	return ERROR_OK;
 }
 
+static int cortex_m_remove_breakpoints(struct target *target,
+	struct breakpoint **breakpoints, int count)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct breakpoint **soft;
+	int i, n = 0;
+	int retval = ERROR_OK;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_WARNING("target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	soft = malloc(count * sizeof(*soft));
+	if (!soft)
+		return ERROR_FAIL;
+
+	for (i = 0; i < count; i++) {
+		if (cortex_m->auto_bp_type)
+			breakpoints[i]->type = BKPT_TYPE_BY_ADDR(breakpoints[i]->address);
+
+		if (breakpoints[i]->type == BKPT_SOFT && breakpoints[i]->set)
+			soft[n++] = breakpoints[i];
+		else
+			cortex_m_remove_breakpoint(target, breakpoints[i]);
+	}
+
+	if (n > 0)
+		retval = cortex_m_patch_soft_breakpoints(target, soft, n, false);
+
+	free(soft);
+	return retval;
+}
+
 int cortex_m_set_watchpoint(struct target *target, struct watchpoint *watchpoint)
 {
 	int dwt_num = 0;
@@ -1631,6 +1805,108 @@ static int cortex_m_write_memory(struct target *target, uint32_t address,
 	return mem_ap_write(swjdp, buffer, size, count, address, true);
 }
 
+static int cortex_m_refill_fifo(struct target *target, uint32_t address,
+	uint32_t size, const uint8_t *buffer, uint32_t wp_addr, uint32_t wp,
+	uint32_t rp_addr, uint32_t *rp)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct adiv5_dap *swjdp = armv7m->arm.dap;
+	uint32_t access_size = 4;
+	int retval;
+
+	/* the fifo holds whole blocks of 1, 2 or 4 bytes */
+	while ((address | size) & (access_size - 1))
+		access_size >>= 1;
+
+	retval = mem_ap_queue_write(swjdp, buffer, access_size, size / access_size,
+			address, true);
+	if (retval == ERROR_OK)
+		retval = mem_ap_write_u32(swjdp, wp_addr, wp);
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(swjdp, rp_addr, rp);
+	if (retval == ERROR_OK)
+		retval = dap_run(swjdp);
+
+	return retval;
+}
+
+static int cortex_m_memory_sequence(struct target *target,
+	struct target_memory_op *ops, int num_ops)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct adiv5_dap *swjdp = armv7m->arm.dap;
+	uint32_t *read_buf, *read_ptr;
+	uint32_t num_reads = 0;
+	int retval = ERROR_OK;
+	int i;
+
+	for (i = 0; i < num_ops; i++) {
+		if (ops[i].size != 1 && ops[i].size != 2 && ops[i].size != 4)
+			return ERROR_TARGET_UNALIGNED_ACCESS;
+		if (ops[i].address & (ops[i].size - 1))
+			return ERROR_TARGET_UNALIGNED_ACCESS;
+		if (!ops[i].write)
+			num_reads += ops[i].count;
+	}
+
+	/* every item read takes a whole DRW word, the byte lanes are picked
+	 * out once the queue has run */
+	read_buf = NULL;
+	if (num_reads) {
+		read_buf = malloc(num_reads * sizeof(uint32_t));
+		if (read_buf == NULL)
+			return ERROR_FAIL;
+	}
+
+	read_ptr = read_buf;
+	for (i = 0; i < num_ops && retval == ERROR_OK; i++) {
+		struct target_memory_op *op = &ops[i];
+		uint32_t csw_size = op->size == 4 ? CSW_32BIT :
+				op->size == 2 ? CSW_16BIT : CSW_8BIT;
+
+		if (op->write) {
+			retval = mem_ap_queue_write(swjdp, op->write, op->size, op->count,
+					op->address, true);
+			/* the incrementing write moved the hardware TAR past the
+			 * cached value, a read of the same address must set it */
+			swjdp->ap_tar_value = -1;
+			continue;
+		}
+
+		for (uint32_t j = 0; j < op->count && retval == ERROR_OK; j++) {
+			retval = dap_setup_accessport(swjdp, csw_size | CSW_ADDRINC_OFF,
+					op->address + j * op->size);
+			if (retval == ERROR_OK)
+				retval = dap_queue_ap_read(swjdp, AP_REG_DRW, read_ptr++);
+		}
+	}
+
+	if (retval == ERROR_OK)
+		retval = dap_run(swjdp);
+
+	read_ptr = read_buf;
+	for (i = 0; i < num_ops && retval == ERROR_OK; i++) {
+		struct target_memory_op *op = &ops[i];
+		uint32_t address = op->address;
+		uint8_t *buffer = op->read;
+
+		if (op->write)
+			continue;
+
+		for (uint32_t j = 0; j < op->count; j++, read_ptr++) {
+			for (uint32_t k = 0; k < op->size; k++, address++) {
+				if (swjdp->ti_be_32_quirks)
+					*buffer++ = *read_ptr >> 8 * (3 - (address & 3));
+				else
+					*buffer++ = *read_ptr >> 8 * (address & 3);
+			}
+		}
+	}
+
+	free(read_buf);
+	return retval;
+}
+
 static int cortex_m_init_target(struct command_context *cmd_ctx,
 	struct target *target)
 {
@@ -2260,14 +2536,19 @@ struct target_type cortexm_target = {
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
+	.sha256_memory = armv7m_sha256_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
 	.wait_algorithm = armv7m_wait_algorithm,
+	.refill_fifo = cortex_m_refill_fifo,
+	.memory_sequence = cortex_m_memory_sequence,
 
 	.add_breakpoint = cortex_m_add_breakpoint,
 	.remove_breakpoint = cortex_m_remove_breakpoint,
+	.add_breakpoints = cortex_m_add_breakpoints,
+	.remove_breakpoints = cortex_m_remove_breakpoints,
 	.add_watchpoint = cortex_m_add_watchpoint,
 	.remove_watchpoint = cortex_m_remove_watchpoint,
 
@@ -0,0 +1,716 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/binarybuffer.h>
+#include <helper/fileio.h>
+#include <helper/time_support.h>
+#include "target.h"
+#include "breakpoints.h"
+#include "register.h"
+#include "image.h"
+#include "arm.h"
+#include "arm_disassembler.h"
+#include "coverage.h"
+
+/*
+ * Block entries are found by a linear sweep over the executable parts
+ * of the image:  the start of each section, every direct branch target,
+ * and the instruction after each conditional branch or call.  The
+ * instruction after an unconditional branch is deliberately not used,
+ * since that is where compilers put literal pools.  Indirect branch
+ * targets (BX, TBB/TBH, loads to PC) can't be known statically; such
+ * blocks are usually also reached by a direct branch or a call.
+ */
+struct coverage_scan {
+	unsigned count;
+	unsigned size;
+	uint32_t *addresses;
+};
+
+static int coverage_add_entry(struct coverage_scan *scan, uint32_t address)
+{
+	if (scan->count == scan->size) {
+		unsigned size = scan->size ? scan->size * 2 : 1024;
+		uint32_t *addresses = realloc(scan->addresses,
+				size * sizeof(*addresses));
+
+		if (!addresses)
+			return ERROR_FAIL;
+		scan->addresses = addresses;
+		scan->size = size;
+	}
+
+	scan->addresses[scan->count++] = address;
+	return ERROR_OK;
+}
+
+static int coverage_scan_thumb(struct target *target, struct coverage_scan *scan,
+		uint32_t base, const uint8_t *buffer, uint32_t size)
+{
+	struct arm_instruction instruction;
+	unsigned it_remaining = 0;
+	uint32_t offset = 0;
+	int retval;
+
+	retval = coverage_add_entry(scan, base);
+
+	while (retval == ERROR_OK && offset + 2 <= size) {
+		uint32_t address = base + offset;
+		uint16_t op = target_buffer_get_u16(target, buffer + offset);
+		uint32_t opcode = op;
+		bool conditional = it_remaining > 0;
+
+		switch (op & 0xf800) {
+			case 0xf800:
+			case 0xf000:
+			case 0xe800:
+				if (offset + 4 > size)
+					return ERROR_OK;
+				opcode = (opcode << 16)
+					| target_buffer_get_u16(target, buffer + offset + 2);
+				break;
+		}
+
+		if (thumb2_evaluate_opcode(opcode, address, &instruction) != ERROR_OK)
+			instruction.instruction_size = (opcode > 0xffff) ? 4 : 2;
+		offset += instruction.instruction_size;
+
+		if (it_remaining)
+			it_remaining--;
+
+		if ((op & 0xff00) == 0xbf00 && (op & 0x000f)) {
+			/* IT: the mask's lowest set bit gives the block length */
+			if (op & 0x1)
+				it_remaining = 4;
+			else if (op & 0x2)
+				it_remaining = 3;
+			else if (op & 0x4)
+				it_remaining = 2;
+			else
+				it_remaining = 1;
+			continue;
+		}
+
+		if ((op & 0xf500) == 0xb100) {
+			/* CBZ/CBNZ are always conditional */
+			unsigned imm = ((op >> 3) & 0x1f) | ((op & 0x0200) >> 4);
+
+			retval = coverage_add_entry(scan, address + 4 + (imm << 1));
+			if (retval == ERROR_OK)
+				retval = coverage_add_entry(scan, base + offset);
+			continue;
+		}
+
+		switch (instruction.type) {
+			case ARM_B:
+				if ((opcode <= 0xffff && (op & 0xf000) == 0xd000)
+						|| (opcode > 0xffff && !(opcode & (1 << 12))))
+					conditional = true;
+				retval = coverage_add_entry(scan,
+						instruction.info.b_bl_bx_blx.target_address);
+				if (retval == ERROR_OK && conditional)
+					retval = coverage_add_entry(scan, base + offset);
+				break;
+			case ARM_BL:
+				retval = coverage_add_entry(scan,
+						instruction.info.b_bl_bx_blx.target_address);
+				if (retval == ERROR_OK)
+					retval = coverage_add_entry(scan, base + offset);
+				break;
+			case ARM_BLX:
+				/* target is ARM code (or a register) */
+				retval = coverage_add_entry(scan, base + offset);
+				break;
+			case ARM_BX:
+				if (conditional)
+					retval = coverage_add_entry(scan, base + offset);
+				break;
+			default:
+				break;
+		}
+	}
+
+	return retval;
+}
+
+static int coverage_scan_arm(struct target *target, struct coverage_scan *scan,
+		uint32_t base, const uint8_t *buffer, uint32_t size)
+{
+	struct arm_instruction instruction;
+	uint32_t offset;
+	int retval;
+
+	retval = coverage_add_entry(scan, base);
+
+	for (offset = 0; retval == ERROR_OK && offset + 4 <= size; offset += 4) {
+		uint32_t address = base + offset;
+		uint32_t opcode = target_buffer_get_u32(target, buffer + offset);
+		bool conditional = (opcode >> 28) != 0xe;
+
+		if (arm_evaluate_opcode(opcode, address, &instruction) != ERROR_OK)
+			continue;
+
+		switch (instruction.type) {
+			case ARM_B:
+				retval = coverage_add_entry(scan,
+						instruction.info.b_bl_bx_blx.target_address);
+				if (retval == ERROR_OK && conditional)
+					retval = coverage_add_entry(scan, address + 4);
+				break;
+			case ARM_BL:
+				retval = coverage_add_entry(scan,
+						instruction.info.b_bl_bx_blx.target_address);
+				if (retval == ERROR_OK)
+					retval = coverage_add_entry(scan, address + 4);
+				break;
+			case ARM_BLX:
+				/* target is Thumb code (or a register) */
+				retval = coverage_add_entry(scan, address + 4);
+				break;
+			case ARM_BX:
+				if (conditional)
+					retval = coverage_add_entry(scan, address + 4);
+				break;
+			default:
+				break;
+		}
+	}
+
+	return retval;
+}
+
+static int coverage_compare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void coverage_free(struct target *target)
+{
+	struct target_coverage *coverage = target->coverage;
+
+	if (!coverage)
+		return;
+
+	free(coverage->blocks);
+	free(coverage->state);
+	free(coverage);
+	target->coverage = NULL;
+}
+
+static int coverage_find(struct target_coverage *coverage, uint32_t address)
+{
+	uint32_t *block = bsearch(&address, coverage->blocks, coverage->num_blocks,
+			sizeof(*coverage->blocks), coverage_compare);
+
+	return block ? block - coverage->blocks : -1;
+}
+
+bool coverage_claim_halt(struct target *target)
+{
+	struct target_coverage *coverage = target->coverage;
+	struct breakpoint *breakpoint;
+	uint32_t pc;
+	int i;
+
+	if (!coverage || !coverage->running || coverage->resume_pending)
+		return false;
+	if (target->debug_reason != DBG_REASON_BREAKPOINT)
+		return false;
+
+	pc = buf_get_u32(target_to_arm(target)->pc->value, 0, 32);
+	i = coverage_find(coverage, pc);
+	if (i < 0 || !(coverage->state[i] & COVERAGE_INSTALLED))
+		return false;
+
+	/* somebody else wants to stop here as well */
+	breakpoint = breakpoint_find(target, pc);
+	if (!breakpoint || !breakpoint->coverage) {
+		coverage->state[i] &= ~COVERAGE_INSTALLED;
+		return false;
+	}
+
+	coverage->state[i] = COVERAGE_HIT;
+	coverage->num_hit++;
+	coverage->resume_pending = true;
+	coverage->resume_pc = pc;
+
+	return true;
+}
+
+void coverage_poll(struct target *target)
+{
+	struct target_coverage *coverage = target->coverage;
+	struct breakpoint *breakpoint;
+	uint32_t pc;
+
+	if (!coverage || !coverage->resume_pending)
+		return;
+
+	coverage->resume_pending = false;
+	pc = coverage->resume_pc;
+
+	if (target->state != TARGET_HALTED)
+		return;
+
+	/* a user or GDB set a breakpoint here after the halt was claimed,
+	 * so report the halt after all */
+	breakpoint = breakpoint_find(target, pc);
+	if (breakpoint && !breakpoint->coverage) {
+		target_call_event_callbacks(target, TARGET_EVENT_HALTED);
+		return;
+	}
+	if (breakpoint)
+		breakpoint_remove(target, pc);
+
+	if (target_resume(target, 1, 0, 0, 0) != ERROR_OK) {
+		LOG_ERROR("coverage: failed to resume at 0x%8.8" PRIx32, pc);
+		target_call_event_callbacks(target, TARGET_EVENT_HALTED);
+	}
+}
+
+static int coverage_stop(struct target *target)
+{
+	struct target_coverage *coverage = target->coverage;
+	uint64_t *addresses;
+	unsigned i, n = 0;
+
+	if (!coverage || !coverage->running)
+		return ERROR_OK;
+
+	addresses = malloc(coverage->num_blocks * sizeof(*addresses));
+	if (!addresses)
+		return ERROR_FAIL;
+
+	for (i = 0; i < coverage->num_blocks; i++) {
+		struct breakpoint *breakpoint;
+
+		if (!(coverage->state[i] & COVERAGE_INSTALLED))
+			continue;
+		coverage->state[i] &= ~COVERAGE_INSTALLED;
+
+		/* leave breakpoints a user or GDB also set */
+		breakpoint = breakpoint_find(target, coverage->blocks[i]);
+		if (breakpoint && breakpoint->coverage)
+			addresses[n++] = coverage->blocks[i];
+	}
+
+	breakpoint_remove_multiple(target, addresses, n);
+	coverage->running = false;
+
+	free(addresses);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_coverage_load_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct arm *arm = target_to_arm(target);
+	struct target_coverage *coverage;
+	struct coverage_scan scan = { 0 };
+	uint32_t min_address = 0;
+	uint32_t max_address = 0xffffffff;
+	struct image image;
+	unsigned i, n;
+	int retval;
+
+	if (CMD_ARGC != 1 && CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!is_arm(arm)) {
+		command_print(CMD_CTX, "coverage is only supported on ARM targets");
+		return ERROR_TARGET_INVALID;
+	}
+
+	if (target->coverage && target->coverage->running) {
+		command_print(CMD_CTX, "coverage collection is running, stop it first");
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC == 3) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], min_address);
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], max_address);
+		if (min_address > max_address)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	image.base_address_set = 0;
+	image.start_address_set = 0;
+	retval = image_open(&image, CMD_ARGV[0], NULL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	coverage_free(target);
+	coverage = calloc(1, sizeof(*coverage));
+	if (!coverage) {
+		image_close(&image);
+		return ERROR_FAIL;
+	}
+	target->coverage = coverage;
+
+	/* microcontroller profile cores only run Thumb code; otherwise go by
+	 * the state of the entry point */
+	coverage->thumb = arm->core_type == ARM_MODE_THREAD
+		|| (image.start_address_set && (image.start_address & 1));
+
+	for (i = 0; retval == ERROR_OK && i < (unsigned)image.num_sections; i++) {
+		struct imagesection *section = &image.sections[i];
+		uint8_t *buffer;
+		size_t size_read;
+
+		/* only the executable segments of an ELF file */
+		if (image.type == IMAGE_ELF && !(section->flags & 0x1))
+			continue;
+
+		buffer = malloc(section->size);
+		if (!buffer) {
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		retval = image_read_section(&image, i, 0, section->size,
+				buffer, &size_read);
+		if (retval == ERROR_OK) {
+			if (coverage->thumb)
+				retval = coverage_scan_thumb(target, &scan,
+						section->base_address, buffer, size_read);
+			else
+				retval = coverage_scan_arm(target, &scan,
+						section->base_address, buffer, size_read);
+		}
+
+		free(buffer);
+	}
+
+	if (retval != ERROR_OK) {
+		free(scan.addresses);
+		image_close(&image);
+		coverage_free(target);
+		return retval;
+	}
+
+	qsort(scan.addresses, scan.count, sizeof(*scan.addresses), coverage_compare);
+
+	/* drop duplicates, anything outside the executable sections or the
+	 * requested range, and branch targets that can't be instructions */
+	for (i = 0, n = 0; i < scan.count; i++) {
+		uint32_t address = scan.addresses[i];
+		int s;
+
+		if (n > 0 && scan.addresses[n - 1] == address)
+			continue;
+		if (address < min_address || address >= max_address)
+			continue;
+		if (address & (coverage->thumb ? 1 : 3))
+			continue;
+
+		for (s = 0; s < image.num_sections; s++) {
+			struct imagesection *section = &image.sections[s];
+
+			if (image.type == IMAGE_ELF && !(section->flags & 0x1))
+				continue;
+			if (address >= section->base_address
+					&& address - section->base_address < section->size)
+				break;
+		}
+		if (s == image.num_sections)
+			continue;
+
+		scan.addresses[n++] = address;
+	}
+
+	image_close(&image);
+
+	coverage->blocks = scan.addresses;
+	coverage->num_blocks = n;
+	coverage->state = calloc(n ? n : 1, sizeof(*coverage->state));
+	if (!coverage->state) {
+		coverage_free(target);
+		return ERROR_FAIL;
+	}
+
+	command_print(CMD_CTX, "%u %s basic blocks", n,
+			coverage->thumb ? "Thumb" : "ARM");
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_coverage_start_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct target_coverage *coverage = target->coverage;
+	struct duration bench;
+	uint64_t *addresses;
+	unsigned i, n = 0, installed = 0;
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!coverage) {
+		command_print(CMD_CTX, "no coverage image loaded");
+		return ERROR_FAIL;
+	}
+	if (coverage->running)
+		return ERROR_OK;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_WARNING("target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	addresses = malloc((coverage->num_blocks ? coverage->num_blocks : 1)
+			* sizeof(*addresses));
+	if (!addresses)
+		return ERROR_FAIL;
+
+	/* leave blocks already hit, and existing breakpoints, alone */
+	for (i = 0; i < coverage->num_blocks; i++) {
+		if (coverage->state[i] & COVERAGE_HIT)
+			continue;
+		if (breakpoint_find(target, coverage->blocks[i]))
+			continue;
+		addresses[n++] = coverage->blocks[i];
+	}
+
+	duration_start(&bench);
+
+	/* failures are reported per breakpoint; collect whatever got set */
+	breakpoint_add_multiple(target, addresses, n,
+			coverage->thumb ? 2 : 4, BKPT_SOFT);
+
+	for (i = 0; i < n; i++) {
+		struct breakpoint *breakpoint = breakpoint_find(target, addresses[i]);
+
+		if (!breakpoint)
+			continue;
+		breakpoint->coverage = true;
+		coverage->state[coverage_find(coverage, addresses[i])] |= COVERAGE_INSTALLED;
+		installed++;
+	}
+
+	free(addresses);
+
+	coverage->running = true;
+
+	if (duration_measure(&bench) == ERROR_OK)
+		command_print(CMD_CTX, "installed %u of %u coverage breakpoints "
+				"in %fs", installed, n, duration_elapsed(&bench));
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_coverage_stop_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (target->coverage && target->coverage->running
+			&& target->state != TARGET_HALTED) {
+		LOG_WARNING("target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	return coverage_stop(target);
+}
+
+COMMAND_HANDLER(handle_coverage_report_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct target_coverage *coverage = target->coverage;
+	unsigned i;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!coverage) {
+		command_print(CMD_CTX, "no coverage image loaded");
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "all") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		for (i = 0; i < coverage->num_blocks; i++)
+			command_print(CMD_CTX, "0x%8.8" PRIx32 " %s",
+					coverage->blocks[i],
+					(coverage->state[i] & COVERAGE_HIT) ? "hit" : "-");
+	}
+
+	command_print(CMD_CTX, "%u of %u basic blocks hit (%s)",
+			coverage->num_hit, coverage->num_blocks,
+			coverage->running ? "running" : "stopped");
+
+	return ERROR_OK;
+}
+
+/*
+ * Binary format, all words little endian:  "OCOV", block count, hit
+ * count, the block addresses, then one bit per block (LSB first) set
+ * for blocks that were hit.
+ */
+static int coverage_write_binary(struct target_coverage *coverage,
+		struct fileio *fileio)
+{
+	unsigned bitmap_size = (coverage->num_blocks + 7) / 8;
+	size_t size = 12 + 4 * coverage->num_blocks + bitmap_size;
+	size_t size_written;
+	uint8_t *buffer;
+	unsigned i;
+	int retval;
+
+	buffer = calloc(1, size);
+	if (!buffer)
+		return ERROR_FAIL;
+
+	memcpy(buffer, "OCOV", 4);
+	h_u32_to_le(buffer + 4, coverage->num_blocks);
+	h_u32_to_le(buffer + 8, coverage->num_hit);
+	for (i = 0; i < coverage->num_blocks; i++) {
+		h_u32_to_le(buffer + 12 + 4 * i, coverage->blocks[i]);
+		if (coverage->state[i] & COVERAGE_HIT)
+			buffer[12 + 4 * coverage->num_blocks + i / 8] |= 1 << (i % 8);
+	}
+
+	retval = fileio_write(fileio, size, buffer, &size_written);
+	free(buffer);
+	return retval;
+}
+
+/* Text format: one "address hits" line per block, ready for addr2line. */
+static int coverage_write_text(struct target_coverage *coverage,
+		struct fileio *fileio)
+{
+	char line[32];
+	size_t size_written;
+	unsigned i;
+	int retval = ERROR_OK;
+
+	for (i = 0; retval == ERROR_OK && i < coverage->num_blocks; i++) {
+		int len = snprintf(line, sizeof(line), "0x%8.8" PRIx32 " %d\n",
+				coverage->blocks[i],
+				(coverage->state[i] & COVERAGE_HIT) ? 1 : 0);
+		retval = fileio_write(fileio, len, line, &size_written);
+	}
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_coverage_dump_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct target_coverage *coverage = target->coverage;
+	struct fileio fileio;
+	bool binary = false;
+	int retval;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 2) {
+		if (strcmp(CMD_ARGV[1], "binary") == 0)
+			binary = true;
+		else if (strcmp(CMD_ARGV[1], "text") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	if (!coverage) {
+		command_print(CMD_CTX, "no coverage image loaded");
+		return ERROR_FAIL;
+	}
+
+	retval = fileio_open(&fileio, CMD_ARGV[0], FILEIO_WRITE,
+			binary ? FILEIO_BINARY : FILEIO_TEXT);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (binary)
+		retval = coverage_write_binary(coverage, &fileio);
+	else
+		retval = coverage_write_text(coverage, &fileio);
+
+	fileio_close(&fileio);
+
+	if (retval == ERROR_OK)
+		command_print(CMD_CTX, "wrote %u blocks (%u hit) to %s",
+				coverage->num_blocks, coverage->num_hit, CMD_ARGV[0]);
+
+	return retval;
+}
+
+static const struct command_registration coverage_exec_command_handlers[] = {
+	{
+		.name = "load",
+		.handler = handle_coverage_load_command,
+		.mode = COMMAND_EXEC,
+		.help = "find the basic blocks of an image, optionally "
+			"restricted to an address range",
+		.usage = "filename [min_address max_address]",
+	},
+	{
+		.name = "start",
+		.handler = handle_coverage_start_command,
+		.mode = COMMAND_EXEC,
+		.help = "set a breakpoint on every block not hit yet",
+		.usage = "",
+	},
+	{
+		.name = "stop",
+		.handler = handle_coverage_stop_command,
+		.mode = COMMAND_EXEC,
+		.help = "remove the remaining coverage breakpoints",
+		.usage = "",
+	},
+	{
+		.name = "report",
+		.handler = handle_coverage_report_command,
+		.mode = COMMAND_EXEC,
+		.help = "display coverage summary, or every block",
+		.usage = "['all']",
+	},
+	{
+		.name = "dump",
+		.handler = handle_coverage_dump_command,
+		.mode = COMMAND_EXEC,
+		.help = "write coverage results to a file",
+		.usage = "filename ['text'|'binary']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+static const struct command_registration coverage_command_handlers[] = {
+	{
+		.name = "coverage",
+		.mode = COMMAND_EXEC,
+		.help = "breakpoint based code coverage",
+		.usage = "",
+		.chain = coverage_exec_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int coverage_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, coverage_command_handlers);
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+struct target;
+struct command_context;
+
+/**
+ * Basic block coverage collected with software breakpoints.  Every
+ * block entry of an image gets a breakpoint; the first hit records the
+ * block, removes the breakpoint and resumes the target without
+ * reporting the halt to anyone else.
+ */
+struct target_coverage {
+	bool thumb;			/* blocks are Thumb code */
+	bool running;		/* breakpoints are installed */
+	unsigned num_blocks;
+	uint32_t *blocks;	/* block entry addresses, sorted */
+	uint8_t *state;		/* COVERAGE_* flags, per block */
+	unsigned num_hit;
+	bool resume_pending;	/* halted on a hit, resume from the next poll */
+	uint32_t resume_pc;
+};
+
+#define COVERAGE_INSTALLED	0x1
+#define COVERAGE_HIT		0x2
+
+/**
+ * Called for every halt of @a target before the halted event is raised.
+ * Returns true if the halt was on a breakpoint owned by coverage; the
+ * block is then recorded, the event must not be raised, and the next
+ * coverage_poll() removes the breakpoint and resumes the target.
+ * Halts on breakpoints which a user or GDB also set are not claimed.
+ */
+bool coverage_claim_halt(struct target *target);
+
+/**
+ * Called from target_poll() after the target type's poll, outside of
+ * any event callback, to resume from a halt claimed by coverage.
+ */
+void coverage_poll(struct target *target);
+
+int coverage_register_commands(struct command_context *cmd_ctx);
+
+#endif /* COVERAGE_H */
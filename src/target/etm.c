@@ -644,10 +644,192 @@ static struct etm_capture_driver *etm_capture_drivers[] = {
 	NULL
 };
 
-static int etm_read_instruction(struct etm_context *ctx, struct arm_instruction *instruction)
+/*
+ * Trace analysis revisits the same few instructions over and over (a traced
+ * loop is decoded once per iteration), so instead of scanning the image
+ * sections and re-disassembling for every traced PC we keep a sorted index
+ * of the image sections and a hash table of already decoded instructions,
+ * keyed by address and core state.  Both are built lazily and dropped when
+ * a different image is loaded.
+ */
+struct etm_section_index {
+	uint32_t base_address;
+	uint32_t size;
+	uint64_t max_end;	/* highest section end up to this entry */
+	int section;
+};
+
+struct etm_insn_entry {
+	bool valid;
+	int core_state;
+	uint32_t address;
+	struct arm_instruction instruction;
+};
+
+struct etm_image_cache {
+	int num_sections;
+	struct etm_section_index *sections;	/* sorted by base_address */
+
+	unsigned insn_count;
+	unsigned insn_mask;		/* number of hash buckets - 1 */
+	struct etm_insn_entry *insns;
+};
+
+#define ETM_INSN_CACHE_MIN	1024
+
+static void etm_image_cache_free(struct etm_context *ctx)
+{
+	struct etm_image_cache *cache = ctx->image_cache;
+
+	if (!cache)
+		return;
+
+	free(cache->sections);
+	free(cache->insns);
+	free(cache);
+	ctx->image_cache = NULL;
+}
+
+static int etm_section_index_compare(const void *a, const void *b)
+{
+	const struct etm_section_index *sa = a;
+	const struct etm_section_index *sb = b;
+
+	if (sa->base_address < sb->base_address)
+		return -1;
+	if (sa->base_address > sb->base_address)
+		return 1;
+	return sa->section - sb->section;
+}
+
+static struct etm_image_cache *etm_image_cache_get(struct etm_context *ctx)
 {
+	struct etm_image_cache *cache = ctx->image_cache;
 	int i;
+
+	if (cache)
+		return cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	cache->num_sections = ctx->image->num_sections;
+	if (cache->num_sections > 0) {
+		cache->sections = malloc(cache->num_sections * sizeof(*cache->sections));
+		if (!cache->sections) {
+			free(cache);
+			return NULL;
+		}
+	}
+
+	for (i = 0; i < cache->num_sections; i++) {
+		cache->sections[i].base_address = ctx->image->sections[i].base_address;
+		cache->sections[i].size = ctx->image->sections[i].size;
+		cache->sections[i].section = i;
+	}
+	qsort(cache->sections, cache->num_sections, sizeof(*cache->sections),
+			etm_section_index_compare);
+
+	for (i = 0; i < cache->num_sections; i++) {
+		struct etm_section_index *s = &cache->sections[i];
+		uint64_t end = (uint64_t)s->base_address + s->size;
+
+		s->max_end = (i > 0 && cache->sections[i - 1].max_end > end)
+				? cache->sections[i - 1].max_end : end;
+	}
+
+	cache->insn_mask = ETM_INSN_CACHE_MIN - 1;
+	cache->insns = calloc(ETM_INSN_CACHE_MIN, sizeof(*cache->insns));
+	if (!cache->insns) {
+		free(cache->sections);
+		free(cache);
+		return NULL;
+	}
+
+	ctx->image_cache = cache;
+	return cache;
+}
+
+/* binary search for the image section containing address, -1 if none */
+static int etm_find_section(struct etm_image_cache *cache, uint32_t address)
+{
+	int lo = 0;
+	int hi = cache->num_sections - 1;
 	int section = -1;
+
+	/* find the last section starting at or below address */
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (cache->sections[mid].base_address <= address)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	/* sections may overlap; like a linear scan of the image, prefer the
+	 * lowest-numbered one containing the address.  max_end lets us stop
+	 * as soon as no earlier section can reach this far. */
+	for (; hi >= 0 && cache->sections[hi].max_end > address; hi--) {
+		struct etm_section_index *s = &cache->sections[hi];
+
+		if (address - s->base_address < s->size
+				&& (section == -1 || s->section < section))
+			section = s->section;
+	}
+
+	return section;
+}
+
+static inline unsigned etm_insn_hash(uint32_t address, int core_state)
+{
+	return ((address >> 1) ^ core_state) * 2654435761u;
+}
+
+static struct etm_insn_entry *etm_insn_lookup(struct etm_image_cache *cache,
+		uint32_t address, int core_state)
+{
+	unsigned i = etm_insn_hash(address, core_state) & cache->insn_mask;
+
+	/* linear probing; the table is never allowed to fill up */
+	while (cache->insns[i].valid) {
+		if (cache->insns[i].address == address
+				&& cache->insns[i].core_state == core_state)
+			break;
+		i = (i + 1) & cache->insn_mask;
+	}
+
+	return &cache->insns[i];
+}
+
+static int etm_insn_cache_grow(struct etm_image_cache *cache)
+{
+	struct etm_insn_entry *old = cache->insns;
+	unsigned old_size = cache->insn_mask + 1;
+	unsigned i;
+
+	cache->insns = calloc(2 * old_size, sizeof(*cache->insns));
+	if (!cache->insns) {
+		cache->insns = old;
+		return ERROR_FAIL;
+	}
+	cache->insn_mask = 2 * old_size - 1;
+
+	for (i = 0; i < old_size; i++) {
+		if (old[i].valid)
+			*etm_insn_lookup(cache, old[i].address, old[i].core_state) = old[i];
+	}
+
+	free(old);
+	return ERROR_OK;
+}
+
+static int etm_read_instruction(struct etm_context *ctx, struct arm_instruction *instruction)
+{
+	struct etm_image_cache *cache;
+	struct etm_insn_entry *entry;
+	int section;
 	size_t size_read;
 	uint32_t opcode;
 	int retval;
@@ -655,16 +837,20 @@ static int etm_read_instruction(struct etm_context *ctx, struct arm_instruction
 	if (!ctx->image)
 		return ERROR_TRACE_IMAGE_UNAVAILABLE;
 
-	/* search for the section the current instruction belongs to */
-	for (i = 0; i < ctx->image->num_sections; i++) {
-		if ((ctx->image->sections[i].base_address <= ctx->current_pc) &&
-			(ctx->image->sections[i].base_address + ctx->image->sections[i].size >
-			ctx->current_pc)) {
-			section = i;
-			break;
-		}
+	cache = etm_image_cache_get(ctx);
+	if (!cache) {
+		LOG_ERROR("out of memory");
+		return ERROR_FAIL;
+	}
+
+	entry = etm_insn_lookup(cache, ctx->current_pc, ctx->core_state);
+	if (entry->valid) {
+		*instruction = entry->instruction;
+		return ERROR_OK;
 	}
 
+	/* search for the section the current instruction belongs to */
+	section = etm_find_section(cache, ctx->current_pc);
 	if (section == -1) {
 		/* current instruction couldn't be found in the image */
 		return ERROR_TRACE_INSTRUCTION_UNAVAILABLE;
@@ -702,6 +888,19 @@ static int etm_read_instruction(struct etm_context *ctx, struct arm_instruction
 		return ERROR_FAIL;
 	}
 
+	/* keep the load factor below 3/4; if growing fails just skip caching */
+	if (4 * (cache->insn_count + 1) > 3 * (cache->insn_mask + 1)) {
+		if (etm_insn_cache_grow(cache) != ERROR_OK)
+			return ERROR_OK;
+		entry = etm_insn_lookup(cache, ctx->current_pc, ctx->core_state);
+	}
+
+	entry->valid = true;
+	entry->core_state = ctx->core_state;
+	entry->address = ctx->current_pc;
+	entry->instruction = *instruction;
+	cache->insn_count++;
+
 	return ERROR_OK;
 }
 
@@ -1672,6 +1871,8 @@ COMMAND_HANDLER(handle_etm_image_command)
 		return ERROR_FAIL;
 	}
 
+	etm_image_cache_free(etm_ctx);
+
 	if (etm_ctx->image) {
 		image_close(etm_ctx->image);
 		free(etm_ctx->image);
@@ -134,6 +134,7 @@ enum {
 
 /* forward-declare ETM context */
 struct etm_context;
+struct etm_image_cache;
 
 struct etm_capture_driver {
 	const char *name;
@@ -172,6 +173,7 @@ struct etm_context {
 	uint32_t control;	/* shadow of ETM_CTRL */
 	int /*arm_state*/ core_state;	/* current core state */
 	struct image *image;		/* source for target opcodes */
+	struct etm_image_cache *image_cache;	/* section index and decoded opcodes */
 	uint32_t pipe_index;		/* current trace cycle */
 	uint32_t data_index;		/* cycle holding next data packet */
 	bool data_half;			/* port half on a 16 bit port */
@@ -35,6 +35,8 @@
 #include "target.h"
 #include <helper/log.h>
 
+#include <sys/stat.h>
+
 /* convert ELF header field to host endianness */
 #define field16(elf, field) \
 	((elf->endianness == ELFDATA2LSB) ? \
@@ -117,6 +119,78 @@ static int identify_image_type(struct image *image, const char *type_string, con
 	return ERROR_OK;
 }
 
+/* value + 1 of each hex digit character, 0 for anything else */
+static const uint8_t image_hex_digit[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+/**
+ * Decodes @a count bytes written as pairs of hex digits at @a s into
+ * @a buf, and adds them to @a sum.  Returns false if @a s runs out of
+ * hex digits first.
+ */
+static bool image_decode_hex(const char *s, uint8_t *buf, unsigned count,
+		uint8_t *sum)
+{
+	uint8_t cal = *sum;
+
+	for (unsigned i = 0; i < count; i++) {
+		unsigned hi = image_hex_digit[(uint8_t)s[2 * i]];
+		if (!hi)
+			return false;
+		unsigned lo = image_hex_digit[(uint8_t)s[2 * i + 1]];
+		if (!lo)
+			return false;
+
+		buf[i] = ((hi - 1) << 4) | (lo - 1);
+		cal += buf[i];
+	}
+
+	*sum = cal;
+	return true;
+}
+
+/**
+ * Starts a new section at @a address, holding the data stored from
+ * @a data on, unless the current section is still empty; then it just
+ * moves that section to @a address.
+ */
+static int image_new_section(struct image *image, struct imagesection *section,
+		uint8_t *data, uint32_t address)
+{
+	if (section[image->num_sections].size != 0) {
+		image->num_sections++;
+		if (image->num_sections >= IMAGE_MAX_SECTIONS) {
+			/* too many sections */
+			LOG_ERROR("Too many sections found in image file");
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+		section[image->num_sections].size = 0x0;
+		section[image->num_sections].flags = 0;
+		section[image->num_sections].private = data;
+	}
+	section[image->num_sections].base_address = address;
+
+	return ERROR_OK;
+}
+
+/* finish the current section and copy the section table to the image */
+static void image_copy_sections(struct image *image, struct imagesection *section)
+{
+	image->num_sections++;
+
+	image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
+	for (int i = 0; i < image->num_sections; i++) {
+		image->sections[i].private = section[i].private;
+		image->sections[i].base_address = section[i].base_address;
+		image->sections[i].size = section[i].size;
+		image->sections[i].flags = section[i].flags;
+	}
+}
+
 static int image_ihex_buffer_complete_inner(struct image *image,
 	char *lpszLine,
 	struct imagesection *section)
@@ -125,7 +199,6 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 	struct fileio *fileio = &ihex->fileio;
 	uint32_t full_address = 0x0;
 	uint32_t cooked_bytes;
-	int i;
 
 	/* we can't determine the number of sections that we'll have to create ahead of time,
 	 * so we locally hold them until parsing is finished */
@@ -137,6 +210,10 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 		return retval;
 
 	ihex->buffer = malloc(filesize >> 1);
+	if (ihex->buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 	cooked_bytes = 0x0;
 	image->num_sections = 0;
 	section[image->num_sections].private = &ihex->buffer[cooked_bytes];
@@ -145,25 +222,36 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 	section[image->num_sections].flags = 0;
 
 	while (fileio_fgets(fileio, 1023, lpszLine) == ERROR_OK) {
+		uint8_t header[4];
+		uint8_t record[256];
+		uint8_t checksum;
+		uint8_t cal_checksum = 0;
 		uint32_t count;
 		uint32_t address;
 		uint32_t record_type;
-		uint32_t checksum;
-		uint8_t cal_checksum = 0;
-		size_t bytes_read = 0;
 
 		if (lpszLine[0] == '#')
 			continue;
 
-		if (sscanf(&lpszLine[bytes_read], ":%2" SCNx32 "%4" SCNx32 "%2" SCNx32, &count,
-			&address, &record_type) != 3)
+		/* count, address and record type */
+		if (lpszLine[0] != ':' || !image_decode_hex(&lpszLine[1], header, 4, &cal_checksum))
+			return ERROR_IMAGE_FORMAT_ERROR;
+		count = header[0];
+		address = (header[1] << 8) | header[2];
+		record_type = header[3];
+
+		/* data goes straight to the image buffer, anything else is decoded
+		 * to the side; the checksum is summed up on the way */
+		uint8_t *data = record_type == 0 ? &ihex->buffer[cooked_bytes] : record;
+		if (!image_decode_hex(&lpszLine[9], data, count, &cal_checksum)
+				|| !image_decode_hex(&lpszLine[9 + 2 * count], &checksum, 1, &cal_checksum))
 			return ERROR_IMAGE_FORMAT_ERROR;
-		bytes_read += 9;
 
-		cal_checksum += (uint8_t)count;
-		cal_checksum += (uint8_t)(address >> 8);
-		cal_checksum += (uint8_t)address;
-		cal_checksum += (uint8_t)record_type;
+		if (cal_checksum != 0) {
+			/* checksum failed */
+			LOG_ERROR("incorrect record checksum found in IHEX file");
+			return ERROR_IMAGE_CHECKSUM;
+		}
 
 		if (record_type == 0) {	/* Data Record */
 			if ((full_address & 0xffff) != address) {
@@ -171,139 +259,50 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 				 * unless the current section has zero size, in which case this specifies
 				 * the current section's base address
 				 */
-				if (section[image->num_sections].size != 0) {
-					image->num_sections++;
-					if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-						/* too many sections */
-						LOG_ERROR("Too many sections found in IHEX file");
-						return ERROR_IMAGE_FORMAT_ERROR;
-					}
-					section[image->num_sections].size = 0x0;
-					section[image->num_sections].flags = 0;
-					section[image->num_sections].private =
-						&ihex->buffer[cooked_bytes];
-				}
-				section[image->num_sections].base_address =
-					(full_address & 0xffff0000) | address;
 				full_address = (full_address & 0xffff0000) | address;
+				retval = image_new_section(image, section, data, full_address);
+				if (retval != ERROR_OK)
+					return retval;
 			}
 
-			while (count-- > 0) {
-				unsigned value;
-				sscanf(&lpszLine[bytes_read], "%2x", &value);
-				ihex->buffer[cooked_bytes] = (uint8_t)value;
-				cal_checksum += (uint8_t)ihex->buffer[cooked_bytes];
-				bytes_read += 2;
-				cooked_bytes += 1;
-				section[image->num_sections].size += 1;
-				full_address++;
-			}
+			cooked_bytes += count;
+			section[image->num_sections].size += count;
+			full_address += count;
 		} else if (record_type == 1) {	/* End of File Record */
-			/* finish the current section */
-			image->num_sections++;
-
-			/* copy section information */
-			image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
-			for (i = 0; i < image->num_sections; i++) {
-				image->sections[i].private = section[i].private;
-				image->sections[i].base_address = section[i].base_address;
-				image->sections[i].size = section[i].size;
-				image->sections[i].flags = section[i].flags;
-			}
-
+			image_copy_sections(image, section);
 			return ERROR_OK;
-		} else if (record_type == 2) {	/* Linear Address Record */
-			uint16_t upper_address;
+		} else if (record_type == 2 || record_type == 4) {
+			/* Extended Segment (2) or Linear (4) Address Record */
+			unsigned shift = record_type == 2 ? 4 : 16;
 
-			sscanf(&lpszLine[bytes_read], "%4hx", &upper_address);
-			cal_checksum += (uint8_t)(upper_address >> 8);
-			cal_checksum += (uint8_t)upper_address;
-			bytes_read += 4;
+			if (count < 2)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			uint32_t upper_address = (record[0] << 8) | record[1];
 
-			if ((full_address >> 4) != upper_address) {
+			if ((full_address >> shift) != upper_address) {
 				/* we encountered a nonconsecutive location, create a new section,
 				 * unless the current section has zero size, in which case this specifies
 				 * the current section's base address
 				 */
-				if (section[image->num_sections].size != 0) {
-					image->num_sections++;
-					if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-						/* too many sections */
-						LOG_ERROR("Too many sections found in IHEX file");
-						return ERROR_IMAGE_FORMAT_ERROR;
-					}
-					section[image->num_sections].size = 0x0;
-					section[image->num_sections].flags = 0;
-					section[image->num_sections].private =
-						&ihex->buffer[cooked_bytes];
-				}
-				section[image->num_sections].base_address =
-					(full_address & 0xffff) | (upper_address << 4);
-				full_address = (full_address & 0xffff) | (upper_address << 4);
+				full_address = (full_address & 0xffff) | (upper_address << shift);
+				retval = image_new_section(image, section,
+						&ihex->buffer[cooked_bytes], full_address);
+				if (retval != ERROR_OK)
+					return retval;
 			}
 		} else if (record_type == 3) {	/* Start Segment Address Record */
-			uint32_t dummy;
-
 			/* "Start Segment Address Record" will not be supported
 			 * but we must consume it, and do not create an error.  */
-			while (count-- > 0) {
-				sscanf(&lpszLine[bytes_read], "%2" SCNx32, &dummy);
-				cal_checksum += (uint8_t)dummy;
-				bytes_read += 2;
-			}
-		} else if (record_type == 4) {	/* Extended Linear Address Record */
-			uint16_t upper_address;
-
-			sscanf(&lpszLine[bytes_read], "%4hx", &upper_address);
-			cal_checksum += (uint8_t)(upper_address >> 8);
-			cal_checksum += (uint8_t)upper_address;
-			bytes_read += 4;
-
-			if ((full_address >> 16) != upper_address) {
-				/* we encountered a nonconsecutive location, create a new section,
-				 * unless the current section has zero size, in which case this specifies
-				 * the current section's base address
-				 */
-				if (section[image->num_sections].size != 0) {
-					image->num_sections++;
-					if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-						/* too many sections */
-						LOG_ERROR("Too many sections found in IHEX file");
-						return ERROR_IMAGE_FORMAT_ERROR;
-					}
-					section[image->num_sections].size = 0x0;
-					section[image->num_sections].flags = 0;
-					section[image->num_sections].private =
-						&ihex->buffer[cooked_bytes];
-				}
-				section[image->num_sections].base_address =
-					(full_address & 0xffff) | (upper_address << 16);
-				full_address = (full_address & 0xffff) | (upper_address << 16);
-			}
 		} else if (record_type == 5) {	/* Start Linear Address Record */
-			uint32_t start_address;
-
-			sscanf(&lpszLine[bytes_read], "%8" SCNx32, &start_address);
-			cal_checksum += (uint8_t)(start_address >> 24);
-			cal_checksum += (uint8_t)(start_address >> 16);
-			cal_checksum += (uint8_t)(start_address >> 8);
-			cal_checksum += (uint8_t)start_address;
-			bytes_read += 8;
+			if (count < 4)
+				return ERROR_IMAGE_FORMAT_ERROR;
 
 			image->start_address_set = 1;
-			image->start_address = be_to_h_u32((uint8_t *)&start_address);
+			image->start_address = be_to_h_u32(record);
 		} else {
 			LOG_ERROR("unhandled IHEX record type: %i", (int)record_type);
 			return ERROR_IMAGE_FORMAT_ERROR;
 		}
-
-		sscanf(&lpszLine[bytes_read], "%2" SCNx32, &checksum);
-
-		if ((uint8_t)checksum != (uint8_t)(~cal_checksum + 1)) {
-			/* checksum failed */
-			LOG_ERROR("incorrect record checksum found in IHEX file");
-			return ERROR_IMAGE_CHECKSUM;
-		}
 	}
 
 	LOG_ERROR("premature end of IHEX file, no end-of-file record found");
@@ -514,7 +513,6 @@ static int image_mot_buffer_complete_inner(struct image *image,
 	struct fileio *fileio = &mot->fileio;
 	uint32_t full_address = 0x0;
 	uint32_t cooked_bytes;
-	int i;
 
 	/* we can't determine the number of sections that we'll have to create ahead of time,
 	 * so we locally hold them until parsing is finished */
@@ -526,6 +524,10 @@ static int image_mot_buffer_complete_inner(struct image *image,
 		return retval;
 
 	mot->buffer = malloc(filesize >> 1);
+	if (mot->buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 	cooked_bytes = 0x0;
 	image->num_sections = 0;
 	section[image->num_sections].private = &mot->buffer[cooked_bytes];
@@ -534,130 +536,92 @@ static int image_mot_buffer_complete_inner(struct image *image,
 	section[image->num_sections].flags = 0;
 
 	while (fileio_fgets(fileio, 1023, lpszLine) == ERROR_OK) {
-		uint32_t count;
-		uint32_t address;
-		uint32_t record_type;
-		uint32_t checksum;
+		uint8_t record[256];
+		uint8_t checksum;
 		uint8_t cal_checksum = 0;
-		uint32_t bytes_read = 0;
+		uint8_t count;
+		uint32_t record_type;
+		unsigned address_bytes;
 
 		/* get record type and record length */
-		if (sscanf(&lpszLine[bytes_read], "S%1" SCNx32 "%2" SCNx32, &record_type,
-			&count) != 2)
+		if (lpszLine[0] != 'S' || !image_hex_digit[(uint8_t)lpszLine[1]]
+				|| !image_decode_hex(&lpszLine[2], &count, 1, &cal_checksum))
 			return ERROR_IMAGE_FORMAT_ERROR;
+		record_type = image_hex_digit[(uint8_t)lpszLine[1]] - 1;
+
+		switch (record_type) {
+			case 1:
+			case 9:
+				address_bytes = 2;	/* 16 bit address */
+				break;
+			case 2:
+			case 8:
+				address_bytes = 3;	/* 24 bit address */
+				break;
+			case 3:
+			case 7:
+				address_bytes = 4;	/* 32 bit address */
+				break;
+			default:
+				address_bytes = 0;
+				break;
+		}
 
-		bytes_read += 4;
-		cal_checksum += (uint8_t)count;
+		/* the count covers address, data and checksum */
+		if (count < address_bytes + 1)
+			return ERROR_IMAGE_FORMAT_ERROR;
+		unsigned data_bytes = count - address_bytes - 1;
+
+		/* address, then data straight to the image buffer for data
+		 * records; the checksum is summed up on the way */
+		const char *s = &lpszLine[4];
+		uint8_t *data = (record_type >= 1 && record_type <= 3) ?
+			&mot->buffer[cooked_bytes] : &record[address_bytes];
+		if (!image_decode_hex(s, record, address_bytes, &cal_checksum))
+			return ERROR_IMAGE_FORMAT_ERROR;
+		s += 2 * address_bytes;
+		if (!image_decode_hex(s, data, data_bytes, &cal_checksum)
+				|| !image_decode_hex(s + 2 * data_bytes, &checksum, 1, &cal_checksum))
+			return ERROR_IMAGE_FORMAT_ERROR;
 
-		/* skip checksum byte */
-		count -= 1;
+		if (cal_checksum != 0xFF) {
+			/* checksum failed */
+			LOG_ERROR("incorrect record checksum found in S19 file");
+			return ERROR_IMAGE_CHECKSUM;
+		}
 
 		if (record_type == 0) {
 			/* S0 - starting record (optional) */
-			int iValue;
-
-			while (count-- > 0) {
-				sscanf(&lpszLine[bytes_read], "%2x", &iValue);
-				cal_checksum += (uint8_t)iValue;
-				bytes_read += 2;
-			}
 		} else if (record_type >= 1 && record_type <= 3) {
-			switch (record_type) {
-				case 1:
-					/* S1 - 16 bit address data record */
-					sscanf(&lpszLine[bytes_read], "%4" SCNx32, &address);
-					cal_checksum += (uint8_t)(address >> 8);
-					cal_checksum += (uint8_t)address;
-					bytes_read += 4;
-					count -= 2;
-					break;
-
-				case 2:
-					/* S2 - 24 bit address data record */
-					sscanf(&lpszLine[bytes_read], "%6" SCNx32, &address);
-					cal_checksum += (uint8_t)(address >> 16);
-					cal_checksum += (uint8_t)(address >> 8);
-					cal_checksum += (uint8_t)address;
-					bytes_read += 6;
-					count -= 3;
-					break;
-
-				case 3:
-					/* S3 - 32 bit address data record */
-					sscanf(&lpszLine[bytes_read], "%8" SCNx32, &address);
-					cal_checksum += (uint8_t)(address >> 24);
-					cal_checksum += (uint8_t)(address >> 16);
-					cal_checksum += (uint8_t)(address >> 8);
-					cal_checksum += (uint8_t)address;
-					bytes_read += 8;
-					count -= 4;
-					break;
-
-			}
+			/* S1, S2, S3 - data records with 16, 24 and 32 bit address */
+			uint32_t address = 0;
+			for (unsigned i = 0; i < address_bytes; i++)
+				address = (address << 8) | record[i];
 
 			if (full_address != address) {
 				/* we encountered a nonconsecutive location, create a new section,
 				 * unless the current section has zero size, in which case this specifies
 				 * the current section's base address
 				 */
-				if (section[image->num_sections].size != 0) {
-					image->num_sections++;
-					section[image->num_sections].size = 0x0;
-					section[image->num_sections].flags = 0;
-					section[image->num_sections].private =
-						&mot->buffer[cooked_bytes];
-				}
-				section[image->num_sections].base_address = address;
+				retval = image_new_section(image, section, data, address);
+				if (retval != ERROR_OK)
+					return retval;
 				full_address = address;
 			}
 
-			while (count-- > 0) {
-				unsigned value;
-				sscanf(&lpszLine[bytes_read], "%2x", &value);
-				mot->buffer[cooked_bytes] = (uint8_t)value;
-				cal_checksum += (uint8_t)mot->buffer[cooked_bytes];
-				bytes_read += 2;
-				cooked_bytes += 1;
-				section[image->num_sections].size += 1;
-				full_address++;
-			}
+			cooked_bytes += data_bytes;
+			section[image->num_sections].size += data_bytes;
+			full_address += data_bytes;
 		} else if (record_type == 5) {
 			/* S5 is the data count record, we ignore it */
-			uint32_t dummy;
-
-			while (count-- > 0) {
-				sscanf(&lpszLine[bytes_read], "%2" SCNx32, &dummy);
-				cal_checksum += (uint8_t)dummy;
-				bytes_read += 2;
-			}
 		} else if (record_type >= 7 && record_type <= 9) {
 			/* S7, S8, S9 - ending records for 32, 24 and 16bit */
-			image->num_sections++;
-
-			/* copy section information */
-			image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
-			for (i = 0; i < image->num_sections; i++) {
-				image->sections[i].private = section[i].private;
-				image->sections[i].base_address = section[i].base_address;
-				image->sections[i].size = section[i].size;
-				image->sections[i].flags = section[i].flags;
-			}
-
+			image_copy_sections(image, section);
 			return ERROR_OK;
 		} else {
 			LOG_ERROR("unhandled S19 record type: %i", (int)(record_type));
 			return ERROR_IMAGE_FORMAT_ERROR;
 		}
-
-		/* account for checksum, will always be 0xFF */
-		sscanf(&lpszLine[bytes_read], "%2" SCNx32, &checksum);
-		cal_checksum += (uint8_t)checksum;
-
-		if (cal_checksum != 0xFF) {
-			/* checksum failed */
-			LOG_ERROR("incorrect record checksum found in S19 file");
-			return ERROR_IMAGE_CHECKSUM;
-		}
 	}
 
 	LOG_ERROR("premature end of S19 file, no end-of-file record found");
@@ -691,6 +655,216 @@ static int image_mot_buffer_complete(struct image *image)
 	return retval;
 }
 
+/*
+ * Parsed IHEX and S19 images are kept in a cache, so that opening the
+ * same unchanged file again (load_image, verify_image and flash
+ * write_image on the same file) does not parse it again.  A file is
+ * identified by its name, device, inode, size and modification time.
+ * Entries are kept most recently used first and are shared by all open
+ * images using them.
+ */
+struct image_file_id {
+	bool valid;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+};
+
+struct image_cache_entry {
+	struct image_cache_entry *next;
+	char *url;
+	enum image_type type;
+	struct image_file_id id;
+	uint8_t *buffer;
+	uint32_t data_size;		/* bytes of section data */
+	int num_sections;
+	struct imagesection *sections;
+	int start_address_set;
+	uint32_t start_address;
+	int refcount;			/* images using the entry */
+	bool flushed;			/* no longer listed, free on release */
+};
+
+static struct image_cache_entry *image_cache;
+static uint32_t image_cache_size;
+static uint32_t image_cache_limit = 16 * 1024 * 1024;
+
+static void image_file_id(const char *url, struct image_file_id *id)
+{
+	struct stat st;
+
+	id->valid = stat(url, &st) == 0 && S_ISREG(st.st_mode);
+	if (!id->valid)
+		return;
+
+	id->dev = st.st_dev;
+	id->ino = st.st_ino;
+	id->size = st.st_size;
+	id->mtime = st.st_mtime;
+}
+
+static void image_cache_free_entry(struct image_cache_entry *entry)
+{
+	free(entry->url);
+	free(entry->buffer);
+	free(entry->sections);
+	free(entry);
+}
+
+static void image_cache_unlink(struct image_cache_entry *entry)
+{
+	struct image_cache_entry **p;
+
+	for (p = &image_cache; *p; p = &(*p)->next) {
+		if (*p == entry) {
+			*p = entry->next;
+			image_cache_size -= entry->data_size;
+			return;
+		}
+	}
+}
+
+/* drop least recently used entries no image is using until the cache
+ * fits its limit */
+static void image_cache_trim(void)
+{
+	while (image_cache_size > image_cache_limit) {
+		struct image_cache_entry *entry, *victim = NULL;
+
+		for (entry = image_cache; entry; entry = entry->next) {
+			if (entry->refcount == 0)
+				victim = entry;
+		}
+		if (!victim)
+			return;
+
+		LOG_DEBUG("dropping cached image %s", victim->url);
+		image_cache_unlink(victim);
+		image_cache_free_entry(victim);
+	}
+}
+
+static void image_cache_flush(void)
+{
+	while (image_cache) {
+		struct image_cache_entry *entry = image_cache;
+
+		image_cache_unlink(entry);
+		if (entry->refcount)
+			entry->flushed = true;
+		else
+			image_cache_free_entry(entry);
+	}
+}
+
+/**
+ * Sets up @a image from a cached parse of @a url, if there is one.
+ * Returns the entry the image now holds a reference to, or NULL.
+ */
+static struct image_cache_entry *image_cache_get(struct image *image,
+		const char *url, const struct image_file_id *id)
+{
+	struct image_cache_entry *entry;
+
+	if (!id->valid)
+		return NULL;
+
+	for (entry = image_cache; entry; entry = entry->next) {
+		if (entry->type == image->type
+				&& entry->id.dev == id->dev
+				&& entry->id.ino == id->ino
+				&& entry->id.size == id->size
+				&& entry->id.mtime == id->mtime
+				&& !strcmp(entry->url, url))
+			break;
+	}
+	if (!entry)
+		return NULL;
+
+	image->sections = malloc(sizeof(struct imagesection) * entry->num_sections);
+	if (!image->sections)
+		return NULL;
+	memcpy(image->sections, entry->sections,
+			sizeof(struct imagesection) * entry->num_sections);
+	image->num_sections = entry->num_sections;
+	if (entry->start_address_set) {
+		image->start_address_set = 1;
+		image->start_address = entry->start_address;
+	}
+
+	/* move to the front */
+	image_cache_unlink(entry);
+	entry->next = image_cache;
+	image_cache = entry;
+	image_cache_size += entry->data_size;
+
+	entry->refcount++;
+	LOG_DEBUG("using cached image %s", url);
+	return entry;
+}
+
+/**
+ * Adds the freshly parsed @a image to the cache.  On success the cache
+ * takes over @a buffer, which all section data points into, and the
+ * entry is returned with a reference held by @a image.
+ */
+static struct image_cache_entry *image_cache_put(struct image *image,
+		const char *url, const struct image_file_id *id, uint8_t **buffer)
+{
+	struct image_cache_entry *entry;
+	uint32_t data_size = 0;
+
+	if (!id->valid || image_cache_limit == 0)
+		return NULL;
+
+	for (int i = 0; i < image->num_sections; i++)
+		data_size += image->sections[i].size;
+	if (data_size > image_cache_limit)
+		return NULL;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return NULL;
+	entry->url = strdup(url);
+	entry->sections = malloc(sizeof(struct imagesection) * image->num_sections);
+	if (!entry->url || !entry->sections) {
+		image_cache_free_entry(entry);
+		return NULL;
+	}
+
+	memcpy(entry->sections, image->sections,
+			sizeof(struct imagesection) * image->num_sections);
+	entry->num_sections = image->num_sections;
+	entry->type = image->type;
+	entry->id = *id;
+	entry->start_address_set = image->start_address_set;
+	entry->start_address = image->start_address;
+	entry->data_size = data_size;
+	entry->refcount = 1;
+	entry->buffer = *buffer;
+	*buffer = NULL;
+
+	entry->next = image_cache;
+	image_cache = entry;
+	image_cache_size += data_size;
+	image_cache_trim();
+
+	return entry;
+}
+
+static void image_cache_release(struct image_cache_entry *entry)
+{
+	entry->refcount--;
+	if (entry->refcount)
+		return;
+
+	if (entry->flushed)
+		image_cache_free_entry(entry);
+	else
+		image_cache_trim();
+}
+
 int image_open(struct image *image, const char *url, const char *type_string)
 {
 	int retval = ERROR_OK;
@@ -723,17 +897,28 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		struct image_ihex *image_ihex;
 
 		image_ihex = image->type_private = malloc(sizeof(struct image_ihex));
+		image_ihex->buffer = NULL;
+
+		struct image_file_id id;
+		image_file_id(url, &id);
+		image_ihex->cached = image_cache_get(image, url, &id);
+		if (!image_ihex->cached) {
+			retval = fileio_open(&image_ihex->fileio, url, FILEIO_READ, FILEIO_TEXT);
+			if (retval != ERROR_OK)
+				return retval;
+
+			retval = image_ihex_buffer_complete(image);
+			if (retval != ERROR_OK) {
+				LOG_ERROR(
+					"failed buffering IHEX image, check daemon output for additional information");
+				fileio_close(&image_ihex->fileio);
+				return retval;
+			}
 
-		retval = fileio_open(&image_ihex->fileio, url, FILEIO_READ, FILEIO_TEXT);
-		if (retval != ERROR_OK)
-			return retval;
-
-		retval = image_ihex_buffer_complete(image);
-		if (retval != ERROR_OK) {
-			LOG_ERROR(
-				"failed buffering IHEX image, check daemon output for additional information");
-			fileio_close(&image_ihex->fileio);
-			return retval;
+			/* the parsed data is all that is needed from now on */
+			image_ihex->cached = image_cache_put(image, url, &id, &image_ihex->buffer);
+			if (image_ihex->cached)
+				fileio_close(&image_ihex->fileio);
 		}
 	} else if (image->type == IMAGE_ELF) {
 		struct image_elf *image_elf;
@@ -774,17 +959,28 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		struct image_mot *image_mot;
 
 		image_mot = image->type_private = malloc(sizeof(struct image_mot));
+		image_mot->buffer = NULL;
+
+		struct image_file_id id;
+		image_file_id(url, &id);
+		image_mot->cached = image_cache_get(image, url, &id);
+		if (!image_mot->cached) {
+			retval = fileio_open(&image_mot->fileio, url, FILEIO_READ, FILEIO_TEXT);
+			if (retval != ERROR_OK)
+				return retval;
+
+			retval = image_mot_buffer_complete(image);
+			if (retval != ERROR_OK) {
+				LOG_ERROR(
+					"failed buffering S19 image, check daemon output for additional information");
+				fileio_close(&image_mot->fileio);
+				return retval;
+			}
 
-		retval = fileio_open(&image_mot->fileio, url, FILEIO_READ, FILEIO_TEXT);
-		if (retval != ERROR_OK)
-			return retval;
-
-		retval = image_mot_buffer_complete(image);
-		if (retval != ERROR_OK) {
-			LOG_ERROR(
-				"failed buffering S19 image, check daemon output for additional information");
-			fileio_close(&image_mot->fileio);
-			return retval;
+			/* the parsed data is all that is needed from now on */
+			image_mot->cached = image_cache_put(image, url, &id, &image_mot->buffer);
+			if (image_mot->cached)
+				fileio_close(&image_mot->fileio);
 		}
 	} else if (image->type == IMAGE_BUILDER) {
 		image->num_sections = 0;
@@ -902,6 +1098,17 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+/* allocated size of an image builder section buffer holding @a size bytes */
+static uint32_t image_builder_capacity(uint32_t size)
+{
+	uint32_t capacity = 256;
+
+	while (capacity < size && capacity < 0x80000000)
+		capacity <<= 1;
+
+	return capacity < size ? size : capacity;
+}
+
 int image_add_section(struct image *image, uint32_t base, uint32_t size, int flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -918,7 +1125,18 @@ int image_add_section(struct image *image, uint32_t base, uint32_t size, int fla
 		 * adding data to previous sections or merging is not supported */
 		if (((section->base_address + section->size) == base) &&
 			(section->flags == flags)) {
-			section->private = realloc(section->private, section->size + size);
+			/* section buffers grow in powers of two, so that a section
+			 * built from many small pieces is not copied over and over */
+			if (image_builder_capacity(section->size + size) >
+					image_builder_capacity(section->size)) {
+				void *buf = realloc(section->private,
+						image_builder_capacity(section->size + size));
+				if (buf == NULL) {
+					LOG_ERROR("Out of memory");
+					return ERROR_FAIL;
+				}
+				section->private = buf;
+			}
 			memcpy((uint8_t *)section->private + section->size, data, size);
 			section->size += size;
 			return ERROR_OK;
@@ -933,7 +1151,7 @@ int image_add_section(struct image *image, uint32_t base, uint32_t size, int fla
 	section->base_address = base;
 	section->size = size;
 	section->flags = flags;
-	section->private = malloc(sizeof(uint8_t) * size);
+	section->private = malloc(image_builder_capacity(size));
 	memcpy((uint8_t *)section->private, data, size);
 
 	return ERROR_OK;
@@ -948,7 +1166,10 @@ void image_close(struct image *image)
 	} else if (image->type == IMAGE_IHEX) {
 		struct image_ihex *image_ihex = image->type_private;
 
-		fileio_close(&image_ihex->fileio);
+		if (image_ihex->cached)
+			image_cache_release(image_ihex->cached);
+		else
+			fileio_close(&image_ihex->fileio);
 
 		if (image_ihex->buffer) {
 			free(image_ihex->buffer);
@@ -978,7 +1199,10 @@ void image_close(struct image *image)
 	} else if (image->type == IMAGE_SRECORD) {
 		struct image_mot *image_mot = image->type_private;
 
-		fileio_close(&image_mot->fileio);
+		if (image_mot->cached)
+			image_cache_release(image_mot->cached);
+		else
+			fileio_close(&image_mot->fileio);
 
 		if (image_mot->buffer) {
 			free(image_mot->buffer);
@@ -1043,3 +1267,59 @@ int image_calculate_checksum(uint8_t *buffer, uint32_t nbytes, uint32_t *checksu
 	*checksum = crc;
 	return ERROR_OK;
 }
+
+COMMAND_HANDLER(handle_image_cache_limit_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned kbytes;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], kbytes);
+		if (kbytes > UINT32_MAX / 1024)
+			return ERROR_COMMAND_ARGUMENT_OVERFLOW;
+
+		image_cache_limit = kbytes * 1024;
+		if (image_cache_limit == 0)
+			image_cache_flush();
+		else
+			image_cache_trim();
+	}
+
+	command_print(CMD_CTX, "image cache limit %" PRIu32 " kB, %" PRIu32 " kB in use",
+			image_cache_limit / 1024, DIV_ROUND_UP(image_cache_size, 1024));
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_image_cache_flush_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	image_cache_flush();
+	return ERROR_OK;
+}
+
+static const struct command_registration image_command_handlers[] = {
+	{
+		.name = "image_cache_limit",
+		.handler = handle_image_cache_limit_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or set the memory limit of the cache of "
+			"parsed IHEX and S19 images; 0 disables the cache",
+		.usage = "[kbytes]",
+	},
+	{
+		.name = "image_cache_flush",
+		.handler = handle_image_cache_flush_command,
+		.mode = COMMAND_ANY,
+		.help = "Forget all cached IHEX and S19 images",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int image_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, image_command_handlers);
+}
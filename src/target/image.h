@@ -72,6 +72,7 @@ struct image_binary {
 struct image_ihex {
 	struct fileio fileio;
 	uint8_t *buffer;
+	struct image_cache_entry *cached;	/* shared parse result, if any */
 };
 
 struct image_memory {
@@ -91,6 +92,7 @@ struct image_elf {
 struct image_mot {
 	struct fileio fileio;
 	uint8_t *buffer;
+	struct image_cache_entry *cached;	/* shared parse result, if any */
 };
 
 int image_open(struct image *image, const char *url, const char *type_string);
@@ -104,6 +106,9 @@ int image_add_section(struct image *image, uint32_t base, uint32_t size,
 int image_calculate_checksum(uint8_t *buffer, uint32_t nbytes,
 		uint32_t *checksum);
 
+struct command_context;
+int image_register_commands(struct command_context *cmd_ctx);
+
 #define ERROR_IMAGE_FORMAT_ERROR	(-1400)
 #define ERROR_IMAGE_TYPE_UNKNOWN	(-1401)
 #define ERROR_IMAGE_TEMPORARILY_UNAVAILABLE		(-1402)
@@ -44,6 +44,7 @@
 #endif
 
 #include <helper/time_support.h>
+#include <helper/sha256.h>
 #include <jtag/jtag.h>
 #include <flash/nor/core.h>
 
@@ -53,6 +54,7 @@
 #include "breakpoints.h"
 #include "register.h"
 #include "trace.h"
+#include "coverage.h"
 #include "image.h"
 #include "rtos/rtos.h"
 #include "transport/transport.h"
@@ -504,6 +506,8 @@ int target_poll(struct target *target)
 	if (retval != ERROR_OK)
 		return retval;
 
+	coverage_poll(target);
+
 	if (target->halt_issued) {
 		if (target->state == TARGET_HALTED)
 			target->halt_issued = false;
@@ -848,6 +852,33 @@ done:
 	return retval;
 }
 
+/**
+ * Writes @a size bytes of @a buffer to an async flash algorithm's fifo at
+ * @a address, then @a wp to the write pointer at @a wp_addr, and reads back
+ * the read pointer at @a rp_addr.  Targets which can batch the three
+ * accesses into a single transport round trip provide refill_fifo().
+ */
+static int target_refill_fifo(struct target *target, uint32_t address,
+		uint32_t size, const uint8_t *buffer, uint32_t wp_addr, uint32_t wp,
+		uint32_t rp_addr, uint32_t *rp)
+{
+	int retval;
+
+	if (target->type->refill_fifo)
+		return target->type->refill_fifo(target, address, size, buffer,
+				wp_addr, wp, rp_addr, rp);
+
+	retval = target_write_buffer(target, address, size, buffer);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_write_u32(target, wp_addr, wp);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return target_read_u32(target, rp_addr, rp);
+}
+
 /**
  * Executes a target-specific native code algorithm in the target.
  * It differs from target_run_algorithm in that the algorithm is asynchronous.
@@ -863,9 +894,28 @@ int target_run_flash_async_algorithm(struct target *target,
 		int num_reg_params, struct reg_param *reg_params,
 		uint32_t buffer_start, uint32_t buffer_size,
 		uint32_t entry_point, uint32_t exit_point, void *arch_info)
+{
+	return target_run_flash_async_algorithm_timeout(target, buffer, count,
+			block_size, num_mem_params, mem_params, num_reg_params, reg_params,
+			buffer_start, buffer_size, entry_point, exit_point, 5000, arch_info);
+}
+
+/**
+ * Like target_run_flash_async_algorithm(), for algorithms which may
+ * consume no data for longer than the usual 5 s, e.g. while erasing.
+ *
+ * @param timeout_ms how long the algorithm may go without draining the
+ * fifo before it is aborted
+ */
+int target_run_flash_async_algorithm_timeout(struct target *target,
+		const uint8_t *buffer, uint32_t count, int block_size,
+		int num_mem_params, struct mem_param *mem_params,
+		int num_reg_params, struct reg_param *reg_params,
+		uint32_t buffer_start, uint32_t buffer_size,
+		uint32_t entry_point, uint32_t exit_point, int timeout_ms,
+		void *arch_info)
 {
 	int retval;
-	int timeout = 0;
 
 	const uint8_t *buffer_orig = buffer;
 
@@ -901,28 +951,50 @@ int target_run_flash_async_algorithm(struct target *target,
 		return retval;
 	}
 
+	/* statistics, and the algorithm's drain rate for throttling */
+	int64_t start_ms = timeval_ms();
+	int64_t progress_ms = start_ms;
+	uint32_t fifo_size = fifo_end_addr - fifo_start_addr;
+	uint64_t drained = 0;
+	unsigned refills = 0;
+	unsigned polls = 0;
+
+	/* rp_next holds a read pointer fetched together with the last refill */
+	uint32_t rp_next = rp;
+	bool rp_fresh = true;
+
 	while (count > 0) {
 
-		retval = target_read_u32(target, rp_addr, &rp);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("failed to get read pointer");
-			break;
+		if (!rp_fresh) {
+			retval = target_read_u32(target, rp_addr, &rp_next);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("failed to get read pointer");
+				break;
+			}
+			polls++;
 		}
+		rp_fresh = false;
 
 		LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
-			(size_t) (buffer - buffer_orig), count, wp, rp);
+			(size_t) (buffer - buffer_orig), count, wp, rp_next);
 
-		if (rp == 0) {
+		if (rp_next == 0) {
 			LOG_ERROR("flash write algorithm aborted by target");
 			retval = ERROR_FLASH_OPERATION_FAILED;
 			break;
 		}
 
-		if ((rp & (block_size - 1)) || rp < fifo_start_addr || rp >= fifo_end_addr) {
-			LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp);
+		if (((rp_next - fifo_start_addr) & (block_size - 1)) || rp_next < fifo_start_addr || rp_next >= fifo_end_addr) {
+			LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp_next);
 			break;
 		}
 
+		if (rp_next != rp) {
+			drained += (rp_next - rp + fifo_size) % fifo_size;
+			progress_ms = timeval_ms();
+			rp = rp_next;
+		}
+
 		/* Count the number of bytes available in the fifo without
 		 * crossing the wrap around. Make sure to not fill it completely,
 		 * because that would make wp == rp and that's the empty condition. */
@@ -935,55 +1007,73 @@ int target_run_flash_async_algorithm(struct target *target,
 			thisrun_bytes = fifo_end_addr - wp - block_size;
 
 		if (thisrun_bytes == 0) {
-			/* Throttle polling a bit if transfer is (much) faster than flash
-			 * programming. The exact delay shouldn't matter as long as it's
-			 * less than buffer size / flash speed. This is very unlikely to
-			 * run when using high latency connections such as USB. */
-			alive_sleep(10);
+			int64_t now = timeval_ms();
 
-			/* to stop an infinite loop on some targets check and increment a timeout
+			/* to stop an infinite loop on some targets check for a timeout
 			 * this issue was observed on a stellaris using the new ICDI interface */
-			if (timeout++ >= 500) {
+			if (now - progress_ms >= timeout_ms) {
 				LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
-				return ERROR_FLASH_OPERATION_FAILED;
+				retval = ERROR_FLASH_OPERATION_FAILED;
+				break;
 			}
+
+			/* The fifo is full.  Wait about as long as the algorithm needs
+			 * to drain a quarter of it, going by its rate so far, but no
+			 * more than 10 ms.  High latency adapters (USB) never sleep,
+			 * the read pointer poll alone takes long enough. */
+			int64_t wait_ms = 10;
+			if (drained)
+				wait_ms = (now - start_ms) * (fifo_size / 4) / drained;
+			if (wait_ms > 10)
+				wait_ms = 10;
+
+			if (wait_ms > 0)
+				alive_sleep(wait_ms);
+			else
+				keep_alive();
 			continue;
 		}
 
-		/* reset our timeout */
-		timeout = 0;
-
 		/* Limit to the amount of data we actually want to write */
 		if (thisrun_bytes > count * block_size)
 			thisrun_bytes = count * block_size;
 
-		/* Write data to fifo */
-		retval = target_write_buffer(target, wp, thisrun_bytes, buffer);
+		/* Update counters and wrap write pointer */
+		uint32_t new_wp = wp + thisrun_bytes;
+		if (new_wp >= fifo_end_addr)
+			new_wp = fifo_start_addr;
+
+		/* Write data to fifo, store the updated write pointer to target
+		 * and fetch the read pointer for the next round */
+		retval = target_refill_fifo(target, wp, thisrun_bytes, buffer,
+				wp_addr, new_wp, rp_addr, &rp_next);
 		if (retval != ERROR_OK)
 			break;
+		rp_fresh = true;
+		refills++;
 
-		/* Update counters and wrap write pointer */
 		buffer += thisrun_bytes;
 		count -= thisrun_bytes / block_size;
-		wp += thisrun_bytes;
-		if (wp >= fifo_end_addr)
-			wp = fifo_start_addr;
-
-		/* Store updated write pointer to target */
-		retval = target_write_u32(target, wp_addr, wp);
-		if (retval != ERROR_OK)
-			break;
+		wp = new_wp;
 	}
 
+	int64_t elapsed_ms = timeval_ms() - start_ms;
+	LOG_DEBUG("flash write algorithm: %zu bytes in %" PRId64 " ms (%" PRId64 " kB/s), "
+			"%u refills, %u polls",
+			(size_t) (buffer - buffer_orig), elapsed_ms,
+			elapsed_ms ? (int64_t) (buffer - buffer_orig) / elapsed_ms : 0,
+			refills, polls);
+
 	if (retval != ERROR_OK) {
 		/* abort flash write algorithm on target */
 		target_write_u32(target, wp_addr, 0);
 	}
 
+	/* the algorithm may still be busy with the last of the fifo */
 	int retval2 = target_wait_algorithm(target, num_mem_params, mem_params,
 			num_reg_params, reg_params,
 			exit_point,
-			10000,
+			timeout_ms > 5000 ? timeout_ms + 5000 : 10000,
 			arch_info);
 
 	if (retval2 != ERROR_OK) {
@@ -1039,6 +1129,33 @@ int target_write_phys_memory(struct target *target,
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
+int target_memory_sequence(struct target *target,
+		struct target_memory_op *ops, int num_ops)
+{
+	int retval = ERROR_OK;
+
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (target->type->memory_sequence)
+		return target->type->memory_sequence(target, ops, num_ops);
+
+	for (int i = 0; i < num_ops && retval == ERROR_OK; i++) {
+		struct target_memory_op *op = &ops[i];
+
+		if (op->write)
+			retval = target_write_memory(target, op->address,
+					op->size, op->count, op->write);
+		else
+			retval = target_read_memory(target, op->address,
+					op->size, op->count, op->read);
+	}
+
+	return retval;
+}
+
 int target_add_breakpoint(struct target *target,
 		struct breakpoint *breakpoint)
 {
@@ -1075,6 +1192,38 @@ int target_remove_breakpoint(struct target *target,
 	return target->type->remove_breakpoint(target, breakpoint);
 }
 
+int target_add_breakpoints(struct target *target,
+		struct breakpoint **breakpoints, int count, int *results)
+{
+	int i;
+
+	/* the batched path is for halted targets only, let
+	 * target_add_breakpoint() sort out the running case */
+	if (target->type->add_breakpoints == NULL || target->state != TARGET_HALTED) {
+		for (i = 0; i < count; i++)
+			results[i] = target_add_breakpoint(target, breakpoints[i]);
+		return ERROR_OK;
+	}
+
+	return target->type->add_breakpoints(target, breakpoints, count, results);
+}
+
+int target_remove_breakpoints(struct target *target,
+		struct breakpoint **breakpoints, int count)
+{
+	int i, retval = ERROR_OK;
+
+	if (target->type->remove_breakpoints)
+		return target->type->remove_breakpoints(target, breakpoints, count);
+
+	for (i = 0; i < count; i++) {
+		int r = target_remove_breakpoint(target, breakpoints[i]);
+		if (retval == ERROR_OK)
+			retval = r;
+	}
+	return retval;
+}
+
 int target_add_watchpoint(struct target *target,
 		struct watchpoint *watchpoint)
 {
@@ -1409,6 +1558,11 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 	struct target_event_callback *next_callback;
 
 	if (event == TARGET_EVENT_HALTED) {
+		/* halts on coverage breakpoints are not reported, the target
+		 * is resumed from target_poll() */
+		if (coverage_claim_halt(target))
+			return ERROR_OK;
+
 		/* execute early halted first */
 		target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
 	}
@@ -2058,6 +2212,60 @@ int target_checksum_memory(struct target *target, uint32_t address, uint32_t siz
 	return retval;
 }
 
+int target_sha256_memory(struct target *target, uint32_t address, uint32_t size, uint8_t *digest)
+{
+	struct sha256_ctx ctx;
+	uint32_t blocks = size / SHA256_BLOCK_SIZE;
+	uint8_t *buffer;
+	int retval;
+
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	sha256_init(&ctx);
+
+	/* whole blocks on the target if it can, the rest on the host */
+	if (blocks && target->type->sha256_memory) {
+		retval = target->type->sha256_memory(target, address, blocks, ctx.state);
+		if (retval == ERROR_OK) {
+			ctx.length = blocks * SHA256_BLOCK_SIZE;
+			address += blocks * SHA256_BLOCK_SIZE;
+			size -= blocks * SHA256_BLOCK_SIZE;
+		} else {
+			LOG_DEBUG("target sha256 failed, reading memory instead");
+			sha256_init(&ctx);
+		}
+	}
+
+	uint32_t chunk = MIN(size, 64 * 1024u);
+	buffer = malloc(MAX(chunk, 1u));
+	if (buffer == NULL) {
+		LOG_ERROR("error allocating buffer for section (%d bytes)", (int)chunk);
+		return ERROR_FAIL;
+	}
+
+	retval = ERROR_OK;
+	while (size > 0) {
+		uint32_t n = MIN(size, chunk);
+
+		retval = target_read_buffer(target, address, n, buffer);
+		if (retval != ERROR_OK)
+			break;
+		sha256_update(&ctx, buffer, n);
+		address += n;
+		size -= n;
+		keep_alive();
+	}
+	free(buffer);
+
+	if (retval == ERROR_OK)
+		sha256_final(&ctx, digest);
+
+	return retval;
+}
+
 int target_blank_check_memory(struct target *target, uint32_t address, uint32_t size, uint32_t* blank)
 {
 	int retval;
@@ -3243,7 +3451,10 @@ static COMMAND_HELPER(handle_verify_image_command_internal, int verify)
 				break;
 			}
 
-			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
+			/* flash written or erased in this session is known already */
+			retval = flash_shadow_checksum(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
+			if (retval != ERROR_OK)
+				retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3323,6 +3534,56 @@ COMMAND_HANDLER(handle_test_image_command)
 	return CALL_COMMAND_HANDLER(handle_verify_image_command_internal, 0);
 }
 
+COMMAND_HANDLER(handle_checksum_memory_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	bool sha256 = false;
+	uint32_t address, size;
+	int retval;
+
+	if (CMD_ARGC == 3) {
+		if (strcmp(CMD_ARGV[0], "sha256") == 0)
+			sha256 = true;
+		else if (strcmp(CMD_ARGV[0], "crc32") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		CMD_ARGC--;
+		CMD_ARGV++;
+	}
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+
+	struct duration bench;
+	duration_start(&bench);
+
+	char result[2 * SHA256_DIGEST_SIZE + 1];
+	if (sha256) {
+		uint8_t digest[SHA256_DIGEST_SIZE];
+
+		retval = target_sha256_memory(target, address, size, digest);
+		if (retval == ERROR_OK) {
+			for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+				sprintf(result + 2 * i, "%02x", digest[i]);
+		}
+	} else {
+		uint32_t crc;
+
+		retval = target_checksum_memory(target, address, size, &crc);
+		if (retval == ERROR_OK)
+			sprintf(result, "0x%08" PRIx32, crc);
+	}
+
+	if ((retval == ERROR_OK) && (duration_measure(&bench) == ERROR_OK)) {
+		command_print(CMD_CTX, "%s: %s (%" PRIu32 " bytes in %fs, %0.3f KiB/s)",
+				sha256 ? "sha256" : "crc32", result, size,
+				duration_elapsed(&bench), duration_kbps(&bench, size));
+	}
+
+	return retval;
+}
+
 static int handle_bp_command_list(struct command_context *cmd_ctx)
 {
 	struct target *target = get_current_target(cmd_ctx);
@@ -3461,6 +3722,73 @@ COMMAND_HANDLER(handle_rbp_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_bp_multi_command)
+{
+	enum breakpoint_type type = BKPT_SOFT;
+	unsigned argc = CMD_ARGC;
+	uint64_t *addresses;
+	uint32_t length;
+	unsigned i;
+	int retval;
+
+	if (argc > 0 && strcmp(CMD_ARGV[argc - 1], "hw") == 0) {
+		type = BKPT_HARD;
+		argc--;
+	}
+	if (argc < 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], length);
+
+	addresses = malloc((argc - 1) * sizeof(*addresses));
+	if (!addresses)
+		return ERROR_FAIL;
+
+	for (i = 1; i < argc; i++) {
+		retval = parse_u64(CMD_ARGV[i], &addresses[i - 1]);
+		if (retval != ERROR_OK) {
+			command_print(CMD_CTX, "invalid address: %s", CMD_ARGV[i]);
+			free(addresses);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
+
+	struct target *target = get_current_target(CMD_CTX);
+	retval = breakpoint_add_multiple(target, addresses, argc - 1, length, type);
+	free(addresses);
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_rbp_multi_command)
+{
+	uint64_t *addresses;
+	unsigned i;
+	int retval;
+
+	if (CMD_ARGC < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	addresses = malloc(CMD_ARGC * sizeof(*addresses));
+	if (!addresses)
+		return ERROR_FAIL;
+
+	for (i = 0; i < CMD_ARGC; i++) {
+		retval = parse_u64(CMD_ARGV[i], &addresses[i]);
+		if (retval != ERROR_OK) {
+			command_print(CMD_CTX, "invalid address: %s", CMD_ARGV[i]);
+			free(addresses);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
+
+	struct target *target = get_current_target(CMD_CTX);
+	breakpoint_remove_multiple(target, addresses, CMD_ARGC);
+	free(addresses);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_wp_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -5198,6 +5526,7 @@ static int target_create(Jim_GetOptInfo *goi)
 	target->debug_reason        = DBG_REASON_UNDEFINED;
 	target->reg_cache           = NULL;
 	target->breakpoints         = NULL;
+	target->breakpoint_index    = NULL;
 	target->watchpoints         = NULL;
 	target->next                = NULL;
 	target->arch_info           = NULL;
@@ -5218,6 +5547,8 @@ static int target_create(Jim_GetOptInfo *goi)
 
 	target->dbgmsg          = NULL;
 	target->dbg_msg_enabled = 0;
+	target->ringbuf         = NULL;
+	target->coverage        = NULL;
 
 	target->endianness = TARGET_ENDIAN_UNKNOWN;
 
@@ -5688,7 +6019,11 @@ static const struct command_registration target_command_handlers[] = {
 
 int target_register_commands(struct command_context *cmd_ctx)
 {
-	return register_commands(cmd_ctx, NULL, target_command_handlers);
+	int retval = register_commands(cmd_ctx, NULL, target_command_handlers);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return image_register_commands(cmd_ctx);
 }
 
 static bool target_reset_nag = true;
@@ -6067,6 +6402,20 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "remove breakpoint",
 		.usage = "address",
 	},
+	{
+		.name = "bp_multi",
+		.handler = handle_bp_multi_command,
+		.mode = COMMAND_EXEC,
+		.help = "set many hardware or software breakpoints at once",
+		.usage = "<length> <address> [<address> ...] ['hw']",
+	},
+	{
+		.name = "rbp_multi",
+		.handler = handle_rbp_multi_command,
+		.mode = COMMAND_EXEC,
+		.help = "remove many breakpoints at once",
+		.usage = "address [address ...]",
+	},
 	{
 		.name = "wp",
 		.handler = handle_wp_command,
@@ -6100,6 +6449,14 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.mode = COMMAND_EXEC,
 		.usage = "filename [offset [type]]",
 	},
+	{
+		.name = "checksum_memory",
+		.handler = handle_checksum_memory_command,
+		.mode = COMMAND_EXEC,
+		.usage = "['crc32'|'sha256'] address length",
+		.help = "Compute the CRC32 (default) or SHA-256 of target memory, "
+			"on the target where supported, and report the time taken",
+	},
 	{
 		.name = "test_image",
 		.handler = handle_test_image_command,
@@ -6158,6 +6515,10 @@ static int target_register_user_commands(struct command_context *cmd_ctx)
 	if (retval != ERROR_OK)
 		return retval;
 
+	retval = coverage_register_commands(cmd_ctx);
+	if (retval != ERROR_OK)
+		return retval;
+
 
 	return register_commands(cmd_ctx, NULL, target_exec_command_handlers);
 }
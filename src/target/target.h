@@ -42,6 +42,9 @@ struct mem_param;
 struct reg_param;
 struct target_list;
 struct gdb_fileio_info;
+struct target_ringbuf;
+struct breakpoint_index;
+struct target_coverage;
 
 /*
  * TARGET_UNKNOWN = 0: we don't know anything about the target yet
@@ -165,10 +168,13 @@ struct target {
 	enum target_state state;			/* the current backend-state (running, halted, ...) */
 	struct reg_cache *reg_cache;		/* the first register cache of the target (core regs) */
 	struct breakpoint *breakpoints;		/* list of breakpoints */
+	struct breakpoint_index *breakpoint_index;	/* breakpoints by address */
 	struct watchpoint *watchpoints;		/* list of watchpoints */
 	struct trace *trace_info;			/* generic trace information */
 	struct debug_msg_receiver *dbgmsg;	/* list of debug message receivers */
 	uint32_t dbg_msg_enabled;			/* debug message status */
+	struct target_ringbuf *ringbuf;		/* RAM ring buffer message channel */
+	struct target_coverage *coverage;	/* breakpoint based code coverage */
 	void *arch_info;					/* architecture specific information */
 	struct target *next;				/* next target in list */
 
@@ -401,6 +407,23 @@ int target_add_hybrid_breakpoint(struct target *target,
 
 int target_remove_breakpoint(struct target *target,
 		struct breakpoint *breakpoint);
+/**
+ * Add @a count breakpoints for @a target, storing the result for each
+ * in @a results.
+ *
+ * This routine is a wrapper for target->type->add_breakpoints, falling
+ * back to target->type->add_breakpoint.
+ */
+int target_add_breakpoints(struct target *target,
+		struct breakpoint **breakpoints, int count, int *results);
+/**
+ * Remove @a count breakpoints for @a target.
+ *
+ * This routine is a wrapper for target->type->remove_breakpoints,
+ * falling back to target->type->remove_breakpoint.
+ */
+int target_remove_breakpoints(struct target *target,
+		struct breakpoint **breakpoints, int count);
 /**
  * Add the @a watchpoint for @a target.
  *
@@ -484,6 +507,13 @@ int target_run_flash_async_algorithm(struct target *target,
 		uint32_t buffer_start, uint32_t buffer_size,
 		uint32_t entry_point, uint32_t exit_point,
 		void *arch_info);
+int target_run_flash_async_algorithm_timeout(struct target *target,
+		const uint8_t *buffer, uint32_t count, int block_size,
+		int num_mem_params, struct mem_param *mem_params,
+		int num_reg_params, struct reg_param *reg_params,
+		uint32_t buffer_start, uint32_t buffer_size,
+		uint32_t entry_point, uint32_t exit_point, int timeout_ms,
+		void *arch_info);
 
 /**
  * Read @a count items of @a size bytes from the memory of @a target at
@@ -517,6 +547,29 @@ int target_write_memory(struct target *target,
 int target_write_phys_memory(struct target *target,
 		uint32_t address, uint32_t size, uint32_t count, const uint8_t *buffer);
 
+/**
+ * One access of a sequence run by target_memory_sequence(): @a count
+ * items of @a size bytes at consecutive addresses from @a address.  The
+ * items are written from @a write or, if that is NULL, read into @a read.
+ */
+struct target_memory_op {
+	uint32_t address;
+	uint32_t size;
+	uint32_t count;
+	const uint8_t *write;
+	uint8_t *read;
+};
+
+/**
+ * Performs the @a num_ops accesses in @a ops in order.  Targets which can
+ * queue them as a single batch of debug transactions provide
+ * target->type->memory_sequence; on others each access is done on its own,
+ * and the sequence stops at the first failure.  Reads only hold valid data
+ * once the whole sequence succeeded.
+ */
+int target_memory_sequence(struct target *target,
+		struct target_memory_op *ops, int num_ops);
+
 /*
  * Write to target memory using the virtual address.
  *
@@ -547,6 +600,14 @@ int target_read_buffer(struct target *target,
 		uint64_t address, uint32_t size, uint8_t *buffer);
 int target_checksum_memory(struct target *target,
 		uint32_t address, uint32_t size, uint32_t *crc);
+/**
+ * Computes the SHA-256 digest of @a size bytes at @a address.  Whole
+ * blocks are hashed on the target if its type provides an algorithm;
+ * the rest, or everything when that fails, is read and hashed on the host.
+ * @param digest On success, the 32 byte digest.
+ */
+int target_sha256_memory(struct target *target,
+		uint32_t address, uint32_t size, uint8_t *digest);
 int target_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t size, uint32_t *blank);
 int target_wait_state(struct target *target, enum target_state state, int ms);
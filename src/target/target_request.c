@@ -30,6 +30,7 @@
 
 #include <helper/log.h>
 #include <helper/binarybuffer.h>
+#include <server/server.h>
 
 #include "target.h"
 #include "target_request.h"
@@ -47,12 +48,15 @@ bool target_got_message(void)
 
 static int charmsg_mode;
 
-static int target_asciimsg(struct target *target, uint32_t length)
+static int target_asciimsg(struct target *target, uint32_t length, const uint8_t *data)
 {
-	char *msg = malloc(DIV_ROUND_UP(length + 1, 4) * 4);
+	char *msg = malloc(length + 1);
 	struct debug_msg_receiver *c = target->dbgmsg;
 
-	target->type->target_request_data(target, DIV_ROUND_UP(length, 4), (uint8_t *)msg);
+	if (!msg)
+		return ERROR_FAIL;
+
+	memcpy(msg, data, length);
 	msg[length] = 0;
 
 	LOG_DEBUG("%s", msg);
@@ -62,6 +66,8 @@ static int target_asciimsg(struct target *target, uint32_t length)
 		c = c->next;
 	}
 
+	free(msg);
+
 	return ERROR_OK;
 }
 
@@ -72,9 +78,8 @@ static int target_charmsg(struct target *target, uint8_t msg)
 	return ERROR_OK;
 }
 
-static int target_hexmsg(struct target *target, int size, uint32_t length)
+static int target_hexmsg(struct target *target, int size, uint32_t length, const uint8_t *data)
 {
-	uint8_t *data = malloc(DIV_ROUND_UP(length * size, 4) * 4);
 	char line[128];
 	int line_len;
 	struct debug_msg_receiver *c = target->dbgmsg;
@@ -82,8 +87,6 @@ static int target_hexmsg(struct target *target, int size, uint32_t length)
 
 	LOG_DEBUG("size: %i, length: %i", (int)size, (int)length);
 
-	target->type->target_request_data(target, DIV_ROUND_UP(length * size, 4), (uint8_t *)data);
-
 	line_len = 0;
 	for (i = 0; i < length; i++) {
 		switch (size) {
@@ -110,19 +113,29 @@ static int target_hexmsg(struct target *target, int size, uint32_t length)
 		}
 	}
 
-	free(data);
-
 	return ERROR_OK;
 }
 
-/* handle requests from the target received by a target specific
- * side-band channel (e.g. ARM7/9 DCC)
- */
-int target_request(struct target *target, uint32_t request)
+/* number of 32-bit data words following a request word */
+static uint32_t target_request_data_words(uint32_t request)
 {
-	target_req_cmd_t target_req_cmd = request & 0xff;
+	uint32_t size = (request & 0xff00) >> 8;
+	uint32_t length = (request & 0xffff0000) >> 16;
 
-	assert(target->type->target_request_data);
+	if (charmsg_mode || (request & 0xff) != TARGET_REQ_DEBUGMSG)
+		return 0;
+
+	if (size == 0)
+		return DIV_ROUND_UP(length, 4);
+	return DIV_ROUND_UP(length * size, 4);
+}
+
+/* handle a request word whose data words (if any) have already been
+ * received, as little endian bytes */
+static int target_request_dispatch(struct target *target, uint32_t request,
+		const uint8_t *data)
+{
+	target_req_cmd_t target_req_cmd = request & 0xff;
 
 	/* Record that we got a target message for back-off algorithm */
 	got_message = true;
@@ -138,9 +151,9 @@ int target_request(struct target *target, uint32_t request)
 			break;
 		case TARGET_REQ_DEBUGMSG:
 			if (((request & 0xff00) >> 8) == 0)
-				target_asciimsg(target, (request & 0xffff0000) >> 16);
+				target_asciimsg(target, (request & 0xffff0000) >> 16, data);
 			else
-				target_hexmsg(target, (request & 0xff00) >> 8, (request & 0xffff0000) >> 16);
+				target_hexmsg(target, (request & 0xff00) >> 8, (request & 0xffff0000) >> 16, data);
 			break;
 		case TARGET_REQ_DEBUGCHAR:
 			target_charmsg(target, (request & 0x00ff0000) >> 16);
@@ -156,6 +169,306 @@ int target_request(struct target *target, uint32_t request)
 	return ERROR_OK;
 }
 
+/* handle requests from the target received by a target specific
+ * side-band channel (e.g. ARM7/9 DCC)
+ */
+int target_request(struct target *target, uint32_t request)
+{
+	uint32_t words = target_request_data_words(request);
+	uint8_t *data = NULL;
+	int retval;
+
+	assert(target->type->target_request_data);
+
+	if (words) {
+		data = malloc(words * 4);
+		if (!data)
+			return ERROR_FAIL;
+
+		retval = target->type->target_request_data(target, words, data);
+		if (retval != ERROR_OK) {
+			free(data);
+			return retval;
+		}
+	}
+
+	retval = target_request_dispatch(target, request, data);
+	free(data);
+
+	return retval;
+}
+
+/*
+ * RAM ring buffer message channel.
+ *
+ * Instead of pushing libdcc words one at a time through the DCC, target
+ * firmware may append them to a ring buffer in RAM described by a
+ * control block of five 32-bit words (in target byte order):
+ *
+ *   0x00  magic, TARGET_RINGBUF_MAGIC
+ *   0x04  address of the data area
+ *   0x08  size of the data area in bytes, a multiple of 4
+ *   0x0c  write offset, advanced by the target after storing a word
+ *   0x10  read offset, advanced by the host after consuming data
+ *
+ * The ring is empty when both offsets are equal, so the target must
+ * leave one word unused.  A timer callback drains everything available
+ * with (at most) two bulk reads, forwards the raw bytes to an optional
+ * TCP port and feeds complete requests to the usual message handlers.
+ */
+#define TARGET_RINGBUF_MAGIC		0x52494e47	/* "RING" */
+#define TARGET_RINGBUF_CTRL_SIZE	0x14
+#define TARGET_RINGBUF_WR_OFFSET	0x0c
+#define TARGET_RINGBUF_RD_OFFSET	0x10
+
+/* a debug message carries at most 0xffff 32-bit words; longer requests
+ * mean the stream is corrupt */
+#define TARGET_RINGBUF_MAX_WORDS	0xffff
+
+/* raw stream port of one target, owned (and freed) by its service */
+struct target_ringbuf_service {
+	struct connection *connection;
+};
+
+struct target_ringbuf {
+	bool enabled;
+	uint32_t control;		/* address of the control block */
+	uint32_t buffer;		/* address of the data area */
+	uint32_t size;			/* size of the data area */
+	uint32_t rd;			/* our copy of the read offset */
+	int interval;			/* polling interval in ms */
+
+	uint8_t *pending;		/* drained bytes not yet handled */
+	uint32_t pending_len;
+	uint32_t pending_size;
+
+	struct target_ringbuf_service *service;	/* NULL without a port */
+};
+
+/* port for the next target's raw stream */
+static char *ringbuf_port;
+
+static int target_ringbuf_new_connection(struct connection *connection)
+{
+	struct target_ringbuf_service *service = connection->service->priv;
+
+	service->connection = connection;
+	return ERROR_OK;
+}
+
+static int target_ringbuf_input(struct connection *connection)
+{
+	uint8_t buffer[64];
+	int bytes_read;
+
+	/* the channel is target-to-host only, discard whatever we get */
+	bytes_read = connection_read(connection, buffer, sizeof(buffer));
+	if (bytes_read == 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	else if (bytes_read == -1) {
+		LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	return ERROR_OK;
+}
+
+static int target_ringbuf_connection_closed(struct connection *connection)
+{
+	struct target_ringbuf_service *service = connection->service->priv;
+
+	if (service->connection == connection)
+		service->connection = NULL;
+	return ERROR_OK;
+}
+
+static int target_ringbuf_poll(void *priv);
+
+/* stop draining; the port (if any) stays open for the next enable */
+static void target_ringbuf_disable(struct target *target)
+{
+	struct target_ringbuf *rb = target->ringbuf;
+
+	if (!rb || !rb->enabled)
+		return;
+
+	target_unregister_timer_callback(target_ringbuf_poll, target);
+	rb->enabled = false;
+
+	free(rb->pending);
+	rb->pending = NULL;
+	rb->pending_len = 0;
+	rb->pending_size = 0;
+}
+
+/* hand every complete request in the pending bytes to the handlers */
+static void target_ringbuf_parse(struct target *target, struct target_ringbuf *rb)
+{
+	uint32_t pos = 0;
+
+	while (rb->pending_len - pos >= 4) {
+		uint8_t *p = rb->pending + pos;
+		uint32_t request = target_buffer_get_u32(target, p);
+		uint32_t words = target_request_data_words(request);
+		uint32_t i;
+
+		if (words > TARGET_RINGBUF_MAX_WORDS) {
+			LOG_ERROR("invalid ring buffer request 0x%8.8" PRIx32
+					", dropping %" PRIu32 " bytes",
+					request, rb->pending_len - pos);
+			pos = rb->pending_len;
+			break;
+		}
+
+		if (rb->pending_len - pos - 4 < words * 4)
+			break;
+
+		/* the handlers expect little endian data words */
+		for (i = 0; i < words; i++)
+			h_u32_to_le(p + 4 + 4 * i, target_buffer_get_u32(target, p + 4 + 4 * i));
+
+		target_request_dispatch(target, request, words ? p + 4 : NULL);
+		pos += 4 + 4 * words;
+	}
+
+	rb->pending_len -= pos;
+	memmove(rb->pending, rb->pending + pos, rb->pending_len);
+}
+
+static int target_ringbuf_poll(void *priv)
+{
+	struct target *target = priv;
+	struct target_ringbuf *rb = target->ringbuf;
+	uint32_t wr, avail, chunk;
+	uint8_t *dst;
+	int retval;
+
+	if (!rb || !rb->enabled || !target_was_examined(target))
+		return ERROR_OK;
+
+	/* cores that can't access memory while running just fail here;
+	 * we'll catch up once they halt */
+	retval = target_read_u32(target, rb->control + TARGET_RINGBUF_WR_OFFSET, &wr);
+	if (retval != ERROR_OK)
+		return ERROR_OK;
+
+	if (wr >= rb->size || (wr & 3)) {
+		LOG_ERROR("ring buffer write offset 0x%" PRIx32 " is invalid, disabling", wr);
+		target_ringbuf_disable(target);
+		return ERROR_FAIL;
+	}
+
+	if (wr == rb->rd)
+		return ERROR_OK;
+
+	/* pending holds less than one request, so this stays below the ring
+	 * size plus TARGET_RINGBUF_MAX_WORDS + 1 words */
+	avail = (wr + rb->size - rb->rd) % rb->size;
+	if (rb->pending_len + avail > rb->pending_size) {
+		uint8_t *pending = realloc(rb->pending, rb->pending_len + avail);
+		if (!pending)
+			return ERROR_FAIL;
+		rb->pending = pending;
+		rb->pending_size = rb->pending_len + avail;
+	}
+
+	/* at most two reads: up to the end of the ring, then from its start */
+	dst = rb->pending + rb->pending_len;
+	chunk = MIN(avail, rb->size - rb->rd);
+	retval = target_read_buffer(target, rb->buffer + rb->rd, chunk, dst);
+	if (retval == ERROR_OK && avail > chunk)
+		retval = target_read_buffer(target, rb->buffer, avail - chunk, dst + chunk);
+	if (retval != ERROR_OK)
+		return retval;
+
+	rb->rd = wr;
+	retval = target_write_u32(target, rb->control + TARGET_RINGBUF_RD_OFFSET, rb->rd);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (rb->service && rb->service->connection)
+		connection_write(rb->service->connection, dst, avail);
+
+	rb->pending_len += avail;
+	target_ringbuf_parse(target, rb);
+
+	return ERROR_OK;
+}
+
+static int target_ringbuf_enable(struct command_context *cmd_ctx,
+		struct target *target, uint32_t control, int interval)
+{
+	uint8_t ctrl[TARGET_RINGBUF_CTRL_SIZE];
+	uint32_t magic, buffer, size, rd;
+	struct target_ringbuf *rb;
+	int retval;
+
+	retval = target_read_buffer(target, control, sizeof(ctrl), ctrl);
+	if (retval != ERROR_OK)
+		return retval;
+
+	magic = target_buffer_get_u32(target, ctrl);
+	buffer = target_buffer_get_u32(target, ctrl + 4);
+	size = target_buffer_get_u32(target, ctrl + 8);
+	rd = target_buffer_get_u32(target, ctrl + TARGET_RINGBUF_RD_OFFSET);
+
+	if (magic != TARGET_RINGBUF_MAGIC) {
+		command_print(cmd_ctx, "no ring buffer control block at 0x%8.8" PRIx32
+				" (magic 0x%8.8" PRIx32 ")", control, magic);
+		return ERROR_FAIL;
+	}
+
+	if (size < 8 || (size & 3) || rd >= size || (rd & 3)) {
+		command_print(cmd_ctx, "invalid ring buffer size %" PRIu32
+				" or read offset %" PRIu32, size, rd);
+		return ERROR_FAIL;
+	}
+
+	rb = target->ringbuf;
+	if (!rb) {
+		rb = calloc(1, sizeof(*rb));
+		if (!rb)
+			return ERROR_FAIL;
+		target->ringbuf = rb;
+	}
+
+	/* one port per target, numbered upwards like the GDB ports */
+	if (!rb->service && strcmp(ringbuf_port, "disabled") != 0) {
+		struct target_ringbuf_service *service = calloc(1, sizeof(*service));
+		if (!service)
+			return ERROR_FAIL;
+
+		retval = add_service("ringbuf", ringbuf_port, 1,
+				target_ringbuf_new_connection, target_ringbuf_input,
+				target_ringbuf_connection_closed, service);
+		if (retval != ERROR_OK) {
+			free(service);
+			return retval;
+		}
+		rb->service = service;
+
+		long portnumber;
+		char *end;
+		portnumber = strtol(ringbuf_port, &end, 0);
+		if (!*end && parse_long(ringbuf_port, &portnumber) == ERROR_OK) {
+			free(ringbuf_port);
+			ringbuf_port = alloc_printf("%ld", portnumber + 1);
+		}
+	}
+
+	rb->control = control;
+	rb->buffer = buffer;
+	rb->size = size;
+	rb->rd = rd;
+	rb->interval = interval;
+
+	retval = target_register_timer_callback(target_ringbuf_poll, interval, 1, target);
+	if (retval == ERROR_OK)
+		rb->enabled = true;
+	return retval;
+}
+
+
 static int add_debug_msg_receiver(struct command_context *cmd_ctx, struct target *target)
 {
 	struct debug_msg_receiver **p = &target->dbgmsg;
@@ -290,6 +603,48 @@ COMMAND_HANDLER(handle_target_request_debugmsgs_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_target_request_ringbuf_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	uint32_t control;
+	int interval = 10;
+	int retval;
+
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1 && !strcmp(CMD_ARGV[0], "off")) {
+		target_ringbuf_disable(target);
+	} else if (CMD_ARGC > 0) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], control);
+		if (CMD_ARGC > 1) {
+			COMMAND_PARSE_NUMBER(int, CMD_ARGV[1], interval);
+			if (interval <= 0)
+				return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+
+		target_ringbuf_disable(target);
+		retval = target_ringbuf_enable(CMD_CTX, target, control, interval);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (target->ringbuf && target->ringbuf->enabled)
+		command_print(CMD_CTX, "ring buffer at 0x%8.8" PRIx32 ", %" PRIu32
+				" bytes, polled every %i ms",
+				target->ringbuf->control, target->ringbuf->size,
+				target->ringbuf->interval);
+	else
+		command_print(CMD_CTX, "ring buffer disabled");
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_target_request_ringbuf_port_command)
+{
+	return CALL_COMMAND_HANDLER(server_pipe_command, &ringbuf_port);
+}
+
 static const struct command_registration target_req_exec_command_handlers[] = {
 	{
 		.name = "debugmsgs",
@@ -298,6 +653,22 @@ static const struct command_registration target_req_exec_command_handlers[] = {
 		.help = "display and/or modify reception of debug messages from target",
 		.usage = "['enable'|'charmsg'|'disable']",
 	},
+	{
+		.name = "ringbuf",
+		.handler = handle_target_request_ringbuf_command,
+		.mode = COMMAND_EXEC,
+		.help = "display or configure draining of target messages "
+			"from a RAM ring buffer",
+		.usage = "[control_address [poll_ms] | 'off']",
+	},
+	{
+		.name = "ringbuf_port",
+		.handler = handle_target_request_ringbuf_port_command,
+		.mode = COMMAND_ANY,
+		.help = "Specify port on which to forward the raw ring buffer "
+			"stream, or 'disabled'.",
+		.usage = "[port_num]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 static const struct command_registration target_req_command_handlers[] = {
@@ -313,5 +684,19 @@ static const struct command_registration target_req_command_handlers[] = {
 
 int target_request_register_commands(struct command_context *cmd_ctx)
 {
+	ringbuf_port = strdup("disabled");
 	return register_commands(cmd_ctx, NULL, target_req_command_handlers);
 }
+
+void target_request_quit(void)
+{
+	for (struct target *target = all_targets; target; target = target->next) {
+		target_ringbuf_disable(target);
+		/* the port's state went with the services */
+		free(target->ringbuf);
+		target->ringbuf = NULL;
+	}
+
+	free(ringbuf_port);
+	ringbuf_port = NULL;
+}
@@ -46,6 +46,11 @@ int target_request(struct target *target, uint32_t request);
 int delete_debug_msg_receiver(struct command_context *cmd_ctx,
 		struct target *target);
 int target_request_register_commands(struct command_context *cmd_ctx);
+/**
+ * Stop all RAM ring buffer channels and free their state.  Called on
+ * exit, after the servers have been shut down.
+ */
+void target_request_quit(void);
 /**
  * Read and clear the flag as to whether we got a message.
  *
@@ -30,6 +30,7 @@
 #include <jim-nvp.h>
 
 struct target;
+struct target_memory_op;
 
 /**
  * This holds methods shared between all instances of a given target
@@ -140,6 +141,14 @@ struct target_type {
 			uint32_t count, uint32_t *checksum);
 	int (*blank_check_memory)(struct target *target, uint32_t address,
 			uint32_t count, uint32_t *blank);
+	/**
+	 * Optional. Updates the SHA-256 @a state (8 words) with @a blocks
+	 * 64 byte blocks of memory at @a address, by running code on the
+	 * target.  Used by target_sha256_memory(), which falls back to
+	 * reading the memory when this is missing or fails.
+	 */
+	int (*sha256_memory)(struct target *target, uint32_t address,
+			uint32_t blocks, uint32_t *state);
 
 	/*
 	 * target break-/watchpoint control
@@ -163,6 +172,16 @@ struct target_type {
 	 */
 	int (*remove_breakpoint)(struct target *target, struct breakpoint *breakpoint);
 
+	/* optional bulk versions of add_breakpoint() and remove_breakpoint()
+	 * which batch the debug transactions; add_breakpoints() stores the
+	 * outcome for each breakpoint in results[].  Targets without them get
+	 * one add_breakpoint()/remove_breakpoint() call per breakpoint.
+	 */
+	int (*add_breakpoints)(struct target *target,
+			struct breakpoint **breakpoints, int count, int *results);
+	int (*remove_breakpoints)(struct target *target,
+			struct breakpoint **breakpoints, int count);
+
 	/* add watchpoint ... see add_breakpoint() comment above. */
 	int (*add_watchpoint)(struct target *target, struct watchpoint *watchpoint);
 
@@ -194,6 +213,23 @@ struct target_type {
 			struct reg_param *reg_param, uint32_t exit_point,
 			int timeout_ms, void *arch_info);
 
+	/* optional method for target_run_flash_async_algorithm(): writes
+	 * size bytes of data to the algorithm's fifo at address, stores the
+	 * new write pointer wp at wp_addr and reads the read pointer at
+	 * rp_addr, all in a single batch of debug transactions.  Targets
+	 * without it get three separate memory accesses.
+	 */
+	int (*refill_fifo)(struct target *target, uint32_t address,
+			uint32_t size, const uint8_t *buffer, uint32_t wp_addr,
+			uint32_t wp, uint32_t rp_addr, uint32_t *rp);
+
+	/* optional method for target_memory_sequence(): performs a list of
+	 * memory reads and writes in order, queued as a single batch of debug
+	 * transactions.  Targets without it get one memory access per entry.
+	 */
+	int (*memory_sequence)(struct target *target,
+			struct target_memory_op *ops, int num_ops);
+
 	const struct command_registration *commands;
 
 	/* called when target is created */
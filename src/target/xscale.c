@@ -3706,6 +3706,7 @@ struct target_type xscale_target = {
 	.write_phys_memory = xscale_write_phys_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.sha256_memory = arm_sha256_memory,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
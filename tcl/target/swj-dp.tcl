@@ -32,5 +32,7 @@ proc swj_newdap {chip tag args} {
      eval swd newdap $chip $tag $args
  } elseif [string equal [transport select] "cmsis-dap"] {
      eval cmsis-dap newdap $chip $tag $args
+ } elseif [string equal [transport select] "dap_direct"] {
+     eval dap_direct newdap $chip $tag $args
  }
 }